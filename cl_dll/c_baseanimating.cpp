@@ -40,11 +40,14 @@
 #include "c_fire_smoke.h"
 #include "input.h"
 #include "soundinfo.h"
+#include "clientleafsystem.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
 
 static ConVar cl_SetupAllBones( "cl_SetupAllBones", "0" );
+static ConVar cl_bonesetup_prepass( "cl_bonesetup_prepass", "0", 0, "Set up bones for the models in each view in one pass, grouped by model, before drawing them." );
+static ConVar cl_bonesetup_stats( "cl_bonesetup_stats", "0", 0, "Show how many SetupBones calls built bones and how many used the cache each frame." );
 ConVar r_sequence_debug( "r_sequence_debug", "" );
 
 // If an NPC is moving faster than this, he should play the running footstep sound
@@ -579,6 +582,15 @@ void C_ClientRagdoll::Release( void )
 // was last time they setup their bones to determine if they need to re-setup their bones.
 static unsigned long	g_iModelBoneCounter = 0;
 
+// True while SetupBonesForRenderList runs. Those calls only replay last frame's request, so
+// they mustn't count as this frame asking for bones.
+static bool g_bInBoneSetupPrepass = false;
+
+// Per-frame SetupBones counters, reported by cl_bonesetup_stats.
+static int	g_nBoneSetupBuilt = 0;
+static int	g_nBoneSetupCached = 0;
+static int	g_nBoneSetupPrepass = 0;
+
 // -----------------------------------------------------------------------------
 // CSequenceTransitioner implementation.
 // -----------------------------------------------------------------------------
@@ -2067,7 +2079,10 @@ bool C_BaseAnimating::SetupBones( matrix3x4_t *pBoneToWorldOut, int nMaxBones, i
 	}
 
 	// Keep track of everthing asked for over the entire frame
-	m_iAccumulatedBoneMask |= boneMask;
+	if ( !g_bInBoneSetupPrepass )
+	{
+		m_iAccumulatedBoneMask |= boneMask;
+	}
 
 	// Make sure that we know that we've already calculated some bone stuff this time around.
 	m_iMostRecentModelBoneCounter = g_iModelBoneCounter;
@@ -2134,6 +2149,12 @@ bool C_BaseAnimating::SetupBones( matrix3x4_t *pBoneToWorldOut, int nMaxBones, i
 		{
 			SetupBones_AttachmentHelper();
 		}
+
+		++g_nBoneSetupBuilt;
+	}
+	else
+	{
+		++g_nBoneSetupCached;
 	}
 
 
@@ -2260,6 +2281,83 @@ void C_BaseAnimating::InvalidateBoneCaches()
 	g_iModelBoneCounter++;
 }
 
+static int BoneSetupSortFn( C_BaseAnimating * const *ppLeft, C_BaseAnimating * const *ppRight )
+{
+	// Group by model so each studiohdr is walked while it's still warm
+	const model_t *pLeftModel = (*ppLeft)->GetModel();
+	const model_t *pRightModel = (*ppRight)->GetModel();
+	if ( pLeftModel != pRightModel )
+		return ( pLeftModel < pRightModel ) ? -1 : 1;
+
+	return (*ppLeft)->entindex() - (*ppRight)->entindex();
+}
+
+// (static function)
+void C_BaseAnimating::UpdateBoneSetupStats()
+{
+	if ( cl_bonesetup_stats.GetBool() )
+	{
+		engine->Con_NPrintf( 20, "SetupBones: %4d built (%4d in pre-pass), %4d cached", 
+			g_nBoneSetupBuilt, g_nBoneSetupPrepass, g_nBoneSetupCached );
+	}
+	g_nBoneSetupBuilt = 0;
+	g_nBoneSetupCached = 0;
+	g_nBoneSetupPrepass = 0;
+}
+
+// (static function)
+void C_BaseAnimating::SetupBonesForRenderList( const CRenderList &renderList )
+{
+	if ( !cl_bonesetup_prepass.GetBool() )
+		return;
+
+	VPROF_BUDGET( "C_BaseAnimating::SetupBonesForRenderList", VPROF_BUDGETGROUP_CLIENT_ANIMATION );
+
+	// Only the entities that are about to be drawn, and only the ones we know the bone
+	// mask for because they set up bones before. View models move after the view is set
+	// up, so leave them alone.
+	static const int s_EntityGroups[] = { RENDER_GROUP_OPAQUE_ENTITY, RENDER_GROUP_TRANSLUCENT_ENTITY };
+
+	CUtlVector< C_BaseAnimating * > entities;
+	for ( int iGroup = 0; iGroup < ARRAYSIZE( s_EntityGroups ); iGroup++ )
+	{
+		const CRenderList::CEntry *pEntries = renderList.m_RenderGroups[ s_EntityGroups[iGroup] ];
+		int nCount = renderList.m_RenderGroupCounts[ s_EntityGroups[iGroup] ];
+		for ( int i = 0; i < nCount; i++ )
+		{
+			C_BaseEntity *pEnt = pEntries[i].m_pRenderable->GetIClientUnknown()->GetBaseEntity();
+			C_BaseAnimating *pAnimating = pEnt ? pEnt->GetBaseAnimating() : NULL;
+			if ( !pAnimating || !pAnimating->GetModel() || pAnimating->IsViewModel() )
+				continue;
+
+			if ( pAnimating->m_iMostRecentModelBoneCounter == g_iModelBoneCounter || !pAnimating->m_iAccumulatedBoneMask )
+				continue;
+
+			entities.AddToTail( pAnimating );
+		}
+	}
+
+	// Each entity's bones only depend on its own state (followers read their
+	// parent through SetupBones, which is cached either way), so the order
+	// here doesn't change the results.
+	entities.Sort( BoneSetupSortFn );
+
+	// Ask for everything each one asked for over the last frame. SetupBones moves that
+	// into m_iPrevBoneMask as the frame's first call; the pre-pass doesn't add to this
+	// frame's mask. Two pass entities are in both groups, the second SetupBones is skipped.
+	g_bInBoneSetupPrepass = true;
+	for ( int i = 0; i < entities.Count(); i++ )
+	{
+		C_BaseAnimating *pEnt = entities[i];
+		if ( pEnt->m_iMostRecentModelBoneCounter == g_iModelBoneCounter )
+			continue;
+
+		pEnt->SetupBones( NULL, -1, pEnt->m_iAccumulatedBoneMask, gpGlobals->curtime );
+		++g_nBoneSetupPrepass;
+	}
+	g_bInBoneSetupPrepass = false;
+}
+
 
 ConVar r_drawothermodels( "r_drawothermodels", "1", FCVAR_CHEAT );
 
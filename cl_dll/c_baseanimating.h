@@ -36,6 +36,7 @@ class C_BaseClientShader
 
 class IRagdoll;
 class CIKContext;
+class CRenderList;
 class CIKState;
 class ConVar;
 class C_RopeKeyframe;
@@ -322,6 +323,13 @@ public:
 	// Invalidate bone caches so all SetupBones() calls force bone transforms to be regenerated.
 	static void						InvalidateBoneCaches();
 
+	// Shows and resets the per-frame SetupBones counters (cl_bonesetup_stats).
+	static void						UpdateBoneSetupStats();
+
+	// Sets up bones up front, sorted by model, for the entities about to be drawn in a view
+	// so the SetupBones() calls made while rendering hit the cache.
+	static void						SetupBonesForRenderList( const CRenderList &renderList );
+
 	// Purpose: My physics object has been updated, react or extract data
 	virtual void					VPhysicsUpdate( IPhysicsObject *pPhysics );
 
@@ -447,22 +447,29 @@ DECLARE_CLIENT_EFFECT( "ShakeRopes", ShakeRopesCallback );
 // ------------------------------------------------------------------------------------ //
 #define WIND_FORCE_FACTOR 10
 
-void C_RopeKeyframe::CPhysicsDelegate::GetNodeForces( CSimplePhysics::CNode *pNodes, int iNode, Vector *pAccel )
+void C_RopeKeyframe::CPhysicsDelegate::SetupForces()
 {
 	// Gravity.
 	if ( !( m_pKeyframe->GetRopeFlags() & ROPE_NO_GRAVITY ) )
 	{
-		pAccel->Init( ROPE_GRAVITY );
+		m_vGravity.Init( ROPE_GRAVITY );
+	}
+	else
+	{
+		m_vGravity.Init();
 	}
 
-	if( !m_pKeyframe->m_LinksTouchingSomething[iNode] && m_pKeyframe->m_bApplyWind)
+	m_vWindAccel.Init();
+	m_bWind = false;
+
+	if( m_pKeyframe->m_bApplyWind )
 	{
 		Vector vecWindVel;
 		GetWindspeedAtTime(gpGlobals->curtime, vecWindVel);
 		if ( vecWindVel.LengthSqr() > 0 )
 		{
-			Vector vecWindAccel;
-			VectorMA( *pAccel, WIND_FORCE_FACTOR, vecWindVel, *pAccel );
+			m_vWindAccel = vecWindVel * WIND_FORCE_FACTOR;
+			m_bWind = true;
 		}
 		else
 		{
@@ -471,14 +478,28 @@ void C_RopeKeyframe::CPhysicsDelegate::GetNodeForces( CSimplePhysics::CNode *pNo
 				float div = m_pKeyframe->m_flCurrentGustTimer / m_pKeyframe->m_flCurrentGustLifetime;
 				float scale = 1 - cos( div * M_PI );
 
-				*pAccel += m_pKeyframe->m_vWindDir * scale;
+				m_vWindAccel = m_pKeyframe->m_vWindDir * scale;
+				m_bWind = true;
 			}
 		}
 	}
 
+	m_bShake = ( rope_shake.GetInt() != 0 );
+}
+
+
+void C_RopeKeyframe::CPhysicsDelegate::GetNodeForces( CSimplePhysics::CNode *pNodes, int iNode, Vector *pAccel )
+{
+	*pAccel = m_vGravity;
+
+	if( m_bWind && !m_pKeyframe->m_LinksTouchingSomething[iNode] )
+	{
+		*pAccel += m_vWindAccel;
+	}
+
 	// HACK.. shake the rope around.
 	static float scale=15000;
-	if( rope_shake.GetInt() )
+	if( m_bShake )
 	{
 		*pAccel += RandomVector( -scale, scale );
 	}
@@ -909,6 +930,9 @@ void C_RopeKeyframe::RunRopeSimulation( float flSeconds )
 	for ( int i=0; i < m_nSegments; i++ )
 		m_LinksTouchingSomething[i] = false;
 
+	// None of the frame's wind, gravity or shake settings change while we step.
+	m_PhysicsDelegate.SetupForces();
+
 	// Simulate, and it will mark which links touched things.
 	m_RopePhysics.Simulate( flSeconds );
 
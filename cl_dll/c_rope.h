@@ -42,8 +42,16 @@ private:
 	public:
 		virtual void	GetNodeForces( CSimplePhysics::CNode *pNodes, int iNode, Vector *pAccel );
 		virtual void	ApplyConstraints( CSimplePhysics::CNode *pNodes, int nNodes );
+
+		// Work out the forces that are the same for every node this frame.
+		void			SetupForces();
 	
 		C_RopeKeyframe	*m_pKeyframe;
+
+		Vector			m_vGravity;
+		Vector			m_vWindAccel;	// Wind or gust, for nodes that aren't touching anything.
+		bool			m_bWind;
+		bool			m_bShake;
 	};
 
 	friend class CPhysicsDelegate;
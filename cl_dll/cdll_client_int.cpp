@@ -1220,6 +1220,8 @@ void OnRenderStart()
 	// their positions so they're in the leaf system correctly.
 	C_BaseEntity::CalcAimEntPositions();
 
+	C_BaseAnimating::UpdateBoneSetupStats();
+
 	// Finally, link all the entities into the leaf system right before rendering.
 	C_BaseEntity::AddVisibleEntities();
 }
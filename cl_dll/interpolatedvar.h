@@ -10,7 +10,7 @@
 #pragma once
 #endif
 
-#include "utlfixedlinkedlist.h"
+#include "utlmemory.h"
 #include "rangecheckedvar.h"
 #include "lerp_functions.h"
 #include "animationlayer.h"
@@ -27,6 +27,11 @@
 
 
 
+#define INTERPOLATED_VAR_INITIAL_HISTORY	4		// Samples allocated with a var's first sample. The ring
+													// doubles when it fills, so no sample is ever dropped.
+
+#define INTERPOLATED_VAR_INVALID_INDEX	-1
+
 #define EXTRA_INTERPOLATION_HISTORY_STORED 0.05f	// It stores this much extra interpolation history,
 													// so you can always call Interpolate() this far
 													// in the past from your last call and be able to 
@@ -270,9 +275,16 @@ protected:
 	
 	bool ValidOrder();
 
-	// Get the next element in VarHistory, or just return i if it's an invalid index.
+	// Get the next element in the history, or just return i if it's an invalid index.
 	int SafeNext( int i );
 
+	// The history is a ring of slots, newest first. Slot indices stay valid until the
+	// history is next changed, so they're what GetHead/GetNext hand out.
+	int HistorySlot( int iPosition ) const;		// slot of the Nth newest sample
+	int HistoryPosition( int iSlot ) const;		// how many samples are newer than this slot
+	void GrowHistory();
+	void UpdateAnyLooping();
+
 
 protected:
 
@@ -282,19 +294,15 @@ protected:
 	Type								m_LastNetworkedValue[ COUNT ];
 	float								m_LastNetworkedTime;
 	int									m_fType;
-	int									m_ListHead;
+	int									m_iHistoryHead;		// slot of the newest sample
+	int									m_nHistoryCount;
 	bool								m_bLooping[ COUNT ];
+	bool								m_bAnyLooping;		// any of m_bLooping set, otherwise the array kernels are used
 	int									m_nMaxCount;
 	float								m_InterpolationAmount;
 	const char *m_pDebugName;
 
-	typedef CUtlFixedLinkedList< CInterpolatedVarEntry > VarHistoryType;
-
-	static VarHistoryType& VarHistory()
-	{
-		static CUtlFixedLinkedList< CInterpolatedVarEntry > ret;
-		return ret;
-	}
+	CUtlMemory< CInterpolatedVarEntry >	m_VarHistory;
 };
 
 
@@ -305,8 +313,10 @@ inline CInterpolatedVarArray<Type,COUNT>::CInterpolatedVarArray( const char *pDe
 	m_pValue = NULL;
 	m_fType = LATCH_ANIMATION_VAR;
 	m_InterpolationAmount = 0.0f;
-	m_ListHead = VarHistory().InvalidIndex();
+	m_iHistoryHead = 0;
+	m_nHistoryCount = 0;
 	memset( m_bLooping, 0x00, sizeof( m_bLooping ) );
+	m_bAnyLooping = false;
 	m_nMaxCount = COUNT;
 	memset( m_LastNetworkedValue, 0, sizeof( m_LastNetworkedValue ) );
 	m_LastNetworkedTime = 0;
@@ -369,87 +379,96 @@ inline void CInterpolatedVarArray<Type,COUNT>::RestoreToLastNetworked()
 }
 
 template< typename Type, const int COUNT >
-inline void CInterpolatedVarArray<Type,COUNT>::ClearHistory()
+inline int CInterpolatedVarArray<Type,COUNT>::HistorySlot( int iPosition ) const
+{
+	int iSlot = m_iHistoryHead + iPosition;
+	if ( iSlot >= m_VarHistory.NumAllocated() )
+		iSlot -= m_VarHistory.NumAllocated();
+	return iSlot;
+}
+
+template< typename Type, const int COUNT >
+inline int CInterpolatedVarArray<Type,COUNT>::HistoryPosition( int iSlot ) const
+{
+	int iPosition = iSlot - m_iHistoryHead;
+	if ( iPosition < 0 )
+		iPosition += m_VarHistory.NumAllocated();
+	return iPosition;
+}
+
+template< typename Type, const int COUNT >
+inline void CInterpolatedVarArray<Type,COUNT>::GrowHistory()
+{
+	int nOldSize = m_VarHistory.NumAllocated();
+	m_VarHistory.Grow( max( nOldSize, INTERPOLATED_VAR_INITIAL_HISTORY ) );
+
+	// At least doubled, so the samples that had wrapped around to the front
+	// of the ring now fit right after the old end.
+	for ( int i = 0; i < m_iHistoryHead + m_nHistoryCount - nOldSize; i++ )
+	{
+		m_VarHistory[ nOldSize + i ] = m_VarHistory[ i ];
+	}
+}
+
+template< typename Type, const int COUNT >
+inline void CInterpolatedVarArray<Type,COUNT>::UpdateAnyLooping()
 {
-	while ( m_ListHead != VarHistory().InvalidIndex() )
+	m_bAnyLooping = false;
+	for ( int i = 0; i < COUNT; i++ )
 	{
-		int next = VarHistory().Next( m_ListHead );
-		VarHistory().Free( m_ListHead );
-		m_ListHead = next;
+		m_bAnyLooping = m_bAnyLooping || m_bLooping[i];
 	}
+}
 
-	Assert( m_ListHead == VarHistory().InvalidIndex() );
+template< typename Type, const int COUNT >
+inline void CInterpolatedVarArray<Type,COUNT>::ClearHistory()
+{
+	m_iHistoryHead = 0;
+	m_nHistoryCount = 0;
 }
 
 template< typename Type, const int COUNT >
 inline void CInterpolatedVarArray<Type,COUNT>::AddToHead( float changeTime, const Type* values, bool bFlushNewer )
 {
-	int newslot = VarHistory().Alloc( true );
-	
-	CInterpolatedVarEntry *e = &VarHistory()[ newslot ];
-	e->changetime	= changeTime;
-	memcpy( e->value, values, m_nMaxCount*sizeof(Type) );
+	int insertPos = 0;
 
 	if ( bFlushNewer )
 	{
 		// Get rid of anything that has a timestamp after this sample. The server might have
 		// corrected our clock and moved us back, so our current changeTime is less than a 
 		// changeTime we added samples during previously.
-		int insertSpot = m_ListHead;
-		while ( insertSpot != VarHistory().InvalidIndex() )
-		{
-			int next = VarHistory().Next( insertSpot );
-			CInterpolatedVarEntry *check = &VarHistory()[ insertSpot ];
-			if ( (check->changetime+0.0001f) >= changeTime )
-			{
-				VarHistory().Free( insertSpot );
-				m_ListHead = next;
-				insertSpot = m_ListHead;
-			}
-			else
-			{
-				break;
-			}
-		}
-
-		if ( insertSpot == VarHistory().InvalidIndex() )
+		while ( m_nHistoryCount > 0 && (m_VarHistory[ m_iHistoryHead ].changetime+0.0001f) >= changeTime )
 		{
-			m_ListHead = newslot;
-		}
-		else
-		{
-			VarHistory().LinkBefore( insertSpot, newslot );
-			if ( insertSpot == m_ListHead )
-			{
-				m_ListHead = newslot;
-			}
+			m_iHistoryHead = HistorySlot( 1 );
+			--m_nHistoryCount;
 		}
 	}
 	else
 	{
-		int insertSpot = m_ListHead;
-		while ( insertSpot != VarHistory().InvalidIndex() )
+		// Insert in front of the first sample that isn't newer than this one.
+		while ( insertPos < m_nHistoryCount && m_VarHistory[ HistorySlot( insertPos ) ].changetime > changeTime )
 		{
-			CInterpolatedVarEntry *check = &VarHistory()[ insertSpot ];
-			if ( check->changetime <= changeTime )
-				break;
-
-			int next = VarHistory().Next( insertSpot );
-			if ( next == VarHistory().InvalidIndex() )
-			{
-				VarHistory().LinkAfter( insertSpot, newslot );
-				return;
-			}
-			insertSpot = next;
+			++insertPos;
 		}
+	}
 
-		VarHistory().LinkBefore( insertSpot, newslot );
+	// Full, make room rather than lose a sample that may still be inside the interpolation window
+	if ( m_nHistoryCount == m_VarHistory.NumAllocated() )
+	{
+		GrowHistory();
+	}
 
-		if ( insertSpot == m_ListHead )
-		{
-			m_ListHead = newslot;
-		}
+	// Open up a slot at the head and slide the newer samples forward into it.
+	m_iHistoryHead = HistorySlot( m_VarHistory.NumAllocated() - 1 );
+	++m_nHistoryCount;
+	for ( int i = 0; i < insertPos; i++ )
+	{
+		m_VarHistory[ HistorySlot( i ) ] = m_VarHistory[ HistorySlot( i + 1 ) ];
 	}
+
+	CInterpolatedVarEntry *e = &m_VarHistory[ HistorySlot( insertPos ) ];
+	e->changetime	= changeTime;
+	memcpy( e->value, values, m_nMaxCount*sizeof(Type) );
 }
 
 template< typename Type, const int COUNT >
@@ -470,37 +489,27 @@ inline void CInterpolatedVarArray<Type,COUNT>::Reset()
 template< typename Type, const int COUNT >
 inline float CInterpolatedVarArray<Type,COUNT>::GetOldestEntry()
 {
-	float lastVal = 0;
-	for ( int i = m_ListHead; i != VarHistory().InvalidIndex(); i = VarHistory().Next( i ) )
-	{
-		lastVal = VarHistory()[i].changetime;
-	}
-	return lastVal;
+	if ( m_nHistoryCount == 0 )
+		return 0;
+
+	return m_VarHistory[ HistorySlot( m_nHistoryCount - 1 ) ].changetime;
 }
 
 
 template< typename Type, const int COUNT >
 inline void CInterpolatedVarArray<Type,COUNT>::RemoveOldEntries( float oldesttime )
 {
-	int c = 0;
-	int next = VarHistory().InvalidIndex();
 	// Always leave three of entries in the list...
-	for ( int i = m_ListHead; i != VarHistory().InvalidIndex(); c++, i = next )
-	{
-		next = VarHistory().Next( i );
-
-		// Always leave elements 0 1 and 2 alone...
-		if ( c <= 2 )
-			continue;
-
-		CInterpolatedVarEntry *h = &VarHistory()[ i ];
-		// Remove everything off the end until we find the first one that's not too old
-		if ( h->changetime > oldesttime )
-			continue;
+	int c = 3;
 
-		// Unlink rest of chain
-		VarHistory().Free( i );
+	// The history is sorted newest first, so once we hit one that's too old
+	// everything after it is too.
+	while ( c < m_nHistoryCount && m_VarHistory[ HistorySlot( c ) ].changetime > oldesttime )
+	{
+		++c;
 	}
+
+	m_nHistoryCount = min( m_nHistoryCount, c );
 }
 
 
@@ -518,28 +527,17 @@ template< typename Type, const int COUNT >
 inline void CInterpolatedVarArray<Type,COUNT>::RemoveEntriesPreviousTo( float flTime )
 {
 	// Find the 2 samples spanning this time.
-	for ( int i=m_ListHead; i != VarHistory().InvalidIndex(); i=VarHistory().Next( i ) )
+	for ( int i = 0; i < m_nHistoryCount; i++ )
 	{
-		if ( VarHistory()[i].changetime < flTime )
+		if ( m_VarHistory[ HistorySlot( i ) ].changetime < flTime )
 		{
 			// We need to preserve this sample (ie: the one right before this timestamp)
 			// and the sample right before it (for hermite blending), and we can get rid
-			// of everything else.
-			i = SafeNext( i );
-			i = SafeNext( i );
-			i = SafeNext( i );	// We keep this one for _Derivative_Hermite_SmoothVelocity.
-			
+			// of everything else. We keep one more for _Derivative_Hermite_SmoothVelocity.
+			m_nHistoryCount = min( m_nHistoryCount, i + 3 );
 			break;
 		}
 	}
-
-	// Now remove all samples starting with i.
-	int next;
-	for ( ; i != VarHistory().InvalidIndex(); i=next )
-	{
-		next = VarHistory().Next( i );
-		VarHistory().Free( i );
-	}
 }
 
 
@@ -556,13 +554,13 @@ inline bool CInterpolatedVarArray<Type,COUNT>::GetInterpolationInfo(
 
 	pInfo->m_bHermite = false;
 	pInfo->frac = 0;
-	pInfo->oldest = pInfo->older = pInfo->newer = VarHistory().InvalidIndex();
+	pInfo->oldest = pInfo->older = pInfo->newer = INTERPOLATED_VAR_INVALID_INDEX;
 	
-	for ( i = m_ListHead; i != VarHistory().InvalidIndex(); i = VarHistory().Next( i ) )
+	for ( i = 0; i < m_nHistoryCount; i++ )
 	{
-		pInfo->older = i;
+		pInfo->older = HistorySlot( i );
 		
-		float older_change_time = VarHistory()[ i ].changetime;
+		float older_change_time = m_VarHistory[ pInfo->older ].changetime;
 		if ( older_change_time == 0.0f )
 			break;
 
@@ -572,26 +570,25 @@ inline bool CInterpolatedVarArray<Type,COUNT>::GetInterpolationInfo(
 			continue;
 		}
 
-		if ( pInfo->newer == VarHistory().InvalidIndex() )
+		if ( pInfo->newer == INTERPOLATED_VAR_INVALID_INDEX )
 		{
 			// Have it linear interpolate between the newest 2 entries.
 			pInfo->newer = pInfo->older; 
 			return true;
 		}
 
-		float newer_change_time = VarHistory()[ pInfo->newer ].changetime;
+		float newer_change_time = m_VarHistory[ pInfo->newer ].changetime;
 		float dt = newer_change_time - older_change_time;
 		if ( dt > 0.0001f )
 		{
 			pInfo->frac = ( targettime - older_change_time ) / ( newer_change_time - older_change_time );
 			pInfo->frac = min( pInfo->frac, 2.0f );
 
-			int oldestindex = VarHistory().Next( i );
-
-			if ( !(m_fType & INTERPOLATE_LINEAR_ONLY) && oldestindex != VarHistory().InvalidIndex() )
+			if ( !(m_fType & INTERPOLATE_LINEAR_ONLY) && i + 1 < m_nHistoryCount )
 			{
+				int oldestindex = HistorySlot( i + 1 );
 				pInfo->oldest = oldestindex;
-				float oldest_change_time = VarHistory()[ oldestindex ].changetime;
+				float oldest_change_time = m_VarHistory[ oldestindex ].changetime;
 				float dt2 = older_change_time - oldest_change_time;
 				if ( dt2 > 0.0001f )
 				{
@@ -607,7 +604,7 @@ inline bool CInterpolatedVarArray<Type,COUNT>::GetInterpolationInfo(
 	}
 
 	// Didn't find any, return last entry???
-	if ( pInfo->newer != VarHistory().InvalidIndex() )
+	if ( pInfo->newer != INTERPOLATED_VAR_INVALID_INDEX )
 	{
 		pInfo->older = pInfo->newer;
 		return true;
@@ -615,7 +612,7 @@ inline bool CInterpolatedVarArray<Type,COUNT>::GetInterpolationInfo(
 
 	// This is the single-element case
 	pInfo->newer = pInfo->older;
-	return (pInfo->older != VarHistory().InvalidIndex());
+	return (pInfo->older != INTERPOLATED_VAR_INVALID_INDEX);
 }
 
 
@@ -647,7 +644,7 @@ inline void CInterpolatedVarArray<Type,COUNT>::Interpolate( float currentTime, f
 	if (!GetInterpolationInfo( &info, currentTime, interpolation_amount ))
 		return;
 
-	VarHistoryType &history = VarHistory();
+	CInterpolatedVarEntry *history = m_VarHistory.Base();
 
 	if ( info.m_bHermite )
 	{
@@ -709,11 +706,11 @@ void CInterpolatedVarArray<Type,COUNT>::GetDerivative( Type *pOut, float current
 
 	if ( info.m_bHermite )
 	{
-		_Derivative_Hermite( pOut, info.frac, &VarHistory()[info.oldest], &VarHistory()[info.older], &VarHistory()[info.newer] );
+		_Derivative_Hermite( pOut, info.frac, &m_VarHistory[info.oldest], &m_VarHistory[info.older], &m_VarHistory[info.newer] );
 	}
 	else
 	{
-		_Derivative_Linear( pOut, &VarHistory()[info.older], &VarHistory()[info.newer] );
+		_Derivative_Linear( pOut, &m_VarHistory[info.older], &m_VarHistory[info.newer] );
 	}
 }
 
@@ -725,7 +722,7 @@ void CInterpolatedVarArray<Type,COUNT>::GetDerivative_SmoothVelocity( Type *pOut
 	if (!GetInterpolationInfo( &info, currentTime, m_InterpolationAmount ))
 		return;
 
-	VarHistoryType &history = VarHistory();
+	CInterpolatedVarEntry *history = m_VarHistory.Base();
 	bool bExtrapolate = false;
 	int realOlder = 0;
 	
@@ -812,24 +809,20 @@ inline void CInterpolatedVarArray<Type,COUNT>::Copy( IInterpolatedVar *pInSrc )
 		m_LastNetworkedValue[i] = pSrc->m_LastNetworkedValue[i];
 		m_bLooping[i] = pSrc->m_bLooping[i];
 	}
+	m_bAnyLooping = pSrc->m_bAnyLooping;
 
 	m_LastNetworkedTime = pSrc->m_LastNetworkedTime;
 
 	// Copy the entries.
-	int insertSpot = m_ListHead;
-	while ( insertSpot != VarHistory().InvalidIndex() )
+	m_iHistoryHead = 0;
+	m_nHistoryCount = pSrc->m_nHistoryCount;
+	if ( m_VarHistory.NumAllocated() < m_nHistoryCount )
 	{
-		int next = VarHistory().Next( insertSpot );
-		VarHistory().Free( insertSpot );
-		insertSpot = next;
+		m_VarHistory.EnsureCapacity( m_nHistoryCount );
 	}
-	m_ListHead = VarHistory().InvalidIndex();
-
-	for ( int srcCur=pSrc->m_ListHead; srcCur != pSrc->VarHistory().InvalidIndex(); srcCur = pSrc->VarHistory().Next( srcCur ) )
+	for ( int i=0; i < m_nHistoryCount; i++ )
 	{
-		int iNew = VarHistory().AddToTail( pSrc->VarHistory()[srcCur] );
-		if ( m_ListHead == VarHistory().InvalidIndex() )
-			m_ListHead = iNew;
+		m_VarHistory[i] = pSrc->m_VarHistory[ pSrc->HistorySlot( i ) ];
 	}
 }
 
@@ -839,15 +832,10 @@ inline const Type& CInterpolatedVarArray<Type,COUNT>::GetPrev( int iArrayIndex )
 	Assert( m_pValue );
 	Assert( iArrayIndex >= 0 && iArrayIndex < m_nMaxCount );
 
-	int ihead = m_ListHead;
-	if ( ihead != VarHistory().InvalidIndex() )
+	if ( m_nHistoryCount > 1 )
 	{
-		ihead = VarHistory().Next( ihead );
-		if ( ihead != VarHistory().InvalidIndex() )
-		{
-			CInterpolatedVarEntry const *h = &VarHistory()[ ihead ];
-			return h->value[ iArrayIndex ];
-		}
+		CInterpolatedVarEntry const *h = &m_VarHistory[ HistorySlot( 1 ) ];
+		return h->value[ iArrayIndex ];
 	}
 	return m_pValue[ iArrayIndex ];
 }
@@ -858,10 +846,9 @@ inline const Type& CInterpolatedVarArray<Type,COUNT>::GetCurrent( int iArrayInde
 	Assert( m_pValue );
 	Assert( iArrayIndex >= 0 && iArrayIndex < m_nMaxCount );
 
-	int ihead = m_ListHead;
-	if ( ihead != VarHistory().InvalidIndex() )
+	if ( m_nHistoryCount > 0 )
 	{
-		CInterpolatedVarEntry const *h = &VarHistory()[ ihead ];
+		CInterpolatedVarEntry const *h = &m_VarHistory[ m_iHistoryHead ];
 		return h->value[ iArrayIndex ];
 	}
 	return m_pValue[ iArrayIndex ];
@@ -870,17 +857,12 @@ inline const Type& CInterpolatedVarArray<Type,COUNT>::GetCurrent( int iArrayInde
 template< typename Type, const int COUNT >
 inline float CInterpolatedVarArray<Type,COUNT>::GetInterval() const
 {	
-	int head = m_ListHead;
-	if ( head != VarHistory().InvalidIndex() )
+	if ( m_nHistoryCount > 1 )
 	{
-		int next = VarHistory().Next( head );
-		if ( next != VarHistory().InvalidIndex() )
-		{
-			CInterpolatedVarEntry const *h = &VarHistory()[ head ];
-			CInterpolatedVarEntry const *n = &VarHistory()[ next ];
-			
-			return ( h->changetime - n->changetime );
-		}
+		CInterpolatedVarEntry const *h = &m_VarHistory[ m_iHistoryHead ];
+		CInterpolatedVarEntry const *n = &m_VarHistory[ HistorySlot( 1 ) ];
+		
+		return ( h->changetime - n->changetime );
 	}
 
 	return 0.0f;
@@ -889,20 +871,20 @@ inline float CInterpolatedVarArray<Type,COUNT>::GetInterval() const
 template< typename Type, const int COUNT >
 inline bool	CInterpolatedVarArray<Type,COUNT>::IsValidIndex( int i )
 {
-	return VarHistory().IsValidIndex( i );
+	return ( i >= 0 && i < m_VarHistory.NumAllocated() && HistoryPosition( i ) < m_nHistoryCount );
 }
 
 template< typename Type, const int COUNT >
 inline Type	*CInterpolatedVarArray<Type,COUNT>::GetHistoryValue( int index, float& changetime, int iArrayIndex )
 {
 	Assert( iArrayIndex >= 0 && iArrayIndex < m_nMaxCount );
-	if ( index == VarHistory().InvalidIndex() )
+	if ( !IsValidIndex( index ) )
 	{
 		changetime = 0.0f;
 		return NULL;
 	}
 
-	CInterpolatedVarEntry *entry = &VarHistory()[ index ];
+	CInterpolatedVarEntry *entry = &m_VarHistory[ index ];
 	changetime = entry->changetime;
 	return &entry->value[ iArrayIndex ];
 }
@@ -910,13 +892,15 @@ inline Type	*CInterpolatedVarArray<Type,COUNT>::GetHistoryValue( int index, floa
 template< typename Type, const int COUNT >
 inline int CInterpolatedVarArray<Type,COUNT>::GetHead()
 {
-	return m_ListHead;
+	return ( m_nHistoryCount > 0 ) ? m_iHistoryHead : INTERPOLATED_VAR_INVALID_INDEX;
 }
 
 template< typename Type, const int COUNT >
 inline int CInterpolatedVarArray<Type,COUNT>::GetNext( int i )
 {
-	return VarHistory().Next( i );
+	Assert( IsValidIndex( i ) );
+	int iPosition = HistoryPosition( i ) + 1;
+	return ( iPosition < m_nHistoryCount ) ? HistorySlot( iPosition ) : INTERPOLATED_VAR_INVALID_INDEX;
 }
 
 template< typename Type, const int COUNT >
@@ -924,10 +908,9 @@ inline void CInterpolatedVarArray<Type,COUNT>::SetHistoryValuesForItem( int item
 {
 	Assert( item >= 0 && item < m_nMaxCount );
 
-	int i;
-	for ( i = m_ListHead; i != VarHistory().InvalidIndex(); i = VarHistory().Next( i ) )
+	for ( int i = 0; i < m_nHistoryCount; i++ )
 	{
-		CInterpolatedVarEntry *entry = &VarHistory()[ i ];
+		CInterpolatedVarEntry *entry = &m_VarHistory[ HistorySlot( i ) ];
 		entry->value[ item ] = value;
 	}
 }
@@ -937,6 +920,7 @@ inline void	CInterpolatedVarArray<Type,COUNT>::SetLooping( bool looping, int iAr
 {
 	Assert( iArrayIndex >= 0 && iArrayIndex < m_nMaxCount );
 	m_bLooping[ iArrayIndex ] = looping;
+	UpdateAnyLooping();
 }
 
 template< typename Type, const int COUNT >
@@ -979,6 +963,17 @@ inline void CInterpolatedVarArray<Type,COUNT>::_Interpolate( Type *out, float fr
 
 	Assert( frac >= 0.0f && frac <= 1.0f );
 
+	if ( !m_bAnyLooping )
+	{
+		// Note that QAngle has a specialization that will do quaternion interpolation here...
+		Lerp_Array( frac, start->value, end->value, out, m_nMaxCount );
+		for ( int i = 0; i < m_nMaxCount; i++ )
+		{
+			Lerp_Clamp( out[i] );
+		}
+		return;
+	}
+
 	// Note that QAngle has a specialization that will do quaternion interpolation here...
 	for ( int i = 0; i < m_nMaxCount; i++ )
 	{
@@ -1042,10 +1037,7 @@ inline void CInterpolatedVarArray<Type,COUNT>::TimeFixup2_Hermite(
 		// Fixed interval into past
 		fixup.changetime = start->changetime - dt1;
 
-		for ( int i = 0; i < m_nMaxCount; i++ )
-		{
-			fixup.value[i] = Lerp( 1-frac, prev->value[i], start->value[i] );
-		}
+		Lerp_Array( 1-frac, prev->value, start->value, fixup.value, m_nMaxCount );
 
 		// Point previous sample at fixed version
 		prev = &fixup;
@@ -1083,6 +1075,17 @@ inline void CInterpolatedVarArray<Type,COUNT>::_Interpolate_Hermite(
 	CInterpolatedVarEntry fixup;
 	TimeFixup_Hermite( fixup, prev, start, end );
 
+	if ( !m_bAnyLooping )
+	{
+		// Note that QAngle has a specialization that will do quaternion interpolation here...
+		Lerp_HermiteArray( frac, prev->value, start->value, end->value, out, m_nMaxCount );
+		for( int i = 0; i < m_nMaxCount; i++ )
+		{
+			Lerp_Clamp( out[i] );
+		}
+		return;
+	}
+
 	for( int i = 0; i < m_nMaxCount; i++ )
 	{
 		// Note that QAngle has a specialization that will do quaternion interpolation here...
@@ -1182,7 +1185,7 @@ inline bool CInterpolatedVarArray<Type,COUNT>::ValidOrder()
 	bool first = true;
 	for ( int i = GetHead(); IsValidIndex( i ); i = GetNext( i ) )
 	{
-		CInterpolatedVarEntry *entry = &VarHistory()[ i ];
+		CInterpolatedVarEntry *entry = &m_VarHistory[ i ];
 		if ( first )
 		{
 			first = false;
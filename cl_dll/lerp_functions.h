@@ -144,6 +144,77 @@ inline float LoopingLerp_Hermite( float t, float p0, float p1, float p2 )
 }
 
 
+// Array versions, used for runs of elements that don't loop. The generic versions just
+// call the per-element functions. The float and Vector versions work out the blend
+// weights once and walk straight through the arrays so the compiler can vectorize them;
+// they do the same arithmetic as Lerp / Lerp_Hermite so the results are identical.
+template <class T>
+inline void Lerp_Array( float t, const T *pFrom, const T *pTo, T *pOut, int count )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		pOut[i] = Lerp( t, pFrom[i], pTo[i] );
+	}
+}
+
+template <>
+inline void Lerp_Array( float t, const float *pFrom, const float *pTo, float *pOut, int count )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		pOut[i] = pFrom[i] + (pTo[i] - pFrom[i]) * t;
+	}
+}
+
+template <>
+inline void Lerp_Array( float t, const Vector *pFrom, const Vector *pTo, Vector *pOut, int count )
+{
+	COMPILE_TIME_ASSERT( sizeof( Vector ) == 3 * sizeof( float ) );
+	Lerp_Array( t, pFrom->Base(), pTo->Base(), pOut->Base(), count * 3 );
+}
+
+template <class T>
+inline void Lerp_HermiteArray( float t, const T *p0, const T *p1, const T *p2, T *pOut, int count )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		pOut[i] = Lerp_Hermite( t, p0[i], p1[i], p2[i] );
+	}
+}
+
+template <>
+inline void Lerp_HermiteArray( float t, const float *p0, const float *p1, const float *p2, float *pOut, int count )
+{
+	float tSqr = t*t;
+	float tCube = t*tSqr;
+
+	float s1 = 2*tCube-3*tSqr+1;
+	float s2 = -2*tCube+3*tSqr;
+	float sd1 = tCube-2*tSqr+t;
+	float sd2 = tCube-tSqr;
+
+	for ( int i = 0; i < count; i++ )
+	{
+		float d1 = p1[i] - p0[i];
+		float d2 = p2[i] - p1[i];
+
+		float output = p1[i] * s1;
+		output += p2[i] * s2;
+		output += d1 * sd1;
+		output += d2 * sd2;
+
+		pOut[i] = output;
+	}
+}
+
+template <>
+inline void Lerp_HermiteArray( float t, const Vector *p0, const Vector *p1, const Vector *p2, Vector *pOut, int count )
+{
+	COMPILE_TIME_ASSERT( sizeof( Vector ) == 3 * sizeof( float ) );
+	Lerp_HermiteArray( t, p0->Base(), p1->Base(), p2->Base(), pOut->Base(), count * 3 );
+}
+
+
 // NOTE: C_AnimationLayer has its own versions of these functions in animationlayer.h.
 
 
@@ -37,6 +37,7 @@
 #include "c_pixel_visibility.h"
 #include "ClientEffectPrecacheSystem.h"
 #include "c_rope.h"
+#include "c_baseanimating.h"
 #include "c_effects.h"
 #include "smoke_fog_overlay.h"
 #include "materialsystem/imaterialsystemhardwareconfig.h"
@@ -506,6 +507,9 @@ void CViewRender::SetupRenderList( const CViewSetup *pView, ClientWorldListInfo_
 				SortEntities( &renderList.m_RenderGroups[RENDER_GROUP_TRANSLUCENT_ENTITY][nTranslucent], nNewTranslucent );
 			}
 		}
+
+		// Set up bones for the animating entities in this view before drawing them.
+		C_BaseAnimating::SetupBonesForRenderList( renderList );
 	}
 }
 
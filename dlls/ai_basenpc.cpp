@@ -173,6 +173,7 @@ CAI_Manager g_AI_Manager;
 //-------------------------------------
 
 CAI_Manager::CAI_Manager()
+ :	m_iChangeCount( 0 )
 {
 	m_AIs.EnsureCapacity( MAX_AIS );
 }
@@ -198,6 +199,7 @@ int CAI_Manager::NumAIs()
 void CAI_Manager::AddAI( CAI_BaseNPC *pAI )
 {
 	m_AIs.AddToTail( pAI );
+	m_iChangeCount++;
 }
 
 //-------------------------------------
@@ -207,7 +209,10 @@ void CAI_Manager::RemoveAI( CAI_BaseNPC *pAI )
 	int i = m_AIs.Find( pAI );
 
 	if ( i != -1 )
+	{
 		m_AIs.FastRemove( i );
+		m_iChangeCount++;
+	}
 }
 
 
@@ -3031,16 +3036,17 @@ void CAI_BaseNPC::UpdateEfficiency( bool bInPVS )
 	
 	if ( GetSoundInterests() & SOUND_DANGER )
 	{
-		int	iSound = CSoundEnt::ActiveList();
+		float hearingSensitivity = HearingSensitivity();
+		Vector vEarPosition = EarPosition();
+
+		int sounds[ MAX_WORLD_SOUNDS ];
+		int nSounds = CSoundEnt::GetSoundsInRange( SOUND_DANGER, vEarPosition, hearingSensitivity, sounds );
 		
-		while ( iSound != SOUNDLIST_EMPTY )
+		for ( int i = 0; i < nSounds; i++ )
 		{
-			CSound *pCurrentSound = CSoundEnt::SoundPointerForIndex( iSound );
+			CSound *pCurrentSound = CSoundEnt::SoundPointerForIndex( sounds[ i ] );
 
-			float hearingSensitivity = HearingSensitivity();
-			Vector vEarPosition = EarPosition();
-
-			if ( pCurrentSound && (SOUND_DANGER & pCurrentSound->SoundType()) )
+			if ( pCurrentSound )
 			{
 				float flHearDistanceSq = pCurrentSound->Volume() * hearingSensitivity;
 				flHearDistanceSq *= flHearDistanceSq;
@@ -3050,8 +3056,6 @@ void CAI_BaseNPC::UpdateEfficiency( bool bInPVS )
 					break;
 				}
 			}
-			
-			iSound = pCurrentSound->NextSound();
 		}
 	}
 
@@ -288,6 +288,10 @@ public:
 	void RemoveAI( CAI_BaseNPC *pAI );
 
 	bool FindAI( CAI_BaseNPC *pAI )	{ return ( m_AIs.Find( pAI ) != m_AIs.InvalidIndex() ); }
+
+	// Bumped whenever the list is added to or removed from, so caches keyed on
+	// an AI's position in the list know when to rebuild
+	int GetChangeCount() const		{ return m_iChangeCount; }
 	
 private:
 	enum
@@ -298,6 +302,7 @@ private:
 	typedef CUtlVector<CAI_BaseNPC *> CAIArray;
 	
 	CAIArray m_AIs;
+	int		 m_iChangeCount;
 
 };
 
@@ -30,6 +30,10 @@
 //-----------------------------------------------------------------------------
 
 CAI_SensedObjectsManager g_AI_SensedObjectsManager;
+CAI_SightBroker g_AI_SightBroker;
+
+ConVar ai_sight_broker( "ai_sight_broker", "1", 0, "Use the spatial partition to gather NPC sight candidates" );
+ConVar ai_sight_broker_validate( "ai_sight_broker_validate", "0", 0, "Check sight broker candidates against a full scan of all AIs" );
 
 //-----------------------------------------------------------------------------
 
@@ -109,20 +113,20 @@ void CAI_Senses::Listen( void )
 	
 	if ( iSoundMask != SOUND_NONE && !(GetOuter()->HasSpawnFlags(SF_NPC_WAIT_TILL_SEEN)) )
 	{
-		int	iSound = CSoundEnt::ActiveList();
+		int sounds[ MAX_WORLD_SOUNDS ];
+		int nSounds = CSoundEnt::GetSoundsInRange( iSoundMask, GetOuter()->EarPosition(), GetOuter()->HearingSensitivity(), sounds );
 		
-		while ( iSound != SOUNDLIST_EMPTY )
+		for ( int i = 0; i < nSounds; i++ )
 		{
+			int iSound = sounds[ i ];
 			CSound *pCurrentSound = CSoundEnt::SoundPointerForIndex( iSound );
 
-			if ( pCurrentSound	&& (iSoundMask & pCurrentSound->SoundType()) && CanHearSound( pCurrentSound ) )
+			if ( pCurrentSound && CanHearSound( pCurrentSound ) )
 			{
 	 			// the npc cares about this sound, and it's close enough to hear.
 				pCurrentSound->m_iNextAudible = m_iAudibleList;
 				m_iAudibleList = iSound;
 			}
-
-			iSound = pCurrentSound->NextSound();
 		}
 	}
 	
@@ -156,8 +160,11 @@ bool CAI_Senses::ShouldSeeEntity( CBaseEntity *pSightEnt )
 
 bool CAI_Senses::CanSeeEntity( CBaseEntity *pSightEnt )
 {
-	return ( GetOuter()->FInViewCone( pSightEnt ) && 
-			 GetOuter()->FVisible( pSightEnt ) );
+	if ( !GetOuter()->FInViewCone( pSightEnt ) )
+		return false;
+
+	g_AI_SightBroker.NoteTrace();
+	return GetOuter()->FVisible( pSightEnt );
 }
 
 //-----------------------------------------------------------------------------
@@ -342,6 +349,8 @@ void CAI_Senses::Look( int iDistance )
 
 bool CAI_Senses::Look( CBaseEntity *pSightEnt )
 {
+	g_AI_SightBroker.NoteQuery();
+
 	if ( WaitingUntilSeen( pSightEnt ) )
 		return false;
 	
@@ -435,9 +444,11 @@ int CAI_Senses::LookForNPCs( int iDistance )
 			BeginGather();
 
 			CAI_BaseNPC **ppAIs = g_AI_Manager.AccessAIs();
+			int nCandidates = g_AI_SightBroker.GatherNPCs( GetOuter(), origin, iDistance, &m_SightCandidates );
 			
-			for ( int i = 0; i < g_AI_Manager.NumAIs(); i++ )
+			for ( int iCandidate = 0; iCandidate < nCandidates; iCandidate++ )
 			{
+				int i = m_SightCandidates[iCandidate];
 #if OTHER_IMPORTANT_ENTITIES_NOT_BAKED
 				if ( ppAIs[i] != GetOuter()->GetTarget() && ppAIs[i] != GetOuter()->GetEnemy() )
 #endif
@@ -698,3 +709,201 @@ void CAI_SensedObjectsManager::AddEntity( CBaseEntity *pEntity )
 }
 
 //=============================================================================
+
+//=============================================================================
+//
+// CAI_SightBroker
+//
+//=============================================================================
+
+#define AI_SIGHT_MAX_PARTITION_HITS 256
+
+static int SightCandidateSortFn( const int *pLeft, const int *pRight )
+{
+	return ( *pLeft - *pRight );
+}
+
+//-----------------------------------------------------------------------------
+
+CAI_SightBroker::CAI_SightBroker()
+ :	m_iTick( -1 ),
+	m_iAIChangeCount( -1 )
+{
+	ResetStats();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Once a tick, or whenever the AI list changes, rebuild the
+//			entindex -> AI index map and re-collect the AIs that have to be
+//			tested regardless of where the partition puts them.
+//-----------------------------------------------------------------------------
+
+void CAI_SightBroker::UpdateForTick()
+{
+	if ( m_iTick == gpGlobals->tickcount && m_iAIChangeCount == g_AI_Manager.GetChangeCount() )
+		return;
+
+	CAI_BaseNPC **ppAIs = g_AI_Manager.AccessAIs();
+	int nAIs = g_AI_Manager.NumAIs();
+
+	m_iAIChangeCount = g_AI_Manager.GetChangeCount();
+	m_iTick = gpGlobals->tickcount;
+	m_Unpartitioned.RemoveAll();
+
+	if ( m_AIIndex.Count() != MAX_EDICTS )
+	{
+		m_AIIndex.SetCount( MAX_EDICTS );
+		for ( int i = 0; i < MAX_EDICTS; i++ )
+		{
+			m_AIIndex[i] = -1;
+		}
+	}
+	else
+	{
+		// Only the slots filled last time need clearing
+		for ( int i = 0; i < m_AIIndexUsed.Count(); i++ )
+		{
+			m_AIIndex[m_AIIndexUsed[i]] = -1;
+		}
+	}
+	m_AIIndexUsed.RemoveAll();
+
+	for ( int i = 0; i < nAIs; i++ )
+	{
+		CAI_BaseNPC *pAI = ppAIs[i];
+		int iEntIndex = pAI->entindex();
+
+		// AIs without an edict or the NPC flag won't come back from the partition
+		// query, nor will non-solid ones (they aren't in the edict partition list),
+		// and the ones that are seen at any distance may lie outside it
+		if ( iEntIndex <= 0 || iEntIndex >= MAX_EDICTS || !( pAI->GetFlags() & FL_NPC ) || 
+			 !pAI->IsSolid() || pAI->ShouldNotDistanceCull() )
+		{
+			m_Unpartitioned.AddToTail( i );
+		}
+		else
+		{
+			m_AIIndex[iEntIndex] = i;
+			m_AIIndexUsed.AddToTail( iEntIndex );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+void CAI_SightBroker::GatherAll( CUtlVector<int> *pResult )
+{
+	int nAIs = g_AI_Manager.NumAIs();
+	pResult->SetCount( nAIs );
+	for ( int i = 0; i < nAIs; i++ )
+	{
+		(*pResult)[i] = i;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Collect every AI whose origin could lie within flDist of origin.
+//			An AI's surrounding bounds contain its origin, so the partition
+//			sphere query can return extra AIs but never drops one that is in
+//			range. The caller still applies its own exact distance test.
+//-----------------------------------------------------------------------------
+
+int CAI_SightBroker::GatherNPCs( CAI_BaseNPC *pLooker, const Vector &origin, float flDist, CUtlVector<int> *pResult )
+{
+	m_nGathers++;
+	m_nLinearCandidates += g_AI_Manager.NumAIs();
+
+	pResult->RemoveAll();
+
+	if ( !ai_sight_broker.GetBool() || pLooker->ShouldNotDistanceCull() )
+	{
+		GatherAll( pResult );
+		m_nCandidates += pResult->Count();
+		return pResult->Count();
+	}
+
+	UpdateForTick();
+
+	CBaseEntity *pHits[AI_SIGHT_MAX_PARTITION_HITS];
+	int nHits = UTIL_EntitiesInSphere( pHits, AI_SIGHT_MAX_PARTITION_HITS, origin, flDist, FL_NPC );
+
+	if ( nHits == AI_SIGHT_MAX_PARTITION_HITS )
+	{
+		// The query may have been truncated
+		GatherAll( pResult );
+		m_nCandidates += pResult->Count();
+		return pResult->Count();
+	}
+
+	for ( int i = 0; i < nHits; i++ )
+	{
+		int iAI = m_AIIndex[pHits[i]->entindex()];
+		if ( iAI != -1 )
+		{
+			pResult->AddToTail( iAI );
+		}
+	}
+
+	pResult->AddMultipleToTail( m_Unpartitioned.Count(), m_Unpartitioned.Base() );
+
+	// Preserve the order the full scan would have visited the AIs in
+	pResult->Sort( SightCandidateSortFn );
+
+	if ( ai_sight_broker_validate.GetBool() )
+	{
+		Validate( pLooker, origin, flDist, *pResult );
+	}
+
+	m_nCandidates += pResult->Count();
+	return pResult->Count();
+}
+
+//-----------------------------------------------------------------------------
+
+void CAI_SightBroker::Validate( CAI_BaseNPC *pLooker, const Vector &origin, float flDist, const CUtlVector<int> &result )
+{
+	CAI_BaseNPC **ppAIs = g_AI_Manager.AccessAIs();
+	float distSq = flDist * flDist;
+
+	for ( int i = 0; i < g_AI_Manager.NumAIs(); i++ )
+	{
+		if ( ppAIs[i] == pLooker || !( ppAIs[i]->ShouldNotDistanceCull() || origin.DistToSqr( ppAIs[i]->GetAbsOrigin() ) < distSq ) )
+			continue;
+
+		if ( result.Find( i ) == -1 )
+		{
+			Warning( "Sight broker missed %s (%d) for %s (%d)\n", 
+					 ppAIs[i]->GetClassname(), ppAIs[i]->entindex(), 
+					 pLooker->GetClassname(), pLooker->entindex() );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+void CAI_SightBroker::ReportStats()
+{
+	Msg( "AI sight: %d NPC gathers, %d candidates (%d without broker), %d sight queries, %d traces\n",
+		 m_nGathers, m_nCandidates, m_nLinearCandidates, m_nQueries, m_nTraces );
+}
+
+//-----------------------------------------------------------------------------
+
+void CAI_SightBroker::ResetStats()
+{
+	m_nGathers = 0;
+	m_nCandidates = 0;
+	m_nLinearCandidates = 0;
+	m_nQueries = 0;
+	m_nTraces = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+CON_COMMAND( ai_sight_stats, "Report and reset NPC sight query and trace counts" )
+{
+	g_AI_SightBroker.ReportStats();
+	g_AI_SightBroker.ResetStats();
+}
+
+//=============================================================================
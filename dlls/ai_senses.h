@@ -19,6 +19,7 @@
 
 class CBaseEntity;
 class CSound;
+class CAI_BaseNPC;
 
 //-------------------------------------
 
@@ -119,8 +120,56 @@ private:
 	CSimTimer		m_HighPriorityTimer;
 	CSimTimer		m_NPCsTimer;
 	CSimTimer		m_MiscTimer;
+
+	CUtlVector<int>	m_SightCandidates;		// scratch, indices into the AI manager list
 };
 
+//-----------------------------------------------------------------------------
+// class CAI_SightBroker
+//
+// Purpose: Shared across all senses. Narrows the AIs an NPC has to consider
+//			when looking for other NPCs down to those the spatial partition
+//			places in range, instead of every AI in the level. The result is
+//			always a superset of the AIs the linear scan would have accepted,
+//			returned in AI manager order, so the seen lists built from it
+//			are identical.
+//-----------------------------------------------------------------------------
+
+class CAI_SightBroker
+{
+public:
+	CAI_SightBroker();
+
+	// Fills pResult with indices into g_AI_Manager.AccessAIs(), sorted
+	int			GatherNPCs( CAI_BaseNPC *pLooker, const Vector &origin, float flDist, CUtlVector<int> *pResult );
+
+	void		NoteQuery()		{ m_nQueries++; }
+	void		NoteTrace()		{ m_nTraces++; }
+
+	void		ReportStats();
+	void		ResetStats();
+
+private:
+	void		UpdateForTick();
+	void		GatherAll( CUtlVector<int> *pResult );
+	void		Validate( CAI_BaseNPC *pLooker, const Vector &origin, float flDist, const CUtlVector<int> &result );
+
+	int			m_iTick;
+	int			m_iAIChangeCount;
+
+	CUtlVector<int> m_AIIndex;				// entindex -> AI manager index, -1 if not an AI
+	CUtlVector<int> m_AIIndexUsed;			// entindices set in m_AIIndex
+	CUtlVector<int> m_Unpartitioned;		// AIs the partition query can't be relied on to return
+
+	int			m_nGathers;
+	int			m_nCandidates;
+	int			m_nLinearCandidates;
+	int			m_nQueries;
+	int			m_nTraces;
+};
+
+extern CAI_SightBroker g_AI_SightBroker;
+
 //-----------------------------------------------------------------------------
 
 class CAI_SensedObjectsManager : public IEntityListener
@@ -538,6 +538,32 @@ CBaseEntity *CBaseEntity::GetFollowedEntity()
 void CBaseEntity::SetClassname( const char *className )
 {
 	m_iClassname = AllocPooledString( className );
+	gEntList.NoteTargetNamesChanged();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Returns the soonest tick PhysicsRunThink would run one of our thinks,
+//			or 0 if none are set.
+//-----------------------------------------------------------------------------
+int CBaseEntity::GetEarliestThinkTick() const
+{
+	int nTick = ( m_nNextThinkTick > 0 ) ? m_nNextThinkTick : 0;
+	for ( int i = 0; i < m_aThinkFunctions.Count(); i++ )
+	{
+		int nContextTick = m_aThinkFunctions[i].m_nNextThinkTick;
+		if ( nContextTick > 0 && ( nTick == 0 || nContextTick < nTick ) )
+		{
+			nTick = nContextTick;
+		}
+	}
+
+	return nTick;
+}
+
+void CBaseEntity::SetName( string_t newName )
+{
+	m_iName = newName;
+	gEntList.NoteTargetNamesChanged();
 }
 
 // position to shoot at
@@ -2544,6 +2570,9 @@ int CBaseEntity::Restore( IRestore &restore )
 	// loops through the data description list, restoring each data desc block in order
 	int status = RestoreDataDescBlock( restore, GetDataDescMap() );
 
+	// our name and classname came back with the rest of the fields
+	gEntList.NoteTargetNamesChanged();
+
 	// ---------------------------------------------------------------
 	// HACKHACK: We don't know the space of these vectors until now
 	// if they are worldspace, fix them up.
@@ -713,6 +713,7 @@ public:
 	float	GetLastThink( const char *szContext = NULL );
 	int		GetNextThinkTick( const char *szContext = NULL );
 	int		GetLastThinkTick( const char *szContext = NULL );
+	int		GetEarliestThinkTick() const;		// soonest tick any think (contexted or not) is due, 0 if none
 
 	float				GetAnimTime() const;
 	void				SetAnimTime( float at );
@@ -1762,12 +1763,6 @@ inline string_t CBaseEntity::GetEntityName()
 	return m_iName; 
 }
 
-inline void CBaseEntity::SetName( string_t newName )
-{
-	m_iName = newName;
-}
-
-
 inline bool CBaseEntity::NameMatches( const char *pszNameOrWildcard )
 {
 	if ( IDENT_STRINGS(m_iName, pszNameOrWildcard) )
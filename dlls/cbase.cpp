@@ -577,7 +577,7 @@ DEFINE_FIXEDSIZE_ALLOCATOR( EventQueuePrioritizedEvent_t, 128, CMemoryPool::GROW
 
 CEventQueue g_EventQueue;
 
-CEventQueue::CEventQueue()
+CEventQueue::CEventQueue() : m_NameTargets( 0, 0, DefLessFunc( const char * ) ), m_ClassnameTargets( 0, 0, DefLessFunc( const char * ) )
 {
 	m_Events.m_flFireTime = -FLT_MAX;
 	m_Events.m_pNext = NULL;
@@ -637,6 +637,23 @@ void CEventQueue::Clear( void )
 	}
 
 	m_Events.m_pNext = NULL;
+
+	ClearTargetLists();
+}
+
+void CEventQueue::ClearTargetLists( void )
+{
+	TargetListMap_t *pMaps[2] = { &m_NameTargets, &m_ClassnameTargets };
+	for ( int i = 0; i < 2; i++ )
+	{
+		for ( int j = pMaps[i]->FirstInorder(); j != pMaps[i]->InvalidIndex(); j = pMaps[i]->NextInorder( j ) )
+		{
+			EventQueueTargetList_t *pList = pMaps[i]->Element( j );
+			delete [] pList->m_pszTarget;
+			delete pList;
+		}
+		pMaps[i]->RemoveAll();
+	}
 }
 
 
@@ -746,17 +763,7 @@ void CEventQueue::ServiceEvents( void )
 		// find the targets
 		if ( pe->m_iTarget != NULL_STRING )
 		{
-			CBaseEntity *target = NULL;
-			while ( 1 )
-			{
-				target = gEntList.FindEntityByName( target, pe->m_iTarget, pe->m_pActivator, pe->m_pCaller );
-				if ( !target )
-					break;
-
-				// pump the action into the target
-				target->AcceptInput( STRING(pe->m_iTargetInput), pe->m_pActivator, pe->m_pCaller, pe->m_VariantValue, pe->m_iOutputID );
-				targetFound = true;
-			}
+			targetFound = FireToTargets( pe, false );
 		}
 
 		// direct pointer
@@ -771,17 +778,7 @@ void CEventQueue::ServiceEvents( void )
 			// See if we can find a target if we treat the target as a classname
 			if ( pe->m_iTarget != NULL_STRING )
 			{
-				CBaseEntity *target = NULL;
-				while ( 1 )
-				{
-					target = gEntList.FindEntityByClassname( target, STRING(pe->m_iTarget) );
-					if ( !target )
-						break;
-
-					// pump the action into the target
-					target->AcceptInput( STRING(pe->m_iTargetInput), pe->m_pActivator, pe->m_pCaller, pe->m_VariantValue, pe->m_iOutputID );
-					targetFound = true;
-				}
+				targetFound = FireToTargets( pe, true );
 			}
 		}
 
@@ -821,6 +818,111 @@ void CEventQueue::ServiceEvents( void )
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Returns the entities that match pszTarget as a name (or classname),
+//			in entity list order, searching again only if something has been
+//			spawned, removed or renamed since the last time.
+//-----------------------------------------------------------------------------
+EventQueueTargetList_t *CEventQueue::GetTargetList( const char *pszTarget, bool bClassname )
+{
+	TargetListMap_t &map = bClassname ? m_ClassnameTargets : m_NameTargets;
+	int iGeneration = gEntList.GetTargetNamesGeneration();
+
+	EventQueueTargetList_t *pList;
+	int i = map.Find( pszTarget );
+	if ( i != map.InvalidIndex() )
+	{
+		pList = map.Element( i );
+		if ( pList->m_iGeneration == iGeneration )
+			return pList;
+
+		pList->m_Targets.RemoveAll();
+	}
+	else
+	{
+		// event targets aren't always pooled strings, so keep our own copy of the key
+		int nLen = Q_strlen( pszTarget ) + 1;
+		pList = new EventQueueTargetList_t;
+		pList->m_pszTarget = new char[nLen];
+		Q_strncpy( pList->m_pszTarget, pszTarget, nLen );
+		map.Insert( pList->m_pszTarget, pList );
+	}
+
+	pList->m_iGeneration = iGeneration;
+
+	CBaseEntity *target = NULL;
+	while ( 1 )
+	{
+		target = bClassname ? gEntList.FindEntityByClassname( target, pszTarget ) : gEntList.FindEntityByName( target, pszTarget, NULL );
+		if ( !target )
+			break;
+
+		pList->m_Targets.AddToTail( target );
+	}
+
+	return pList;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Sends the event's input to every entity its target string matches
+//			as a name (or classname). Returns true if there were any.
+//-----------------------------------------------------------------------------
+bool CEventQueue::FireToTargets( EventQueuePrioritizedEvent_t *pe, bool bClassname )
+{
+	const char *pszTarget = STRING(pe->m_iTarget);
+	bool targetFound = false;
+	CBaseEntity *target = NULL;
+
+	// procedural names depend on the activator and caller, so they're always searched for
+	if ( bClassname || pszTarget[0] != '!' )
+	{
+		EventQueueTargetList_t *pList = GetTargetList( pszTarget, bClassname );
+		int iGeneration = pList->m_iGeneration;
+
+		for ( int i = 0; i < pList->m_Targets.Count(); i++ )
+		{
+			target = pList->m_Targets[i];
+			Assert( target );
+
+			// pump the action into the target
+			target->AcceptInput( STRING(pe->m_iTargetInput), pe->m_pActivator, pe->m_pCaller, pe->m_VariantValue, pe->m_iOutputID );
+			targetFound = true;
+
+			// If the input spawned, removed or renamed anything, the rest of the
+			// list can't be trusted. Carry on searching from this target instead,
+			// which is what would have happened without the list.
+			if ( gEntList.GetTargetNamesGeneration() != iGeneration )
+				break;
+		}
+
+		if ( gEntList.GetTargetNamesGeneration() == iGeneration )
+			return targetFound;
+	}
+
+	while ( 1 )
+	{
+		if ( bClassname )
+		{
+			target = gEntList.FindEntityByClassname( target, pszTarget );
+		}
+		else
+		{
+			target = gEntList.FindEntityByName( target, pe->m_iTarget, pe->m_pActivator, pe->m_pCaller );
+		}
+
+		if ( !target )
+			break;
+
+		// pump the action into the target
+		target->AcceptInput( STRING(pe->m_iTargetInput), pe->m_pActivator, pe->m_pCaller, pe->m_VariantValue, pe->m_iOutputID );
+		targetFound = true;
+	}
+
+	return targetFound;
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Removes all pending events from the I/O queue that were added by the
 //			given caller.
@@ -130,6 +130,25 @@ int CompareEntityThinkTimes( const unsigned short *pIndex0, const unsigned short
 // NOTE: This is usually a small subset of the global entity list, so it's
 // an optimization to maintain this list incrementally rather than polling each
 // frame.
+//
+// Entities without an edict are only ever asked to think by Physics_SimulateEntity,
+// and PhysicsRunThink does nothing for them until one of their thinks is due. They
+// are also put on a timing wheel, in the bucket for the tick their earliest think
+// is due, and only handed out on that tick. Scheduling is O(1) and a tick only
+// touches the buckets it covers. Thinks more than a turn of the wheel away just
+// stay in their bucket until a pass finds them due. They keep their place in
+// m_simThinkList, so the ones that are due still think in the same order relative
+// to everything else as when every entity in the list was handed out. The
+// entities with edicts are also kept in m_edictThinkList, in list order, and
+// ListCopy merges that with the due ones by list position, so the ones that
+// aren't due are never touched.
+#define SIMTHINK_WHEEL_BITS		8
+#define SIMTHINK_WHEEL_SIZE		(1 << SIMTHINK_WHEEL_BITS)
+#define SIMTHINK_WHEEL_MASK		(SIMTHINK_WHEEL_SIZE - 1)
+#define SIMTHINK_WHEEL_DUE		SIMTHINK_WHEEL_SIZE		// bucket for thinks already due when they were scheduled
+
+static ConVar sv_simthink_check( "sv_simthink_check", "0", FCVAR_CHEAT, "Check the entities handed out to think against a walk of the whole think list." );
+
 class CSimThinkManager : public IEntityListener
 {
 public:
@@ -140,10 +159,22 @@ public:
 	void Clear()
 	{
 		m_simThinkList.Purge();
+		m_edictThinkList.Purge();
 		for ( int i = 0; i < ARRAYSIZE(m_entinfoIndex); i++ )
 		{
 			m_entinfoIndex[i] = 0xFFFF;
+			m_wheelBucket[i] = 0xFFFF;
+			m_bOnWheel[i] = false;
+			m_bDue[i] = false;
+			m_nLastCollectTick[i] = -1;
+		}
+		for ( int i = 0; i < ARRAYSIZE(m_wheel); i++ )
+		{
+			m_wheel[i].Purge();
 		}
+		m_dueList.Purge();
+		m_dueKeys.Purge();
+		m_nCollectedTick = 0;
 	}
 	void LevelInitPreEntity()
 	{
@@ -159,10 +190,13 @@ public:
 	void OnEntityCreated( CBaseEntity *pEntity )
 	{
 		Assert( m_entinfoIndex[pEntity->GetRefEHandle().GetEntryIndex()] == 0xFFFF );
+		Assert( !m_bOnWheel[pEntity->GetRefEHandle().GetEntryIndex()] );
 	}
 	void OnEntityDeleted( CBaseEntity *pEntity )
 	{
-		RemoveEntinfoIndex( pEntity->GetRefEHandle().GetEntryIndex() );
+		int index = pEntity->GetRefEHandle().GetEntryIndex();
+		RemoveEntinfoIndex( index );
+		RemoveFromWheel( index );
 	}
 
 	void RemoveEntinfoIndex( int index )
@@ -172,30 +206,340 @@ public:
 		if ( listHandle != 0xFFFF )
 		{
 			Assert(m_simThinkList[listHandle] == index);
+			if ( !m_bOnWheel[index] )
+			{
+				RemoveEdictThinker( index );
+			}
 			m_simThinkList.FastRemove( listHandle );
 			m_entinfoIndex[index] = 0xFFFF;
 			
 			// fast remove shifted someone, update that someone
 			if ( listHandle < m_simThinkList.Count() )
 			{
-				m_entinfoIndex[m_simThinkList[listHandle]] = listHandle;
+				int moved = m_simThinkList[listHandle];
+				if ( m_bOnWheel[moved] )
+				{
+					m_entinfoIndex[moved] = listHandle;
+				}
+				else
+				{
+					RemoveEdictThinker( moved );
+					m_entinfoIndex[moved] = listHandle;
+					InsertEdictThinker( moved );
+				}
+			}
+		}
+	}
+
+	// Finds where an entity at list position pos goes in m_edictThinkList
+	int FindEdictThinkerSlot( int pos )
+	{
+		int lo = 0;
+		int hi = m_edictThinkList.Count();
+		while ( lo < hi )
+		{
+			int mid = ( lo + hi ) >> 1;
+			if ( m_entinfoIndex[m_edictThinkList[mid]] < pos )
+			{
+				lo = mid + 1;
+			}
+			else
+			{
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	void InsertEdictThinker( int index )
+	{
+		int slot = FindEdictThinkerSlot( m_entinfoIndex[index] );
+		m_edictThinkList.InsertBefore( slot, (unsigned short)index );
+	}
+
+	void RemoveEdictThinker( int index )
+	{
+		int slot = FindEdictThinkerSlot( m_entinfoIndex[index] );
+		Assert( m_edictThinkList[slot] == index );
+		m_edictThinkList.Remove( slot );
+	}
+
+	void RemoveFromWheel( int index )
+	{
+		if ( !m_bOnWheel[index] )
+			return;
+
+		Unschedule( index );
+		if ( m_bDue[index] )
+		{
+			m_dueList.FindAndRemove( (unsigned short)index );
+			m_bDue[index] = false;
+		}
+		m_bOnWheel[index] = false;
+		m_nLastCollectTick[index] = -1;
+	}
+
+	void Unschedule( int index )
+	{
+		int bucket = m_wheelBucket[index];
+		if ( bucket == 0xFFFF )
+			return;
+
+		CUtlVector<unsigned short> &list = m_wheel[bucket];
+		int slot = m_wheelSlot[index];
+		Assert( list[slot] == index );
+		list.FastRemove( slot );
+		m_wheelBucket[index] = 0xFFFF;
+
+		// fast remove shifted someone, update that someone
+		if ( slot < list.Count() )
+		{
+			m_wheelSlot[list[slot]] = slot;
+		}
+	}
+
+	void Schedule( int index, int bucket )
+	{
+		m_wheelBucket[index] = bucket;
+		m_wheelSlot[index] = m_wheel[bucket].AddToTail( (unsigned short)index );
+	}
+
+	void ScheduleThink( CBaseEntity *pEntity, int index )
+	{
+		Unschedule( index );
+
+		int thinkTick = pEntity->GetEarliestThinkTick();
+		m_nWheelTick[index] = thinkTick;
+		if ( thinkTick <= 0 )
+			return;
+
+		if ( thinkTick > m_nCollectedTick )
+		{
+			Schedule( index, thinkTick & SIMTHINK_WHEEL_MASK );
+		}
+		else if ( m_nLastCollectTick[index] == m_nCollectedTick )
+		{
+			// Already handed out this tick; like everyone else in the list, it
+			// doesn't get a second go until the next one.
+			Schedule( index, ( m_nCollectedTick + 1 ) & SIMTHINK_WHEEL_MASK );
+		}
+		else
+		{
+			Schedule( index, SIMTHINK_WHEEL_DUE );
+		}
+	}
+
+	// Moves the wheel entities whose thinks are due by tick into m_dueList
+	void CollectBucket( int bucket, int tick )
+	{
+		CUtlVector<unsigned short> &list = m_wheel[bucket];
+		for ( int i = 0; i < list.Count(); )
+		{
+			int index = list[i];
+			if ( m_nWheelTick[index] > tick )
+			{
+				i++;
+				continue;
+			}
+
+			Unschedule( index );
+			if ( m_nLastCollectTick[index] == tick )
+			{
+				Schedule( index, ( tick + 1 ) & SIMTHINK_WHEEL_MASK );
+			}
+			else
+			{
+				m_nLastCollectTick[index] = tick;
+				m_bDue[index] = true;
+				m_dueList.AddToTail( (unsigned short)index );
+			}
+		}
+	}
+
+	int CollectDue( int tick )
+	{
+		if ( tick > m_nCollectedTick )
+		{
+			if ( tick - m_nCollectedTick >= SIMTHINK_WHEEL_SIZE )
+			{
+				for ( int i = 0; i < SIMTHINK_WHEEL_SIZE; i++ )
+				{
+					CollectBucket( i, tick );
+				}
+			}
+			else
+			{
+				for ( int t = m_nCollectedTick + 1; t <= tick; t++ )
+				{
+					CollectBucket( t & SIMTHINK_WHEEL_MASK, tick );
+				}
+			}
+			m_nCollectedTick = tick;
+		}
+
+		CollectBucket( SIMTHINK_WHEEL_DUE, tick );
+		if ( !m_dueList.Count() && sv_simthink_check.GetBool() )
+		{
+			CheckNoneMissed( tick );
+		}
+		return m_dueList.Count();
+	}
+
+	// For sv_simthink_check: is this wheel entity's think due, and not run yet this tick?
+	bool IsWheelThinkerDue( int index, int tick )
+	{
+		int thinkTick = EntityForIndex( index )->GetEarliestThinkTick();
+		return thinkTick > 0 && thinkTick <= tick && m_nLastCollectTick[index] != tick;
+	}
+
+	// For sv_simthink_check: once nothing more is due, nothing in the list should be either
+	void CheckNoneMissed( int tick )
+	{
+		for ( int i = 0; i < m_simThinkList.Count(); i++ )
+		{
+			int index = m_simThinkList[i];
+			if ( m_bOnWheel[index] && IsWheelThinkerDue( index, tick ) )
+			{
+				CBaseEntity *pEntity = EntityForIndex( index );
+				Warning( "sv_simthink_check: tick %d: %s(%d) is due to think at %d but wasn't collected\n",
+					tick, pEntity->GetClassname(), index, pEntity->GetEarliestThinkTick() );
+			}
+		}
+	}
+
+	// For sv_simthink_check: walks the whole list the way it was handed out before
+	// the wheel, keeping the entities that would do anything, and compares
+	void CheckListCopy( CBaseEntity *pList[], int count, int listMax )
+	{
+		int tick = gpGlobals->tickcount;
+		int expected = 0;
+		int mismatch = -1;
+		for ( int i = 0; i < m_simThinkList.Count() && expected < listMax; i++ )
+		{
+			int index = m_simThinkList[i];
+			// the wheel entities have all been collected by now, so ask the entity
+			if ( m_bOnWheel[index] )
+			{
+				int thinkTick = EntityForIndex( index )->GetEarliestThinkTick();
+				if ( thinkTick <= 0 || thinkTick > tick )
+					continue;
+			}
+
+			if ( mismatch < 0 && ( expected >= count || pList[expected] != EntityForIndex( index ) ) )
+			{
+				mismatch = expected;
 			}
+			expected++;
+		}
+
+		if ( mismatch < 0 && expected != count )
+		{
+			mismatch = expected;
+		}
+
+		if ( mismatch >= 0 )
+		{
+			Warning( "sv_simthink_check: tick %d: handed out %d entities, list walk has %d; first difference at %d\n",
+				tick, count, expected, mismatch );
 		}
 	}
+
 	int ListCount()
 	{
 		return m_simThinkList.Count();
 	}
 
+	CBaseEntity *EntityForIndex( int entinfoIndex )
+	{
+		const CEntInfo *pInfo = gEntList.GetEntInfoPtrByIndex( entinfoIndex );
+		CBaseEntity *pEntity = (CBaseEntity *)pInfo->m_pEntity;
+		Assert( gEntList.IsEntityPtr( pEntity ) );
+		return pEntity;
+	}
+
+	// Copies the due list out and empties it
+	int DueListCopy( CBaseEntity *pList[], int listMax )
+	{
+		int count = min(listMax, m_dueList.Count());
+		for ( int i = 0; i < count; i++ )
+		{
+			pList[i] = EntityForIndex( m_dueList[i] );
+			m_bDue[m_dueList[i]] = false;
+		}
+
+		m_dueList.RemoveAll();
+		return count;
+	}
+
+	// Everything with an edict, and the wheel entities that are due, in list order
 	int ListCopy( CBaseEntity *pList[], int listMax )
 	{
-		int count = min(listMax, ListCount());
+		// Put the due ones in list order; the key is the list position above
+		// the entinfo index
+		int dueCount = m_dueList.Count();
+		m_dueKeys.SetSize( dueCount );
+		for ( int i = 0; i < dueCount; i++ )
+		{
+			int index = m_dueList[i];
+			m_dueKeys[i] = ( (unsigned int)m_entinfoIndex[index] << 16 ) | index;
+			m_bDue[index] = false;
+		}
+		m_dueKeys.Sort( CompareDueKeys );
+		m_dueList.RemoveAll();
+
+		int count = 0;
+		int edict = 0;
+		int due = 0;
+		while ( count < listMax )
+		{
+			int index;
+			if ( edict < m_edictThinkList.Count() )
+			{
+				index = m_edictThinkList[edict];
+				if ( due < dueCount && ( m_dueKeys[due] >> 16 ) < m_entinfoIndex[index] )
+				{
+					index = m_dueKeys[due++] & 0xFFFF;
+				}
+				else
+				{
+					edict++;
+				}
+			}
+			else if ( due < dueCount )
+			{
+				index = m_dueKeys[due++] & 0xFFFF;
+			}
+			else
+			{
+				break;
+			}
+			pList[count++] = EntityForIndex( index );
+		}
+
+		if ( sv_simthink_check.GetBool() )
+		{
+			CheckListCopy( pList, count, listMax );
+		}
+
+		return count;
+	}
+
+	static int CompareDueKeys( const unsigned int *pKey0, const unsigned int *pKey1 )
+	{
+		if ( *pKey0 > *pKey1 )
+			return 1;
+		if ( *pKey0 < *pKey1 )
+			return -1;
+		return 0;
+	}
+
+	// Everything we're tracking, including wheel entities that aren't due
+	int ListCopyAll( CBaseEntity *pList[], int listMax )
+	{
+		int count = min(listMax, m_simThinkList.Count());
 		for ( int i = 0; i < count; i++ )
 		{
-			int entinfoIndex = m_simThinkList[i];
-			const CEntInfo *pInfo = gEntList.GetEntInfoPtrByIndex( entinfoIndex );
-			pList[i] = (CBaseEntity *)pInfo->m_pEntity;
-			Assert( gEntList.IsEntityPtr( pList[i] ) );
+			pList[i] = EntityForIndex( m_simThinkList[i] );
 		}
 
 		return count;
@@ -213,20 +557,51 @@ public:
 
 		int index = eh.GetEntryIndex();
 		// UNDONE: Maintain separate lists for "no think/no sim" and just "no sim"
-		// UNDONE: Keep "no sim" list sorted by thinktime
-		// UNDONE: Add query for "no sim" list that includes a time and just get ents that will think by that time
 		if ( pEntity->IsEFlagSet( EFL_NO_THINK_FUNCTION ) && pEntity->IsEFlagSet( EFL_NO_GAME_PHYSICS_SIMULATION ) )
 		{
 			Assert( !pEntity->IsPlayer() );
 			RemoveEntinfoIndex( index );
+			RemoveFromWheel( index );
 		}
 		else
 		{
 			// already in the list? (had think or sim last time, now has both - or had both last time, now just one)
-			if ( m_entinfoIndex[index] == 0xFFFF )
+			bool bInList = ( m_entinfoIndex[index] != 0xFFFF );
+			if ( !bInList )
 			{
 				m_entinfoIndex[index] = m_simThinkList.AddToTail( (unsigned short)index );
 			}
+
+			if ( !pEntity->edict() )
+			{
+				if ( bInList && !m_bOnWheel[index] )
+				{
+					RemoveEdictThinker( index );
+				}
+				m_bOnWheel[index] = true;
+				ScheduleThink( pEntity, index );
+			}
+			else if ( !bInList || m_bOnWheel[index] )
+			{
+				RemoveFromWheel( index );
+				InsertEdictThinker( index );
+			}
+		}
+	}
+
+	void ThinkTimeChanged( CBaseEntity *pEntity )
+	{
+		if ( pEntity->IsMarkedForDeletion() )
+			return;
+
+		const CBaseHandle &eh = pEntity->GetRefEHandle();
+		if ( !eh.IsValid() )
+			return;
+
+		int index = eh.GetEntryIndex();
+		if ( m_bOnWheel[index] )
+		{
+			ScheduleThink( pEntity, index );
 		}
 	}
 
@@ -241,14 +616,32 @@ public:
 		m_simThinkList.Sort( CompareEntityThinkTimes );
 
 		// now remap the entindex map
+		m_edictThinkList.RemoveAll();
 		for ( i = 0; i < count; i++ )
 		{
 			m_entinfoIndex[m_simThinkList[i]] = i;
+			if ( !m_bOnWheel[m_simThinkList[i]] )
+			{
+				m_edictThinkList.AddToTail( m_simThinkList[i] );
+			}
 		}
 	}
 private:
 	unsigned short m_entinfoIndex[NUM_ENT_ENTRIES];
 	CUtlVector<unsigned short>	m_simThinkList;
+	CUtlVector<unsigned short>	m_edictThinkList;	// the ones not on the wheel, in list order
+
+	// timing wheel for entities without edicts
+	bool			m_bOnWheel[NUM_ENT_ENTRIES];
+	bool			m_bDue[NUM_ENT_ENTRIES];			// collected, not handed out yet
+	unsigned short	m_wheelBucket[NUM_ENT_ENTRIES];		// 0xFFFF if not scheduled
+	unsigned short	m_wheelSlot[NUM_ENT_ENTRIES];
+	int				m_nWheelTick[NUM_ENT_ENTRIES];		// tick the earliest think is due
+	int				m_nLastCollectTick[NUM_ENT_ENTRIES];
+	CUtlVector<unsigned short>	m_wheel[SIMTHINK_WHEEL_SIZE + 1];
+	CUtlVector<unsigned short>	m_dueList;
+	CUtlVector<unsigned int>	m_dueKeys;			// scratch for ListCopy
+	int				m_nCollectedTick;
 };
 
 CSimThinkManager g_SimThinkManager;
@@ -263,11 +656,31 @@ int SimThink_ListCopy( CBaseEntity *pList[], int listMax )
 	return g_SimThinkManager.ListCopy( pList, listMax );
 }
 
+int SimThink_DueListCopy( CBaseEntity *pList[], int listMax )
+{
+	return g_SimThinkManager.DueListCopy( pList, listMax );
+}
+
+int SimThink_ListCopyAll( CBaseEntity *pList[], int listMax )
+{
+	return g_SimThinkManager.ListCopyAll( pList, listMax );
+}
+
+int SimThink_CollectDueThinkers()
+{
+	return g_SimThinkManager.CollectDue( gpGlobals->tickcount );
+}
+
 void SimThink_EntityChanged( CBaseEntity *pEntity )
 {
 	g_SimThinkManager.EntityChanged( pEntity );
 }
 
+void SimThink_ThinkTimeChanged( CBaseEntity *pEntity )
+{
+	g_SimThinkManager.ThinkTimeChanged( pEntity );
+}
+
 void SimThink_SortThinkList()
 {
 	g_SimThinkManager.ListSort();
@@ -319,6 +732,7 @@ CGlobalEntityList::CGlobalEntityList()
 {
 	m_iHighestEnt = m_iNumEnts = m_iNumEdicts = 0;
 	m_bClearingEntities = false;
+	m_iTargetNamesGeneration = 0;
 }
 
 
@@ -1080,6 +1494,7 @@ void CGlobalEntityList::OnAddEntity( IHandleEntity *pEnt, CBaseHandle handle )
 
 	// record current list details
 	m_iNumEnts++;
+	m_iTargetNamesGeneration++;
 	if ( i > m_iHighestEnt )
 		m_iHighestEnt = i;
 
@@ -1121,6 +1536,7 @@ void CGlobalEntityList::OnRemoveEntity( IHandleEntity *pEnt, CBaseHandle handle
 		m_iNumEdicts--;
 
 	m_iNumEnts--;
+	m_iTargetNamesGeneration++;
 }
 
 
@@ -1500,7 +1916,7 @@ CON_COMMAND(report_touchlinks, "Lists all touchlinks")
 CON_COMMAND(report_simthinklist, "Lists all simulating/thinking entities")
 {
 	CBaseEntity *pTmp[NUM_ENT_ENTRIES];
-	int count = SimThink_ListCopy( pTmp, ARRAYSIZE(pTmp) );
+	int count = SimThink_ListCopyAll( pTmp, ARRAYSIZE(pTmp) );
 
 	CSortedEntityList list;
 	for ( int i = 0; i < count; i++ )
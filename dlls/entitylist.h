@@ -73,6 +73,8 @@ private:
 	bool m_bClearingEntities;
 	CUtlVector<IEntityListener *>	m_entityListeners;
 
+	int m_iTargetNamesGeneration;
+
 public:
 	IServerNetworkable* GetServerNetworkable( CBaseHandle hEnt ) const;
 	CBaseNetworkable* GetBaseNetworkable( CBaseHandle hEnt ) const;
@@ -125,6 +127,11 @@ public:
 		return NULL;
 	}
 
+	// Changes whenever an entity is added or removed, or changes its name or classname,
+	// so the results of FindEntityByName/FindEntityByClassname can be cached until then.
+	int			GetTargetNamesGeneration() const	{ return m_iTargetNamesGeneration; }
+	void		NoteTargetNamesChanged()			{ m_iTargetNamesGeneration++; }
+
 	// search functions
 	bool		 IsEntityPtr( void *pTest );
 	CBaseEntity *FindEntityByClassname( CBaseEntity *pStartEntity, const char *szName );
@@ -350,8 +357,12 @@ int AimTarget_ListCopy( CBaseEntity *pList[], int listMax );
 void AimTarget_ForceRepopulateList();
 
 void SimThink_EntityChanged( CBaseEntity *pEntity );
+void SimThink_ThinkTimeChanged( CBaseEntity *pEntity );
+int SimThink_CollectDueThinkers();
 int SimThink_ListCount();
 int SimThink_ListCopy( CBaseEntity *pList[], int listMax );
+int SimThink_DueListCopy( CBaseEntity *pList[], int listMax );
+int SimThink_ListCopyAll( CBaseEntity *pList[], int listMax );
 void SimThink_SortThinkList();
 
 #endif // ENTITYLIST_H
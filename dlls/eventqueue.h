@@ -15,6 +15,7 @@
 #endif
 
 #include "mempool.h"
+#include "utlmap.h"
 
 struct EventQueuePrioritizedEvent_t
 {
@@ -36,6 +37,15 @@ struct EventQueuePrioritizedEvent_t
 	DECLARE_FIXEDSIZE_ALLOCATOR( PrioritizedEvent_t );
 };
 
+// The entities a string target resolved to, reused until the entity list or
+// any entity's name or classname changes.
+struct EventQueueTargetList_t
+{
+	char *m_pszTarget;
+	int m_iGeneration;
+	CUtlVector<EHANDLE> m_Targets;
+};
+
 class CEventQueue
 {
 public:
@@ -69,6 +79,14 @@ private:
 	void AddEvent( EventQueuePrioritizedEvent_t *event );
 	void RemoveEvent( EventQueuePrioritizedEvent_t *pe );
 
+	bool FireToTargets( EventQueuePrioritizedEvent_t *pe, bool bClassname );
+	EventQueueTargetList_t *GetTargetList( const char *pszTarget, bool bClassname );
+	void ClearTargetLists( void );
+
+	typedef CUtlMap<const char *, EventQueueTargetList_t *> TargetListMap_t;
+	TargetListMap_t m_NameTargets;
+	TargetListMap_t m_ClassnameTargets;
+
 	DECLARE_SIMPLE_DATADESC();
 	EventQueuePrioritizedEvent_t m_Events;
 	int m_iListCount;
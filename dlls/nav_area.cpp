@@ -28,7 +28,8 @@ unsigned int CNavArea::m_nextID = 1;
 NavAreaList TheNavAreaList;
 
 unsigned int CNavArea::m_masterMarker = 1;
-CNavArea *CNavArea::m_openList = NULL;
+CUtlVector< CNavArea * > CNavArea::m_openList;
+unsigned int CNavArea::m_openSequence = 0;
 
 bool CNavArea::m_isReset = false;
 
@@ -39,6 +40,8 @@ bool CNavArea::m_isReset = false;
 void CNavArea::Initialize( void )
 {
 	m_marker = 0;
+	m_openMarker = 0;
+	m_nearestSearchMarker = 0;
 	m_parent = NULL;
 	m_parentHow = GO_NORTH;
 	m_attributeFlags = 0;
@@ -1515,96 +1518,100 @@ void CNavArea::DrawMarkedCorner( NavCornerType corner, byte red, byte green, byt
 
 //--------------------------------------------------------------------------------------------------------------
 /**
- * Add to open list in decreasing value order
+ * Open list ordering: lowest total cost first. Among equal costs, the area that was pushed or last
+ * updated earliest goes first, which is the order the sorted linked list this replaced produced.
  */
-void CNavArea::AddToOpenList( void )
+inline bool CNavArea::IsOpenBefore( const CNavArea *other ) const
 {
-	// mark as being on open list for quick check
-	m_openMarker = m_masterMarker;
+	if (m_totalCost != other->m_totalCost)
+		return (m_totalCost < other->m_totalCost);
 
-	// if list is empty, add and return
-	if (m_openList == NULL)
-	{
-		m_openList = this;
-		this->m_prevOpen = NULL;
-		this->m_nextOpen = NULL;
-		return;
-	}
+	return (m_openOrder < other->m_openOrder);
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavArea::OpenListSiftUp( int index )
+{
+	CNavArea *area = m_openList[ index ];
 
-	// insert self in ascending cost order
-	CNavArea *area, *last = NULL;
-	for( area = m_openList; area; area = area->m_nextOpen )
+	while( index > 0 )
 	{
-		if (this->GetTotalCost() < area->GetTotalCost())
+		int parent = (index - 1) / 2;
+		if (!area->IsOpenBefore( m_openList[ parent ] ))
 			break;
 
-		last = area;
+		m_openList[ parent ]->SetOpenIndex( index );
+		index = parent;
 	}
 
-	if (area)
-	{
-		// insert before this area
-		this->m_prevOpen = area->m_prevOpen;
-		if (this->m_prevOpen)
-			this->m_prevOpen->m_nextOpen = this;
-		else
-			m_openList = this;
+	area->SetOpenIndex( index );
+}
 
-		this->m_nextOpen = area;
-		area->m_prevOpen = this;
-	}
-	else
+//--------------------------------------------------------------------------------------------------------------
+void CNavArea::OpenListSiftDown( int index )
+{
+	CNavArea *area = m_openList[ index ];
+	int count = m_openList.Count();
+
+	while( true )
 	{
-		// append to end of list
-		last->m_nextOpen = this;
+		int child = 2 * index + 1;
+		if (child >= count)
+			break;
+
+		if (child + 1 < count && m_openList[ child + 1 ]->IsOpenBefore( m_openList[ child ] ))
+			++child;
+
+		if (!m_openList[ child ]->IsOpenBefore( area ))
+			break;
 
-		this->m_prevOpen = last;
-		this->m_nextOpen = NULL;
+		m_openList[ child ]->SetOpenIndex( index );
+		index = child;
 	}
+
+	area->SetOpenIndex( index );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Add to open list in increasing cost order.
+ * NOTE: Set the area's total cost before adding it - the open list is ordered by it.
+ */
+void CNavArea::AddToOpenList( void )
+{
+	// mark as being on open list for quick check
+	m_openMarker = m_masterMarker;
+	m_openOrder = m_openSequence++;
+
+	OpenListSiftUp( m_openList.AddToTail( this ) );
 }
 
 //--------------------------------------------------------------------------------------------------------------
 /**
  * A smaller value has been found, update this area on the open list
- * @todo "bubbling" does unnecessary work, since the order of all other nodes will be unchanged - only this node is altered
  */
 void CNavArea::UpdateOnOpenList( void )
 {
 	// since value can only decrease, bubble this area up from current spot
-	while( m_prevOpen && 
-				 this->GetTotalCost() < m_prevOpen->GetTotalCost() )
-	{
-		// swap position with predecessor
-		CNavArea *other = m_prevOpen;
-		CNavArea *before = other->m_prevOpen;
-		CNavArea *after  = this->m_nextOpen;
-
-		this->m_nextOpen = other;
-		this->m_prevOpen = before;
-
-		other->m_prevOpen = this;
-		other->m_nextOpen = after;
-
-		if (before)
-			before->m_nextOpen = this;
-		else
-			m_openList = this;
-
-		if (after)
-			after->m_prevOpen = other;
-	}
+	m_openOrder = m_openSequence++;
+	OpenListSiftUp( m_openIndex );
 }
 
 //--------------------------------------------------------------------------------------------------------------
 void CNavArea::RemoveFromOpenList( void )
 {
-	if (m_prevOpen)
-		m_prevOpen->m_nextOpen = m_nextOpen;
-	else
-		m_openList = m_nextOpen;
+	// move the last area into our spot and let it find its place
+	int index = m_openIndex;
+	int lastIndex = m_openList.Count() - 1;
+	CNavArea *last = m_openList[ lastIndex ];
+	m_openList.Remove( lastIndex );
 
-	if (m_nextOpen)
-		m_nextOpen->m_prevOpen = m_prevOpen;
+	if (last != this)
+	{
+		last->SetOpenIndex( index );
+		OpenListSiftUp( index );
+		OpenListSiftDown( last->m_openIndex );
+	}
 
 	// zero is an invalid marker
 	m_openMarker = 0;
@@ -1619,7 +1626,8 @@ void CNavArea::ClearSearchLists( void )
 	// effectively clears all open list pointers and closed flags
 	CNavArea::MakeNewMarker();
 
-	m_openList = NULL;
+	m_openList.RemoveAll();
+	m_openSequence = 0;
 }
 
 //--------------------------------------------------------------------------------------------------------------
@@ -13,6 +13,7 @@
 #define _NAV_AREA_H_
 
 class CNavArea;
+class CUtlBuffer;
 
 //-------------------------------------------------------------------------------------------------------------------
 /**
@@ -116,7 +117,7 @@ public:
 	int GetFlags( void ) const		{ return m_flags; }
 
 	void Save( FileHandle_t file, unsigned int version ) const;
-	void Load( FileHandle_t file, unsigned int version );
+	void Load( CUtlBuffer &fileBuffer, unsigned int version );
 
 	const Vector *GetPosition( void ) const	{ return &m_pos; }	///< get the position of the hiding spot
 	unsigned int GetID( void ) const				{ return m_id; }
@@ -191,7 +192,7 @@ public:
 	void Disconnect( CNavArea *area );							///< disconnect this area from given area
 
 	void Save( FileHandle_t file, unsigned int version ) const;
-	void Load( FileHandle_t file, unsigned int version );
+	void Load( CUtlBuffer &fileBuffer, unsigned int version );
 	NavErrorType PostLoad( void );
 
 	unsigned int GetID( void ) const	{ return m_id; }		///< return this area's unique ID
@@ -359,10 +360,19 @@ private:
 	float m_totalCost;											///< the distance so far plus an estimate of the distance left
 	float m_costSoFar;											///< distance travelled so far
 
-	static CNavArea *m_openList;
-	CNavArea *m_nextOpen, *m_prevOpen;							///< only valid if m_openMarker == m_masterMarker
+	static CUtlVector< CNavArea * > m_openList;					///< binary heap, cheapest total cost first
+	static unsigned int m_openSequence;							///< counts pushes and updates to the open list during a search
+	int m_openIndex;											///< our position in m_openList, only valid if m_openMarker == m_masterMarker
+	unsigned int m_openOrder;									///< m_openSequence when we were last pushed or updated, breaks cost ties
 	unsigned int m_openMarker;									///< if this equals the current marker value, we are on the open list
 
+	bool IsOpenBefore( const CNavArea *other ) const;
+	static void OpenListSiftUp( int index );
+	static void OpenListSiftDown( int index );
+	void SetOpenIndex( int index )		{ m_openIndex = index; m_openList[ index ] = this; }
+
+	unsigned int m_nearestSearchMarker;							///< set by CNavMesh::GetNearestNavArea, kept apart from the A* markers
+
 	//- connections to adjacent areas -------------------------------------------------------------------
 	NavConnectList m_connect[ NUM_DIRECTIONS ];					///< a list of adjacent areas for each direction
 	NavLadderList m_ladder[ CNavLadder::NUM_LADDER_DIRECTIONS ];///< list of ladders leading up and down from this area
@@ -422,15 +432,15 @@ inline bool CNavArea::IsOpen( void ) const
 //--------------------------------------------------------------------------------------------------------------
 inline bool CNavArea::IsOpenListEmpty( void )
 {
-	return (m_openList) ? false : true;
+	return (m_openList.Count()) ? false : true;
 }
 
 //--------------------------------------------------------------------------------------------------------------
 inline CNavArea *CNavArea::PopOpenList( void )
 {
-	if (m_openList)
+	if (m_openList.Count())
 	{
-		CNavArea *area = m_openList;
+		CNavArea *area = m_openList[0];
 	
 		// disconnect from list
 		area->RemoveFromOpenList();
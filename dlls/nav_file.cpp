@@ -10,6 +10,7 @@
 // Author: Michael S. Booth (mike@turtlerockstudios.com), January-September 2003
 
 #include "cbase.h"
+#include "utlbuffer.h"
 #include "nav_mesh.h"
 
 //--------------------------------------------------------------------------------------------------------------
@@ -109,21 +110,28 @@ public:
 	}
 
 	/// load the directory
-	void Load( FileHandle_t file )
+	void Load( CUtlBuffer &fileBuffer )
 	{
 		// read number of entries
-		IndexType count;
-		filesystem->Read( &count, sizeof(IndexType), file );
+		IndexType count = fileBuffer.GetUnsignedShort();
 
 		m_directory.EnsureCount( count );
 
 		// read each entry
 		char placeName[256];
+		const int maxLen = sizeof(placeName)-1;
 		unsigned short len;
 		for( int i=0; i<count; ++i )
 		{
-			filesystem->Read( &len, sizeof(unsigned short), file );
-			filesystem->Read( placeName, len, file );
+			// string length includes the terminator - clip names too long for our buffer
+			len = fileBuffer.GetUnsignedShort();
+			for( int c=0; c<len; ++c )
+			{
+				char ch = fileBuffer.GetChar();
+				if (c < maxLen)
+					placeName[c] = ch;
+			}
+			placeName[ min( (int)len, maxLen ) ] = '\0';
 
 			AddPlace( TheNavMesh->NameToPlace( placeName ) );
 		}
@@ -340,45 +348,49 @@ void CNavArea::Save( FileHandle_t file, unsigned int version ) const
 
 //--------------------------------------------------------------------------------------------------------------
 /**
- * Load a navigation area from the file
+ * Load a navigation area from the file image
  */
-void CNavArea::Load( FileHandle_t file, unsigned int version )
+void CNavArea::Load( CUtlBuffer &fileBuffer, unsigned int version )
 {
 	// load ID
-	filesystem->Read( &m_id, sizeof(unsigned int), file );
+	m_id = fileBuffer.GetUnsignedInt();
 
 	// update nextID to avoid collisions
 	if (m_id >= m_nextID)
 		m_nextID = m_id+1;
 
 	// load attribute flags
-	filesystem->Read( &m_attributeFlags, sizeof(unsigned char), file );
+	m_attributeFlags = fileBuffer.GetUnsignedChar();
 
 	// load extent of area
-	filesystem->Read( &m_extent, 6*sizeof(float), file );
+	m_extent.lo.x = fileBuffer.GetFloat();
+	m_extent.lo.y = fileBuffer.GetFloat();
+	m_extent.lo.z = fileBuffer.GetFloat();
+	m_extent.hi.x = fileBuffer.GetFloat();
+	m_extent.hi.y = fileBuffer.GetFloat();
+	m_extent.hi.z = fileBuffer.GetFloat();
 
 	m_center.x = (m_extent.lo.x + m_extent.hi.x)/2.0f;
 	m_center.y = (m_extent.lo.y + m_extent.hi.y)/2.0f;
 	m_center.z = (m_extent.lo.z + m_extent.hi.z)/2.0f;
 
 	// load heights of implicit corners
-	filesystem->Read( &m_neZ, sizeof(float), file );
-	filesystem->Read( &m_swZ, sizeof(float), file );
+	m_neZ = fileBuffer.GetFloat();
+	m_swZ = fileBuffer.GetFloat();
 
 	// load connections (IDs) to adjacent areas
 	// in the enum order NORTH, EAST, SOUTH, WEST
 	for( int d=0; d<NUM_DIRECTIONS; d++ )
 	{
 		// load number of connections for this direction
-		unsigned int count;
-		int result = filesystem->Read( &count, sizeof(unsigned int), file );
-		Assert( result == sizeof(unsigned int) );
+		unsigned int count = fileBuffer.GetUnsignedInt();
+		Assert( fileBuffer.IsValid() );
 
-		for( unsigned int i=0; i<count; ++i )
+		for( unsigned int i=0; i<count && fileBuffer.IsValid(); ++i )
 		{
 			NavConnect connect;
-			result = filesystem->Read( &connect.id, sizeof(unsigned int), file );
-			Assert( result == sizeof(unsigned int) );
+			connect.id = fileBuffer.GetUnsignedInt();
+			Assert( fileBuffer.IsValid() );
 
 			m_connect[d].AddToTail( connect );
 		}
@@ -389,8 +401,7 @@ void CNavArea::Load( FileHandle_t file, unsigned int version )
 	//
 
 	// load number of hiding spots
-	unsigned char hidingSpotCount;
-	filesystem->Read( &hidingSpotCount, sizeof(unsigned char), file );
+	unsigned char hidingSpotCount = fileBuffer.GetUnsignedChar();
 
 	if (version == 1)
 	{
@@ -398,7 +409,9 @@ void CNavArea::Load( FileHandle_t file, unsigned int version )
 		Vector pos;
 		for( int h=0; h<hidingSpotCount; ++h )
 		{
-			filesystem->Read( &pos, 3 * sizeof(float), file );
+			pos.x = fileBuffer.GetFloat();
+			pos.y = fileBuffer.GetFloat();
+			pos.z = fileBuffer.GetFloat();
 
 			// create new hiding spot and put on master list
 			HidingSpot *spot = new HidingSpot( &pos, HidingSpot::IN_COVER );
@@ -414,7 +427,7 @@ void CNavArea::Load( FileHandle_t file, unsigned int version )
 			// create new hiding spot and put on master list
 			HidingSpot *spot = new HidingSpot;
 
-			spot->Load( file, version );
+			spot->Load( fileBuffer, version );
 			
 			m_hidingSpotList.AddToTail( spot );
 		}
@@ -423,85 +436,62 @@ void CNavArea::Load( FileHandle_t file, unsigned int version )
 	//
 	// Load number of approach areas
 	//
-	filesystem->Read( &m_approachCount, sizeof(unsigned char), file );
+	m_approachCount = fileBuffer.GetUnsignedChar();
 
 	// load approach area info (IDs)
-	unsigned char type;
 	for( int a=0; a<m_approachCount; ++a )
 	{
-		filesystem->Read( &m_approach[a].here.id, sizeof(unsigned int), file );
+		m_approach[a].here.id = fileBuffer.GetUnsignedInt();
 
-		filesystem->Read( &m_approach[a].prev.id, sizeof(unsigned int), file );
-		filesystem->Read( &type, sizeof(unsigned char), file );
-		m_approach[a].prevToHereHow = (NavTraverseType)type;
+		m_approach[a].prev.id = fileBuffer.GetUnsignedInt();
+		m_approach[a].prevToHereHow = (NavTraverseType)fileBuffer.GetUnsignedChar();
 
-		filesystem->Read( &m_approach[a].next.id, sizeof(unsigned int), file );
-		filesystem->Read( &type, sizeof(unsigned char), file );
-		m_approach[a].hereToNextHow = (NavTraverseType)type;
+		m_approach[a].next.id = fileBuffer.GetUnsignedInt();
+		m_approach[a].hereToNextHow = (NavTraverseType)fileBuffer.GetUnsignedChar();
 	}
 
 
 	//
 	// Load encounter paths for this area
 	//
-	unsigned int count;
-	filesystem->Read( &count, sizeof(unsigned int), file );
+	unsigned int count = fileBuffer.GetUnsignedInt();
 
 	if (version < 3)
 	{
-		// old data, read and discard
-		for( unsigned int e=0; e<count; ++e )
-		{
-			SpotEncounter encounter;
+		// old data, skip it - each path is two IDs and two positions, 
+		// followed by a count of spots of four floats each
+		const int pathSize = 2 * sizeof(unsigned int) + 6 * sizeof(float);
+		const int spotSize = 4 * sizeof(float);
 
-			filesystem->Read( &encounter.from.id, sizeof(unsigned int), file );
-			filesystem->Read( &encounter.to.id, sizeof(unsigned int), file );
-
-			filesystem->Read( &encounter.path.from.x, 3 * sizeof(float), file );
-			filesystem->Read( &encounter.path.to.x, 3 * sizeof(float), file );
+		for( unsigned int e=0; e<count && fileBuffer.IsValid(); ++e )
+		{
+			fileBuffer.SeekGet( CUtlBuffer::SEEK_CURRENT, pathSize );
 
-			// read list of spots along this path
-			unsigned char spotCount;
-			filesystem->Read( &spotCount, sizeof(unsigned char), file );
-		
-			for( int s=0; s<spotCount; ++s )
-			{
-				Vector pos;
-				filesystem->Read( &pos, 3*sizeof(float), file );
-				filesystem->Read( &pos, sizeof(float), file );
-			}
+			// skip list of spots along this path
+			unsigned char spotCount = fileBuffer.GetUnsignedChar();
+			fileBuffer.SeekGet( CUtlBuffer::SEEK_CURRENT, spotCount * spotSize );
 		}
 		return;
 	}
 
-	for( unsigned int e=0; e<count; ++e )
+	for( unsigned int e=0; e<count && fileBuffer.IsValid(); ++e )
 	{
 		SpotEncounter *encounter = new SpotEncounter;
 
-		filesystem->Read( &encounter->from.id, sizeof(unsigned int), file );
-
-		unsigned char dir;
-		filesystem->Read( &dir, sizeof(unsigned char), file );
-		encounter->fromDir = static_cast<NavDirType>( dir );
-
-		filesystem->Read( &encounter->to.id, sizeof(unsigned int), file );
+		encounter->from.id = fileBuffer.GetUnsignedInt();
+		encounter->fromDir = static_cast<NavDirType>( fileBuffer.GetUnsignedChar() );
 
-		filesystem->Read( &dir, sizeof(unsigned char), file );
-		encounter->toDir = static_cast<NavDirType>( dir );
+		encounter->to.id = fileBuffer.GetUnsignedInt();
+		encounter->toDir = static_cast<NavDirType>( fileBuffer.GetUnsignedChar() );
 
 		// read list of spots along this path
-		unsigned char spotCount;
-		filesystem->Read( &spotCount, sizeof(unsigned char), file );
+		unsigned char spotCount = fileBuffer.GetUnsignedChar();
 	
 		SpotOrder order;
 		for( int s=0; s<spotCount; ++s )
 		{
-			filesystem->Read( &order.id, sizeof(unsigned int), file );
-
-			unsigned char t;
-			filesystem->Read( &t, sizeof(unsigned char), file );
-
-			order.t = (float)t/255.0f;
+			order.id = fileBuffer.GetUnsignedInt();
+			order.t = (float)fileBuffer.GetUnsignedChar()/255.0f;
 
 			encounter->spotList.AddToTail( order );
 		}
@@ -515,13 +505,170 @@ void CNavArea::Load( FileHandle_t file, unsigned int version )
 	//
 	// Load Place data
 	//
-	PlaceDirectory::IndexType entry;
-	filesystem->Read( &entry, sizeof(entry), file );
+	PlaceDirectory::IndexType entry = fileBuffer.GetUnsignedShort();
 
 	// convert entry to actual Place
 	SetPlace( placeDirectory.IndexToPlace( entry ) );
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Dense ID tables used to resolve the IDs in a nav file while it is being loaded.
+ * IDs are handed out sequentially, so indexing a flat array by ID replaces the hash chain
+ * walk for areas and the list walk for hiding spots on every reference.
+ * IDs too large to be indexed densely fall back to the regular lookups.
+ */
+static CUtlVector< CNavArea * > loadAreaIndex;
+static CUtlVector< HidingSpot * > loadSpotIndex;
+
+/// return the size of the table needed to index IDs up to maxID, capped so corrupt data can't make it huge
+static int GetLoadIndexSize( unsigned int maxID, int count )
+{
+	unsigned int limit = 4 * count + 1024;
+	return (maxID < limit) ? (int)maxID + 1 : (int)limit;
+}
+
+static void BuildLoadIndices( void )
+{
+	unsigned int maxID = 0;
+	FOR_EACH_LL( TheNavAreaList, it )
+	{
+		maxID = max( maxID, TheNavAreaList[ it ]->GetID() );
+	}
+
+	loadAreaIndex.SetSize( GetLoadIndexSize( maxID, TheNavAreaList.Count() ) );
+	for( int i=0; i<loadAreaIndex.Count(); ++i )
+		loadAreaIndex[i] = NULL;
+
+	// if IDs repeat, the hash table returns the area added last, so let later areas win
+	FOR_EACH_LL( TheNavAreaList, ait )
+	{
+		CNavArea *area = TheNavAreaList[ ait ];
+		unsigned int id = area->GetID();
+
+		if (id && id < (unsigned int)loadAreaIndex.Count())
+			loadAreaIndex[ id ] = area;
+	}
+
+	maxID = 0;
+	FOR_EACH_LL( TheHidingSpotList, sit )
+	{
+		maxID = max( maxID, TheHidingSpotList[ sit ]->GetID() );
+	}
+
+	loadSpotIndex.SetSize( GetLoadIndexSize( maxID, TheHidingSpotList.Count() ) );
+	for( int i=0; i<loadSpotIndex.Count(); ++i )
+		loadSpotIndex[i] = NULL;
+
+	// GetHidingSpotByID() returns the first spot with a given ID, so keep the first one
+	FOR_EACH_LL( TheHidingSpotList, hit )
+	{
+		HidingSpot *spot = TheHidingSpotList[ hit ];
+		unsigned int id = spot->GetID();
+
+		if (id < (unsigned int)loadSpotIndex.Count() && loadSpotIndex[ id ] == NULL)
+			loadSpotIndex[ id ] = spot;
+	}
+}
+
+static void PurgeLoadIndices( void )
+{
+	loadAreaIndex.Purge();
+	loadSpotIndex.Purge();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * With nav_check_load set, every ID resolved while linking is recorded, and afterwards looked up again
+ * through both the dense tables and the lookups they replaced. Overlap lists are also rebuilt by testing
+ * every area, as they were before the grid was used.
+ */
+ConVar nav_check_load( "nav_check_load", "0", 0, "Set to one to check the ID lookups and overlap lists built by nav_load against the lookups they replaced, and report any difference and the time each took." );
+
+static bool loadCheck = false;
+static CUtlVector< unsigned int > loadCheckAreaIDs;
+static CUtlVector< unsigned int > loadCheckSpotIDs;
+static int loadCheckOverlapMismatches = 0;
+static double loadCheckOverlapGridTime = 0.0;
+static double loadCheckOverlapAllTime = 0.0;
+
+inline CNavArea *GetLoadedNavAreaByID( unsigned int id )
+{
+	if (loadCheck)
+		loadCheckAreaIDs.AddToTail( id );
+
+	if (id < (unsigned int)loadAreaIndex.Count())
+		return loadAreaIndex[ id ];
+
+	return TheNavMesh->GetNavAreaByID( id );
+}
+
+inline HidingSpot *GetLoadedHidingSpotByID( unsigned int id )
+{
+	if (loadCheck)
+		loadCheckSpotIDs.AddToTail( id );
+
+	if (id < (unsigned int)loadSpotIndex.Count())
+		return loadSpotIndex[ id ];
+
+	return GetHidingSpotByID( id );
+}
+
+/// look up every ID recorded while linking both ways, and report any difference and the times
+static void ReportLoadCheck( void )
+{
+	loadCheck = false;
+
+	int mismatches = 0;
+
+	// count what each way finds, so neither loop can be optimized away
+	int denseFound = 0;
+	double start = Plat_FloatTime();
+	for( int i=0; i<loadCheckAreaIDs.Count(); ++i )
+		denseFound += (GetLoadedNavAreaByID( loadCheckAreaIDs[i] ) != NULL);
+	for( int i=0; i<loadCheckSpotIDs.Count(); ++i )
+		denseFound += (GetLoadedHidingSpotByID( loadCheckSpotIDs[i] ) != NULL);
+	double denseTime = Plat_FloatTime() - start;
+
+	int oldFound = 0;
+	start = Plat_FloatTime();
+	for( int i=0; i<loadCheckAreaIDs.Count(); ++i )
+		oldFound += (TheNavMesh->GetNavAreaByID( loadCheckAreaIDs[i] ) != NULL);
+	for( int i=0; i<loadCheckSpotIDs.Count(); ++i )
+		oldFound += (GetHidingSpotByID( loadCheckSpotIDs[i] ) != NULL);
+	double oldTime = Plat_FloatTime() - start;
+
+	for( int i=0; i<loadCheckAreaIDs.Count(); ++i )
+	{
+		unsigned int id = loadCheckAreaIDs[i];
+		if (GetLoadedNavAreaByID( id ) != TheNavMesh->GetNavAreaByID( id ))
+		{
+			if (mismatches < 10)
+				Msg( "nav_check_load: area ID %u resolves to a different area\n", id );
+			++mismatches;
+		}
+	}
+
+	for( int i=0; i<loadCheckSpotIDs.Count(); ++i )
+	{
+		unsigned int id = loadCheckSpotIDs[i];
+		if (GetLoadedHidingSpotByID( id ) != GetHidingSpotByID( id ))
+		{
+			if (mismatches < 10)
+				Msg( "nav_check_load: hiding spot ID %u resolves to a different spot\n", id );
+			++mismatches;
+		}
+	}
+
+	Msg( "nav_check_load: %d area and %d hiding spot lookups, %d mismatches, tables found %d in %.3f ms, old lookups found %d in %.3f ms\n",
+		 loadCheckAreaIDs.Count(), loadCheckSpotIDs.Count(), mismatches, denseFound, 1000.0 * denseTime, oldFound, 1000.0 * oldTime );
+	Msg( "nav_check_load: %d areas, %d overlap lists differ, grid %.3f ms, every area %.3f ms\n",
+		 TheNavAreaList.Count(), loadCheckOverlapMismatches, 1000.0 * loadCheckOverlapGridTime, 1000.0 * loadCheckOverlapAllTime );
+
+	loadCheckAreaIDs.Purge();
+	loadCheckSpotIDs.Purge();
+}
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Convert loaded IDs to pointers
@@ -539,7 +686,7 @@ NavErrorType CNavArea::PostLoad( void )
 			NavConnect *connect = &m_connect[ d ][ it ];
 
 			unsigned int id = connect->id;
-			connect->area = TheNavMesh->GetNavAreaByID( id );
+			connect->area = GetLoadedNavAreaByID( id );
 			if (id && connect->area == NULL)
 			{
 				Error( "CNavArea::PostLoad: Corrupt navigation data. Cannot connect Navigation Areas.\n" );
@@ -551,21 +698,21 @@ NavErrorType CNavArea::PostLoad( void )
 	// resolve approach area IDs
 	for( int a=0; a<m_approachCount; ++a )
 	{
-		m_approach[a].here.area = TheNavMesh->GetNavAreaByID( m_approach[a].here.id );
+		m_approach[a].here.area = GetLoadedNavAreaByID( m_approach[a].here.id );
 		if (m_approach[a].here.id && m_approach[a].here.area == NULL)
 		{
 			Error( "CNavArea::PostLoad: Corrupt navigation data. Missing Approach Area (here).\n" );
 			error = NAV_CORRUPT_DATA;
 		}
 
-		m_approach[a].prev.area = TheNavMesh->GetNavAreaByID( m_approach[a].prev.id );
+		m_approach[a].prev.area = GetLoadedNavAreaByID( m_approach[a].prev.id );
 		if (m_approach[a].prev.id && m_approach[a].prev.area == NULL)
 		{
 			Error( "CNavArea::PostLoad: Corrupt navigation data. Missing Approach Area (prev).\n" );
 			error = NAV_CORRUPT_DATA;
 		}
 
-		m_approach[a].next.area = TheNavMesh->GetNavAreaByID( m_approach[a].next.id );
+		m_approach[a].next.area = GetLoadedNavAreaByID( m_approach[a].next.id );
 		if (m_approach[a].next.id && m_approach[a].next.area == NULL)
 		{
 			Error( "CNavArea::PostLoad: Corrupt navigation data. Missing Approach Area (next).\n" );
@@ -579,14 +726,14 @@ NavErrorType CNavArea::PostLoad( void )
 	{
 		e = m_spotEncounterList[ it ];
 
-		e->from.area = TheNavMesh->GetNavAreaByID( e->from.id );
+		e->from.area = GetLoadedNavAreaByID( e->from.id );
 		if (e->from.area == NULL)
 		{
 			Error( "CNavArea::PostLoad: Corrupt navigation data. Missing \"from\" Navigation Area for Encounter Spot.\n" );
 			error = NAV_CORRUPT_DATA;
 		}
 
-		e->to.area = TheNavMesh->GetNavAreaByID( e->to.id );
+		e->to.area = GetLoadedNavAreaByID( e->to.id );
 		if (e->to.area == NULL)
 		{
 			Error( "CNavArea::PostLoad: Corrupt navigation data. Missing \"to\" Navigation Area for Encounter Spot.\n" );
@@ -610,7 +757,7 @@ NavErrorType CNavArea::PostLoad( void )
 		{
 			SpotOrder *order = &e->spotList[ sit ];
 
-			order->spot = GetHidingSpotByID( order->id );
+			order->spot = GetLoadedHidingSpotByID( order->id );
 			if (order->spot == NULL)
 			{
 				Error( "CNavArea::PostLoad: Corrupt navigation data. Missing Hiding Spot\n" );
@@ -619,17 +766,69 @@ NavErrorType CNavArea::PostLoad( void )
 		}
 	}
 
-	// build overlap list
-	/// @todo Optimize this
-	FOR_EACH_LL( TheNavAreaList, nit )
+	// build overlap list - only areas sharing a grid cell with us can overlap us
+	double overlapStart = (loadCheck) ? Plat_FloatTime() : 0.0;
+
+	CNavArea::MakeNewMarker();
+	Mark();
+
+	int loX = TheNavMesh->WorldToGridX( m_extent.lo.x );
+	int loY = TheNavMesh->WorldToGridY( m_extent.lo.y );
+	int hiX = TheNavMesh->WorldToGridX( m_extent.hi.x );
+	int hiY = TheNavMesh->WorldToGridY( m_extent.hi.y );
+
+	for( int y = loY; y <= hiY; ++y )
 	{
-		CNavArea *area = TheNavAreaList[ nit ];
+		for( int x = loX; x <= hiX; ++x )
+		{
+			NavAreaList *list = &TheNavMesh->m_grid[ x + y*TheNavMesh->m_gridSizeX ];
+
+			FOR_EACH_LL( (*list), nit )
+			{
+				CNavArea *area = (*list)[ nit ];
+
+				// areas span several cells, only test each one once
+				if (area->IsMarked())
+					continue;
+
+				area->Mark();
+
+				if (IsOverlapping( area ))
+					m_overlapList.AddToTail( area );
+			}
+		}
+	}
+
+	if (loadCheck)
+	{
+		loadCheckOverlapGridTime += Plat_FloatTime() - overlapStart;
 
-		if (area == this)
-			continue;
+		// the overlap list as it was built before, testing every area
+		overlapStart = Plat_FloatTime();
+		int overlapCount = 0;
+		bool overlapMatch = true;
+		FOR_EACH_LL( TheNavAreaList, nit )
+		{
+			CNavArea *area = TheNavAreaList[ nit ];
+
+			if (area == this)
+				continue;
+
+			if (IsOverlapping( area ))
+			{
+				++overlapCount;
+				if (m_overlapList.Find( area ) == m_overlapList.InvalidIndex())
+					overlapMatch = false;
+			}
+		}
+		loadCheckOverlapAllTime += Plat_FloatTime() - overlapStart;
 
-		if (IsOverlapping( area ))
-			m_overlapList.AddToTail( area );
+		if (!overlapMatch || overlapCount != m_overlapList.Count())
+		{
+			if (loadCheckOverlapMismatches < 10)
+				Msg( "nav_check_load: area #%d has %d overlapping areas, %d by testing every area\n", m_id, m_overlapList.Count(), overlapCount );
+			++loadCheckOverlapMismatches;
+		}
 	}
 
 	return error;
@@ -792,38 +991,45 @@ NavErrorType CNavMesh::Load( void )
 		return NAV_CANT_ACCESS_FILE;
 	}
 
+	double startTime = Plat_FloatTime();
+
+	// read the file in one gulp and parse it from memory
+	int fileSize = filesystem->Size( file );
+	CUtlBuffer fileBuffer( 0, fileSize, false );
+	int result = filesystem->Read( fileBuffer.Base(), fileSize, file );
+	filesystem->Close( file );
+
+	if (result != fileSize)
+	{
+		Error( "Invalid navigation file '%s'.\n", filename );
+		return NAV_INVALID_FILE;
+	}
+
 	// check magic number
-	int result;
-	unsigned int magic;
-	result = filesystem->Read( &magic, sizeof(unsigned int), file );
-	if (!result || magic != NAV_MAGIC_NUMBER)
+	unsigned int magic = fileBuffer.GetUnsignedInt();
+	if (!fileBuffer.IsValid() || magic != NAV_MAGIC_NUMBER)
 	{
 		Error( "Invalid navigation file '%s'.\n", filename );
-		filesystem->Close( file );
 		return NAV_INVALID_FILE;
 	}
 
 	// read file version number
-	unsigned int version;
-	result = filesystem->Read( &version, sizeof(unsigned int), file );
-	if (!result || version > 5)
+	unsigned int version = fileBuffer.GetUnsignedInt();
+	if (!fileBuffer.IsValid() || version > 5)
 	{
 		Error( "Unknown navigation file version.\n" );
-		filesystem->Close( file );
 		return NAV_BAD_FILE_VERSION;
 	}
 
 	if (version >= 4)
 	{
 		// get size of source bsp file and verify that the bsp hasn't changed
-		unsigned int saveBspSize;
-		filesystem->Read( &saveBspSize, sizeof(unsigned int), file );
+		unsigned int saveBspSize = fileBuffer.GetUnsignedInt();
 
 		// verify size
 		char *bspFilename = GetBspFilename( filename );
 		if ( bspFilename == NULL )
 		{
-			filesystem->Close( file );
 			return NAV_INVALID_FILE;
 		}
 
@@ -838,12 +1044,11 @@ NavErrorType CNavMesh::Load( void )
 	// load Place directory
 	if (version >= 5)
 	{
-		placeDirectory.Load( file );
+		placeDirectory.Load( fileBuffer );
 	}
 
 	// get number of areas
-	unsigned int count;
-	result = filesystem->Read( &count, sizeof(unsigned int), file );
+	unsigned int count = fileBuffer.GetUnsignedInt();
 
 	Extent extent;
 	extent.lo.x = 9999999999.9f;
@@ -852,10 +1057,10 @@ NavErrorType CNavMesh::Load( void )
 	extent.hi.y = -9999999999.9f;
 
 	// load the areas and compute total extent
-	for( unsigned int i=0; i<count; ++i )
+	for( unsigned int i=0; i<count && fileBuffer.IsValid(); ++i )
 	{
 		CNavArea *area = new CNavArea;
-		area->Load( file, version );
+		area->Load( fileBuffer, version );
 		TheNavAreaList.AddToTail( area );
 
 		const Extent *areaExtent = area->GetExtent();
@@ -875,6 +1080,16 @@ NavErrorType CNavMesh::Load( void )
 			extent.hi.y = areaExtent->hi.y;
 	}
 
+	if (!fileBuffer.IsValid())
+	{
+		// the file ended before all of the areas it claims to hold were read
+		Warning( "Navigation file '%s' is truncated.\n", filename );
+		Reset();
+		return NAV_CORRUPT_DATA;
+	}
+
+	double readTime = Plat_FloatTime();
+
 	// add the areas to the grid
 	AllocateGrid( extent.lo.x, extent.hi.x, extent.lo.y, extent.hi.y );
 
@@ -885,12 +1100,24 @@ NavErrorType CNavMesh::Load( void )
 
 
 	// allow areas to connect to each other, etc
+	BuildLoadIndices();
+
+	loadCheck = nav_check_load.GetBool();
+	loadCheckOverlapMismatches = 0;
+	loadCheckOverlapGridTime = 0.0;
+	loadCheckOverlapAllTime = 0.0;
+
 	FOR_EACH_LL( TheNavAreaList, pit )
 	{
 		CNavArea *area = TheNavAreaList[ pit ];
 		area->PostLoad();
 	}
 
+	if (loadCheck)
+		ReportLoadCheck();
+
+	PurgeLoadIndices();
+
 	//
 	// Set up all the ladders
 	//
@@ -899,7 +1126,10 @@ NavErrorType CNavMesh::Load( void )
 	// the Navigation Mesh has been successfully loaded
 	m_isLoaded = true;
 
-	filesystem->Close( file );
+	double endTime = Plat_FloatTime();
+	DevMsg( "Loaded %d navigation areas, %d hiding spots from %d bytes in %.3f seconds (read %.3f, link %.3f)\n",
+			TheNavAreaList.Count(), TheHidingSpotList.Count(), fileSize,
+			endTime - startTime, readTime - startTime, endTime - readTime );
 
 	return NAV_OK;
 }
@@ -13,6 +13,7 @@
 #include "nav_mesh.h"
 #include "nav_node.h"
 #include "nav_pathfind.h"
+#include "checksum_crc.h"
 
 enum { MAX_BLOCKED_AREAS = 256 };
 static unsigned int blockedID[ MAX_BLOCKED_AREAS ];
@@ -1127,6 +1128,7 @@ void CNavMesh::CreateNavAreasFromNodes( void )
 void CNavMesh::BeginGeneration( void )
 {
 	m_generationState = SAMPLE_WALKABLE_SPACE;
+	m_generationIndex = TheNavAreaList.InvalidIndex();
 	m_isGenerating = true;
 
 	// clear any previous mesh
@@ -1171,6 +1173,31 @@ void CNavMesh::BeginGeneration( void )
 	Msg( "Generating Navigation Mesh...\n" );
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * CRC the saved navigation map, so meshes generated in batch mode and across time slices
+ * can be checked to be byte for byte the same
+ */
+static bool ComputeNavFileCRC( const char *filename, CRC32_t *crc )
+{
+	FileHandle_t file = filesystem->Open( filename, "rb" );
+	if (!file)
+		return false;
+
+	CRC32_Init( crc );
+
+	char buffer[ 4096 ];
+	int count;
+	while( (count = filesystem->Read( buffer, sizeof(buffer), file )) > 0 )
+	{
+		CRC32_ProcessBuffer( crc, buffer, count );
+	}
+
+	filesystem->Close( file );
+	CRC32_Final( crc );
+	return true;
+}
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Process the auto-generation for 'maxTime' seconds. return false if generation is complete.
@@ -1207,6 +1234,7 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 			CreateNavAreasFromNodes();
 			DestroyHidingSpots();
 
+			m_generationIndex = TheNavAreaList.Head();
 			m_generationState = FIND_HIDING_SPOTS;
 			return true;
 		}
@@ -1216,9 +1244,11 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 		{
 			Msg( "Finding hiding spots...\n" );
 
-			FOR_EACH_LL( TheNavAreaList, it )
+			// pick up where the last time slice left off
+			while( m_generationIndex != TheNavAreaList.InvalidIndex() )
 			{
-				CNavArea *area = TheNavAreaList[ it ];
+				CNavArea *area = TheNavAreaList[ m_generationIndex ];
+				m_generationIndex = TheNavAreaList.Next( m_generationIndex );
 
 				area->ComputeHidingSpots();
 
@@ -1229,6 +1259,7 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 				}
 			}
 
+			m_generationIndex = TheNavAreaList.Head();
 			m_generationState = FIND_APPROACH_AREAS;
 			return true;
 		}
@@ -1238,9 +1269,11 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 		{
 			Msg( "Finding approach areas...\n" );
 
-			FOR_EACH_LL( TheNavAreaList, it )
+			// pick up where the last time slice left off
+			while( m_generationIndex != TheNavAreaList.InvalidIndex() )
 			{
-				CNavArea *area = TheNavAreaList[ it ];
+				CNavArea *area = TheNavAreaList[ m_generationIndex ];
+				m_generationIndex = TheNavAreaList.Next( m_generationIndex );
 
 				area->ComputeApproachAreas();
 
@@ -1251,6 +1284,7 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 				}
 			}
 
+			m_generationIndex = TheNavAreaList.Head();
 			m_generationState = FIND_ENCOUNTER_SPOTS;
 			return true;
 		}
@@ -1260,9 +1294,11 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 		{
 			Msg( "Finding encounter spots...\n" );
 
-			FOR_EACH_LL( TheNavAreaList, it )
+			// pick up where the last time slice left off
+			while( m_generationIndex != TheNavAreaList.InvalidIndex() )
 			{
-				CNavArea *area = TheNavAreaList[ it ];
+				CNavArea *area = TheNavAreaList[ m_generationIndex ];
+				m_generationIndex = TheNavAreaList.Next( m_generationIndex );
 
 				area->ComputeSpotEncounters();
 
@@ -1273,6 +1309,7 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 				}
 			}
 
+			m_generationIndex = TheNavAreaList.Head();
 			m_generationState = FIND_SNIPER_SPOTS;
 			return true;
 		}
@@ -1282,9 +1319,11 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 		{
 			Msg( "Finding sniper spots...\n" );
 
-			FOR_EACH_LL( TheNavAreaList, it )
+			// pick up where the last time slice left off
+			while( m_generationIndex != TheNavAreaList.InvalidIndex() )
 			{
-				CNavArea *area = TheNavAreaList[ it ];
+				CNavArea *area = TheNavAreaList[ m_generationIndex ];
+				m_generationIndex = TheNavAreaList.Next( m_generationIndex );
 
 				area->ComputeSniperSpots();
 
@@ -1302,7 +1341,15 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 			// save the mesh
 			if (Save())
 			{
-				Msg( "Navigation map '%s' saved.\n", GetFilename() );
+				CRC32_t crc;
+				if (ComputeNavFileCRC( GetFilename(), &crc ))
+				{
+					Msg( "Navigation map '%s' saved, CRC %08lX.\n", GetFilename(), crc );
+				}
+				else
+				{
+					Msg( "Navigation map '%s' saved.\n", GetFilename() );
+				}
 			}
 			else
 			{
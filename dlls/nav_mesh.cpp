@@ -11,8 +11,10 @@
 
 #include "cbase.h"
 #include "filesystem.h"
+#include "utlbuffer.h"
 #include "nav_mesh.h"
 #include "nav_node.h"
+#include "nav_pathfind.h"
 
 #define DrawLine( from, to, duration, red, green, blue )		NDebugOverlay::Line( from, to, red, green, blue, true, 0.1f )
 
@@ -26,6 +28,8 @@ ConVar nav_edit( "nav_edit", "0", 0, "Set to one to interactively edit the Navig
 ConVar nav_quicksave( "nav_quicksave", "1", 0, "Set to one to skip the time consuming phases of the analysis.  Useful for data collection and testing." );
 ConVar nav_show_approach_points( "nav_show_approach_points", "0", 0, "Show Approach Points in the Navigation Mesh." );
 ConVar nav_show_danger( "nav_show_danger", "0", 0, "Show current 'danger' levels." );
+ConVar nav_generate_batch( "nav_generate_batch", "0", 0, "Set to one to run each phase of nav_generate to completion in a single frame instead of spreading it across frames. The server will not respond until generation is done." );
+ConVar nav_generate_slice_time( "nav_generate_slice_time", "0.25", 0, "Seconds of nav_generate to run each frame when not in batch mode. Set it very small to make the analysis resume after nearly every area, then compare the saved mesh's CRC with a batch run.", true, 0.001f, false, 0.0f );
 
 
 
@@ -35,6 +39,7 @@ CNavMesh::CNavMesh( void )
 	m_grid = NULL;
 	m_spawnName = NULL;
 	m_gridCellSize = 300.0f;
+	m_nearestSearchMarker = 0;
 
 	LoadPlaceDatabase();
 
@@ -145,7 +150,17 @@ void CNavMesh::DestroyNavigationMesh( void )
 void CNavMesh::Update( void )
 {
 	if (IsGenerating())
-		UpdateGeneration();
+	{
+		if (nav_generate_batch.GetBool())
+		{
+			// run each phase to completion - nothing else is going on while a mesh is generated offline
+			UpdateGeneration( 999999.9f );
+		}
+		else
+		{
+			UpdateGeneration( nav_generate_slice_time.GetFloat() );
+		}
+	}
 
 	if (nav_edit.GetBool())
 		UpdateEditMode();
@@ -340,6 +355,17 @@ CNavArea *CNavMesh::GetNavArea( const Vector *pos, float beneathLimit ) const
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * An area GetNearestNavArea might return, and the point on it closest to the source
+ */
+struct NearestCandidate
+{
+	CNavArea *area;
+	Vector pos;
+	float distSq;
+};
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Given a position in the world, return the nav area that is closest
@@ -372,35 +398,119 @@ CNavArea *CNavMesh::GetNearestNavArea( const Vector *pos, bool anyZ ) const
 
 	source.z += HalfHumanHeight;
 
-	/// @todo Step incrementally using grid for speed
+	// Step outward from the source's grid cell one ring of cells at a time. Once every cell
+	// within 'ring' of the source has been searched, any area we haven't seen lies entirely
+	// outside that block of cells, so we can stop as soon as the block's edge is further
+	// away than the closest area found so far.
+	static CUtlVector< NearestCandidate > candidates;
 
-	// find closest nav area
-	FOR_EACH_LL( TheNavAreaList, it )
+	// areas span several cells, so stamp each one the first time we see it this search
+	if (++m_nearestSearchMarker == 0)
+		m_nearestSearchMarker = 1;
+
+	int centerX = WorldToGridX( source.x );
+	int centerY = WorldToGridY( source.y );
+
+	for( int ring = 0; ; ++ring )
 	{
-		CNavArea *area = TheNavAreaList[ it ];
+		int loX = centerX - ring;
+		int hiX = centerX + ring;
+		int loY = centerY - ring;
+		int hiY = centerY + ring;
 
-		Vector areaPos;
-		area->GetClosestPointOnArea( &source, &areaPos );
+		// collect the unseen areas in this ring that could beat the current best
+		candidates.RemoveAll();
 
-		float distSq = (areaPos - source).LengthSqr();
+		for( int y = max( loY, 0 ); y <= min( hiY, m_gridSizeY-1 ); ++y )
+		{
+			// interior rows only touch the left and right columns of the ring
+			int step = (y == loY || y == hiY) ? 1 : hiX - loX;
+			if (step <= 0)
+				step = 1;
 
-		// keep the closest area
-		if (distSq < closeDistSq)
+			for( int x = loX; x <= hiX; x += step )
+			{
+				if (x < 0 || x >= m_gridSizeX)
+					continue;
+
+				NavAreaList *list = &m_grid[ x + y*m_gridSizeX ];
+				FOR_EACH_LL( (*list), it )
+				{
+					CNavArea *area = (*list)[ it ];
+
+					if (area->m_nearestSearchMarker == m_nearestSearchMarker)
+						continue;
+
+					area->m_nearestSearchMarker = m_nearestSearchMarker;
+
+					NearestCandidate candidate;
+					candidate.area = area;
+					area->GetClosestPointOnArea( &source, &candidate.pos );
+					candidate.distSq = (candidate.pos - source).LengthSqr();
+
+					if (candidate.distSq < closeDistSq)
+					{
+						candidates.AddToTail( candidate );
+					}
+				}
+			}
+		}
+
+		// try the candidates nearest first, so we only trace until one is visible
+		for( int i=1; i<candidates.Count(); ++i )
+		{
+			NearestCandidate candidate = candidates[i];
+
+			int j;
+			for( j=i; j > 0 && candidates[j-1].distSq > candidate.distSq; --j )
+				candidates[j] = candidates[j-1];
+
+			candidates[j] = candidate;
+		}
+
+		for( int i=0; i<candidates.Count(); ++i )
 		{
+			const NearestCandidate &candidate = candidates[i];
+
+			if (candidate.distSq >= closeDistSq)
+				break;
+
 			// check LOS to area
 			if (!anyZ)
 			{
 				trace_t result;
-				UTIL_TraceLine( source, areaPos + Vector( 0, 0, HalfHumanHeight ), MASK_PLAYERSOLID_BRUSHONLY, NULL, COLLISION_GROUP_NONE, &result );
+				UTIL_TraceLine( source, candidate.pos + Vector( 0, 0, HalfHumanHeight ), MASK_PLAYERSOLID_BRUSHONLY, NULL, COLLISION_GROUP_NONE, &result );
 				if (result.fraction != 1.0f)
 				{
 					continue;
 				}
 			}
-					
-			closeDistSq = distSq;
-			close = area;
+
+			closeDistSq = candidate.distSq;
+			close = candidate.area;
+			break;
 		}
+
+		// find how far the source is from the nearest cell we haven't searched yet
+		// sides that reach the edge of the grid have nothing beyond them
+		const float unbounded = 999999999.9f;
+		float edgeDist = unbounded;
+
+		if (loX > 0)
+			edgeDist = min( edgeDist, source.x - (m_minX + loX * m_gridCellSize) );
+		if (hiX < m_gridSizeX-1)
+			edgeDist = min( edgeDist, (m_minX + (hiX+1) * m_gridCellSize) - source.x );
+		if (loY > 0)
+			edgeDist = min( edgeDist, source.y - (m_minY + loY * m_gridCellSize) );
+		if (hiY < m_gridSizeY-1)
+			edgeDist = min( edgeDist, (m_minY + (hiY+1) * m_gridCellSize) - source.y );
+
+		// the whole grid has been searched
+		if (edgeDist == unbounded)
+			break;
+
+		if (edgeDist > 0.0f && edgeDist * edgeDist >= closeDistSq)
+			break;
 	}
 
 	return close;
@@ -757,8 +867,8 @@ void CNavMesh::IncreaseDangerNearby( int teamID, float amount, CNavArea *startAr
 	CNavArea::MakeNewMarker();
 	CNavArea::ClearSearchLists();
 
-	startArea->AddToOpenList();
 	startArea->SetTotalCost( 0.0f );
+	startArea->AddToOpenList();
 	startArea->Mark();
 	startArea->IncreaseDanger( teamID, amount );
 
@@ -781,8 +891,8 @@ void CNavMesh::IncreaseDangerNearby( int teamID, float amount, CNavArea *startAr
 					float cost = (*adjArea->GetCenter() - *pos).Length();
 					if (cost <= maxRadius)
 					{
-						adjArea->AddToOpenList();
 						adjArea->SetTotalCost( cost );
+						adjArea->AddToOpenList();
 						adjArea->Mark();
 						adjArea->IncreaseDanger( teamID, amount * cost/maxRadius );
 					}
@@ -917,6 +1027,610 @@ void CommandNavLoad( void )
 }
 static ConCommand nav_load( "nav_load", CommandNavLoad, "Loads the Navigation Mesh for the current map.", FCVAR_GAMEDLL );
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Reference A* for nav_check_paths. This is NavAreaBuildPath() with ShortestPathCost as it ran before the
+ * open list became a heap: the open list is the cost-sorted linked list, and the search state is kept in
+ * a table indexed by area ID so it doesn't disturb the state the real search leaves on each CNavArea.
+ */
+class CNavReferencePath
+{
+public:
+	void Reset( void );
+	bool Build( CNavArea *startArea, CNavArea *goalArea, const Vector *goalPos, CNavArea **closestArea );
+
+	CNavArea *GetParent( const CNavArea *area ) const			{ return m_node[ area->GetID() ].parent; }
+	NavTraverseType GetParentHow( const CNavArea *area ) const	{ return m_node[ area->GetID() ].parentHow; }
+
+private:
+	struct Node
+	{
+		CNavArea *area;
+		CNavArea *parent;
+		NavTraverseType parentHow;
+		float costSoFar;
+		float totalCost;
+		unsigned int marker;
+		unsigned int openMarker;
+		Node *prevOpen;
+		Node *nextOpen;
+	};
+
+	Node *GetNode( const CNavArea *area )			{ return &m_node[ area->GetID() ]; }
+	bool IsOpen( const Node *node ) const			{ return (node->openMarker == m_masterMarker); }
+	bool IsClosed( const Node *node ) const			{ return (node->marker == m_masterMarker && !IsOpen( node )); }
+
+	float Cost( CNavArea *area, CNavArea *fromArea, const CNavLadder *ladder );
+
+	void AddToOpenList( Node *node );
+	void UpdateOnOpenList( Node *node );
+	void RemoveFromOpenList( Node *node );
+
+	CUtlVector< Node > m_node;
+	Node *m_openList;
+	unsigned int m_masterMarker;
+};
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavReferencePath::Reset( void )
+{
+	unsigned int maxID = 0;
+	FOR_EACH_LL( TheNavAreaList, it )
+	{
+		if (TheNavAreaList[ it ]->GetID() > maxID)
+			maxID = TheNavAreaList[ it ]->GetID();
+	}
+
+	m_node.SetCount( maxID + 1 );
+	memset( m_node.Base(), 0, m_node.Count() * sizeof(Node) );
+
+	FOR_EACH_LL( TheNavAreaList, it )
+	{
+		GetNode( TheNavAreaList[ it ] )->area = TheNavAreaList[ it ];
+	}
+
+	m_openList = NULL;
+	m_masterMarker = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * ShortestPathCost, reading the cost so far from the reference table
+ */
+float CNavReferencePath::Cost( CNavArea *area, CNavArea *fromArea, const CNavLadder *ladder )
+{
+	if (fromArea == NULL)
+		return 0.0f;
+
+	float dist;
+
+	if (ladder)
+		dist = ladder->m_length;
+	else
+		dist = (*area->GetCenter() - *fromArea->GetCenter()).Length();
+
+	float cost = dist + GetNode( fromArea )->costSoFar;
+
+	if (area->GetAttributes() & NAV_MESH_CROUCH)
+	{
+		const float crouchPenalty = 20.0f;
+		cost += crouchPenalty * dist;
+	}
+
+	if (area->GetAttributes() & NAV_MESH_JUMP)
+	{
+		const float jumpPenalty = 5.0f;
+		cost += jumpPenalty * dist;
+	}
+
+	return cost;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Insert before the first node with a strictly greater total cost
+ */
+void CNavReferencePath::AddToOpenList( Node *node )
+{
+	node->openMarker = m_masterMarker;
+
+	Node *other, *last = NULL;
+	for( other = m_openList; other; other = other->nextOpen )
+	{
+		if (node->totalCost < other->totalCost)
+			break;
+
+		last = other;
+	}
+
+	if (other)
+	{
+		node->prevOpen = other->prevOpen;
+		if (node->prevOpen)
+			node->prevOpen->nextOpen = node;
+		else
+			m_openList = node;
+
+		node->nextOpen = other;
+		other->prevOpen = node;
+	}
+	else
+	{
+		node->prevOpen = last;
+		node->nextOpen = NULL;
+
+		if (last)
+			last->nextOpen = node;
+		else
+			m_openList = node;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Bubble toward the front while strictly cheaper than the predecessor
+ */
+void CNavReferencePath::UpdateOnOpenList( Node *node )
+{
+	while( node->prevOpen && node->totalCost < node->prevOpen->totalCost )
+	{
+		Node *other = node->prevOpen;
+		Node *before = other->prevOpen;
+		Node *after = node->nextOpen;
+
+		node->nextOpen = other;
+		node->prevOpen = before;
+
+		other->prevOpen = node;
+		other->nextOpen = after;
+
+		if (before)
+			before->nextOpen = node;
+		else
+			m_openList = node;
+
+		if (after)
+			after->prevOpen = other;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavReferencePath::RemoveFromOpenList( Node *node )
+{
+	if (node->prevOpen)
+		node->prevOpen->nextOpen = node->nextOpen;
+	else
+		m_openList = node->nextOpen;
+
+	if (node->nextOpen)
+		node->nextOpen->prevOpen = node->prevOpen;
+
+	node->openMarker = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Same search, in the same order, as NavAreaBuildPath()
+ */
+bool CNavReferencePath::Build( CNavArea *startArea, CNavArea *goalArea, const Vector *goalPos, CNavArea **closestArea )
+{
+	if (startArea == NULL)
+		return false;
+
+	if (goalArea == NULL && goalPos == NULL)
+		return false;
+
+	Node *startNode = GetNode( startArea );
+	startNode->parent = NULL;
+	startNode->parentHow = NUM_TRAVERSE_TYPES;
+
+	if (startArea == goalArea)
+		return true;
+
+	Vector actualGoalPos = (goalPos) ? *goalPos : *goalArea->GetCenter();
+
+	++m_masterMarker;
+	if (m_masterMarker == 0)
+		m_masterMarker = 1;
+	m_openList = NULL;
+
+	startNode->totalCost = (*startArea->GetCenter() - actualGoalPos).Length();
+	startNode->costSoFar = Cost( startArea, NULL, NULL );
+	AddToOpenList( startNode );
+
+	if (closestArea)
+		*closestArea = startArea;
+	float closestAreaDist = startNode->totalCost;
+
+	while( m_openList )
+	{
+		Node *node = m_openList;
+		RemoveFromOpenList( node );
+
+		CNavArea *area = node->area;
+		if (area == goalArea)
+			return true;
+
+		bool searchFloor = true;
+		int dir = NORTH;
+		const NavConnectList *floorList = area->GetAdjacentList( NORTH );
+		int floorIter = floorList->Head();
+
+		bool ladderUp = true;
+		const NavLadderList *ladderList = NULL;
+		int ladderIter = NavLadderList::InvalidIndex();
+		enum { AHEAD = 0, LEFT, RIGHT, BEHIND, NUM_TOP_DIRECTIONS };
+		int ladderTopDir = AHEAD;
+
+		while(true)
+		{
+			CNavArea *newArea;
+			NavTraverseType how;
+			const CNavLadder *ladder = NULL;
+
+			if (searchFloor)
+			{
+				if (floorIter == floorList->InvalidIndex())
+				{
+					++dir;
+
+					if (dir == NUM_DIRECTIONS)
+					{
+						searchFloor = false;
+
+						ladderList = area->GetLadderList( CNavLadder::LADDER_UP );
+						ladderIter = ladderList->Head();
+						ladderTopDir = AHEAD;
+					}
+					else
+					{
+						floorList = area->GetAdjacentList( (NavDirType)dir );
+						floorIter = floorList->Head();
+					}
+
+					continue;
+				}
+
+				newArea = floorList->Element(floorIter).area;
+				how = (NavTraverseType)dir;
+				floorIter = floorList->Next( floorIter );
+			}
+			else
+			{
+				if (ladderIter == ladderList->InvalidIndex())
+				{
+					if (!ladderUp)
+						break;
+
+					ladderUp = false;
+					ladderList = area->GetLadderList( CNavLadder::LADDER_DOWN );
+					ladderIter = ladderList->Head();
+					continue;
+				}
+
+				if (ladderUp)
+				{
+					ladder = ladderList->Element( ladderIter );
+
+					if (ladder->m_isDangling)
+					{
+						ladderIter = ladderList->Next( ladderIter );
+						continue;
+					}
+
+					if (ladderTopDir == AHEAD)
+						newArea = ladder->m_topForwardArea;
+					else if (ladderTopDir == LEFT)
+						newArea = ladder->m_topLeftArea;
+					else if (ladderTopDir == RIGHT)
+						newArea = ladder->m_topRightArea;
+					else
+					{
+						ladderIter = ladderList->Next( ladderIter );
+						continue;
+					}
+
+					how = GO_LADDER_UP;
+					++ladderTopDir;
+				}
+				else
+				{
+					newArea = ladderList->Element(ladderIter)->m_bottomArea;
+					how = GO_LADDER_DOWN;
+					ladder = ladderList->Element(ladderIter);
+					ladderIter = ladderList->Next( ladderIter );
+				}
+
+				if (newArea == NULL)
+					continue;
+			}
+
+			if (newArea == area)
+				continue;
+
+			float newCostSoFar = Cost( newArea, area, ladder );
+			if (newCostSoFar < 0.0f)
+				continue;
+
+			Node *newNode = GetNode( newArea );
+			bool isOpen = IsOpen( newNode );
+
+			if ((isOpen || IsClosed( newNode )) && newNode->costSoFar <= newCostSoFar)
+				continue;
+
+			float newCostRemaining = (*newArea->GetCenter() - actualGoalPos).Length();
+
+			if (closestArea && newCostRemaining < closestAreaDist)
+			{
+				*closestArea = newArea;
+				closestAreaDist = newCostRemaining;
+			}
+
+			newNode->parent = area;
+			newNode->parentHow = how;
+			newNode->costSoFar = newCostSoFar;
+			newNode->totalCost = newCostSoFar + newCostRemaining;
+
+			if (isOpen)
+				UpdateOnOpenList( newNode );
+			else
+				AddToOpenList( newNode );
+		}
+
+		node->marker = m_masterMarker;
+	}
+
+	return false;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+static unsigned int s_navCheckSeed = 1;
+
+static int NavCheckRandom( int count )
+{
+	s_navCheckSeed = s_navCheckSeed * 1103515245 + 12345;
+	return (int)((s_navCheckSeed >> 16) % (unsigned int)count);
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Run random path requests through NavAreaBuildPath() and the reference search above, and report any
+ * request where the result, the closest area, or the route differs.
+ */
+void CommandNavCheckPaths( void )
+{
+	int count = (engine->Cmd_Argc() > 1) ? atoi( engine->Cmd_Argv( 1 ) ) : 1000;
+	s_navCheckSeed = (engine->Cmd_Argc() > 2) ? atoi( engine->Cmd_Argv( 2 ) ) : 1;
+
+	CUtlVector< CNavArea * > areas;
+	FOR_EACH_LL( TheNavAreaList, it )
+	{
+		areas.AddToTail( TheNavAreaList[ it ] );
+	}
+
+	if (areas.Count() == 0)
+	{
+		Msg( "nav_check_paths: no Navigation Mesh loaded.\n" );
+		return;
+	}
+
+	CNavReferencePath reference;
+	reference.Reset();
+
+	ShortestPathCost cost;
+	double heapTime = 0.0, listTime = 0.0;
+	int mismatches = 0;
+
+	for( int i=0; i<count; ++i )
+	{
+		CNavArea *startArea = areas[ NavCheckRandom( areas.Count() ) ];
+		CNavArea *targetArea = areas[ NavCheckRandom( areas.Count() ) ];
+		CNavArea *goalArea = targetArea;
+
+		// mix the kinds of request the bots make: area only, area and position, and position only
+		Vector pos = *targetArea->GetCenter();
+		const Vector *goalPos = NULL;
+		switch( i % 3 )
+		{
+			case 1:
+				goalPos = &pos;
+				break;
+
+			case 2:
+				pos.x += NavCheckRandom( 129 ) - 64;
+				pos.y += NavCheckRandom( 129 ) - 64;
+				goalPos = &pos;
+				goalArea = NULL;
+				break;
+		}
+
+		CNavArea *closest = NULL;
+		double start = Plat_FloatTime();
+		bool found = NavAreaBuildPath( startArea, goalArea, goalPos, cost, &closest );
+		heapTime += Plat_FloatTime() - start;
+
+		CNavArea *refClosest = NULL;
+		start = Plat_FloatTime();
+		bool refFound = reference.Build( startArea, goalArea, goalPos, &refClosest );
+		listTime += Plat_FloatTime() - start;
+
+		bool match = (found == refFound && closest == refClosest);
+
+		// walk both routes back to the start area
+		CNavArea *area = (found && goalArea) ? goalArea : closest;
+		CNavArea *refArea = (refFound && goalArea) ? goalArea : refClosest;
+		for( int steps = 0; match && steps <= areas.Count(); ++steps )
+		{
+			if (area != refArea)
+			{
+				match = false;
+				break;
+			}
+
+			if (area == NULL || area == startArea)
+				break;
+
+			if (area->GetParentHow() != reference.GetParentHow( refArea ))
+			{
+				match = false;
+				break;
+			}
+
+			area = area->GetParent();
+			refArea = reference.GetParent( refArea );
+		}
+
+		if (!match)
+		{
+			if (mismatches < 10)
+			{
+				Msg( "nav_check_paths: request %d from area #%d to %s #%d differs\n", i, startArea->GetID(),
+					 (goalArea) ? "area" : "a position near area", targetArea->GetID() );
+			}
+			++mismatches;
+		}
+	}
+
+	Msg( "nav_check_paths: %d requests, %d mismatches, heap %.1f us/path, sorted list %.1f us/path\n",
+		 count, mismatches, (count) ? 1000000.0 * heapTime / count : 0.0, (count) ? 1000000.0 * listTime / count : 0.0 );
+}
+static ConCommand nav_check_paths( "nav_check_paths", CommandNavCheckPaths, "Runs random path requests through the A* search and a copy of it using the old sorted open list, and reports any request whose route differs. Arguments: [count] [seed]", FCVAR_GAMEDLL );
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Reference for nav_check_nearest. This is GetNearestNavArea() as it ran before the grid search, walking
+ * every area in the mesh. Also returns the source position it measured from.
+ */
+static CNavArea *NavReferenceNearestArea( const Vector *pos, bool anyZ, Vector *source )
+{
+	CNavArea *close = NULL;
+	float closeDistSq = 99999999.9f;
+
+	// quick check
+	close = TheNavMesh->GetNavArea( pos );
+	if (close)
+	{
+		return close;
+	}
+
+	// ensure source position is well behaved
+	source->x = pos->x;
+	source->y = pos->y;
+	if (TheNavMesh->GetGroundHeight( pos, &source->z ) == false)
+	{
+		return NULL;
+	}
+
+	source->z += HalfHumanHeight;
+
+	// find closest nav area
+	FOR_EACH_LL( TheNavAreaList, it )
+	{
+		CNavArea *area = TheNavAreaList[ it ];
+
+		Vector areaPos;
+		area->GetClosestPointOnArea( source, &areaPos );
+
+		float distSq = (areaPos - *source).LengthSqr();
+
+		// keep the closest area
+		if (distSq < closeDistSq)
+		{
+			// check LOS to area
+			if (!anyZ)
+			{
+				trace_t result;
+				UTIL_TraceLine( *source, areaPos + Vector( 0, 0, HalfHumanHeight ), MASK_PLAYERSOLID_BRUSHONLY, NULL, COLLISION_GROUP_NONE, &result );
+				if (result.fraction != 1.0f)
+				{
+					continue;
+				}
+			}
+
+			closeDistSq = distSq;
+			close = area;
+		}
+	}
+
+	return close;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Look up random points, mostly off the mesh, with GetNearestNavArea() and the reference above, and report
+ * any point where they disagree. Different areas at exactly the same distance are counted as ties.
+ */
+void CommandNavCheckNearest( void )
+{
+	int count = (engine->Cmd_Argc() > 1) ? atoi( engine->Cmd_Argv( 1 ) ) : 1000;
+	s_navCheckSeed = (engine->Cmd_Argc() > 2) ? atoi( engine->Cmd_Argv( 2 ) ) : 1;
+
+	CUtlVector< CNavArea * > areas;
+	FOR_EACH_LL( TheNavAreaList, it )
+	{
+		areas.AddToTail( TheNavAreaList[ it ] );
+	}
+
+	if (areas.Count() == 0)
+	{
+		Msg( "nav_check_nearest: no Navigation Mesh loaded.\n" );
+		return;
+	}
+
+	double gridTime = 0.0, listTime = 0.0;
+	int mismatches = 0;
+	int ties = 0;
+
+	for( int i=0; i<count; ++i )
+	{
+		// scatter points around a random area, most of them well off the mesh
+		CNavArea *nearArea = areas[ NavCheckRandom( areas.Count() ) ];
+		Vector pos = *nearArea->GetCenter();
+		pos.x += NavCheckRandom( 3001 ) - 1500;
+		pos.y += NavCheckRandom( 3001 ) - 1500;
+		pos.z += NavCheckRandom( 201 );
+
+		// every other point skips the line of sight checks
+		bool anyZ = (i & 1) != 0;
+
+		double start = Plat_FloatTime();
+		CNavArea *area = TheNavMesh->GetNearestNavArea( &pos, anyZ );
+		gridTime += Plat_FloatTime() - start;
+
+		Vector source;
+		start = Plat_FloatTime();
+		CNavArea *refArea = NavReferenceNearestArea( &pos, anyZ, &source );
+		listTime += Plat_FloatTime() - start;
+
+		if (area == refArea)
+			continue;
+
+		if (area && refArea)
+		{
+			Vector areaPos, refAreaPos;
+			area->GetClosestPointOnArea( &source, &areaPos );
+			refArea->GetClosestPointOnArea( &source, &refAreaPos );
+
+			if ((areaPos - source).LengthSqr() == (refAreaPos - source).LengthSqr())
+			{
+				++ties;
+				continue;
+			}
+		}
+
+		if (mismatches < 10)
+		{
+			Msg( "nav_check_nearest: point %d (%.1f, %.1f, %.1f)%s found area #%d, reference found #%d\n", i,
+				 pos.x, pos.y, pos.z, (anyZ) ? " anyZ" : "", (area) ? area->GetID() : 0, (refArea) ? refArea->GetID() : 0 );
+		}
+		++mismatches;
+	}
+
+	Msg( "nav_check_nearest: %d points, %d mismatches, %d ties, grid %.1f us/point, area list %.1f us/point\n",
+		 count, mismatches, ties, (count) ? 1000000.0 * gridTime / count : 0.0, (count) ? 1000000.0 * listTime / count : 0.0 );
+}
+static ConCommand nav_check_nearest( "nav_check_nearest", CommandNavCheckNearest, "Looks up random points, mostly off the mesh, with the grid search for the nearest area and a copy of the old walk over every area, and reports any point where they differ. Arguments: [count] [seed]", FCVAR_GAMEDLL );
+
 //--------------------------------------------------------------------------------------------------------------
 void CommandNavUsePlace( void )
 {
@@ -1146,11 +1860,13 @@ void HidingSpot::Save( FileHandle_t file, unsigned int version ) const
 }
 
 //--------------------------------------------------------------------------------------------------------------
-void HidingSpot::Load( FileHandle_t file, unsigned int version )
+void HidingSpot::Load( CUtlBuffer &fileBuffer, unsigned int version )
 {
-	filesystem->Read( &m_id, sizeof(unsigned int), file );
-	filesystem->Read( &m_pos, 3 * sizeof(float), file );
-	filesystem->Read( &m_flags, sizeof(unsigned char), file );
+	m_id = fileBuffer.GetUnsignedInt();
+	m_pos.x = fileBuffer.GetFloat();
+	m_pos.y = fileBuffer.GetFloat();
+	m_pos.z = fileBuffer.GetFloat();
+	m_flags = fileBuffer.GetUnsignedChar();
 
 	// update next ID to avoid ID collisions by later spots
 	if (m_id >= m_nextID)
@@ -156,6 +156,7 @@ private:
 	float m_minX;
 	float m_minY;
 	unsigned int m_areaCount;									///< total number of nav areas
+	mutable unsigned int m_nearestSearchMarker;					///< stamps areas already considered by GetNearestNavArea
 
 	bool m_isLoaded;											///< true if a Navigation Mesh has been loaded
 
@@ -227,6 +228,7 @@ private:
 		NUM_GENERATION_STATES
 	}
 	m_generationState;											///< the state of the generation process
+	int m_generationIndex;										///< the next area in TheNavAreaList to analyze in the current generation state
 	bool m_isGenerating;										///< true while a Navigation Mesh is being generated
 
 	char *m_spawnName;											///< name of player spawn entity, used to initiate sampling
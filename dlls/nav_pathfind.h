@@ -418,8 +418,8 @@ void SearchSurroundingAreas( CNavArea *startArea, const Vector *startPos, Functo
 	CNavArea::MakeNewMarker();
 	CNavArea::ClearSearchLists();
 
-	startArea->AddToOpenList();
 	startArea->SetTotalCost( 0.0f );
+	startArea->AddToOpenList();
 	startArea->SetCostSoFar( 0.0f );
 	startArea->SetParent( NULL );
 	startArea->Mark();
@@ -2101,6 +2101,7 @@ void Physics_RunThinkFunctions( bool simulating )
 	else
 	{
 		UTIL_DisableRemoveImmediate();
+		SimThink_CollectDueThinkers();
 		int listMax = SimThink_ListCount();
 		listMax = max(listMax,1);
 		CBaseEntity **list = (CBaseEntity **)stackalloc( sizeof(CBaseEntity *) * listMax );
@@ -2121,6 +2122,23 @@ void Physics_RunThinkFunctions( bool simulating )
 		}
 
 		stackfree( list );
+
+		// Thinkers without an edict that came due while that ran (something set
+		// their next think to now) still get to think this tick, once, after
+		// everything above. Walking the whole list used to run them this tick
+		// only if they came after whatever set the think.
+		CUtlVector<CBaseEntity *> dueList;
+		while ( ( count = SimThink_CollectDueThinkers() ) != 0 )
+		{
+			dueList.SetSize( count );
+			count = SimThink_DueListCopy( dueList.Base(), count );
+			for ( int i = 0; i < count; i++ )
+			{
+				gpGlobals->curtime = starttime;
+				Physics_SimulateEntity( dueList[i] );
+			}
+		}
+
 		UTIL_EnableRemoveImmediate();
 	}
 
@@ -57,6 +57,13 @@ void CSound::Clear ( void )
 	m_bNoExpirationTime = false;
 	m_iNext				= SOUNDLIST_EMPTY;
 	m_iNextAudible		= 0;
+	m_iPrev				= SOUNDLIST_EMPTY;
+	m_iGridLevel		= SOUNDGRID_NOT_LINKED;
+	m_iGridBucket		= 0;
+	m_iNextInBucket		= SOUNDLIST_EMPTY;
+	m_iActiveSerial		= 0;
+	m_iExpireSerial		= 0;
+	m_iQueryStamp		= 0;
 }
 
 //=========================================================
@@ -68,7 +75,6 @@ void CSound::Reset ( void )
 	m_vecOrigin		= vec3_origin;
 	m_iType			= 0;
 	m_iVolume		= 0;
-	m_iNext			= SOUNDLIST_EMPTY;
 }
 
 //=========================================================
@@ -220,6 +226,7 @@ void CSoundEnt::ShutdownSoundEnt()
 // Construction, destruction
 //-----------------------------------------------------------------------------
 CSoundEnt::CSoundEnt()
+ :	m_ExpireQueue( 0, MAX_WORLD_SOUNDS, ExpirationLessFunc )
 {
 }
 
@@ -250,101 +257,121 @@ void CSoundEnt::OnRestore()
 		UTIL_Remove( g_pSoundEnt );
 	}
 	g_pSoundEnt = this;
+
+	RebuildSoundIndex();
 }
 
 
 //=========================================================
-// Think - at interval, the entire active sound list is checked
-// for sounds that have ExpireTimes less than or equal
-// to the current world time, and these sounds are deallocated.
+// Think - at interval, sounds whose ExpireTimes are less than
+// or equal to the current world time are pulled off the
+// expiration queue and deallocated.
 //=========================================================
 void CSoundEnt::Think ( void )
 {
-	int iSound;
-	int iPreviousSound;
+	int expired[ MAX_WORLD_SOUNDS ];
+	int nExpired = 0;
 
 	SetNextThink( gpGlobals->curtime + 0.1 );// how often to check the sound list.
 
-	iPreviousSound = SOUNDLIST_EMPTY;
-	iSound = m_iActiveSound; 
-
-	while ( iSound != SOUNDLIST_EMPTY )
+	while ( m_ExpireQueue.Count() && m_ExpireQueue.ElementAtHead().m_flExpireTime <= gpGlobals->curtime )
 	{
-		if ( m_SoundPool[ iSound ].m_flExpireTime <= gpGlobals->curtime && (!m_SoundPool[ iSound ].m_bNoExpirationTime) )
-		{
-			int iNext = m_SoundPool[ iSound ].m_iNext;
+		SoundExpiration_t expiration = m_ExpireQueue.ElementAtHead();
+		m_ExpireQueue.RemoveAtHead();
 
-			if( displaysoundlist.GetInt() == 1 )
-			{
-				Msg("  Removed Sound: %d\n", m_SoundPool[ iSound ].SoundType() );
-			}
-			if( displaysoundlist.GetInt() == 2 && m_SoundPool[ iSound ].IsSoundType( SOUND_DANGER ) )
-			{
-				Msg("  Removed Danger Sound: %d\n", m_SoundPool[ iSound ].SoundType() );
-			}
+		// Entries for sounds that have since been freed or reinserted are stale
+		CSound *pSound = &m_SoundPool[ expiration.m_iSound ];
+		if ( expiration.m_iSerial != pSound->m_iExpireSerial || pSound->m_bNoExpirationTime )
+			continue;
+
+		pSound->m_iExpireSerial++;
+		expired[ nExpired++ ] = expiration.m_iSound;
+	}
+
+	// free them in the order they sit in the active list
+	SortByActiveOrder( expired, nExpired );
 
-			// move this sound back into the free list
-			FreeSound( iSound, iPreviousSound );
+	for ( int i = 0; i < nExpired; i++ )
+	{
+		int iSound = expired[ i ];
 
-			iSound = iNext;
+		if( displaysoundlist.GetInt() == 1 )
+		{
+			Msg("  Removed Sound: %d\n", m_SoundPool[ iSound ].SoundType() );
 		}
-		else
+		if( displaysoundlist.GetInt() == 2 && m_SoundPool[ iSound ].IsSoundType( SOUND_DANGER ) )
 		{
-			if( displaysoundlist.GetBool() )
-			{
-				Vector forward, right, up;
-				GetVectors( &forward, &right, &up );
-				byte r, g, b;
+			Msg("  Removed Danger Sound: %d\n", m_SoundPool[ iSound ].SoundType() );
+		}
 
-				// Default to yellow.
-				r = 255;
-				g = 255;
-				b = 0;
+		// move this sound back into the free list
+		FreeSound( iSound, m_SoundPool[ iSound ].m_iPrev );
+	}
 
-				CSound *pSound = &m_SoundPool[ iSound ];
+	if( displaysoundlist.GetBool() )
+	{
+		DrawSoundList();
+	}
+}
 
-				if( pSound->IsSoundType( SOUND_DANGER ) )
-				{
-					r = 255;
-					g = 0;
-					b = 0;
-				}
+//=========================================================
+// DrawSoundList - draws the volume of every active sound
+//=========================================================
+void CSoundEnt::DrawSoundList( void )
+{
+	int iSound = m_iActiveSound; 
 
-				if( displaysoundlist.GetInt() == 1 || (displaysoundlist.GetInt() == 2 && pSound->IsSoundType( SOUND_DANGER ) ) )
-				{
-					NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() + forward * pSound->Volume(), r,g,b, false, 0.1 );
-					NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() - forward * pSound->Volume(), r,g,b, false, 0.1 );
+	while ( iSound != SOUNDLIST_EMPTY )
+	{
+		Vector forward, right, up;
+		GetVectors( &forward, &right, &up );
+		byte r, g, b;
 
-					NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() + right * pSound->Volume(), r,g,b, false, 0.1 );
-					NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() - right * pSound->Volume(), r,g,b, false, 0.1 );
+		// Default to yellow.
+		r = 255;
+		g = 255;
+		b = 0;
 
-					NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() + up * pSound->Volume(), r,g,b, false, 0.1 );
-					NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() - up * pSound->Volume(), r,g,b, false, 0.1 );
+		CSound *pSound = &m_SoundPool[ iSound ];
 
-					if( pSound->m_flOcclusionScale != 1.0 )
-					{
-						// Draw the occluded radius, too.
-						r = 0; g = 150; b = 255;
-						NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() + forward * pSound->OccludedVolume(), r,g,b, false, 0.1 );
-						NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() - forward * pSound->OccludedVolume(), r,g,b, false, 0.1 );
+		if( pSound->IsSoundType( SOUND_DANGER ) )
+		{
+			r = 255;
+			g = 0;
+			b = 0;
+		}
 
-						NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() + right * pSound->OccludedVolume(), r,g,b, false, 0.1 );
-						NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() - right * pSound->OccludedVolume(), r,g,b, false, 0.1 );
+		if( displaysoundlist.GetInt() == 1 || (displaysoundlist.GetInt() == 2 && pSound->IsSoundType( SOUND_DANGER ) ) )
+		{
+			NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() + forward * pSound->Volume(), r,g,b, false, 0.1 );
+			NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() - forward * pSound->Volume(), r,g,b, false, 0.1 );
 
-						NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() + up * pSound->OccludedVolume(), r,g,b, false, 0.1 );
-						NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() - up * pSound->OccludedVolume(), r,g,b, false, 0.1 );
-					}
-				}
+			NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() + right * pSound->Volume(), r,g,b, false, 0.1 );
+			NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() - right * pSound->Volume(), r,g,b, false, 0.1 );
 
-				DevMsg( 2, "Soundlist: %d / %d  (%d)\n", ISoundsInList( SOUNDLISTTYPE_ACTIVE ),ISoundsInList( SOUNDLISTTYPE_FREE ), ISoundsInList( SOUNDLISTTYPE_ACTIVE ) - m_cLastActiveSounds );
-				m_cLastActiveSounds = ISoundsInList ( SOUNDLISTTYPE_ACTIVE );
-			}
+			NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() + up * pSound->Volume(), r,g,b, false, 0.1 );
+			NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() - up * pSound->Volume(), r,g,b, false, 0.1 );
+
+			if( pSound->m_flOcclusionScale != 1.0 )
+			{
+				// Draw the occluded radius, too.
+				r = 0; g = 150; b = 255;
+				NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() + forward * pSound->OccludedVolume(), r,g,b, false, 0.1 );
+				NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() - forward * pSound->OccludedVolume(), r,g,b, false, 0.1 );
 
-			iPreviousSound = iSound;
-			iSound = m_SoundPool[ iSound ].m_iNext;
+				NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() + right * pSound->OccludedVolume(), r,g,b, false, 0.1 );
+				NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() - right * pSound->OccludedVolume(), r,g,b, false, 0.1 );
+
+				NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() + up * pSound->OccludedVolume(), r,g,b, false, 0.1 );
+				NDebugOverlay::Line( pSound->GetSoundOrigin(), pSound->GetSoundOrigin() - up * pSound->OccludedVolume(), r,g,b, false, 0.1 );
+			}
 		}
-	}
 
+		DevMsg( 2, "Soundlist: %d / %d  (%d)\n", ISoundsInList( SOUNDLISTTYPE_ACTIVE ),ISoundsInList( SOUNDLISTTYPE_FREE ), ISoundsInList( SOUNDLISTTYPE_ACTIVE ) - m_cLastActiveSounds );
+		m_cLastActiveSounds = ISoundsInList ( SOUNDLISTTYPE_ACTIVE );
+
+		iSound = pSound->m_iNext;
+	}
 }
 
 //=========================================================
@@ -367,18 +394,32 @@ void CSoundEnt::FreeSound ( int iSound, int iPrevious )
 		return;
 	}
 
+	Assert( g_pSoundEnt->m_SoundPool[ iSound ].m_iPrev == iPrevious );
+
+	int iNext = g_pSoundEnt->m_SoundPool[ iSound ].m_iNext;
+
 	if ( iPrevious != SOUNDLIST_EMPTY )
 	{
 		// iSound is not the head of the active list, so
 		// must fix the index for the Previous sound
-		g_pSoundEnt->m_SoundPool[ iPrevious ].m_iNext = g_pSoundEnt->m_SoundPool[ iSound ].m_iNext;
+		g_pSoundEnt->m_SoundPool[ iPrevious ].m_iNext = iNext;
 	}
 	else 
 	{
 		// the sound we're freeing IS the head of the active list.
-		g_pSoundEnt->m_iActiveSound = g_pSoundEnt->m_SoundPool [ iSound ].m_iNext;
+		g_pSoundEnt->m_iActiveSound = iNext;
+	}
+
+	if ( iNext != SOUNDLIST_EMPTY )
+	{
+		g_pSoundEnt->m_SoundPool[ iNext ].m_iPrev = iPrevious;
 	}
 
+	// pull it out of the grid and drop any pending expiration
+	g_pSoundEnt->UnlinkSoundFromGrid( iSound );
+	g_pSoundEnt->m_SoundPool[ iSound ].m_iExpireSerial++;
+	g_pSoundEnt->m_SoundPool[ iSound ].m_iPrev = SOUNDLIST_EMPTY;
+
 	// make iSound the head of the Free list.
 	g_pSoundEnt->m_SoundPool[ iSound ].m_iNext = g_pSoundEnt->m_iFreeSound;
 	g_pSoundEnt->m_iFreeSound = iSound;
@@ -407,6 +448,13 @@ int CSoundEnt::IAllocSound( void )
 	m_iFreeSound = m_SoundPool[ m_iFreeSound ].m_iNext;// move the index down into the free list. 
 
 	m_SoundPool[ iNewSound ].m_iNext = m_iActiveSound;// point the new sound at the top of the active list.
+	m_SoundPool[ iNewSound ].m_iPrev = SOUNDLIST_EMPTY;
+	m_SoundPool[ iNewSound ].m_iActiveSerial = ++m_iNextActiveSerial;
+
+	if ( m_iActiveSound != SOUNDLIST_EMPTY )
+	{
+		m_SoundPool[ m_iActiveSound ].m_iPrev = iNewSound;
+	}
 
 	m_iActiveSound = iNewSound;// now make the new sound the top of the active list. You're done.
 
@@ -451,6 +499,8 @@ void CSoundEnt::InsertSound ( int iType, const Vector &vecOrigin, int iVolume, f
 	pSound->m_bNoExpirationTime = false;
 	pSound->m_hOwner = NULL;
 
+	g_pSoundEnt->OnSoundUpdated( iThisSound );
+
 	if( displaysoundlist.GetInt() == 1 )
 	{
 		Msg("  Added Sound! Type:%d  Duration:%f\n", pSound->SoundType(), flDuration );
@@ -504,6 +554,8 @@ void CSoundEnt::InsertSound ( int iType, const Vector &vecOrigin, int iVolume, f
 	pSound->m_hOwner.Set( pOwner );
 	pSound->m_ownerChannelIndex = soundChannelIndex;
 
+	g_pSoundEnt->OnSoundUpdated( iThisSound );
+
 	if( displaysoundlist.GetBool() )
 	{
 		Msg("  Added Sound! Type:%d  Duration:%f\n", pSound->SoundType(), flDuration );
@@ -552,6 +604,8 @@ void CSoundEnt::Initialize ( void )
 
 	m_SoundPool[ i - 1 ].m_iNext = SOUNDLIST_EMPTY;// terminate the list here.
 
+	ClearSoundIndex();
+
 	
 	// now reserve enough sounds for each client
 	for ( i = 0 ; i < gpGlobals->maxClients ; i++ )
@@ -565,6 +619,7 @@ void CSoundEnt::Initialize ( void )
 		}
 
 		m_SoundPool[ iSound ].m_bNoExpirationTime = true;
+		LinkSoundToGrid( iSound );
 	}
 }
 
@@ -692,10 +747,12 @@ CSound*	CSoundEnt::GetLoudestSoundOfType( int iType, const Vector &vecEarPositio
 	float flDist;
 	CSound *pSound;
 
-	iThisSound = ActiveList();
+	int sounds[ MAX_WORLD_SOUNDS ];
+	int nSounds = GetSoundsInRange( iType, vecEarPosition, 1.0, sounds );
 
-	while ( iThisSound != SOUNDLIST_EMPTY )
+	for ( int i = 0; i < nSounds; i++ )
 	{
+		iThisSound = sounds[ i ];
 		pSound = SoundPointerForIndex( iThisSound );
 
 		if ( pSound && pSound->m_iType == iType )
@@ -713,13 +770,293 @@ CSound*	CSoundEnt::GetLoudestSoundOfType( int iType, const Vector &vecEarPositio
 				flBestDist = flDist;
 			}
 		}
-
-		iThisSound = pSound->m_iNext;
 	}
 
 	return pLoudestSound;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Collect the sounds that might be heard at an ear position
+//-----------------------------------------------------------------------------
+int CSoundEnt::GetSoundsInRange( int iTypeMask, const Vector &vecEarPosition, float flHearingSensitivity, int *pSounds )
+{
+	if ( !g_pSoundEnt )
+	{
+		return 0;
+	}
+
+	return g_pSoundEnt->QuerySounds( iTypeMask, vecEarPosition, flHearingSensitivity, pSounds );
+}
+
+//-----------------------------------------------------------------------------
+// Sound grid
+//-----------------------------------------------------------------------------
+static inline int SoundGridCell( float flCoord, float flCellSize )
+{
+	return (int)floor( flCoord / flCellSize );
+}
+
+static inline int SoundGridHash( int x, int y, int z )
+{
+	return ( ( (unsigned)x * 73856093u ) ^ ( (unsigned)y * 19349663u ) ^ ( (unsigned)z * 83492791u ) ) & ( SOUNDGRID_BUCKETS - 1 );
+}
+
+static int SoundGridLevel( int iVolume )
+{
+	float flRadius = fabs( (float)iVolume );
+	float flCellSize = SOUNDGRID_CELL_SIZE;
+
+	for ( int i = 0; i < SOUNDGRID_LEVELS; i++, flCellSize *= 2 )
+	{
+		if ( flRadius < flCellSize )
+			return i;
+	}
+
+	return SOUNDGRID_UNINDEXED;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Called after InsertSound has (re)filled a sound
+//-----------------------------------------------------------------------------
+void CSoundEnt::OnSoundUpdated( int iSound )
+{
+	CSound *pSound = &m_SoundPool[ iSound ];
+
+	LinkSoundToGrid( iSound );
+
+	pSound->m_iExpireSerial++;
+	if ( !pSound->m_bNoExpirationTime )
+	{
+		SoundExpiration_t expiration;
+		expiration.m_flExpireTime = pSound->m_flExpireTime;
+		expiration.m_iSound = iSound;
+		expiration.m_iSerial = pSound->m_iExpireSerial;
+		m_ExpireQueue.Insert( expiration );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Earliest expiration at the head of the queue
+//-----------------------------------------------------------------------------
+bool CSoundEnt::ExpirationLessFunc( const SoundExpiration_t &lhs, const SoundExpiration_t &rhs )
+{
+	return ( lhs.m_flExpireTime > rhs.m_flExpireTime );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Non-expiring sounds (the client reserved ones) are updated in place
+//			by their owners, so they are kept out of the grid along with
+//			anything too loud for the coarsest level.
+//-----------------------------------------------------------------------------
+void CSoundEnt::LinkSoundToGrid( int iSound )
+{
+	UnlinkSoundFromGrid( iSound );
+
+	CSound *pSound = &m_SoundPool[ iSound ];
+	int iLevel = ( pSound->m_bNoExpirationTime ) ? SOUNDGRID_UNINDEXED : SoundGridLevel( pSound->m_iVolume );
+
+	pSound->m_iGridLevel = iLevel;
+
+	if ( iLevel == SOUNDGRID_UNINDEXED )
+	{
+		pSound->m_iGridBucket = 0;
+		pSound->m_iNextInBucket = m_iUnindexedSound;
+		m_iUnindexedSound = iSound;
+		return;
+	}
+
+	float flCellSize = SOUNDGRID_CELL_SIZE * ( 1 << iLevel );
+	const Vector &vecOrigin = pSound->GetSoundOrigin();
+	int iBucket = SoundGridHash( SoundGridCell( vecOrigin.x, flCellSize ), 
+								 SoundGridCell( vecOrigin.y, flCellSize ), 
+								 SoundGridCell( vecOrigin.z, flCellSize ) );
+
+	pSound->m_iGridBucket = iBucket;
+	pSound->m_iNextInBucket = m_GridBuckets[ iLevel ][ iBucket ];
+	m_GridBuckets[ iLevel ][ iBucket ] = iSound;
+	m_nGridLevelSounds[ iLevel ]++;
+}
+
+//-----------------------------------------------------------------------------
+
+void CSoundEnt::UnlinkSoundFromGrid( int iSound )
+{
+	CSound *pSound = &m_SoundPool[ iSound ];
+
+	if ( pSound->m_iGridLevel == SOUNDGRID_NOT_LINKED )
+		return;
+
+	short *pLink;
+	if ( pSound->m_iGridLevel == SOUNDGRID_UNINDEXED )
+	{
+		pLink = &m_iUnindexedSound;
+	}
+	else
+	{
+		pLink = &m_GridBuckets[ pSound->m_iGridLevel ][ pSound->m_iGridBucket ];
+		m_nGridLevelSounds[ pSound->m_iGridLevel ]--;
+	}
+
+	while ( *pLink != iSound )
+	{
+		Assert( *pLink != SOUNDLIST_EMPTY );
+		pLink = &m_SoundPool[ *pLink ].m_iNextInBucket;
+	}
+
+	*pLink = pSound->m_iNextInBucket;
+
+	pSound->m_iNextInBucket = SOUNDLIST_EMPTY;
+	pSound->m_iGridLevel = SOUNDGRID_NOT_LINKED;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: A sound in level L has a volume below that level's cell size, so
+//			a listener with sensitivity s can only hear it from within
+//			ceil(s) cells in each direction.
+//-----------------------------------------------------------------------------
+int CSoundEnt::QuerySounds( int iTypeMask, const Vector &vecEarPosition, float flHearingSensitivity, int *pSounds )
+{
+	int nSounds = 0;
+
+	m_iQueryStamp++;
+
+	CollectBucket( m_iUnindexedSound, iTypeMask, pSounds, nSounds );
+
+	float flReach = fabs( flHearingSensitivity );
+	int nReach = ( flReach < SOUNDGRID_BUCKETS ) ? (int)ceil( flReach ) : SOUNDGRID_BUCKETS;
+	int nSide = 2 * nReach + 1;
+
+	// Once the neighborhood covers more cells than there are buckets just
+	// walk every bucket in the level
+	bool bWholeLevel = ( nSide * nSide * nSide >= SOUNDGRID_BUCKETS );
+
+	float flCellSize = SOUNDGRID_CELL_SIZE;
+	for ( int iLevel = 0; iLevel < SOUNDGRID_LEVELS; iLevel++, flCellSize *= 2 )
+	{
+		if ( !m_nGridLevelSounds[ iLevel ] )
+			continue;
+
+		if ( bWholeLevel )
+		{
+			for ( int iBucket = 0; iBucket < SOUNDGRID_BUCKETS; iBucket++ )
+			{
+				CollectBucket( m_GridBuckets[ iLevel ][ iBucket ], iTypeMask, pSounds, nSounds );
+			}
+			continue;
+		}
+
+		int x = SoundGridCell( vecEarPosition.x, flCellSize );
+		int y = SoundGridCell( vecEarPosition.y, flCellSize );
+		int z = SoundGridCell( vecEarPosition.z, flCellSize );
+
+		for ( int dx = -nReach; dx <= nReach; dx++ )
+		{
+			for ( int dy = -nReach; dy <= nReach; dy++ )
+			{
+				for ( int dz = -nReach; dz <= nReach; dz++ )
+				{
+					CollectBucket( m_GridBuckets[ iLevel ][ SoundGridHash( x + dx, y + dy, z + dz ) ], iTypeMask, pSounds, nSounds );
+				}
+			}
+		}
+	}
+
+	SortByActiveOrder( pSounds, nSounds );
+
+	return nSounds;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Buckets can be shared by several cells, so each sound is only
+//			taken once per query
+//-----------------------------------------------------------------------------
+void CSoundEnt::CollectBucket( int iSound, int iTypeMask, int *pSounds, int &nSounds )
+{
+	while ( iSound != SOUNDLIST_EMPTY )
+	{
+		CSound *pSound = &m_SoundPool[ iSound ];
+
+		if ( pSound->m_iQueryStamp != m_iQueryStamp )
+		{
+			pSound->m_iQueryStamp = m_iQueryStamp;
+
+			if ( iTypeMask & pSound->SoundType() )
+			{
+				pSounds[ nSounds++ ] = iSound;
+			}
+		}
+
+		iSound = pSound->m_iNextInBucket;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Head of the active list first
+//-----------------------------------------------------------------------------
+void CSoundEnt::SortByActiveOrder( int *pSounds, int nSounds )
+{
+	for ( int i = 1; i < nSounds; i++ )
+	{
+		int iSound = pSounds[ i ];
+		int iSerial = m_SoundPool[ iSound ].m_iActiveSerial;
+		int j = i - 1;
+
+		while ( j >= 0 && m_SoundPool[ pSounds[ j ] ].m_iActiveSerial < iSerial )
+		{
+			pSounds[ j + 1 ] = pSounds[ j ];
+			j--;
+		}
+
+		pSounds[ j + 1 ] = iSound;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Empty the grid and the expiration queue
+//-----------------------------------------------------------------------------
+void CSoundEnt::ClearSoundIndex()
+{
+	memset( m_GridBuckets, 0xFF, sizeof( m_GridBuckets ) );
+	memset( m_nGridLevelSounds, 0, sizeof( m_nGridLevelSounds ) );
+	m_iUnindexedSound = SOUNDLIST_EMPTY;
+	m_iNextActiveSerial = 0;
+	m_iQueryStamp = 0;
+	m_ExpireQueue.RemoveAll();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Rebuild everything that isn't saved from the restored active list
+//-----------------------------------------------------------------------------
+void CSoundEnt::RebuildSoundIndex()
+{
+	int i;
+
+	ClearSoundIndex();
+
+	for ( i = 0; i < MAX_WORLD_SOUNDS; i++ )
+	{
+		m_SoundPool[ i ].m_iPrev = SOUNDLIST_EMPTY;
+		m_SoundPool[ i ].m_iGridLevel = SOUNDGRID_NOT_LINKED;
+		m_SoundPool[ i ].m_iGridBucket = 0;
+		m_SoundPool[ i ].m_iNextInBucket = SOUNDLIST_EMPTY;
+		m_SoundPool[ i ].m_iActiveSerial = 0;
+		m_SoundPool[ i ].m_iExpireSerial = 0;
+		m_SoundPool[ i ].m_iQueryStamp = 0;
+	}
+
+	m_iNextActiveSerial = ISoundsInList( SOUNDLISTTYPE_ACTIVE );
+
+	int iSerial = m_iNextActiveSerial;
+	int iPrevious = SOUNDLIST_EMPTY;
+	for ( i = m_iActiveSound; i != SOUNDLIST_EMPTY; i = m_SoundPool[ i ].m_iNext )
+	{
+		m_SoundPool[ i ].m_iPrev = iPrevious;
+		m_SoundPool[ i ].m_iActiveSerial = iSerial--;
+		OnSoundUpdated( i );
+		iPrevious = i;
+	}
+}
+
 
 //-----------------------------------------------------------------------------
 // Purpose: Inserts an AI sound into the world sound list.
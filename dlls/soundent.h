@@ -16,11 +16,27 @@
 #pragma once
 #endif
 
+#include "utlpriorityqueue.h"
+
 enum
 {
 	MAX_WORLD_SOUNDS	= 64 // maximum number of sounds handled by the world at one time.
 };
 
+// Active sounds are bucketed in a hashed grid with one level per cell size.
+// A sound goes in the first level whose cells are larger than its volume, so
+// anyone who can hear it is at most a cell or so away.
+enum
+{
+	SOUNDGRID_LEVELS		= 6,
+	SOUNDGRID_BUCKETS		= 64,	// per level, must be a power of two
+
+	SOUNDGRID_NOT_LINKED	= -2,
+	SOUNDGRID_UNINDEXED		= -1,	// always tested (non-expiring and very loud sounds)
+};
+
+#define SOUNDGRID_CELL_SIZE		512.0f	// cell size of the finest level
+
 enum
 {
 	SOUND_NONE				= 0,
@@ -120,6 +136,15 @@ private:
 
 	Vector	m_vecOrigin;	// sound's location in space
 
+	// Not saved, rebuilt from the active list on restore
+	short	m_iPrev;			// index of previous sound in the active list
+	short	m_iGridLevel;		// SOUNDGRID_NOT_LINKED, SOUNDGRID_UNINDEXED, or grid level
+	short	m_iGridBucket;
+	short	m_iNextInBucket;
+	int		m_iActiveSerial;	// higher for sounds nearer the head of the active list
+	int		m_iExpireSerial;	// bumped to invalidate queued expirations for this sound
+	int		m_iQueryStamp;
+
 #ifdef DEBUG
 	int		m_iMyIndex;		// debugging
 #endif
@@ -204,16 +229,49 @@ public:
 	static CSound*	GetLoudestSoundOfType( int iType, const Vector &vecEarPosition );
 	static int		ClientSoundIndex ( edict_t *pClient );
 
+	// Fills pSounds (MAX_WORLD_SOUNDS long) with the active sounds of a type in
+	// iTypeMask that might be audible at vecEarPosition, in active list order.
+	// Callers still apply their own hearing test to what comes back.
+	static int		GetSoundsInRange( int iTypeMask, const Vector &vecEarPosition, float flHearingSensitivity, int *pSounds );
+
 	bool	IsEmpty( void );
 	int		ISoundsInList ( int iListType );
 	int		IAllocSound ( void );
 	int		FindOrAllocateSound( CBaseEntity *pOwner, int soundChannelIndex );
 	
 private:
+	struct SoundExpiration_t
+	{
+		float	m_flExpireTime;
+		int		m_iSound;
+		int		m_iSerial;
+	};
+
+	static bool ExpirationLessFunc( const SoundExpiration_t &lhs, const SoundExpiration_t &rhs );
+
+	void	OnSoundUpdated( int iSound );
+	void	LinkSoundToGrid( int iSound );
+	void	UnlinkSoundFromGrid( int iSound );
+	void	ClearSoundIndex();
+	void	RebuildSoundIndex();
+	int		QuerySounds( int iTypeMask, const Vector &vecEarPosition, float flHearingSensitivity, int *pSounds );
+	void	CollectBucket( int iSound, int iTypeMask, int *pSounds, int &nSounds );
+	void	SortByActiveOrder( int *pSounds, int nSounds );
+	void	DrawSoundList();
+
 	int		m_iFreeSound;	// index of the first sound in the free sound list
 	int		m_iActiveSound; // indes of the first sound in the active sound list
 	int		m_cLastActiveSounds; // keeps track of the number of active sounds at the last update. (for diagnostic work)
 	CSound	m_SoundPool[ MAX_WORLD_SOUNDS ];
+
+	// Not saved, rebuilt from the active list on restore
+	short	m_GridBuckets[ SOUNDGRID_LEVELS ][ SOUNDGRID_BUCKETS ];
+	int		m_nGridLevelSounds[ SOUNDGRID_LEVELS ];
+	short	m_iUnindexedSound;	// head of the list of sounds outside the grid
+	int		m_iNextActiveSerial;
+	int		m_iQueryStamp;
+
+	CUtlPriorityQueue<SoundExpiration_t> m_ExpireQueue;
 };
 
 
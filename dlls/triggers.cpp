@@ -319,11 +319,13 @@ void CBaseTrigger::StartTouch(CBaseEntity *pOther)
 //-----------------------------------------------------------------------------
 void CBaseTrigger::EndTouch(CBaseEntity *pOther)
 {
-	if ( IsTouching( pOther ) )
+	// Look it up once; IsTouching + FindAndRemove would walk the list twice
+	EHANDLE hOther;
+	hOther = pOther;
+	int iTouching = m_hTouchingEntities.Find( hOther );
+	if ( iTouching != m_hTouchingEntities.InvalidIndex() )
 	{
-		EHANDLE hOther;
-		hOther = pOther;
-		m_hTouchingEntities.FindAndRemove( hOther );
+		m_hTouchingEntities.Remove( iTouching );
 		
 		//FIXME: Without this, triggers fire their EndTouch outputs when they are disabled!
 		//if ( !m_bDisabled )
@@ -361,7 +361,14 @@ bool CBaseEntity::KeyValue( const char *szKeyName, const char *szValue )
 	
 	if ( FStrEq( szKeyName, "targetname" ) )
 	{
-		m_iName = AllocPooledString( szValue );
+		SetName( AllocPooledString( szValue ) );
+		return true;
+	}
+
+	// Through SetClassname rather than the keyfield, so cached target lists see the change
+	if ( FStrEq( szKeyName, "classname" ) )
+	{
+		SetClassname( szValue );
 		return true;
 	}
 
@@ -801,6 +808,13 @@ void CBaseEntity::CheckHasThinkFunction( bool isThinking )
 		SimThink_EntityChanged( this );
 #endif
 	}
+#if !defined( CLIENT_DLL )
+	else
+	{
+		// still thinking, but maybe at a different time
+		SimThink_ThinkTimeChanged( this );
+	}
+#endif
 }
 
 bool CBaseEntity::WillSimulateGamePhysics()
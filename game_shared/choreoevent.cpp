@@ -1078,6 +1078,7 @@ CChoreoEvent& CChoreoEvent::operator=( const CChoreoEvent& src )
 	m_pMixer = src.m_pMixer;
 
 	m_pScene = src.m_pScene;
+	OnTimingChanged();
 
 	m_nPitch = src.m_nPitch;
 	m_nYaw = src.m_nYaw;
@@ -1173,6 +1174,7 @@ CChoreoEvent::EVENTTYPE CChoreoEvent::GetType( void )
 void CChoreoEvent::SetType( EVENTTYPE type )
 {
 	m_fType = type;
+	OnTimingChanged();
 
 	if ( m_fType == SPEAK ||
 		m_fType == SUBSCENE )
@@ -1293,6 +1295,8 @@ void CChoreoEvent::SetStartTime( float starttime )
 			m_flEndTime = m_flStartTime;
 		}
 	}
+
+	OnTimingChanged();
 }
 
 //-----------------------------------------------------------------------------
@@ -1313,6 +1317,7 @@ void CChoreoEvent::SetEndTime( float endtime  )
 	bool changed = m_flEndTime != endtime;
 
 	m_flEndTime = endtime;
+	OnTimingChanged();
 
 	if ( endtime != -1.0f )
 	{
@@ -1566,6 +1571,8 @@ void CChoreoEvent::OffsetTime( float dt )
 		m_flEndTime += dt;
 	}
 	m_flStartTime += dt;
+
+	OnTimingChanged();
 }
 
 //-----------------------------------------------------------------------------
@@ -2360,6 +2367,8 @@ void CChoreoEvent::SnapTimes()
 		float dt = m_flStartTime - oldstart;
 		m_flEndTime += dt;
 	}
+
+	OnTimingChanged();
 }
 
 //-----------------------------------------------------------------------------
@@ -2395,6 +2404,18 @@ CChoreoScene *CChoreoEvent::GetScene( void )
 void CChoreoEvent::SetScene( CChoreoScene *scene )
 {
 	m_pScene = scene;
+	OnTimingChanged();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: 
+//-----------------------------------------------------------------------------
+void CChoreoEvent::OnTimingChanged( void )
+{
+	if ( m_pScene )
+	{
+		m_pScene->InvalidateEventIndex();
+	}
 }
 
 //-----------------------------------------------------------------------------
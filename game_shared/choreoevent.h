@@ -540,6 +540,9 @@ private:
 
 	float			_GetIntensity( float time );
 
+	// Tells our scene its event index is stale
+	void			OnTimingChanged( void );
+
 	// String bounds
 	enum
 	{
@@ -131,6 +131,7 @@ CChoreoScene& CChoreoScene::operator=( const CChoreoScene& src )
 	}
 
 	m_Events.RemoveAll();
+	InvalidateEventIndex();
 
 	for ( i = 0 ; i < m_Channels.Size(); i++ )
 	{
@@ -239,6 +240,12 @@ void CChoreoScene::Init( IChoreoEventCallback *callback )
 
 	m_bIsBackground = false;
 	m_nLastPauseEvent = -1;
+
+	m_bEventIndexValid = false;
+	m_bThinkAllEvents = false;
+	m_flEventIndexMinTime = 0.0f;
+	m_flEventIndexBucketWidth = 1.0f;
+	m_nEventThinkStamp = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -405,6 +412,7 @@ CChoreoEvent *CChoreoScene::AllocEvent( void )
 	CChoreoEvent *e = new CChoreoEvent( this );
 	Assert( e );
 	m_Events.AddToTail( e );
+	InvalidateEventIndex();
 	return e;
 }
 
@@ -1943,6 +1951,9 @@ void CChoreoScene::ResetSimulation( bool forward /*= true*/, float starttime /*=
 	m_ResumeConditions.RemoveAll();
 	m_PauseEvents.RemoveAll();
 
+	// Pause events feed into which .wav events have to be thought about every frame
+	InvalidateEventIndex();
+
 	// Put all items into the pending queue
 	for ( int i = 0; i < m_Events.Size(); i++ )
 	{
@@ -2281,6 +2292,253 @@ void CChoreoScene::AddPauseEventDependency( CChoreoEvent *pauseEvent, CChoreoEve
 	pauseEvent->AddEventDependency( suppressed );
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Forces the event index to be rebuilt the next time the scene thinks
+//-----------------------------------------------------------------------------
+void CChoreoScene::InvalidateEventIndex( void )
+{
+	m_bEventIndexValid = false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: 
+// Input  : thinkall - 
+//-----------------------------------------------------------------------------
+void CChoreoScene::SetThinkAllEvents( bool thinkall )
+{
+	m_bThinkAllEvents = thinkall;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Time span over which EventThink could start an event, including the
+//  pre-queue of .wav files by the sound system latency
+// Input  : *e - 
+//			starttime - 
+//			endtime - 
+//-----------------------------------------------------------------------------
+void CChoreoScene::GetEventIndexSpan( CChoreoEvent *e, float& starttime, float& endtime )
+{
+	starttime = e->GetStartTime();
+	endtime = e->HasEndTime() ? e->GetEndTime() : e->GetStartTime();
+
+	if ( e->GetType() == CChoreoEvent::SPEAK )
+	{
+		starttime -= m_flSoundSystemLatency;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: 
+// Input  : t - 
+// Output : int
+//-----------------------------------------------------------------------------
+int CChoreoScene::GetEventIndexBucket( float t )
+{
+	float f = ( t - m_flEventIndexMinTime ) / m_flEventIndexBucketWidth;
+
+	// Clamp before converting so huge times can't overflow
+	int lastBucket = m_EventIndexBucketStart.Count() - 2;
+	if ( f <= 0.0f )
+		return 0;
+	if ( f >= (float)lastBucket )
+		return lastBucket;
+
+	return (int)f;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Buckets every event by the time span it can be started in.  Also finds
+//  the events which are already running and the .wav events which a pause could
+//  suppress, since Think has to look at those every frame.
+//-----------------------------------------------------------------------------
+void CChoreoScene::BuildEventIndex( void )
+{
+	int c = m_Events.Count();
+
+	m_EventIndexBucketStart.RemoveAll();
+	m_EventIndexEvents.RemoveAll();
+	m_AlwaysThinkEvents.RemoveAll();
+	m_ProcessingEvents.RemoveAll();
+
+	m_EventThinkStamp.SetSize( c );
+	for ( int i = 0; i < c; i++ )
+	{
+		m_EventThinkStamp[ i ] = 0;
+	}
+	m_nEventThinkStamp = 0;
+
+	float mintime = 0.0f;
+	float maxtime = 0.0f;
+	bool first = true;
+
+	for ( int i = 0; i < c; i++ )
+	{
+		CChoreoEvent *e = m_Events[ i ];
+		if ( !e )
+			continue;
+
+		float starttime, endtime;
+		GetEventIndexSpan( e, starttime, endtime );
+
+		if ( first || starttime < mintime )
+			mintime = starttime;
+		if ( first || endtime > maxtime )
+			maxtime = endtime;
+		first = false;
+
+		if ( e->IsProcessing() )
+		{
+			m_ProcessingEvents.AddToTail( i );
+		}
+
+		// Same test EventThink uses to see if a pause suppresses the .wav
+		if ( e->GetType() == CChoreoEvent::SPEAK )
+		{
+			if ( FindPauseBetweenTimes( starttime, starttime + m_flSoundSystemLatency ) )
+			{
+				m_AlwaysThinkEvents.AddToTail( i );
+			}
+		}
+	}
+
+	m_flEventIndexMinTime = mintime;
+	m_flEventIndexBucketWidth = max( ( maxtime - mintime ) / (float)MAX_EVENT_INDEX_BUCKETS, 0.25f );
+
+	int buckets = min( (int)( ( maxtime - mintime ) / m_flEventIndexBucketWidth ) + 1, (int)MAX_EVENT_INDEX_BUCKETS );
+
+	// Count the events in each bucket, then turn the counts into offsets
+	m_EventIndexBucketStart.SetSize( buckets + 1 );
+	for ( int b = 0; b <= buckets; b++ )
+	{
+		m_EventIndexBucketStart[ b ] = 0;
+	}
+
+	for ( int i = 0; i < c; i++ )
+	{
+		CChoreoEvent *e = m_Events[ i ];
+		if ( !e )
+			continue;
+
+		float starttime, endtime;
+		GetEventIndexSpan( e, starttime, endtime );
+
+		int lo = GetEventIndexBucket( starttime );
+		int hi = GetEventIndexBucket( endtime );
+		for ( int b = lo; b <= hi; b++ )
+		{
+			m_EventIndexBucketStart[ b + 1 ]++;
+		}
+	}
+
+	for ( int b = 0; b < buckets; b++ )
+	{
+		m_EventIndexBucketStart[ b + 1 ] += m_EventIndexBucketStart[ b ];
+	}
+
+	m_EventIndexEvents.SetSize( m_EventIndexBucketStart[ buckets ] );
+
+	CUtlVector< int > fill;
+	fill.SetSize( buckets );
+	for ( int b = 0; b < buckets; b++ )
+	{
+		fill[ b ] = m_EventIndexBucketStart[ b ];
+	}
+
+	// Events go in in m_Events order, so each bucket stays sorted
+	for ( int i = 0; i < c; i++ )
+	{
+		CChoreoEvent *e = m_Events[ i ];
+		if ( !e )
+			continue;
+
+		float starttime, endtime;
+		GetEventIndexSpan( e, starttime, endtime );
+
+		int lo = GetEventIndexBucket( starttime );
+		int hi = GetEventIndexBucket( endtime );
+		for ( int b = lo; b <= hi; b++ )
+		{
+			m_EventIndexEvents[ fill[ b ]++ ] = i;
+		}
+	}
+
+	m_bEventIndexValid = true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: 
+// Input  : event - 
+//-----------------------------------------------------------------------------
+void CChoreoScene::AddThinkCandidate( int event )
+{
+	if ( m_EventThinkStamp[ event ] == m_nEventThinkStamp )
+		return;
+
+	m_EventThinkStamp[ event ] = m_nEventThinkStamp;
+	m_ThinkCandidates.AddToTail( event );
+}
+
+static int EventIndexCompare( const int *a, const int *b )
+{
+	return *a - *b;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Finds every event EventThink might not ignore between the two times
+// Input  : frame_start_time - earlier of the two times
+//			frame_end_time - later of the two times
+//-----------------------------------------------------------------------------
+void CChoreoScene::GatherThinkCandidates( float frame_start_time, float frame_end_time )
+{
+	// Zero means "never gathered", so skip it if we wrap
+	++m_nEventThinkStamp;
+	if ( m_nEventThinkStamp == 0 )
+	{
+		for ( int i = 0; i < m_EventThinkStamp.Count(); i++ )
+		{
+			m_EventThinkStamp[ i ] = 0;
+		}
+		m_nEventThinkStamp = 1;
+	}
+
+	m_ThinkCandidates.RemoveAll();
+
+	int i;
+	if ( m_bThinkAllEvents )
+	{
+		for ( i = 0; i < m_Events.Count(); i++ )
+		{
+			m_ThinkCandidates.AddToTail( i );
+		}
+		return;
+	}
+
+	for ( i = 0; i < m_ProcessingEvents.Count(); i++ )
+	{
+		AddThinkCandidate( m_ProcessingEvents[ i ] );
+	}
+
+	for ( i = 0; i < m_AlwaysThinkEvents.Count(); i++ )
+	{
+		AddThinkCandidate( m_AlwaysThinkEvents[ i ] );
+	}
+
+	int lo = GetEventIndexBucket( frame_start_time );
+	int hi = GetEventIndexBucket( frame_end_time );
+	for ( int b = lo; b <= hi; b++ )
+	{
+		for ( i = m_EventIndexBucketStart[ b ]; i < m_EventIndexBucketStart[ b + 1 ]; i++ )
+		{
+			AddThinkCandidate( m_EventIndexEvents[ i ] );
+		}
+	}
+
+	if ( m_ThinkCandidates.Count() > 1 )
+	{
+		m_ThinkCandidates.Sort( EventIndexCompare );
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 // Input  : dt - 
@@ -2299,11 +2557,26 @@ void CChoreoScene::Think( float curtime )
 
 	CUtlRBTree< ActiveList, int > pending(0,0,EventLess);
 
-	// Iterate through all events in the scene
+	if ( !m_bEventIndexValid )
+	{
+		BuildEventIndex();
+	}
+
+	// Only look at the events which could be doing something in this frame, in the same
+	//  order as m_Events so that events which sort equally are still dispatched in that order
+	if ( playing_forward )
+	{
+		GatherThinkCandidates( m_flCurrentTime, curtime );
+	}
+	else
+	{
+		GatherThinkCandidates( curtime, m_flCurrentTime );
+	}
+
 	int i;
-	for ( i = 0; i < m_Events.Size(); i++ )
+	for ( i = 0; i < m_ThinkCandidates.Count(); i++ )
 	{
-		e = m_Events[ i ];
+		e = m_Events[ m_ThinkCandidates[ i ] ];
 		if ( !e )
 			continue;
 
@@ -2387,6 +2660,21 @@ void CChoreoScene::Think( float curtime )
 		Msg( "\n" );
 	}
 
+	// Anything still running has to be looked at next frame, even if time jumps past it.  If a
+	//  callback changed the scene, the index gets rebuilt from scratch instead.
+	if ( m_bEventIndexValid )
+	{
+		m_ProcessingEvents.RemoveAll();
+		for ( i = 0; i < m_ThinkCandidates.Count(); i++ )
+		{
+			e = m_Events[ m_ThinkCandidates[ i ] ];
+			if ( e && e->IsProcessing() )
+			{
+				m_ProcessingEvents.AddToTail( m_ThinkCandidates[ i ] );
+			}
+		}
+	}
+
 	m_flCurrentTime = curtime;
 
 	// Still processing?
@@ -2574,6 +2862,8 @@ void CChoreoScene::DestroyEvent( CChoreoEvent *event )
 		}
 	}
 
+	InvalidateEventIndex();
+
 	delete event;
 }
 
@@ -2610,6 +2900,16 @@ void CChoreoScene::ResumeSimulation( void )
 			Assert( startEvent );
 			// Start them now.  Yes, they won't pre-queue, but it's better than totally skipping the sound!!!
 			startEvent->StartProcessing( m_pIChoreoEventCallback, this, m_flCurrentTime );
+
+			// Think needs to know to keep an eye on it
+			if ( m_bEventIndexValid )
+			{
+				int event = m_Events.Find( startEvent );
+				if ( event != m_Events.InvalidIndex() )
+				{
+					m_ProcessingEvents.AddToTail( event );
+				}
+			}
 		}
 	}
 
@@ -2624,6 +2924,9 @@ void CChoreoScene::SetSoundFileStartupLatency( float time )
 {
 	Assert( time >= 0 );
 	m_flSoundSystemLatency = time;
+
+	// .wav events are indexed from their pre-queued start time
+	InvalidateEventIndex();
 }
 
 //-----------------------------------------------------------------------------
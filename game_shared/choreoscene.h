@@ -99,6 +99,11 @@ public:
 
 	void			ResumeSimulation( void );
 
+	// Events call this when their type or timing changes, or when they join the scene
+	void			InvalidateEventIndex( void );
+	// Think visits every event instead of using the index, for comparing against the index
+	void			SetThinkAllEvents( bool thinkall );
+
 	// Have all the pause events happened
 	bool			CheckEventCompletion( void );
 
@@ -268,6 +273,14 @@ private:
 	void			ClearPauseEventDependencies();
 	void			AddPauseEventDependency( CChoreoEvent *pauseEvent, CChoreoEvent *suppressed );
 
+	// Time interval index over m_Events, so Think only visits the events that can
+	//  start, continue or stop between the previous and current time
+	void			BuildEventIndex( void );
+	void			GetEventIndexSpan( CChoreoEvent *e, float& starttime, float& endtime );
+	int				GetEventIndexBucket( float t );
+	void			GatherThinkCandidates( float frame_start_time, float frame_end_time );
+	void			AddThinkCandidate( int event );
+
 	// Global object storage
 	CUtlVector < CChoreoEvent * >	m_Events;
 	CUtlVector < CChoreoActor * >	m_Actors;
@@ -326,6 +339,28 @@ private:
 	bool			m_bIsBackground;
 
 	int				m_nLastPauseEvent;
+
+	enum
+	{
+		MAX_EVENT_INDEX_BUCKETS = 256,
+	};
+
+	bool			m_bEventIndexValid;
+	bool			m_bThinkAllEvents;
+	float			m_flEventIndexMinTime;
+	float			m_flEventIndexBucketWidth;
+	// Offset into m_EventIndexEvents of each bucket's events, plus one past the last bucket
+	CUtlVector< int >	m_EventIndexBucketStart;
+	// m_Events indices, grouped by the buckets the event's time span overlaps
+	CUtlVector< int >	m_EventIndexEvents;
+	// .wav events a SECTION pause can suppress, these have to be looked at every Think
+	CUtlVector< int >	m_AlwaysThinkEvents;
+	// Events which may still be processing, started by Think or ResumeSimulation
+	CUtlVector< int >	m_ProcessingEvents;
+	// Events to look at this Think, in m_Events order
+	CUtlVector< int >	m_ThinkCandidates;
+	CUtlVector< int >	m_EventThinkStamp;
+	int				m_nEventThinkStamp;
 };
 
 CChoreoScene *ChoreoLoadScene( 
@@ -12,6 +12,8 @@
 #include "engine/IEngineTrace.h"
 #include "SoundEmitterSystem/isoundemittersystembase.h"
 #include "decals.h"
+#include "checksum_crc.h"
+#include "tier0/fasttimer.h"
 
 #if defined(HL2_DLL) || defined(HL2_CLIENT_DLL)
 #include "hl_movedata.h"
@@ -31,6 +33,7 @@ extern IFileSystem *filesystem;
 #ifndef CLIENT_DLL
 	#include "env_player_surface_trigger.h"
 	static ConVar dispcoll_drawplane( "dispcoll_drawplane", "0" );
+	extern ConVar sv_movement_stats;
 #endif
 
 
@@ -299,6 +302,8 @@ inline void CGameMovement::TracePlayerBBox( const Vector& start, const Vector& e
 
 inline CBaseHandle CGameMovement::TestPlayerPosition( const Vector& pos, int collisionGroup, trace_t& pm )
 {
+	++m_nMoveTraces;
+
 	Ray_t ray;
 	ray.Init( pos, pos, GetPlayerMins(), GetPlayerMaxs() );
 	UTIL_TraceRay( ray, MASK_PLAYERSOLID, mv->m_nPlayerHandle.Get(), collisionGroup, &pm );
@@ -680,6 +685,18 @@ void CGameMovement::ProcessMovement( CBasePlayer *pPlayer, CMoveData *pMove )
 
 	ResetGetPointContentsCache();
 
+	m_iMoveStatsCategory = MOVESTATS_OTHER;
+	m_nMoveTraces = 0;
+	m_nMovePointContents = 0;
+
+#ifndef CLIENT_DLL
+	CFastTimer moveTimer;
+	if ( sv_movement_stats.GetBool() )
+	{
+		moveTimer.Start();
+	}
+#endif
+
 	// Cropping movement speed scales mv->m_fForwardSpeed etc. globally
 	// Once we crop, we don't want to recursively crop again, so we set the crop
 	//  flag globally here once per usercmd cycle.
@@ -698,11 +715,240 @@ void CGameMovement::ProcessMovement( CBasePlayer *pPlayer, CMoveData *pMove )
 
 	FinishTrackPredictionErrors();
 
+#ifndef CLIENT_DLL
+	if ( sv_movement_stats.GetBool() )
+	{
+		moveTimer.End();
+		AccumulateMoveStats( moveTimer.GetDuration().GetMicrosecondsF() );
+	}
+#endif
+
 	//This is probably not needed, but just in case.
 	gpGlobals->frametime = flStoreFrametime;
 }
 
 
+#ifndef CLIENT_DLL
+//-----------------------------------------------------------------------------
+// Movement cost accounting. Each command's time and engine query counts go in
+// the bucket for the routine that moved the player, and its result is folded
+// into a running CRC. Replaying the same demo or bot script twice with
+// sv_movement_stats on should give the same CRC; a different one means a
+// change altered where players ended up. sv_movement_stats_save keeps every
+// command's result as a golden file, and sv_movement_stats_compare finds the
+// first command of a later run that doesn't match it.
+//-----------------------------------------------------------------------------
+struct MoveStatsBucket_t
+{
+	int		m_nCommands;
+	int		m_nTraces;
+	int		m_nPointContents;
+	double	m_flMicroseconds;
+	double	m_flMaxMicroseconds;
+};
+
+static MoveStatsBucket_t s_MoveStats[CGameMovement::MOVESTATS_COUNT];
+static CRC32_t s_MoveStatsCRC;
+
+// Each command's result, for sv_movement_stats_save and sv_movement_stats_compare
+struct MoveStatsRecord_t
+{
+	int		m_iPlayer;
+	int		m_nCommand;
+	Vector	m_vecOrigin;
+	Vector	m_vecVelocity;
+};
+
+static CUtlVector< MoveStatsRecord_t > s_MoveStatsRecords;
+
+// sv_movement_stats 2 asks the engine again on every point contents cache hit
+static int s_nContentsCacheChecks;
+static int s_nContentsCacheMismatches;
+
+static const char *s_pMoveStatsNames[CGameMovement::MOVESTATS_COUNT] =
+{
+	"walk",
+	"air",
+	"water",
+	"ladder",
+	"other",
+};
+
+static void ResetMoveStats()
+{
+	memset( s_MoveStats, 0, sizeof( s_MoveStats ) );
+	CRC32_Init( &s_MoveStatsCRC );
+	s_MoveStatsRecords.RemoveAll();
+	s_nContentsCacheChecks = 0;
+	s_nContentsCacheMismatches = 0;
+}
+
+static void MoveStatsChanged( ConVar *var, char const *pOldString )
+{
+	if ( var->GetBool() && !atoi( pOldString ) )
+	{
+		ResetMoveStats();
+	}
+}
+
+ConVar sv_movement_stats( "sv_movement_stats", "0", FCVAR_CHEAT, "Accumulate per-command player movement cost and a checksum of the results. 2 also checks every point contents cache hit against the engine. See sv_movement_stats_report.", MoveStatsChanged );
+
+void CGameMovement::AccumulateMoveStats( double flMicroseconds )
+{
+	MoveStatsBucket_t &bucket = s_MoveStats[m_iMoveStatsCategory];
+	bucket.m_nCommands++;
+	bucket.m_nTraces += m_nMoveTraces;
+	bucket.m_nPointContents += m_nMovePointContents;
+	bucket.m_flMicroseconds += flMicroseconds;
+	bucket.m_flMaxMicroseconds = max( bucket.m_flMaxMicroseconds, flMicroseconds );
+
+	int iPlayer = player->entindex();
+	CRC32_ProcessBuffer( &s_MoveStatsCRC, &iPlayer, sizeof( iPlayer ) );
+	CRC32_ProcessBuffer( &s_MoveStatsCRC, mv->m_vecAbsOrigin.Base(), sizeof( Vector ) );
+	CRC32_ProcessBuffer( &s_MoveStatsCRC, mv->m_vecVelocity.Base(), sizeof( Vector ) );
+
+	MoveStatsRecord_t &record = s_MoveStatsRecords[ s_MoveStatsRecords.AddToTail() ];
+	record.m_iPlayer = iPlayer;
+	record.m_nCommand = player->CurrentCommandNumber();
+	record.m_vecOrigin = mv->m_vecAbsOrigin;
+	record.m_vecVelocity = mv->m_vecVelocity;
+}
+
+CON_COMMAND( sv_movement_stats_report, "Prints the player movement cost gathered while sv_movement_stats is on." )
+{
+	MoveStatsBucket_t total;
+	memset( &total, 0, sizeof( total ) );
+
+	Msg( "%-8s %9s %10s %10s %10s %10s %10s\n", "move", "commands", "us/cmd", "max us", "traces/cmd", "contents/cmd", "total ms" );
+	for ( int i = 0; i < CGameMovement::MOVESTATS_COUNT; i++ )
+	{
+		const MoveStatsBucket_t &bucket = s_MoveStats[i];
+		total.m_nCommands += bucket.m_nCommands;
+		total.m_nTraces += bucket.m_nTraces;
+		total.m_nPointContents += bucket.m_nPointContents;
+		total.m_flMicroseconds += bucket.m_flMicroseconds;
+		total.m_flMaxMicroseconds = max( total.m_flMaxMicroseconds, bucket.m_flMaxMicroseconds );
+
+		if ( !bucket.m_nCommands )
+			continue;
+
+		Msg( "%-8s %9d %10.2f %10.2f %10.2f %10.2f %10.2f\n", s_pMoveStatsNames[i], bucket.m_nCommands,
+			bucket.m_flMicroseconds / bucket.m_nCommands, bucket.m_flMaxMicroseconds,
+			(float)bucket.m_nTraces / bucket.m_nCommands, (float)bucket.m_nPointContents / bucket.m_nCommands,
+			bucket.m_flMicroseconds / 1000.0 );
+	}
+
+	if ( total.m_nCommands )
+	{
+		Msg( "%-8s %9d %10.2f %10.2f %10.2f %10.2f %10.2f\n", "total", total.m_nCommands,
+			total.m_flMicroseconds / total.m_nCommands, total.m_flMaxMicroseconds,
+			(float)total.m_nTraces / total.m_nCommands, (float)total.m_nPointContents / total.m_nCommands,
+			total.m_flMicroseconds / 1000.0 );
+	}
+
+	CRC32_t crc = s_MoveStatsCRC;
+	CRC32_Final( &crc );
+	Msg( "result checksum: %08x\n", (unsigned int)crc );
+
+	if ( s_nContentsCacheChecks )
+	{
+		Msg( "point contents cache: %d hits checked, %d differed from the engine\n", s_nContentsCacheChecks, s_nContentsCacheMismatches );
+	}
+}
+
+CON_COMMAND( sv_movement_stats_reset, "Clears the player movement cost and checksum." )
+{
+	ResetMoveStats();
+}
+
+// %.9g gives back the same float when it's read in again
+#define MOVESTATS_RECORD_FORMAT		"%d %d %.9g %.9g %.9g %.9g %.9g %.9g\n"
+
+CON_COMMAND( sv_movement_stats_save, "Writes every command's final player origin and velocity recorded while sv_movement_stats is on to a golden file." )
+{
+	if ( engine->Cmd_Argc() != 2 )
+	{
+		Msg( "Usage: sv_movement_stats_save <filename>\n" );
+		return;
+	}
+
+	FileHandle_t hFile = filesystem->Open( engine->Cmd_Argv( 1 ), "w", "MOD" );
+	if ( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Warning( "sv_movement_stats_save: couldn't write %s\n", engine->Cmd_Argv( 1 ) );
+		return;
+	}
+
+	for ( int i = 0; i < s_MoveStatsRecords.Count(); i++ )
+	{
+		const MoveStatsRecord_t &record = s_MoveStatsRecords[i];
+		filesystem->FPrintf( hFile, MOVESTATS_RECORD_FORMAT, record.m_iPlayer, record.m_nCommand,
+			record.m_vecOrigin.x, record.m_vecOrigin.y, record.m_vecOrigin.z,
+			record.m_vecVelocity.x, record.m_vecVelocity.y, record.m_vecVelocity.z );
+	}
+
+	filesystem->Close( hFile );
+	Msg( "Wrote %d commands to %s\n", s_MoveStatsRecords.Count(), engine->Cmd_Argv( 1 ) );
+}
+
+CON_COMMAND( sv_movement_stats_compare, "Compares the commands recorded while sv_movement_stats is on with a golden file from sv_movement_stats_save." )
+{
+	if ( engine->Cmd_Argc() != 2 )
+	{
+		Msg( "Usage: sv_movement_stats_compare <filename>\n" );
+		return;
+	}
+
+	FileHandle_t hFile = filesystem->Open( engine->Cmd_Argv( 1 ), "r", "MOD" );
+	if ( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Warning( "sv_movement_stats_compare: couldn't read %s\n", engine->Cmd_Argv( 1 ) );
+		return;
+	}
+
+	int nGolden = 0;
+	int nMismatches = 0;
+	char szLine[256];
+	while ( filesystem->ReadLine( szLine, sizeof( szLine ), hFile ) )
+	{
+		MoveStatsRecord_t golden;
+		if ( sscanf( szLine, "%d %d %f %f %f %f %f %f", &golden.m_iPlayer, &golden.m_nCommand,
+				&golden.m_vecOrigin.x, &golden.m_vecOrigin.y, &golden.m_vecOrigin.z,
+				&golden.m_vecVelocity.x, &golden.m_vecVelocity.y, &golden.m_vecVelocity.z ) != 8 )
+		{
+			continue;
+		}
+
+		if ( nGolden < s_MoveStatsRecords.Count() )
+		{
+			const MoveStatsRecord_t &record = s_MoveStatsRecords[nGolden];
+			if ( record.m_iPlayer != golden.m_iPlayer || record.m_nCommand != golden.m_nCommand ||
+				 record.m_vecOrigin != golden.m_vecOrigin || record.m_vecVelocity != golden.m_vecVelocity )
+			{
+				// Everything after the first difference usually differs too
+				if ( !nMismatches )
+				{
+					Msg( "First difference at command %d:\n", nGolden );
+					Msg( "  golden   " MOVESTATS_RECORD_FORMAT, golden.m_iPlayer, golden.m_nCommand,
+						golden.m_vecOrigin.x, golden.m_vecOrigin.y, golden.m_vecOrigin.z,
+						golden.m_vecVelocity.x, golden.m_vecVelocity.y, golden.m_vecVelocity.z );
+					Msg( "  recorded " MOVESTATS_RECORD_FORMAT, record.m_iPlayer, record.m_nCommand,
+						record.m_vecOrigin.x, record.m_vecOrigin.y, record.m_vecOrigin.z,
+						record.m_vecVelocity.x, record.m_vecVelocity.y, record.m_vecVelocity.z );
+				}
+				nMismatches++;
+			}
+		}
+		nGolden++;
+	}
+
+	filesystem->Close( hFile );
+
+	Msg( "%d golden commands, %d recorded, %d differ\n", nGolden, s_MoveStatsRecords.Count(), nMismatches );
+}
+#endif // !CLIENT_DLL
+
+
 // This code is useful for finding where prediction errors happened.
 // Change it to use any variable inside mv or in the player and then look at the 
 // client.txt and server.txt files to see where the values went astray.
@@ -1547,6 +1793,7 @@ void CGameMovement::FullWalkMove( )
 	// If we are leaping out of the water, just update the counters.
 	if (player->m_flWaterJumpTime)
 	{
+		m_iMoveStatsCategory = MOVESTATS_WATER;
 		WaterJump();
 		TryPlayerMove();
 		// See if we are still in water?
@@ -1581,6 +1828,7 @@ void CGameMovement::FullWalkMove( )
 		}
 
 		// Perform regular water movement
+		m_iMoveStatsCategory = MOVESTATS_WATER;
 		WaterMove();
 
 		// Redetermine position vars
@@ -1618,10 +1866,12 @@ void CGameMovement::FullWalkMove( )
 
 		if (player->GetGroundEntity() != NULL)
 		{
+			m_iMoveStatsCategory = MOVESTATS_WALK;
 			WalkMove();
 		}
 		else
 		{
+			m_iMoveStatsCategory = MOVESTATS_AIR;
 			AirMove();  // Take into account movement when in air.
 		}
 
@@ -2024,6 +2274,8 @@ bool CGameMovement::CheckJumpButton( void )
 //-----------------------------------------------------------------------------
 void CGameMovement::FullLadderMove()
 {
+	m_iMoveStatsCategory = MOVESTATS_LADDER;
+
 	CheckWater();
 
 	// Was jump button pressed? If so, set velocity to 270 away from ladder.  
@@ -2329,7 +2581,7 @@ bool CGameMovement::LadderMove( void )
 	VectorCopy( mv->m_vecAbsOrigin, floor );
 	floor[2] += GetPlayerMins()[2] - 1;
 
-	if( enginetrace->GetPointContents( floor ) == CONTENTS_SOLID )
+	if( GetPointContentsFrameCached( floor ) == CONTENTS_SOLID )
 	{
 		onFloor = true;
 	}
@@ -2899,13 +3151,80 @@ void CGameMovement::ResetGetPointContentsCache()
 }
 
 
+//-----------------------------------------------------------------------------
+// Point contents looked up by each player during the current move. CheckWater
+// runs more than once per move and asks for exactly the same points again.
+// Entries only match the exact point, the same player, the same frame and the
+// same curtime, so nothing else has run between the lookup and the hit and
+// the result is what the engine would have returned. curtime is the player's
+// tickbase time, so it changes with every usercmd and with every tick the host
+// runs when it falls behind. The frame count keeps the client from reusing a
+// result when it predicts the same command again in a later frame. tickcount
+// can't be used here, it isn't set during prediction.
+//-----------------------------------------------------------------------------
+#define POINT_CONTENTS_FRAME_CACHE_SIZE		64	// must be a power of two
+
+struct PointContentsFrameCacheEntry_t
+{
+	Vector	m_vecPoint;
+	int		m_nFrameCount;
+	float	m_flCurTime;
+	int		m_iPlayer;		// 0 for an unused entry
+	int		m_nContents;
+};
+
+static PointContentsFrameCacheEntry_t s_PointContentsFrameCache[POINT_CONTENTS_FRAME_CACHE_SIZE];
+
+static inline unsigned int PointContentsFrameCacheHash( const Vector &point, int iPlayer )
+{
+	const unsigned int *pBits = (const unsigned int *)point.Base();
+	unsigned int nHash = pBits[0] * 73856093 ^ pBits[1] * 19349663 ^ pBits[2] * 83492791 ^ iPlayer;
+	return ( nHash ^ ( nHash >> 16 ) ) & ( POINT_CONTENTS_FRAME_CACHE_SIZE - 1 );
+}
+
+
+int CGameMovement::GetPointContentsFrameCached( const Vector &point )
+{
+	if ( !g_bMovementOptimizations )
+	{
+		++m_nMovePointContents;
+		return enginetrace->GetPointContents( point );
+	}
+
+	int iPlayer = player->entindex();
+	PointContentsFrameCacheEntry_t &entry = s_PointContentsFrameCache[ PointContentsFrameCacheHash( point, iPlayer ) ];
+	if ( entry.m_iPlayer != iPlayer || entry.m_nFrameCount != gpGlobals->framecount || entry.m_flCurTime != gpGlobals->curtime || entry.m_vecPoint != point )
+	{
+		entry.m_vecPoint = point;
+		entry.m_nFrameCount = gpGlobals->framecount;
+		entry.m_flCurTime = gpGlobals->curtime;
+		entry.m_iPlayer = iPlayer;
+		entry.m_nContents = enginetrace->GetPointContents( point );
+		++m_nMovePointContents;
+	}
+#ifndef CLIENT_DLL
+	else if ( sv_movement_stats.GetInt() == 2 )
+	{
+		// Not counted in m_nMovePointContents, this query is only here to check the hit
+		++s_nContentsCacheChecks;
+		if ( enginetrace->GetPointContents( point ) != entry.m_nContents )
+		{
+			++s_nContentsCacheMismatches;
+		}
+	}
+#endif
+
+	return entry.m_nContents;
+}
+
+
 int CGameMovement::GetPointContentsCached( const Vector &point )
 {
 	if ( g_bMovementOptimizations ) 
 	{
 		if ( m_CachedGetPointContents == -9999 || point.DistToSqr( m_CachedGetPointContentsPoint ) > 1 )
 		{
-			m_CachedGetPointContents = enginetrace->GetPointContents ( point );
+			m_CachedGetPointContents = GetPointContentsFrameCached( point );
 			m_CachedGetPointContentsPoint = point;
 		}
 		
@@ -2913,6 +3232,7 @@ int CGameMovement::GetPointContentsCached( const Vector &point )
 	}
 	else
 	{
+		++m_nMovePointContents;
 		return enginetrace->GetPointContents ( point );
 	}
 }
@@ -2951,7 +3271,7 @@ bool CGameMovement::CheckWater( void )
 
 		// Now check a point that is at the player hull midpoint.
 		point[2] = mv->m_vecAbsOrigin[2] + (GetPlayerMins()[2] + GetPlayerMaxs()[2])*0.5;
-		cont = enginetrace->GetPointContents( point );
+		cont = GetPointContentsFrameCached( point );
 		// If that point is also under water...
 		if ( cont & MASK_WATER )
 		{
@@ -2960,7 +3280,7 @@ bool CGameMovement::CheckWater( void )
 
 			// Now check the eye position.  (view_ofs is relative to the origin)
 			point[2] = mv->m_vecAbsOrigin[2] + player->GetViewOffset()[2];
-			cont = enginetrace->GetPointContents( point );
+			cont = GetPointContentsFrameCached( point );
 			if ( cont & MASK_WATER )
 				player->SetWaterLevel( WL_Eyes );  // In over our eyes
 		}
@@ -43,6 +43,18 @@ public:
 	virtual const Vector&	GetPlayerMaxs( bool ducked ) const;
 	virtual const Vector&	GetPlayerViewOffset( bool ducked ) const;
 
+	// Which movement routine did the work for a command, for sv_movement_stats.
+	enum MoveStatsCategory_t
+	{
+		MOVESTATS_WALK = 0,
+		MOVESTATS_AIR,
+		MOVESTATS_WATER,
+		MOVESTATS_LADDER,
+		MOVESTATS_OTHER,
+
+		MOVESTATS_COUNT
+	};
+
 protected:
 	// Input/Output for this movement
 	CMoveData		*mv;
@@ -187,6 +199,9 @@ protected:
 
 	void ResetGetPointContentsCache();
 	int GetPointContentsCached( const Vector &point );
+	int GetPointContentsFrameCached( const Vector &point );
+
+	void AccumulateMoveStats( double flMicroseconds );
 
 	// Ducking
 	virtual void	Duck( void );
@@ -238,6 +253,11 @@ protected:
 	int m_CachedGetPointContents;
 	Vector m_CachedGetPointContentsPoint;	
 
+	// Category and engine query counts for the current command.
+	int				m_iMoveStatsCategory;
+	int				m_nMoveTraces;
+	int				m_nMovePointContents;
+
 	Vector			m_vecProximityMins;		// Used to be globals in sv_user.cpp.
 	Vector			m_vecProximityMaxs;
 
@@ -256,6 +276,8 @@ inline void CGameMovement::TracePlayerBBox( const Vector& start, const Vector& e
 {
 	VPROF( "CGameMovement::TracePlayerBBox" );
 
+	++m_nMoveTraces;
+
 	Ray_t ray;
 	ray.Init( start, end, GetPlayerMins(), GetPlayerMaxs() );
 	UTIL_TraceRay( ray, fMask, mv->m_nPlayerHandle.Get(), collisionGroup, &pm );
@@ -385,6 +385,110 @@ inline void FreeTouchLink( touchlink_t *link )
 	g_EdictTouchLinks.Free( link );
 }
 
+//-----------------------------------------------------------------------------
+// Touch link index. Every touchlink is also filed here under (owner, touched
+// entity) so that finding an existing touch doesn't have to walk the owner's
+// whole list; a big trigger with lots of objects in it used to pay for that
+// on every touch, every frame. The lists themselves are left alone, so
+// Touch/StartTouch/EndTouch still happen in the same order.
+//-----------------------------------------------------------------------------
+#if defined( CLIENT_DLL )
+typedef C_BaseEntity *TouchedEntityKey_t;
+static inline TouchedEntityKey_t TouchedEntityKey( C_BaseEntity *pEntity )	{ return pEntity; }
+static inline TouchedEntityKey_t TouchedEntityKey( touchlink_t *link )		{ return link->entityTouched; }
+#else
+// The handle keeps its value after the entity goes away, so stale links can still be found
+typedef unsigned int TouchedEntityKey_t;
+static inline TouchedEntityKey_t TouchedEntityKey( CBaseEntity *pEntity )	{ return pEntity->GetRefEHandle().ToInt(); }
+static inline TouchedEntityKey_t TouchedEntityKey( touchlink_t *link )		{ return link->entityTouched.ToInt(); }
+#endif
+
+struct TouchLinkIndexEntry_t
+{
+	CBaseEntity			*m_pOwner;
+	TouchedEntityKey_t	m_Touched;
+	touchlink_t			*m_pLink;
+};
+
+static bool TouchLinkIndexLessFunc( const TouchLinkIndexEntry_t &lhs, const TouchLinkIndexEntry_t &rhs )
+{
+	if ( lhs.m_pOwner != rhs.m_pOwner )
+		return lhs.m_pOwner < rhs.m_pOwner;
+	return lhs.m_Touched < rhs.m_Touched;
+}
+
+static CUtlRBTree< TouchLinkIndexEntry_t, int > g_TouchLinkIndex( 0, 0, TouchLinkIndexLessFunc );
+
+static touchlink_t *FindTouchLink( CBaseEntity *pOwner, TouchedEntityKey_t touched )
+{
+	TouchLinkIndexEntry_t search;
+	search.m_pOwner = pOwner;
+	search.m_Touched = touched;
+	int i = g_TouchLinkIndex.Find( search );
+	return ( i != g_TouchLinkIndex.InvalidIndex() ) ? g_TouchLinkIndex[i].m_pLink : NULL;
+}
+
+#if !defined( CLIENT_DLL )
+static ConVar sv_touchlink_check( "sv_touchlink_check", "0", FCVAR_CHEAT, "Check every touch link lookup against a walk of the owner's touch list." );
+#endif
+
+//-----------------------------------------------------------------------------
+// Purpose: For sv_touchlink_check, walks the touch list the way the lookups did
+//  before the index and complains if it finds a different link
+//-----------------------------------------------------------------------------
+static void CheckTouchLink( CBaseEntity *pOwner, CBaseEntity *pTouched, touchlink_t *pFound )
+{
+#if !defined( CLIENT_DLL )
+	if ( !sv_touchlink_check.GetBool() )
+		return;
+
+	touchlink_t *link = NULL;
+	touchlink_t *root = ( touchlink_t * )pOwner->GetDataObject( TOUCHLINK );
+	if ( root )
+	{
+		for ( link = root->nextLink; link != root; link = link->nextLink )
+		{
+			if ( link->entityTouched == pTouched )
+				break;
+		}
+
+		if ( link == root )
+		{
+			link = NULL;
+		}
+	}
+
+	if ( link != pFound )
+	{
+		Warning( "sv_touchlink_check: %s(%d) touching %s(%d): index found %p, touch list has %p\n",
+			pOwner->GetClassname(), pOwner->entindex(), pTouched->GetClassname(), pTouched->entindex(), pFound, link );
+	}
+#endif
+}
+
+static void IndexTouchLink( CBaseEntity *pOwner, touchlink_t *link )
+{
+	TouchLinkIndexEntry_t entry;
+	entry.m_pOwner = pOwner;
+	entry.m_Touched = TouchedEntityKey( link );
+	entry.m_pLink = link;
+	Assert( g_TouchLinkIndex.Find( entry ) == g_TouchLinkIndex.InvalidIndex() );
+	g_TouchLinkIndex.Insert( entry );
+}
+
+static void UnindexTouchLink( CBaseEntity *pOwner, touchlink_t *link )
+{
+	TouchLinkIndexEntry_t entry;
+	entry.m_pOwner = pOwner;
+	entry.m_Touched = TouchedEntityKey( link );
+	int i = g_TouchLinkIndex.Find( entry );
+	Assert( i != g_TouchLinkIndex.InvalidIndex() && g_TouchLinkIndex[i].m_pLink == link );
+	if ( i != g_TouchLinkIndex.InvalidIndex() )
+	{
+		g_TouchLinkIndex.RemoveAt( i );
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 // Output : inline groundlink_t
@@ -501,29 +605,24 @@ void CBaseEntity::PhysicsNotifyOtherOfUntouch( CBaseEntity *ent, CBaseEntity *ot
 	if ( !other )
 		return;
 
-	// loop through ed's touch list, looking for the notifier
+	// look up the notifier in ed's touch list
 	// remove and call untouch if found
 	touchlink_t *root = ( touchlink_t * )other->GetDataObject( TOUCHLINK );
-	if ( root )
+	if ( root && ent )
 	{
-		touchlink_t *link = root->nextLink;
-		while ( link != root )
+		touchlink_t *link = FindTouchLink( other, TouchedEntityKey( ent ) );
+		CheckTouchLink( other, ent, link );
+		if ( link )
 		{
-			if ( link->entityTouched == ent )
-			{
-				PhysicsRemoveToucher( other, link );
+			PhysicsRemoveToucher( other, link );
 
-				// Check for complete removal
-				if ( g_bCleanupDatObject &&
-					 root->nextLink == root && 
-					 root->prevLink == root )
-				{
-					other->DestroyDataObject( TOUCHLINK );
-				}
-				return;
+			// Check for complete removal
+			if ( g_bCleanupDatObject &&
+				 root->nextLink == root && 
+				 root->prevLink == root )
+			{
+				other->DestroyDataObject( TOUCHLINK );
 			}
-
-			link = link->nextLink;
 		}
 	}
 }
@@ -545,6 +644,7 @@ void CBaseEntity::PhysicsRemoveToucher( CBaseEntity *otherEntity, touchlink_t *l
 	link->nextLink->prevLink = link->prevLink;
 	link->prevLink->nextLink = link->nextLink;
 
+	UnindexTouchLink( otherEntity, link );
 	FreeTouchLink( link );
 }
 
@@ -570,6 +670,7 @@ void CBaseEntity::PhysicsRemoveTouchedList( CBaseEntity *ent )
 			PhysicsNotifyOtherOfUntouch( ent, link->entityTouched );
 
 			// kill it
+			UnindexTouchLink( ent, link );
 			FreeTouchLink( link );
 
 			link = nextLink;
@@ -809,18 +910,17 @@ touchlink_t *CBaseEntity::PhysicsMarkEntityAsTouched( CBaseEntity *other )
 	touchlink_t *root = ( touchlink_t * )GetDataObject( TOUCHLINK );
 	if ( root )
 	{
-		for ( link = root->nextLink; link != root; link = link->nextLink )
+		link = FindTouchLink( this, TouchedEntityKey( other ) );
+		CheckTouchLink( this, other, link );
+		if ( link )
 		{
-			if ( link->entityTouched == other )
-			{
-				// update stamp
-				link->touchStamp = touchStamp;
-				
-				PhysicsTouch( other );
+			// update stamp
+			link->touchStamp = touchStamp;
+			
+			PhysicsTouch( other );
 
-				// no more to do
-				return link;
-			}
+			// no more to do
+			return link;
 		}
 	}
 	else
@@ -846,6 +946,7 @@ touchlink_t *CBaseEntity::PhysicsMarkEntityAsTouched( CBaseEntity *other )
 	link->prevLink = root;
 	link->prevLink->nextLink = link;
 	link->nextLink->prevLink = link;
+	IndexTouchLink( this, link );
 
 	// non-solid entities don't get touched
 	bool bShouldTouch = (IsSolid() && !IsSolidFlagSet(FSOLID_VOLUME_CONTENTS)) || IsSolidFlagSet(FSOLID_TRIGGER);
@@ -39,6 +39,7 @@ CSheetSimulator::~CSheetSimulator()
 		delete[] m_ControlPoints;
 		delete[] m_pCollisionPlanes;
 		delete[] m_pValidCollisionPlane;
+		delete[] m_pCollisionPlaneOriginDist;
 	}
 	delete[] m_Particle;
 }
@@ -60,6 +61,7 @@ void CSheetSimulator::Init( int w, int h, int fixedPointCount )
 		m_ControlPoints = new Vector[fixedPointCount];
 		m_pCollisionPlanes = new cplane_t[fixedPointCount];
 		m_pValidCollisionPlane = new bool[fixedPointCount];
+		m_pCollisionPlaneOriginDist = new float[fixedPointCount];
 	}
 
 	// Initialize distances and such
@@ -353,7 +355,7 @@ void CSheetSimulator::ComputeForces()
 //-----------------------------------------------------------------------------
 // Used for testing neighbors against a particular plane
 //-----------------------------------------------------------------------------
-void CSheetSimulator::TestVertAgainstPlane( int vert, int plane, bool bFarTest )
+void CSheetSimulator::TestVertAgainstPlane( int vert, int plane, const Vector& vecDelta, bool bFarTest )
 {
 	if (!m_pValidCollisionPlane[plane])
 		return;
@@ -361,9 +363,15 @@ void CSheetSimulator::TestVertAgainstPlane( int vert, int plane, bool bFarTest )
 	// Compute distance to the plane under consideration
 	cplane_t* pPlane = &m_pCollisionPlanes[plane];
 
-	Ray_t ray;
-	ray.Init( m_Origin, m_Particle[vert].m_Position ); 
-	float t = IntersectRayWithPlane( ray, *pPlane ); 
+	// This is IntersectRayWithPlane along the ray from the origin to the vert,
+	// using the plane's distance from the origin worked out for this pass
+	float t = 0.0f;
+	float denom = DotProduct( vecDelta, pPlane->normal );
+	if (denom != 0.0f)
+	{
+		denom = 1.0f / denom;
+		t = m_pCollisionPlaneOriginDist[plane] * denom;
+	}
 
 	if (!bFarTest || (t <= 1.0f))
 	{
@@ -463,8 +471,21 @@ void CSheetSimulator::DetectCollision( int i, float flPlaneOffset )
 //-----------------------------------------------------------------------------
 void CSheetSimulator::DetermineBestCollisionPlane( bool bFarTest )
 {
+	// The origin is fixed for the whole pass, so each plane's distance from it
+	// is only computed once instead of once per neighboring vert
+	int nValidPlanes = 0;
+	int i;
+	for ( i = 0; i < NumParticles(); ++i )
+	{
+		if (!m_pValidCollisionPlane[i])
+			continue;
+
+		++nValidPlanes;
+		m_pCollisionPlaneOriginDist[i] = m_pCollisionPlanes[i].dist - DotProduct( m_Origin, m_pCollisionPlanes[i].normal );
+	}
+
 	// Check neighbors for violation of collision plane constraints
-	for	( int i = 0; i < NumVertical(); ++i)
+	for	( i = 0; i < NumVertical(); ++i)
 	{
 		for ( int j = 0; j < NumHorizontal(); ++j)
 		{
@@ -476,19 +497,28 @@ void CSheetSimulator::DetermineBestCollisionPlane( bool bFarTest )
 			// is the one that comes closest to the origin.
 			m_Particle[idx].m_CollisionDist = FLT_MAX;
 			m_Particle[idx].m_CollisionPlane = -1;
-			TestVertAgainstPlane( idx, idx, bFarTest );
+
+			// Out in the open there's nothing to test against
+			if (nValidPlanes == 0)
+				continue;
+
+			// All the tests for this vert are along the same ray
+			Vector vecDelta;
+			VectorSubtract( m_Particle[idx].m_Position, m_Origin, vecDelta );
+
+			TestVertAgainstPlane( idx, idx, vecDelta, bFarTest );
 			if (j > 0)
 			{
-				TestVertAgainstPlane( idx, idx-1, bFarTest );
+				TestVertAgainstPlane( idx, idx-1, vecDelta, bFarTest );
 			}
 			if (j < NumHorizontal() - 1)
 			{
-				TestVertAgainstPlane( idx, idx+1, bFarTest );
+				TestVertAgainstPlane( idx, idx+1, vecDelta, bFarTest );
 			}
 			if (i > 0)
-				TestVertAgainstPlane( idx, idx-NumHorizontal(), bFarTest );
+				TestVertAgainstPlane( idx, idx-NumHorizontal(), vecDelta, bFarTest );
 			if (i < NumVertical() - 1)
-				TestVertAgainstPlane( idx, idx+NumHorizontal(), bFarTest );
+				TestVertAgainstPlane( idx, idx+NumHorizontal(), vecDelta, bFarTest );
 		}
 	}
 }
@@ -121,7 +121,7 @@ protected:
 	void			ComputeControlPoints();
 	void			ClearForces();
 	void			ComputeForces();
-	void			TestVertAgainstPlane( int vert, int plane, bool bFarTest = true );
+	void			TestVertAgainstPlane( int vert, int plane, const Vector& vecDelta, bool bFarTest = true );
 	void			SatisfyCollisionConstraints();
 	void			DetermineBestCollisionPlane( bool bFarTest = true );
 	void			ClampPointsToCollisionPlanes();
@@ -168,6 +168,7 @@ protected:
 	// Collision planes
 	cplane_t*	m_pCollisionPlanes;
 	bool*		m_pValidCollisionPlane;
+	float*		m_pCollisionPlaneOriginDist;	// plane dist minus the origin's distance along its normal
 
 	// Control point offset
 	Vector		m_ControlPointOffset;
@@ -267,10 +267,472 @@ void ExtractAnimValue( const studiohdr_t *pStudioHdr, int frame,
 
 
 //-----------------------------------------------------------------------------
-// Purpose: return a sub frame rotation for a single bone
+// Purpose: per-lane helpers for the block kernels.  These repeat the math of
+//			QuaternionAlign, QuaternionBlendNoAlign, QuaternionSlerpNoAlign,
+//			AngleQuaternion and QuaternionMatrix operation for operation, so
+//			the batched paths give the same result as the per-bone calls.
 //-----------------------------------------------------------------------------
-void CalcBoneQuaternion( const studiohdr_t *pStudioHdr, int frame, float s, 
-						const mstudiobone_t *pbone, const mstudioanim_t *panim, Quaternion &q )
+static inline void AlignQuaternionLanes( const float p[4][BONE_SOA_WIDTH], float q[4][BONE_SOA_WIDTH], const bool bNoAlign[BONE_SOA_WIDTH] )
+{
+	float a[BONE_SOA_WIDTH], b[BONE_SOA_WIDTH], flSign[BONE_SOA_WIDTH];
+	int i, k;
+
+	for (k = 0; k < BONE_SOA_WIDTH; k++)
+	{
+		a[k] = 0;
+		b[k] = 0;
+	}
+	for (i = 0; i < 4; i++)
+	{
+		for (k = 0; k < BONE_SOA_WIDTH; k++)
+		{
+			a[k] += (p[i][k]-q[i][k])*(p[i][k]-q[i][k]);
+			b[k] += (p[i][k]+q[i][k])*(p[i][k]+q[i][k]);
+		}
+	}
+	for (k = 0; k < BONE_SOA_WIDTH; k++)
+	{
+		flSign[k] = (a[k] > b[k] && !bNoAlign[k]) ? -1.0f : 1.0f;
+	}
+	for (i = 0; i < 4; i++)
+	{
+		for (k = 0; k < BONE_SOA_WIDTH; k++)
+		{
+			q[i][k] *= flSign[k];
+		}
+	}
+}
+
+static inline void NormalizeQuaternionLanes( float q[4][BONE_SOA_WIDTH] )
+{
+	for (int k = 0; k < BONE_SOA_WIDTH; k++)
+	{
+		float radius = q[0][k]*q[0][k] + q[1][k]*q[1][k] + q[2][k]*q[2][k] + q[3][k]*q[3][k];
+		if ( radius )
+		{
+			radius = sqrt(radius);
+			float iradius = 1.0f/radius;
+			q[3][k] *= iradius;
+			q[2][k] *= iradius;
+			q[1][k] *= iradius;
+			q[0][k] *= iradius;
+		}
+	}
+}
+
+// qt = p * (1 - t) + q * t, normalized.  q must already be aligned to p.
+static inline void BlendQuaternionLanes( const float p[4][BONE_SOA_WIDTH], const float q[4][BONE_SOA_WIDTH], const float t[BONE_SOA_WIDTH], float qt[4][BONE_SOA_WIDTH] )
+{
+	for (int i = 0; i < 4; i++)
+	{
+		for (int k = 0; k < BONE_SOA_WIDTH; k++)
+		{
+			qt[i][k] = (1.0f - t[k]) * p[i][k] + t[k] * q[i][k];
+		}
+	}
+	NormalizeQuaternionLanes( qt );
+}
+
+// q must already be aligned to p.
+static inline void SlerpQuaternionLanes( const float p[4][BONE_SOA_WIDTH], const float q[4][BONE_SOA_WIDTH], const float t[BONE_SOA_WIDTH], float qt[4][BONE_SOA_WIDTH] )
+{
+	float sclp[BONE_SOA_WIDTH], sclq[BONE_SOA_WIDTH];
+	bool bOpposite[BONE_SOA_WIDTH];
+	int i, k;
+
+	for (k = 0; k < BONE_SOA_WIDTH; k++)
+	{
+		float cosom = p[0][k]*q[0][k] + p[1][k]*q[1][k] + p[2][k]*q[2][k] + p[3][k]*q[3][k];
+
+		bOpposite[k] = !((1.0f + cosom) > 0.000001f);
+		if (bOpposite[k])
+		{
+			sclp[k] = sin( (1.0f - t[k]) * (0.5f * M_PI));
+			sclq[k] = sin( t[k] * (0.5f * M_PI));
+		}
+		else if ((1.0f - cosom) > 0.000001f)
+		{
+			float omega = acos( cosom );
+			float sinom = sin( omega );
+			sclp[k] = sin( (1.0f - t[k])*omega) / sinom;
+			sclq[k] = sin( t[k]*omega ) / sinom;
+		}
+		else
+		{
+			sclp[k] = 1.0f - t[k];
+			sclq[k] = t[k];
+		}
+	}
+
+	for (i = 0; i < 4; i++)
+	{
+		for (k = 0; k < BONE_SOA_WIDTH; k++)
+		{
+			qt[i][k] = sclp[k] * p[i][k] + sclq[k] * q[i][k];
+		}
+	}
+
+	// nearly opposite quaternions rotate through a perpendicular one instead
+	for (k = 0; k < BONE_SOA_WIDTH; k++)
+	{
+		if (bOpposite[k])
+		{
+			qt[0][k] = sclp[k] * p[0][k] + sclq[k] * -q[1][k];
+			qt[1][k] = sclp[k] * p[1][k] + sclq[k] * q[0][k];
+			qt[2][k] = sclp[k] * p[2][k] + sclq[k] * -q[3][k];
+			qt[3][k] = q[2][k];
+		}
+	}
+}
+
+// the trig dominates, so lanes that aren't bActive skip it and come out as
+// the identity
+static inline void AngleQuaternionLanes( const float angles[3][BONE_SOA_WIDTH], float q[4][BONE_SOA_WIDTH], const bool bActive[BONE_SOA_WIDTH] )
+{
+	float sr[BONE_SOA_WIDTH], sp[BONE_SOA_WIDTH], sy[BONE_SOA_WIDTH];
+	float cr[BONE_SOA_WIDTH], cp[BONE_SOA_WIDTH], cy[BONE_SOA_WIDTH];
+	int k;
+
+	for (k = 0; k < BONE_SOA_WIDTH; k++)
+	{
+		if (!bActive[k])
+		{
+			sy[k] = sp[k] = sr[k] = 0.0f;
+			cy[k] = cp[k] = cr[k] = 1.0f;
+			continue;
+		}
+		SinCos( angles[2][k] * 0.5f, &sy[k], &cy[k] );
+		SinCos( angles[1][k] * 0.5f, &sp[k], &cp[k] );
+		SinCos( angles[0][k] * 0.5f, &sr[k], &cr[k] );
+	}
+
+	for (k = 0; k < BONE_SOA_WIDTH; k++)
+	{
+		float srXcp = sr[k] * cp[k], crXsp = cr[k] * sp[k];
+		q[0][k] = srXcp*cy[k]-crXsp*sy[k];
+		q[1][k] = crXsp*cy[k]+srXcp*sy[k];
+
+		float crXcp = cr[k] * cp[k], srXsp = sr[k] * sp[k];
+		q[2][k] = crXcp*sy[k]-srXsp*cy[k];
+		q[3][k] = crXcp*cy[k]+srXsp*sy[k];
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: CBonePoseSoA
+//-----------------------------------------------------------------------------
+void CBonePoseSoA::Gather( const Vector pos[], const Quaternion q[], const int *pBones, int nCount )
+{
+	Assert( nCount >= 0 && nCount <= MAXSTUDIOBONES );
+	m_nCount = nCount;
+
+	int n;
+	for (n = 0; n < nCount; n++)
+	{
+		BonePoseBlock_t &block = m_Blocks[n / BONE_SOA_WIDTH];
+		int k = n % BONE_SOA_WIDTH;
+		int iBone = pBones[n];
+
+		block.m_Pos[0][k] = pos[iBone].x;
+		block.m_Pos[1][k] = pos[iBone].y;
+		block.m_Pos[2][k] = pos[iBone].z;
+		block.m_Quat[0][k] = q[iBone].x;
+		block.m_Quat[1][k] = q[iBone].y;
+		block.m_Quat[2][k] = q[iBone].z;
+		block.m_Quat[3][k] = q[iBone].w;
+	}
+
+	// pad out the last block so the kernels never see garbage
+	for ( ; n % BONE_SOA_WIDTH; n++)
+	{
+		BonePoseBlock_t &block = m_Blocks[n / BONE_SOA_WIDTH];
+		int k = n % BONE_SOA_WIDTH;
+
+		block.m_Pos[0][k] = block.m_Pos[1][k] = block.m_Pos[2][k] = 0.0f;
+		block.m_Quat[0][k] = block.m_Quat[1][k] = block.m_Quat[2][k] = 0.0f;
+		block.m_Quat[3][k] = 1.0f;
+	}
+}
+
+void CBonePoseSoA::Scatter( Vector pos[], Quaternion q[], const int *pBones ) const
+{
+	for (int n = 0; n < m_nCount; n++)
+	{
+		const BonePoseBlock_t &block = m_Blocks[n / BONE_SOA_WIDTH];
+		int k = n % BONE_SOA_WIDTH;
+		int iBone = pBones[n];
+
+		pos[iBone].x = block.m_Pos[0][k];
+		pos[iBone].y = block.m_Pos[1][k];
+		pos[iBone].z = block.m_Pos[2][k];
+		q[iBone].x = block.m_Quat[0][k];
+		q[iBone].y = block.m_Quat[1][k];
+		q[iBone].z = block.m_Quat[2][k];
+		q[iBone].w = block.m_Quat[3][k];
+	}
+}
+
+// copies a block's worth of per-bone values, padding past nCount
+static inline void LoadBlockLanes( const float *pSrc, int nBase, int nCount, float flPad, float out[BONE_SOA_WIDTH] )
+{
+	for (int k = 0; k < BONE_SOA_WIDTH; k++)
+	{
+		out[k] = (nBase + k < nCount) ? pSrc[nBase + k] : flPad;
+	}
+}
+
+static inline void LoadBlockLanes( const bool *pSrc, int nBase, int nCount, bool out[BONE_SOA_WIDTH] )
+{
+	for (int k = 0; k < BONE_SOA_WIDTH; k++)
+	{
+		out[k] = (nBase + k < nCount) ? pSrc[nBase + k] : false;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: pose1 = slerp( pose2, pose1, 1 - s[i] )
+//-----------------------------------------------------------------------------
+void SlerpBonePoseSoA( CBonePoseSoA &pose1, const CBonePoseSoA &pose2, const float s[], const bool bNoAlign[] )
+{
+	Assert( pose1.Count() == pose2.Count() );
+
+	int nCount = pose1.Count();
+	for (int n = 0; n < pose1.BlockCount(); n++)
+	{
+		BonePoseBlock_t &block1 = pose1.m_Blocks[n];
+		const BonePoseBlock_t &block2 = pose2.m_Blocks[n];
+
+		float s1[BONE_SOA_WIDTH], s2[BONE_SOA_WIDTH];
+		bool bLaneNoAlign[BONE_SOA_WIDTH];
+		int i, k;
+
+		LoadBlockLanes( s, n * BONE_SOA_WIDTH, nCount, 0.0f, s2 );
+		LoadBlockLanes( bNoAlign, n * BONE_SOA_WIDTH, nCount, bLaneNoAlign );
+		for (k = 0; k < BONE_SOA_WIDTH; k++)
+		{
+			s1[k] = 1.0 - s2[k];
+		}
+
+		float q1[4][BONE_SOA_WIDTH];
+		memcpy( q1, block1.m_Quat, sizeof(q1) );
+		AlignQuaternionLanes( block2.m_Quat, q1, bLaneNoAlign );
+		SlerpQuaternionLanes( block2.m_Quat, q1, s1, block1.m_Quat );
+
+		for (i = 0; i < 3; i++)
+		{
+			for (k = 0; k < BONE_SOA_WIDTH; k++)
+			{
+				block1.m_Pos[i][k] = block1.m_Pos[i][k] * s1[k] + block2.m_Pos[i][k] * s2[k];
+			}
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: pose1 = blend( pose2, pose1, 1 - s )
+//-----------------------------------------------------------------------------
+void BlendBonePoseSoA( CBonePoseSoA &pose1, const CBonePoseSoA &pose2, float s, const bool bNoAlign[] )
+{
+	Assert( pose1.Count() == pose2.Count() );
+
+	float s2 = s;
+	float s1 = 1.0 - s2;
+
+	float t[BONE_SOA_WIDTH];
+	int i, k;
+	for (k = 0; k < BONE_SOA_WIDTH; k++)
+	{
+		t[k] = s1;
+	}
+
+	int nCount = pose1.Count();
+	for (int n = 0; n < pose1.BlockCount(); n++)
+	{
+		BonePoseBlock_t &block1 = pose1.m_Blocks[n];
+		const BonePoseBlock_t &block2 = pose2.m_Blocks[n];
+
+		bool bLaneNoAlign[BONE_SOA_WIDTH];
+		LoadBlockLanes( bNoAlign, n * BONE_SOA_WIDTH, nCount, bLaneNoAlign );
+
+		float q1[4][BONE_SOA_WIDTH];
+		memcpy( q1, block1.m_Quat, sizeof(q1) );
+		AlignQuaternionLanes( block2.m_Quat, q1, bLaneNoAlign );
+		BlendQuaternionLanes( block2.m_Quat, q1, t, block1.m_Quat );
+
+		for (i = 0; i < 3; i++)
+		{
+			for (k = 0; k < BONE_SOA_WIDTH; k++)
+			{
+				block1.m_Pos[i][k] = block1.m_Pos[i][k] * s1 + block2.m_Pos[i][k] * s2;
+			}
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: local[i] = QuaternionMatrix( q, pos ) of slot i
+//-----------------------------------------------------------------------------
+void BuildBoneMatricesSoA( const CBonePoseSoA &pose, matrix3x4_t local[] )
+{
+	int nCount = pose.Count();
+	for (int n = 0; n < pose.BlockCount(); n++)
+	{
+		const BonePoseBlock_t &block = pose.m_Blocks[n];
+		const float *x = block.m_Quat[0];
+		const float *y = block.m_Quat[1];
+		const float *z = block.m_Quat[2];
+		const float *w = block.m_Quat[3];
+
+		float m[3][4][BONE_SOA_WIDTH];
+		int k;
+
+		for (k = 0; k < BONE_SOA_WIDTH; k++)
+		{
+			m[0][0][k] = 1.0 - 2.0 * y[k] * y[k] - 2.0 * z[k] * z[k];
+			m[1][0][k] = 2.0 * x[k] * y[k] + 2.0 * w[k] * z[k];
+			m[2][0][k] = 2.0 * x[k] * z[k] - 2.0 * w[k] * y[k];
+
+			m[0][1][k] = 2.0f * x[k] * y[k] - 2.0f * w[k] * z[k];
+			m[1][1][k] = 1.0f - 2.0f * x[k] * x[k] - 2.0f * z[k] * z[k];
+			m[2][1][k] = 2.0f * y[k] * z[k] + 2.0f * w[k] * x[k];
+
+			m[0][2][k] = 2.0f * x[k] * z[k] + 2.0f * w[k] * y[k];
+			m[1][2][k] = 2.0f * y[k] * z[k] - 2.0f * w[k] * x[k];
+			m[2][2][k] = 1.0f - 2.0f * x[k] * x[k] - 2.0f * y[k] * y[k];
+
+			m[0][3][k] = block.m_Pos[0][k];
+			m[1][3][k] = block.m_Pos[1][k];
+			m[2][3][k] = block.m_Pos[2][k];
+		}
+
+		int nLanes = min( BONE_SOA_WIDTH, nCount - n * BONE_SOA_WIDTH );
+		for (k = 0; k < nLanes; k++)
+		{
+			matrix3x4_t &matrix = local[n * BONE_SOA_WIDTH + k];
+			for (int i = 0; i < 3; i++)
+			{
+				matrix[i][0] = m[i][0][k];
+				matrix[i][1] = m[i][1][k];
+				matrix[i][2] = m[i][2][k];
+				matrix[i][3] = m[i][3][k];
+			}
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: queues decoded euler angles and turns them into quaternions a
+//			block at a time.  Decoding the compressed anim runs stays per
+//			channel, the conversion and blending are done across the block.
+//-----------------------------------------------------------------------------
+class CAnimRotationBatch
+{
+public:
+	CAnimRotationBatch() : m_nCount( 0 ) {}
+	~CAnimRotationBatch() { Assert( m_nCount == 0 ); }
+
+	void Add( const RadianEuler &angle1, const RadianEuler &angle2, float s, const Quaternion *pAlignment, Quaternion *pOut );
+	void Flush();
+
+private:
+	int					m_nCount;
+	float				m_Angle1[3][BONE_SOA_WIDTH];
+	float				m_Angle2[3][BONE_SOA_WIDTH];
+	float				m_s[BONE_SOA_WIDTH];
+	bool				m_bBlend[BONE_SOA_WIDTH];
+	const Quaternion	*m_pAlignment[BONE_SOA_WIDTH];
+	Quaternion			*m_pOut[BONE_SOA_WIDTH];
+};
+
+void CAnimRotationBatch::Add( const RadianEuler &angle1, const RadianEuler &angle2, float s, const Quaternion *pAlignment, Quaternion *pOut )
+{
+	int k = m_nCount;
+	m_Angle1[0][k] = angle1.x;
+	m_Angle1[1][k] = angle1.y;
+	m_Angle1[2][k] = angle1.z;
+	m_Angle2[0][k] = angle2.x;
+	m_Angle2[1][k] = angle2.y;
+	m_Angle2[2][k] = angle2.z;
+	m_s[k] = s;
+	m_bBlend[k] = (angle1.x != angle2.x || angle1.y != angle2.y || angle1.z != angle2.z);
+	m_pAlignment[k] = pAlignment;
+	m_pOut[k] = pOut;
+
+	if (++m_nCount == BONE_SOA_WIDTH)
+	{
+		Flush();
+	}
+}
+
+void CAnimRotationBatch::Flush()
+{
+	if (!m_nCount)
+		return;
+
+	int i, k;
+	bool bAnyBlend = false;
+	bool bUsed[BONE_SOA_WIDTH];
+	for (k = 0; k < BONE_SOA_WIDTH; k++)
+	{
+		bUsed[k] = (k < m_nCount);
+	}
+	for (k = m_nCount; k < BONE_SOA_WIDTH; k++)
+	{
+		for (i = 0; i < 3; i++)
+		{
+			m_Angle1[i][k] = m_Angle2[i][k] = 0.0f;
+		}
+		m_s[k] = 0.0f;
+		m_bBlend[k] = false;
+	}
+	for (k = 0; k < m_nCount; k++)
+	{
+		bAnyBlend = bAnyBlend || m_bBlend[k];
+	}
+
+	float q1[4][BONE_SOA_WIDTH];
+	float qBlend[4][BONE_SOA_WIDTH];
+	AngleQuaternionLanes( m_Angle1, q1, bUsed );
+
+	if (bAnyBlend)
+	{
+		static const bool bNoAlign[BONE_SOA_WIDTH] = { false };
+		float q2[4][BONE_SOA_WIDTH];
+		AngleQuaternionLanes( m_Angle2, q2, m_bBlend );
+		AlignQuaternionLanes( q1, q2, bNoAlign );
+		BlendQuaternionLanes( q1, q2, m_s, qBlend );
+	}
+
+	for (k = 0; k < m_nCount; k++)
+	{
+		const float (*pSrc)[BONE_SOA_WIDTH] = m_bBlend[k] ? qBlend : q1;
+		Quaternion q;
+		q.Init( pSrc[0][k], pSrc[1][k], pSrc[2][k], pSrc[3][k] );
+		Assert( q.IsValid() );
+
+		// align to unified bone
+		if (m_pAlignment[k])
+		{
+			QuaternionAlign( *m_pAlignment[k], q, q );
+		}
+		*m_pOut[k] = q;
+	}
+
+	m_nCount = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: return a sub frame rotation for a single bone.  Animated rotations
+//			are queued on the batch and only written to q when it is flushed.
+//-----------------------------------------------------------------------------
+static void CalcBoneQuaternion( const studiohdr_t *pStudioHdr, int frame, float s, 
+						const mstudiobone_t *pbone, const mstudioanim_t *panim, Quaternion &q, CAnimRotationBatch &batch )
 {
 	if (panim->flags & STUDIO_ANIM_RAWROT)
 	{
@@ -291,7 +753,6 @@ void CalcBoneQuaternion( const studiohdr_t *pStudioHdr, int frame, float s,
 		return;
 	}
 
-	Quaternion			q1, q2;
 	RadianEuler			angle1, angle2;
 	mstudioanim_valueptr_t *pValuesPtr = panim->pRotV();
 
@@ -299,6 +760,7 @@ void CalcBoneQuaternion( const studiohdr_t *pStudioHdr, int frame, float s,
 	ExtractAnimValue( pStudioHdr, frame, pValuesPtr->pAnimvalue( 1 ), pbone->rotscale.y, angle1.y, angle2.y );
 	ExtractAnimValue( pStudioHdr, frame, pValuesPtr->pAnimvalue( 2 ), pbone->rotscale.z, angle1.z, angle2.z );
 
+	const Quaternion *pAlignment = NULL;
 	if (!(panim->flags & STUDIO_ANIM_DELTA))
 	{
 		angle1.x = angle1.x + pbone->rot.x;
@@ -307,27 +769,27 @@ void CalcBoneQuaternion( const studiohdr_t *pStudioHdr, int frame, float s,
 		angle2.x = angle2.x + pbone->rot.x;
 		angle2.y = angle2.y + pbone->rot.y;
 		angle2.z = angle2.z + pbone->rot.z;
+
+		if (pbone->flags & BONE_FIXED_ALIGNMENT)
+		{
+			pAlignment = &pbone->qAlignment;
+		}
 	}
 
 	Assert( angle1.IsValid() && angle2.IsValid() );
-	if (angle1.x != angle2.x || angle1.y != angle2.y || angle1.z != angle2.z)
-	{
-		AngleQuaternion( angle1, q1 );
-		AngleQuaternion( angle2, q2 );
-		QuaternionBlend( q1, q2, s, q );
-	}
-	else
-	{
-		AngleQuaternion( angle1, q );
-	}
+	batch.Add( angle1, angle2, s, pAlignment, &q );
+}
 
-	Assert( q.IsValid() );
 
-	// align to unified bone
-	if (!(panim->flags & STUDIO_ANIM_DELTA) && (pbone->flags & BONE_FIXED_ALIGNMENT))
-	{
-		QuaternionAlign( pbone->qAlignment, q, q );
-	}
+//-----------------------------------------------------------------------------
+// Purpose: return a sub frame rotation for a single bone
+//-----------------------------------------------------------------------------
+void CalcBoneQuaternion( const studiohdr_t *pStudioHdr, int frame, float s, 
+						const mstudiobone_t *pbone, const mstudioanim_t *panim, Quaternion &q )
+{
+	CAnimRotationBatch batch;
+	CalcBoneQuaternion( pStudioHdr, frame, s, pbone, panim, q, batch );
+	batch.Flush();
 }
 
 
@@ -480,6 +942,8 @@ static void CalcVirtualAnimation( virtualmodel_t *pVModel, const studiohdr_t *pS
 		}
 	}
 
+	CAnimRotationBatch rotations;
+
 	// FIXME: change encoding so that bone -1 is never the case
 	while (panim && panim->bone < 255)
 	{
@@ -490,12 +954,14 @@ static void CalcVirtualAnimation( virtualmodel_t *pVModel, const studiohdr_t *pS
 
 			if (k >= 0 && pweight[k] > 0.0f)
 			{
-				CalcBoneQuaternion( pAnimStudioHdr, iFrame, s, &pAnimbone[panim->bone], panim, q[j] );
+				CalcBoneQuaternion( pAnimStudioHdr, iFrame, s, &pAnimbone[panim->bone], panim, q[j], rotations );
 				CalcBonePosition  ( pAnimStudioHdr, iFrame, s, &pAnimbone[panim->bone], panim, pos[j] );
 			}
 		}
 		panim = panim->pNext();
 	}
+
+	rotations.Flush();
 }
 
 
@@ -531,6 +997,8 @@ static void CalcAnimation( const studiohdr_t *pStudioHdr,	Vector *pos, Quaternio
 
 	float *pweight = seqdesc.pBoneweight( 0 );
 
+	CAnimRotationBatch rotations;
+
 	// BUGBUG: the sequence, the anim, and the model can have all different bone mappings.
 	for (i = 0; i < pStudioHdr->numbones; i++, pbone++, pweight++, pAnimbone++)
 	{
@@ -539,7 +1007,7 @@ static void CalcAnimation( const studiohdr_t *pStudioHdr,	Vector *pos, Quaternio
 		{
 			if (*pweight > 0 && (pbone->flags & boneMask))
 			{
-				CalcBoneQuaternion( pStudioHdr, iFrame, s, pAnimbone, panim, q[i] );
+				CalcBoneQuaternion( pStudioHdr, iFrame, s, pAnimbone, panim, q[i], rotations );
 				CalcBonePosition  ( pStudioHdr, iFrame, s, pAnimbone, panim, pos[i] );
 			}
 			panim = panim->pNext();
@@ -558,6 +1026,8 @@ static void CalcAnimation( const studiohdr_t *pStudioHdr,	Vector *pos, Quaternio
 			}
 		}
 	}
+
+	rotations.Flush();
 }
 
 
@@ -618,8 +1088,7 @@ void SlerpBones(
 	int boneMask )
 {
 	int			i, j;
-	Quaternion		q3, q4;
-	float		s1, s2;
+	float		s2;
 
 	const mstudioseqdesc_t &seqdesc = pStudioHdr->pSeqdesc( sequence );
 
@@ -693,6 +1162,11 @@ void SlerpBones(
 	}
 	else
 	{
+		int			nBones = 0;
+		int			bones[MAXSTUDIOBONES];
+		float		weights[MAXSTUDIOBONES];
+		bool		bNoAlign[MAXSTUDIOBONES];
+
 		for (i = 0; i < pStudioHdr->numbones; i++)
 		{
 			// skip unused bones
@@ -719,25 +1193,19 @@ void SlerpBones(
 			}
 			if (s2 > 0.0)
 			{
-				s1 = 1.0 - s2;
-
-				if (pbone[i].flags & BONE_FIXED_ALIGNMENT)
-				{
-					QuaternionSlerpNoAlign( q2[i], q1[i], s1, q3 );
-				}
-				else
-				{
-					QuaternionSlerp( q2[i], q1[i], s1, q3 );
-				}
-				q1[i][0] = q3[0];
-				q1[i][1] = q3[1];
-				q1[i][2] = q3[2];
-				q1[i][3] = q3[3];
-				pos1[i][0] = pos1[i][0] * s1 + pos2[i][0] * s2;
-				pos1[i][1] = pos1[i][1] * s1 + pos2[i][1] * s2;
-				pos1[i][2] = pos1[i][2] * s1 + pos2[i][2] * s2;
+				bones[nBones] = i;
+				weights[nBones] = s2;
+				bNoAlign[nBones] = (pbone[i].flags & BONE_FIXED_ALIGNMENT) != 0;
+				nBones++;
 			}
 		}
+
+		// slerp the collected bones a block at a time
+		CBonePoseSoA pose1, pose2;
+		pose1.Gather( pos1, q1, bones, nBones );
+		pose2.Gather( pos2, q2, bones, nBones );
+		SlerpBonePoseSoA( pose1, pose2, weights, bNoAlign );
+		pose1.Scatter( pos1, q1, bones );
 	}
 }
 
@@ -759,7 +1227,6 @@ void BlendBones(
 	int boneMask )
 {
 	int			i, j;
-	Quaternion		q3;
 
 	mstudioseqdesc_t &seqdesc = pStudioHdr->pSeqdesc( sequence );
 
@@ -806,8 +1273,9 @@ void BlendBones(
 		return;
 	}
 
-	float s2 = s;
-	float s1 = 1.0 - s2;
+	int			nBones = 0;
+	int			bones[MAXSTUDIOBONES];
+	bool		bNoAlign[MAXSTUDIOBONES];
 
 	for (i = 0; i < pStudioHdr->numbones; i++)
 	{
@@ -828,23 +1296,18 @@ void BlendBones(
 
 		if (j >= 0 && seqdesc.weight( j ) > 0.0)
 		{
-			if (pbone[i].flags & BONE_FIXED_ALIGNMENT)
-			{
-				QuaternionBlendNoAlign( q2[i], q1[i], s1, q3 );
-			}
-			else
-			{
-				QuaternionBlend( q2[i], q1[i], s1, q3 );
-			}
-			q1[i][0] = q3[0];
-			q1[i][1] = q3[1];
-			q1[i][2] = q3[2];
-			q1[i][3] = q3[3];
-			pos1[i][0] = pos1[i][0] * s1 + pos2[i][0] * s2;
-			pos1[i][1] = pos1[i][1] * s1 + pos2[i][1] * s2;
-			pos1[i][2] = pos1[i][2] * s1 + pos2[i][2] * s2;
+			bones[nBones] = i;
+			bNoAlign[nBones] = (pbone[i].flags & BONE_FIXED_ALIGNMENT) != 0;
+			nBones++;
 		}
 	}
+
+	// blend the collected bones a block at a time
+	CBonePoseSoA pose1, pose2;
+	pose1.Gather( pos1, q1, bones, nBones );
+	pose2.Gather( pos2, q2, bones, nBones );
+	BlendBonePoseSoA( pose1, pose2, s, bNoAlign );
+	pose1.Scatter( pos1, q1, bones );
 }
 
 
@@ -3152,25 +3615,38 @@ void Studio_BuildMatrices(
 		}
 	}
 
-	matrix3x4_t bonematrix;
 	matrix3x4_t rotationmatrix; // model to world transformation
 	AngleMatrix( angles, origin, rotationmatrix);
 
+	// build all the local transforms first, a block at a time, then walk
+	// down the hierarchy concatenating them in parent order
+	int					bones[MAXSTUDIOBONES];
+	int					nBones = 0;
+
 	for (j = chainlength - 1; j >= 0; j--)
 	{
 		i = chain[j];
 		if (pbones[i].flags & boneMask)
 		{
-			QuaternionMatrix( q[i], pos[i], bonematrix );
+			bones[nBones++] = i;
+		}
+	}
 
-			if (pbones[i].parent == -1) 
-			{
-				ConcatTransforms (rotationmatrix, bonematrix, bonetoworld[i]);
-			} 
-			else 
-			{
-				ConcatTransforms (bonetoworld[pbones[i].parent], bonematrix, bonetoworld[i]);
-			}
+	CBonePoseSoA pose;
+	matrix3x4_t bonematrix[MAXSTUDIOBONES];
+	pose.Gather( pos, q, bones, nBones );
+	BuildBoneMatricesSoA( pose, bonematrix );
+
+	for (j = 0; j < nBones; j++)
+	{
+		i = bones[j];
+		if (pbones[i].parent == -1) 
+		{
+			ConcatTransforms (rotationmatrix, bonematrix[j], bonetoworld[i]);
+		} 
+		else 
+		{
+			ConcatTransforms (bonetoworld[pbones[i].parent], bonematrix[j], bonetoworld[i]);
 		}
 	}
 }
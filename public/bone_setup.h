@@ -47,6 +47,50 @@ public:
 };
 
 
+//-----------------------------------------------------------------------------
+// Purpose: structure-of-arrays copy of a subset of a pose.  Bones are packed
+//			BONE_SOA_WIDTH to a block so the blend and matrix kernels below
+//			work on a whole block at a time.  Gather() and Scatter() convert
+//			to and from the usual Vector[] / Quaternion[] arrays.
+//-----------------------------------------------------------------------------
+#define BONE_SOA_WIDTH			4
+#define BONE_SOA_BLOCKS(_count)	(((_count) + BONE_SOA_WIDTH - 1) / BONE_SOA_WIDTH)
+
+struct BonePoseBlock_t
+{
+	float	m_Pos[3][BONE_SOA_WIDTH];
+	float	m_Quat[4][BONE_SOA_WIDTH];
+};
+
+class CBonePoseSoA
+{
+public:
+	CBonePoseSoA() : m_nCount( 0 ) {}
+
+	// copies pos[pBones[i]], q[pBones[i]] into slot i, unused slots in the last block are identity
+	void Gather( const Vector pos[], const Quaternion q[], const int *pBones, int nCount );
+	// writes slot i back out to pos[pBones[i]], q[pBones[i]]
+	void Scatter( Vector pos[], Quaternion q[], const int *pBones ) const;
+
+	int Count() const { return m_nCount; }
+	int BlockCount() const { return BONE_SOA_BLOCKS( m_nCount ); }
+
+	BonePoseBlock_t	m_Blocks[BONE_SOA_BLOCKS(MAXSTUDIOBONES)];
+
+private:
+	int		m_nCount;
+};
+
+// pose1 = slerp( pose2, pose1, 1 - s[i] ), matches QuaternionSlerp() / QuaternionSlerpNoAlign() per bone
+void SlerpBonePoseSoA( CBonePoseSoA &pose1, const CBonePoseSoA &pose2, const float s[], const bool bNoAlign[] );
+
+// pose1 = blend( pose2, pose1, 1 - s ), matches QuaternionBlend() / QuaternionBlendNoAlign() per bone
+void BlendBonePoseSoA( CBonePoseSoA &pose1, const CBonePoseSoA &pose2, float s, const bool bNoAlign[] );
+
+// local[i] = QuaternionMatrix( q, pos ) of slot i
+void BuildBoneMatricesSoA( const CBonePoseSoA &pose, matrix3x4_t local[] );
+
+
 
 
 //-----------------------------------------------------------------------------
@@ -15,6 +15,12 @@
 #include "vector4d.h"
 #include "trace.h"
 
+// The batched queries have SSE versions of their inner loops
+#if defined( _WIN32 ) || defined( __SSE__ )
+#define COLLISION_BATCH_SSE
+#include <xmmintrin.h>
+#endif
+
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
 
@@ -2602,3 +2608,337 @@ bool IsBoxIntersectingTriangle( const Vector &vecBoxCenter, const Vector &vecBox
 
 	return true;
 }
+
+
+//-----------------------------------------------------------------------------
+// Batched queries
+//
+// The inner loops below are written without early-outs so that each lane
+// (primitive) is evaluated with the same sequence of operations; results are
+// accumulated into a 32-bit mask word at a time. When mathlib has SSE enabled
+// the ray/box and box/box tests run four boxes at a time with the same
+// operations in the same order, and the scalar loop finishes the remainder.
+//-----------------------------------------------------------------------------
+static inline int CollisionBatch_StoreMask( uint32 *pResultMask, int nWord, uint32 nMask )
+{
+	pResultMask[nWord] = nMask;
+
+	int nCount = 0;
+	for ( ; nMask; nMask &= nMask - 1 )
+	{
+		++nCount;
+	}
+	return nCount;
+}
+
+
+//-----------------------------------------------------------------------------
+// Slab test of one ray against N boxes. The box extents are optionally grown
+// by vecExpand (the ray extents) before the tolerance is applied, matching
+// IsBoxIntersectingRay( const Vector&, const Vector&, const Ray_t&, float )
+//-----------------------------------------------------------------------------
+static int IsBoxIntersectingRayBatch( const CollisionAABBArray_t &boxes, 
+	const Vector& origin, const Vector& delta, const Vector &vecExpand, 
+	float flTolerance, uint32 *pResultMask )
+{
+	// Parallel axes and the inverse delta only depend on the ray
+	bool bParallel[3];
+	float flInvDelta[3];
+	for ( int i = 0; i < 3; ++i )
+	{
+		bParallel[i] = ( FloatMakePositive( delta[i] ) < 1e-8 );
+		flInvDelta[i] = bParallel[i] ? 0.0f : 1.0f / delta[i];
+	}
+
+#ifdef COLLISION_BATCH_SSE
+	bool bSSE = MathLib_SSEEnabled();
+	__m128 vecOrigin4[3], vecInvDelta4[3], vecExpand4[3];
+	for ( int i = 0; i < 3; ++i )
+	{
+		vecOrigin4[i] = _mm_set1_ps( origin[i] );
+		vecInvDelta4[i] = _mm_set1_ps( flInvDelta[i] );
+		vecExpand4[i] = _mm_set1_ps( vecExpand[i] );
+	}
+	__m128 flTolerance4 = _mm_set1_ps( flTolerance );
+#endif
+
+	int nHits = 0;
+	for ( int nBase = 0; nBase < boxes.m_nCount; nBase += 32 )
+	{
+		int nLanes = min( 32, boxes.m_nCount - nBase );
+		uint32 nMask = 0;
+		int j = 0;
+
+#ifdef COLLISION_BATCH_SSE
+		for ( ; bSSE && ( j + 4 <= nLanes ); j += 4 )
+		{
+			int n = nBase + j;
+			__m128 tmin = _mm_set1_ps( -FLT_MAX );
+			__m128 tmax = _mm_set1_ps( FLT_MAX );
+			__m128 bOutside = _mm_setzero_ps();
+			for ( int i = 0; i < 3; ++i )
+			{
+				__m128 flMin = _mm_sub_ps( _mm_sub_ps( _mm_loadu_ps( &boxes.m_pMins[i][n] ), vecExpand4[i] ), flTolerance4 );
+				__m128 flMax = _mm_add_ps( _mm_add_ps( _mm_loadu_ps( &boxes.m_pMaxs[i][n] ), vecExpand4[i] ), flTolerance4 );
+				if ( bParallel[i] )
+				{
+					bOutside = _mm_or_ps( bOutside, _mm_or_ps( _mm_cmplt_ps( vecOrigin4[i], flMin ), _mm_cmpgt_ps( vecOrigin4[i], flMax ) ) );
+					continue;
+				}
+
+				// minps/maxps pick the same operand as the compares in the scalar loop
+				__m128 t1 = _mm_mul_ps( _mm_sub_ps( flMin, vecOrigin4[i] ), vecInvDelta4[i] );
+				__m128 t2 = _mm_mul_ps( _mm_sub_ps( flMax, vecOrigin4[i] ), vecInvDelta4[i] );
+				tmin = _mm_max_ps( _mm_min_ps( t1, t2 ), tmin );
+				tmax = _mm_min_ps( _mm_max_ps( t2, t1 ), tmax );
+			}
+
+			__m128 bHit = _mm_and_ps( _mm_cmple_ps( tmin, tmax ), 
+				_mm_and_ps( _mm_cmpge_ps( tmax, _mm_setzero_ps() ), _mm_cmple_ps( tmin, _mm_set1_ps( 1.0f ) ) ) );
+			nMask |= ( (uint32)_mm_movemask_ps( _mm_andnot_ps( bOutside, bHit ) ) << j );
+		}
+#endif
+
+		for ( ; j < nLanes; ++j )
+		{
+			int n = nBase + j;
+			float tmin = -FLT_MAX;
+			float tmax = FLT_MAX;
+			bool bOutside = false;
+			for ( int i = 0; i < 3; ++i )
+			{
+				float flMin = ( boxes.m_pMins[i][n] - vecExpand[i] ) - flTolerance;
+				float flMax = ( boxes.m_pMaxs[i][n] + vecExpand[i] ) + flTolerance;
+				if ( bParallel[i] )
+				{
+					bOutside |= ( origin[i] < flMin ) | ( origin[i] > flMax );
+					continue;
+				}
+
+				float t1 = ( flMin - origin[i] ) * flInvDelta[i];
+				float t2 = ( flMax - origin[i] ) * flInvDelta[i];
+				float tNear = ( t1 < t2 ) ? t1 : t2;
+				float tFar = ( t1 < t2 ) ? t2 : t1;
+				tmin = ( tNear > tmin ) ? tNear : tmin;
+				tmax = ( tFar < tmax ) ? tFar : tmax;
+			}
+
+			// tmin only ever grows and tmax only ever shrinks, so testing once
+			// at the end is equivalent to the per-axis early outs
+			bool bHit = !bOutside & ( tmin <= tmax ) & ( tmax >= 0.0f ) & ( tmin <= 1.0f );
+			nMask |= ( (uint32)bHit << j );
+		}
+		nHits += CollisionBatch_StoreMask( pResultMask, nBase >> 5, nMask );
+	}
+
+	return nHits;
+}
+
+int IsBoxIntersectingRayBatch( const CollisionAABBArray_t &boxes, 
+	const Vector& origin, const Vector& delta, float flTolerance, uint32 *pResultMask )
+{
+	return IsBoxIntersectingRayBatch( boxes, origin, delta, vec3_origin, flTolerance, pResultMask );
+}
+
+int IsBoxIntersectingRayBatch( const CollisionAABBArray_t &boxes, 
+	const Ray_t& ray, float flTolerance, uint32 *pResultMask )
+{
+	if ( !ray.m_IsSwept )
+	{
+		Vector rayMins, rayMaxs;
+		VectorSubtract( ray.m_Start, ray.m_Extents, rayMins );
+		VectorAdd( ray.m_Start, ray.m_Extents, rayMaxs );
+		if ( flTolerance != 0.0f )
+		{
+			rayMins.x -= flTolerance; rayMins.y -= flTolerance; rayMins.z -= flTolerance;
+			rayMaxs.x += flTolerance; rayMaxs.y += flTolerance; rayMaxs.z += flTolerance;
+		}
+		return IsBoxIntersectingBoxBatch( boxes, rayMins, rayMaxs, pResultMask );
+	}
+
+	return IsBoxIntersectingRayBatch( boxes, ray.m_Start, ray.m_Delta, ray.m_Extents, flTolerance, pResultMask );
+}
+
+
+//-----------------------------------------------------------------------------
+// Tests one box against N boxes
+//-----------------------------------------------------------------------------
+int IsBoxIntersectingBoxBatch( const CollisionAABBArray_t &boxes, 
+	const Vector& boxMin, const Vector& boxMax, uint32 *pResultMask )
+{
+	Assert( boxMin[0] <= boxMax[0] );
+	Assert( boxMin[1] <= boxMax[1] );
+	Assert( boxMin[2] <= boxMax[2] );
+
+#ifdef COLLISION_BATCH_SSE
+	bool bSSE = MathLib_SSEEnabled();
+	__m128 vecBoxMin4[3], vecBoxMax4[3];
+	for ( int i = 0; i < 3; ++i )
+	{
+		vecBoxMin4[i] = _mm_set1_ps( boxMin[i] );
+		vecBoxMax4[i] = _mm_set1_ps( boxMax[i] );
+	}
+#endif
+
+	int nHits = 0;
+	for ( int nBase = 0; nBase < boxes.m_nCount; nBase += 32 )
+	{
+		int nLanes = min( 32, boxes.m_nCount - nBase );
+		uint32 nMask = 0;
+		int j = 0;
+
+#ifdef COLLISION_BATCH_SSE
+		for ( ; bSSE && ( j + 4 <= nLanes ); j += 4 )
+		{
+			int n = nBase + j;
+			__m128 bHit = _mm_and_ps( _mm_cmple_ps( _mm_loadu_ps( &boxes.m_pMins[0][n] ), vecBoxMax4[0] ), 
+				_mm_cmpge_ps( _mm_loadu_ps( &boxes.m_pMaxs[0][n] ), vecBoxMin4[0] ) );
+			for ( int i = 1; i < 3; ++i )
+			{
+				bHit = _mm_and_ps( bHit, _mm_cmple_ps( _mm_loadu_ps( &boxes.m_pMins[i][n] ), vecBoxMax4[i] ) );
+				bHit = _mm_and_ps( bHit, _mm_cmpge_ps( _mm_loadu_ps( &boxes.m_pMaxs[i][n] ), vecBoxMin4[i] ) );
+			}
+			nMask |= ( (uint32)_mm_movemask_ps( bHit ) << j );
+		}
+#endif
+
+		for ( ; j < nLanes; ++j )
+		{
+			int n = nBase + j;
+			bool bHit = 
+				( boxes.m_pMins[0][n] <= boxMax[0] ) & ( boxes.m_pMaxs[0][n] >= boxMin[0] ) &
+				( boxes.m_pMins[1][n] <= boxMax[1] ) & ( boxes.m_pMaxs[1][n] >= boxMin[1] ) &
+				( boxes.m_pMins[2][n] <= boxMax[2] ) & ( boxes.m_pMaxs[2][n] >= boxMin[2] );
+			nMask |= ( (uint32)bHit << j );
+		}
+		nHits += CollisionBatch_StoreMask( pResultMask, nBase >> 5, nMask );
+	}
+
+	return nHits;
+}
+
+
+//-----------------------------------------------------------------------------
+// Tests one OBB against N OBBs. The transform of the query box is only
+// computed once; boxes sharing its orientation take the AABB path just like
+// IsOBBIntersectingOBB does.
+//-----------------------------------------------------------------------------
+int IsOBBIntersectingOBBBatch( const CollisionOBBArray_t &boxes, 
+	const Vector &vecOrigin, const QAngle &vecAngles, const Vector& boxMin, const Vector& boxMax, 
+	float flTolerance, uint32 *pResultMask )
+{
+	matrix3x4_t	worldToBox1;
+	ComputeCenterIMatrix( vecOrigin, vecAngles, boxMin, boxMax, worldToBox1 );
+
+	Vector box1Size;
+	VectorSubtract( boxMax, boxMin, box1Size );
+	box1Size *= 0.5f;
+
+	int nHits = 0;
+	for ( int nBase = 0; nBase < boxes.m_nCount; nBase += 32 )
+	{
+		int nLanes = min( 32, boxes.m_nCount - nBase );
+		uint32 nMask = 0;
+		for ( int j = 0; j < nLanes; ++j )
+		{
+			int n = nBase + j;
+			bool bHit;
+			if ( vecAngles == boxes.m_pAngles[n] )
+			{
+				const Vector &vecDelta = boxes.m_pOrigins[n] - vecOrigin;
+				Vector vecOtherMins, vecOtherMaxs;
+				VectorAdd( boxes.m_pMins[n], vecDelta, vecOtherMins );
+				VectorAdd( boxes.m_pMaxs[n], vecDelta, vecOtherMaxs );
+				bHit = IsBoxIntersectingBox( boxMin, boxMax, vecOtherMins, vecOtherMaxs );
+			}
+			else
+			{
+				matrix3x4_t box2ToWorld;
+				ComputeCenterMatrix( boxes.m_pOrigins[n], boxes.m_pAngles[n], boxes.m_pMins[n], boxes.m_pMaxs[n], box2ToWorld );
+
+				Vector box2Size;
+				VectorSubtract( boxes.m_pMaxs[n], boxes.m_pMins[n], box2Size );
+				box2Size *= 0.5f;
+
+				cplane_t plane;
+				bHit = !ComputeSeparatingPlane( worldToBox1, box2ToWorld, box1Size, box2Size, flTolerance, &plane );
+			}
+			nMask |= ( (uint32)bHit << j );
+		}
+		nHits += CollisionBatch_StoreMask( pResultMask, nBase >> 5, nMask );
+	}
+
+	return nHits;
+}
+
+
+//-----------------------------------------------------------------------------
+// Intersects one (swept) ray against N triangles, see IntersectRayWithTriangle
+//-----------------------------------------------------------------------------
+int IntersectRayWithTriangleBatch( const CollisionTriangleArray_t &triangles, 
+	const Ray_t& ray, bool oneSided, float *pT, uint32 *pResultMask )
+{
+	const Vector &d = ray.m_Delta;
+	float boxt = ComputeBoxOffset( ray );
+
+	int nHits = 0;
+	for ( int nBase = 0; nBase < triangles.m_nCount; nBase += 32 )
+	{
+		int nLanes = min( 32, triangles.m_nCount - nBase );
+		uint32 nMask = 0;
+		for ( int j = 0; j < nLanes; ++j )
+		{
+			int n = nBase + j;
+			float v1x = triangles.m_pVerts[0][0][n], v1y = triangles.m_pVerts[0][1][n], v1z = triangles.m_pVerts[0][2][n];
+
+			float e1x = triangles.m_pVerts[1][0][n] - v1x;
+			float e1y = triangles.m_pVerts[1][1][n] - v1y;
+			float e1z = triangles.m_pVerts[1][2][n] - v1z;
+			float e2x = triangles.m_pVerts[2][0][n] - v1x;
+			float e2y = triangles.m_pVerts[2][1][n] - v1y;
+			float e2z = triangles.m_pVerts[2][2][n] - v1z;
+
+			bool bValid = true;
+			if ( oneSided )
+			{
+				float nx = e1y*e2z - e1z*e2y;
+				float ny = e1z*e2x - e1x*e2z;
+				float nz = e1x*e2y - e1y*e2x;
+				bValid = ( nx*d.x + ny*d.y + nz*d.z < 0.0f );
+			}
+
+			// D x E2
+			float dcx = d.y*e2z - d.z*e2y;
+			float dcy = d.z*e2x - d.x*e2z;
+			float dcz = d.x*e2y - d.y*e2x;
+
+			float denom = dcx*e1x + dcy*e1y + dcz*e1z;
+			bValid &= !( FloatMakePositive( denom ) < 1e-6 );
+			denom = bValid ? 1.0f / denom : 0.0f;
+
+			float ox = ray.m_Start.x - v1x;
+			float oy = ray.m_Start.y - v1y;
+			float oz = ray.m_Start.z - v1z;
+			float u = ( dcx*ox + dcy*oy + dcz*oz ) * denom;
+
+			// org x E1
+			float ocx = oy*e1z - oz*e1y;
+			float ocy = oz*e1x - ox*e1z;
+			float ocz = ox*e1y - oy*e1x;
+			float v = ( ocx*d.x + ocy*d.y + ocz*d.z ) * denom;
+			float t = ( ocx*e2x + ocy*e2y + ocz*e2z ) * denom;
+
+			bValid &= ( u >= 0.0f ) & ( u <= 1.0f ) & ( v >= 0.0f ) & ( v + u <= 1.0f );
+			bValid &= ( t >= -boxt ) & ( t <= 1.0f + boxt );
+
+			if ( pT )
+			{
+				pT[n] = bValid ? clamp( t, 0, 1 ) : -1.0f;
+			}
+			nMask |= ( (uint32)bValid << j );
+		}
+		nHits += CollisionBatch_StoreMask( pResultMask, nBase >> 5, nMask );
+	}
+
+	return nHits;
+}
@@ -13,6 +13,7 @@
 #pragma once
 #endif
 
+#include "tier0/platform.h"
 
 //-----------------------------------------------------------------------------
 // forward declarations
@@ -340,4 +341,61 @@ bool IsBoxIntersectingTriangle( const Vector &vecBoxCenter, const Vector &vecBox
 				   		        const Vector &v1, const Vector &v2, const Vector &v3,
 						        const cplane_t &plane, float flTolerance );
 
+
+//-----------------------------------------------------------------------------
+// Batched queries
+//
+// These test a single ray or box against N primitives stored in 
+// structure-of-arrays form. One bit per primitive is written into
+// pResultMask, which must hold at least COLLISION_BATCH_MASK_SIZE( nCount )
+// entries. The return value is the number of primitives that were hit.
+// Results are identical to calling the single-primitive versions above
+// once per primitive.
+//-----------------------------------------------------------------------------
+#define COLLISION_BATCH_MASK_SIZE( _count )		( ( (_count) + 31 ) >> 5 )
+
+struct CollisionAABBArray_t
+{
+	const float *m_pMins[3];	// [axis][box]
+	const float *m_pMaxs[3];	// [axis][box]
+	int m_nCount;
+};
+
+struct CollisionOBBArray_t
+{
+	const Vector *m_pOrigins;
+	const QAngle *m_pAngles;
+	const Vector *m_pMins;
+	const Vector *m_pMaxs;
+	int m_nCount;
+};
+
+struct CollisionTriangleArray_t
+{
+	const float *m_pVerts[3][3];	// [vertex][axis][triangle]
+	int m_nCount;
+};
+
+inline bool IsCollisionBatchBitSet( const uint32 *pResultMask, int i )
+{
+	return ( pResultMask[i >> 5] & ( 1u << ( i & 31 ) ) ) != 0;
+}
+
+int IsBoxIntersectingRayBatch( const CollisionAABBArray_t &boxes, 
+	const Vector& origin, const Vector& delta, float flTolerance, uint32 *pResultMask );
+
+int IsBoxIntersectingRayBatch( const CollisionAABBArray_t &boxes, 
+	const Ray_t& ray, float flTolerance, uint32 *pResultMask );
+
+int IsBoxIntersectingBoxBatch( const CollisionAABBArray_t &boxes, 
+	const Vector& boxMin, const Vector& boxMax, uint32 *pResultMask );
+
+int IsOBBIntersectingOBBBatch( const CollisionOBBArray_t &boxes, 
+	const Vector &vecOrigin, const QAngle &vecAngles, const Vector& boxMin, const Vector& boxMax, 
+	float flTolerance, uint32 *pResultMask );
+
+// pT (optional) receives the same value IntersectRayWithTriangle would return per triangle
+int IntersectRayWithTriangleBatch( const CollisionTriangleArray_t &triangles, 
+	const Ray_t& ray, bool oneSided, float *pT, uint32 *pResultMask );
+
 #endif // COLLISIONUTILS_H
\ No newline at end of file
@@ -15,8 +15,6 @@
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
 
-#define NEWRAYTEST 1
-
 //=============================================================================
 //	Displacement Collision Triangle
 
@@ -161,8 +159,13 @@ bool CDispCollTree::AABBTree_Create( CCoreDispInfo *pDisp )
 	// Setup/create the leaf nodes first so the recusion can use this data to stop.
 	AABBTree_CreateLeafs();
 
-	// Generate bounding boxes.
-	AABBTree_GenerateBoxes();
+	// Generate bounding boxes. The exact boxes of the internal nodes are only
+	// needed to build the quantized 4-wide nodes, so they aren't kept.
+	CUtlVector<CDispCollAABBNode> aNodes;
+	AABBTree_GenerateBoxes( aNodes );
+
+	// Generate the quantized 4-wide nodes used for traversal.
+	AABBTree_GenerateNodes4( aNodes );
 
 	// Create the bounding box of the displacement surface + the base face.
 	AABBTree_CalcBounds();
@@ -191,13 +194,15 @@ void CDispCollTree::AABBTree_CopyDispData( CCoreDispInfo *pDisp )
 	// Allocate collision tree data.
 	m_aVerts.SetSize( GetSize() );
 	m_aTris.SetSize( GetTriSize() );
-	m_aNodes.SetSize( Nodes_CalcCount( m_nPower ) );
+	m_aLeafs.SetSize( Nodes_CalcCount( m_nPower ) - Nodes4_CalcCount( m_nPower ) );
+	m_aNodes4.SetSize( Nodes4_CalcCount( m_nPower ) );
 
 	// Setup size.
 	m_nSize = sizeof( this );
 	m_nSize += sizeof( Vector ) * GetSize();
 	m_nSize += sizeof( CDispCollTri ) * GetTriSize();
-	m_nSize += sizeof( CDispCollAABBNode ) * Nodes_CalcCount( m_nPower );
+	m_nSize += sizeof( CDispCollAABBNode ) * ( Nodes_CalcCount( m_nPower ) - Nodes4_CalcCount( m_nPower ) );
+	m_nSize += sizeof( CDispCollAABBNode4 ) * Nodes4_CalcCount( m_nPower );
 	m_nSize += sizeof( CDispCollTri* ) * DISPCOLL_TREETRI_SIZE;
 
 	// Copy vertex data.
@@ -268,14 +273,15 @@ void CDispCollTree::AABBTree_CreateLeafs( void )
 	{
 		for ( int iWid = 0; iWid < nWidth; ++iWid )
 		{
-			int iNode = Nodes_GetIndexFromComponents( iWid, iHgt );
-			iNode += iMinNode;
+			// The leaves are stored from the bottom leftmost node on.
+			int iLeaf = Nodes_GetIndexFromComponents( iWid, iHgt );
+			Assert( iMinNode + iLeaf < Nodes_CalcCount( m_nPower ) );
 
 			int iIndex = iHgt * nWidth + iWid;
 			int iTri = iIndex * 2;
 
-			m_aNodes[iNode].m_iTris[0] = iTri;
-			m_aNodes[iNode].m_iTris[1] = iTri + 1;
+			m_aLeafs[iLeaf].m_iTris[0] = iTri;
+			m_aLeafs[iLeaf].m_iTris[1] = iTri + 1;
 		}
 	}
 }
@@ -283,30 +289,265 @@ void CDispCollTree::AABBTree_CreateLeafs( void )
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
-void CDispCollTree::AABBTree_GenerateBoxes( void )
+void CDispCollTree::AABBTree_GenerateBoxes( CUtlVector<CDispCollAABBNode> &aNodes )
 {
-	for ( int iNode = ( m_aNodes.Count() - 1 ); iNode >= 0; --iNode )
+	aNodes.SetSize( Nodes_CalcCount( m_nPower ) );
+
+	for ( int iNode = ( aNodes.Count() - 1 ); iNode >= 0; --iNode )
 	{
 		// Leaf?
-		if ( m_aNodes[iNode].IsLeaf() )
+		if ( iNode >= m_aNodes4.Count() )
 		{
-			m_aNodes[iNode].GenerateBox( m_aTris, m_aVerts );
+			CDispCollAABBNode &leaf = m_aLeafs[iNode - m_aNodes4.Count()];
+			leaf.GenerateBox( m_aTris, m_aVerts );
+			aNodes[iNode] = leaf;
 		}
 		else
 		{
 			// Get bounds from children.
-			m_aNodes[iNode].m_vecBox[0].Init( FLT_MAX, FLT_MAX, FLT_MAX );
-			m_aNodes[iNode].m_vecBox[1].Init( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+			aNodes[iNode].m_vecBox[0].Init( FLT_MAX, FLT_MAX, FLT_MAX );
+			aNodes[iNode].m_vecBox[1].Init( -FLT_MAX, -FLT_MAX, -FLT_MAX );
 			
 			for ( int iChild = 0; iChild < 4; ++iChild )
 			{
 				int iChildNode = Nodes_GetChild( iNode, iChild );
 				
-				VectorMin( m_aNodes[iChildNode].m_vecBox[0], m_aNodes[iNode].m_vecBox[0], m_aNodes[iNode].m_vecBox[0] );
-				VectorMax( m_aNodes[iChildNode].m_vecBox[1], m_aNodes[iNode].m_vecBox[1], m_aNodes[iNode].m_vecBox[1] );
+				VectorMin( aNodes[iChildNode].m_vecBox[0], aNodes[iNode].m_vecBox[0], aNodes[iNode].m_vecBox[0] );
+				VectorMax( aNodes[iChildNode].m_vecBox[1], aNodes[iNode].m_vecBox[1], aNodes[iNode].m_vecBox[1] );
+			}
+		}
+	}
+
+	m_vecTreeBounds[0] = aNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[0];
+	m_vecTreeBounds[1] = aNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[1];
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Quantize the child bounds of every internal node. Mins are rounded
+//          down and maxs up, so the quantized boxes always contain the exact
+//          ones and can only ever let more children through the traversal.
+//-----------------------------------------------------------------------------
+void CDispCollTree::AABBTree_GenerateNodes4( const CUtlVector<CDispCollAABBNode> &aNodes )
+{
+	const Vector &vecTreeMin = m_vecTreeBounds[0];
+	const Vector &vecTreeMax = m_vecTreeBounds[1];
+	for ( int iAxis = 0; iAxis < 3; ++iAxis )
+	{
+		// Keep a minimum range so a step is never lost in the float precision of the origin.
+		float flRange = max( vecTreeMax[iAxis] - vecTreeMin[iAxis], 1.0f );
+		m_vecQuantOrigin[iAxis] = vecTreeMin[iAxis];
+		m_vecQuantScale[iAxis] = flRange / DISPCOLL_QUANT_STEPS;
+	}
+
+	for ( int iNode = 0; iNode < m_aNodes4.Count(); ++iNode )
+	{
+		Assert( !aNodes[iNode].IsLeaf() );
+
+		CDispCollAABBNode4 &node4 = m_aNodes4[iNode];
+		for ( int iChild = 0; iChild < 4; ++iChild )
+		{
+			const CDispCollAABBNode &child = aNodes[Nodes_GetChild( iNode, iChild )];
+			for ( int iAxis = 0; iAxis < 3; ++iAxis )
+			{
+				float flInvScale = 1.0f / m_vecQuantScale[iAxis];
+
+				int nMin = ( int )floor( ( child.m_vecBox[0][iAxis] - m_vecQuantOrigin[iAxis] ) * flInvScale );
+				nMin = clamp( nMin, 0, 0xffff );
+				while ( ( nMin > 0 ) && ( Nodes4_Dequantize( iAxis, nMin ) > child.m_vecBox[0][iAxis] ) )
+				{
+					--nMin;
+				}
+
+				int nMax = ( int )ceil( ( child.m_vecBox[1][iAxis] - m_vecQuantOrigin[iAxis] ) * flInvScale );
+				nMax = clamp( nMax, 0, 0xffff );
+				while ( ( nMax < 0xffff ) && ( Nodes4_Dequantize( iAxis, nMax ) < child.m_vecBox[1][iAxis] ) )
+				{
+					++nMax;
+				}
+
+				Assert( Nodes4_Dequantize( iAxis, nMin ) <= child.m_vecBox[0][iAxis] );
+				Assert( Nodes4_Dequantize( iAxis, nMax ) >= child.m_vecBox[1][iAxis] );
+				node4.m_nMins[iAxis][iChild] = nMin;
+				node4.m_nMaxs[iAxis][iChild] = nMax;
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Test a (swept) ray against all four children of an internal node.
+//          This is the slab test from IsBoxIntersectingRay, run on the four
+//          boxes side by side.
+//  Output: int - bit n is set if child n is hit
+//-----------------------------------------------------------------------------
+int CDispCollTree::Nodes4_IntersectRay( int iNode, const Vector &vecStart, const Vector &vecDelta, 
+									    const Vector &vecExtents, float flTolerance )
+{
+	const CDispCollAABBNode4 &node4 = m_aNodes4[iNode];
+
+	float flMin[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	float flMax[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+	int nOutside = 0;
+
+	for ( int iAxis = 0; iAxis < 3; ++iAxis )
+	{
+		float flBoxMin[4], flBoxMax[4];
+		for ( int iChild = 0; iChild < 4; ++iChild )
+		{
+			flBoxMin[iChild] = ( Nodes4_Dequantize( iAxis, node4.m_nMins[iAxis][iChild] ) - vecExtents[iAxis] ) - flTolerance;
+			flBoxMax[iChild] = ( Nodes4_Dequantize( iAxis, node4.m_nMaxs[iAxis][iChild] ) + vecExtents[iAxis] ) + flTolerance;
+		}
+
+		// Parallel case...
+		if ( FloatMakePositive( vecDelta[iAxis] ) < 1e-8 )
+		{
+			for ( int iChild = 0; iChild < 4; ++iChild )
+			{
+				nOutside |= ( ( vecStart[iAxis] < flBoxMin[iChild] ) | ( vecStart[iAxis] > flBoxMax[iChild] ) ) << iChild;
+			}
+			continue;
+		}
+
+		float flInvDelta = 1.0f / vecDelta[iAxis];
+		for ( int iChild = 0; iChild < 4; ++iChild )
+		{
+			float t1 = ( flBoxMin[iChild] - vecStart[iAxis] ) * flInvDelta;
+			float t2 = ( flBoxMax[iChild] - vecStart[iAxis] ) * flInvDelta;
+			float tNear = ( t1 < t2 ) ? t1 : t2;
+			float tFar = ( t1 < t2 ) ? t2 : t1;
+			flMin[iChild] = ( tNear > flMin[iChild] ) ? tNear : flMin[iChild];
+			flMax[iChild] = ( tFar < flMax[iChild] ) ? tFar : flMax[iChild];
+		}
+	}
+
+	int nHit = 0;
+	for ( int iChild = 0; iChild < 4; ++iChild )
+	{
+		nHit |= ( ( flMin[iChild] <= flMax[iChild] ) & ( flMax[iChild] >= 0.0f ) & ( flMin[iChild] <= 1.0f ) ) << iChild;
+	}
+
+	return ( nHit & ~nOutside );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Test a box against all four children of an internal node.
+//  Output: int - bit n is set if child n is hit
+//-----------------------------------------------------------------------------
+int CDispCollTree::Nodes4_IntersectBox( int iNode, const Vector &vecMin, const Vector &vecMax )
+{
+	const CDispCollAABBNode4 &node4 = m_aNodes4[iNode];
+
+	int nHit = 0xf;
+	for ( int iAxis = 0; iAxis < 3; ++iAxis )
+	{
+		for ( int iChild = 0; iChild < 4; ++iChild )
+		{
+			int nOverlap = ( Nodes4_Dequantize( iAxis, node4.m_nMins[iAxis][iChild] ) <= vecMax[iAxis] ) &
+				           ( Nodes4_Dequantize( iAxis, node4.m_nMaxs[iAxis][iChild] ) >= vecMin[iAxis] );
+			nHit &= ~( ( nOverlap ^ 1 ) << iChild );
+		}
+	}
+
+	return nHit;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Collect the leaves hit by a (swept) ray, in the same depth first
+//          order the tree used to be recursed in. The internal levels are
+//          culled with the quantized 4-wide nodes; the leaves themselves are
+//          tested against their exact boxes, so the leaf set is identical to
+//          testing the exact box of every node.
+//  Output: int - the number of leaves written to pLeafs
+//-----------------------------------------------------------------------------
+int CDispCollTree::AABBTree_GatherLeafsRay( const Ray_t &ray, const Vector &vecInvDelta, 
+										    const Vector &vecExtents, unsigned short *pLeafs )
+{
+	int nLeafCount = 0;
+
+	int aStack[DISPCOLL_NODESTACK_SIZE];
+	int nStackCount = 0;
+	aStack[nStackCount++] = DISPCOLL_ROOTNODE_INDEX;
+
+	while ( nStackCount > 0 )
+	{
+		int iNode = aStack[--nStackCount];
+		int iFirstChild = Nodes_GetChild( iNode, 0 );
+
+		if ( iFirstChild >= m_aNodes4.Count() )
+		{
+			// The children are leaves.
+			for ( int iChild = 0; iChild < 4; ++iChild )
+			{
+				const CDispCollAABBNode &leaf = Nodes_GetLeaf( iFirstChild + iChild );
+				Vector vecBox[2];
+				VectorSubtract( leaf.m_vecBox[0], vecExtents, vecBox[0] );
+				VectorAdd( leaf.m_vecBox[1], vecExtents, vecBox[1] );
+				if ( IsBoxIntersectingRay( vecBox[0], vecBox[1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON ) )
+				{
+					pLeafs[nLeafCount++] = iFirstChild + iChild;
+				}
+			}
+			continue;
+		}
+
+		// Push in reverse so the children pop in order.
+		int nHit = Nodes4_IntersectRay( iNode, ray.m_Start, ray.m_Delta, vecExtents, DISPCOLL_DIST_EPSILON );
+		for ( int iChild = 3; iChild >= 0; --iChild )
+		{
+			if ( nHit & ( 1 << iChild ) )
+			{
+				Assert( nStackCount < DISPCOLL_NODESTACK_SIZE );
+				aStack[nStackCount++] = iFirstChild + iChild;
+			}
+		}
+	}
+
+	return nLeafCount;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Collect the leaves overlapping a box, see AABBTree_GatherLeafsRay.
+//-----------------------------------------------------------------------------
+int CDispCollTree::AABBTree_GatherLeafsBox( const Vector &vecMin, const Vector &vecMax, unsigned short *pLeafs )
+{
+	int nLeafCount = 0;
+
+	int aStack[DISPCOLL_NODESTACK_SIZE];
+	int nStackCount = 0;
+	aStack[nStackCount++] = DISPCOLL_ROOTNODE_INDEX;
+
+	while ( nStackCount > 0 )
+	{
+		int iNode = aStack[--nStackCount];
+		int iFirstChild = Nodes_GetChild( iNode, 0 );
+
+		if ( iFirstChild >= m_aNodes4.Count() )
+		{
+			// The children are leaves.
+			for ( int iChild = 0; iChild < 4; ++iChild )
+			{
+				const CDispCollAABBNode &leaf = Nodes_GetLeaf( iFirstChild + iChild );
+				if ( IsBoxIntersectingBox( leaf.m_vecBox[0], leaf.m_vecBox[1], vecMin, vecMax ) )
+				{
+					pLeafs[nLeafCount++] = iFirstChild + iChild;
+				}
+			}
+			continue;
+		}
+
+		// Push in reverse so the children pop in order.
+		int nHit = Nodes4_IntersectBox( iNode, vecMin, vecMax );
+		for ( int iChild = 3; iChild >= 0; --iChild )
+		{
+			if ( nHit & ( 1 << iChild ) )
+			{
+				Assert( nStackCount < DISPCOLL_NODESTACK_SIZE );
+				aStack[nStackCount++] = iFirstChild + iChild;
 			}
 		}
 	}
+
+	return nLeafCount;
 }
 
 //-----------------------------------------------------------------------------
@@ -315,11 +556,11 @@ void CDispCollTree::AABBTree_GenerateBoxes( void )
 void CDispCollTree::AABBTree_CalcBounds( void )
 {
 	// Check data.
-	if ( ( m_aVerts.Count() == 0 ) || ( m_aNodes.Count() == 0 ) )
+	if ( ( m_aVerts.Count() == 0 ) || ( m_aLeafs.Count() == 0 ) )
 		return;
 
-	m_vecBounds[0] = m_aNodes[0].m_vecBox[0];
-	m_vecBounds[1] = m_aNodes[0].m_vecBox[1];
+	m_vecBounds[0] = m_vecTreeBounds[0];
+	m_vecBounds[1] = m_vecTreeBounds[1];
 	
 	// Add surface points to bounds.
 	for ( int iPoint = 0; iPoint < 4; ++iPoint )
@@ -352,7 +593,6 @@ void CDispCollTree::Cache_TestIt( void )
 	}
 }
 
-#ifdef NEWRAYTEST
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -380,144 +620,43 @@ bool CDispCollTree::AABBTree_Ray( const Ray_t &ray, RayDispOutput_t &output )
 		}
 	}
 	
-	if ( IsBoxIntersectingRay( m_aNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[0], 
-		                       m_aNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[1], 
+	if ( IsBoxIntersectingRay( m_vecTreeBounds[0], 
+		                       m_vecTreeBounds[1], 
 		                       ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON ) )
 	{
-		AABBTree_TreeTrisRayBarycentricTest_r( ray, vecInvDelta, DISPCOLL_ROOTNODE_INDEX, output, &pImpactTri );
-	}
-
-	if ( pImpactTri )
-	{
-		// Collision.
-		output.ndxVerts[0] = pImpactTri->GetVert( 0 );
-		output.ndxVerts[1] = pImpactTri->GetVert( 2 );
-		output.ndxVerts[2] = pImpactTri->GetVert( 1 );
-
-		Assert( (output.u <= 1.0f ) && ( output.v <= 1.0f ) );
-		Assert( (output.u >= 0.0f ) && ( output.v >= 0.0f ) );
-
-		return true;
-	}
-
-	// No collision.
-	return false;
-}
-
-//-----------------------------------------------------------------------------
-// Purpose: 
-//-----------------------------------------------------------------------------
-void CDispCollTree::AABBTree_TreeTrisRayBarycentricTest_r( const Ray_t &ray, const Vector &vecInvDelta, int iNode, RayDispOutput_t &output, CDispCollTri **pImpactTri )
-{
-	if ( m_aNodes[iNode].IsLeaf() )
-	{
-		float flU, flV, flT;
-
-		CDispCollTri *pTri0 = &m_aTris[m_aNodes[iNode].m_iTris[0]];
-		CDispCollTri *pTri1 = &m_aTris[m_aNodes[iNode].m_iTris[1]];
-		if ( ComputeIntersectionBarycentricCoordinates( ray, m_aVerts[pTri0->GetVert( 0 )], m_aVerts[pTri0->GetVert( 2 )], m_aVerts[pTri0->GetVert( 1 )], flU, flV, &flT ) )
+		unsigned short aLeafs[DISPCOLL_TREETRI_SIZE/2];
+		int nLeafCount = AABBTree_GatherLeafsRay( ray, vecInvDelta, vec3_origin, aLeafs );
+		for ( int iLeaf = 0; iLeaf < nLeafCount; ++iLeaf )
 		{
-			// Make sure it's inside the range
-			if ( ( flU >= 0.0f ) && ( flV >= 0.0f ) && ( ( flU + flV ) <= 1.0f ) )
+			const CDispCollAABBNode &leaf = Nodes_GetLeaf( aLeafs[iLeaf] );
+			for ( int iTri = 0; iTri < 2; ++iTri )
 			{
-				if( ( flT > 0.0f ) && ( flT < output.dist ) )
+				float flU, flV, flT;
+				CDispCollTri *pTri = &m_aTris[leaf.m_iTris[iTri]];
+				if ( ComputeIntersectionBarycentricCoordinates( ray, m_aVerts[pTri->GetVert( 0 )], m_aVerts[pTri->GetVert( 2 )], m_aVerts[pTri->GetVert( 1 )], flU, flV, &flT ) )
 				{
-					(*pImpactTri) = pTri0;
-					output.u = flU;
-					output.v = flV;
-					output.dist = flT;
+					// Make sure it's inside the range
+					if ( ( flU >= 0.0f ) && ( flV >= 0.0f ) && ( ( flU + flV ) <= 1.0f ) )
+					{
+						if( ( flT > 0.0f ) && ( flT < output.dist ) )
+						{
+							pImpactTri = pTri;
+							output.u = flU;
+							output.v = flV;
+							output.dist = flT;
+						}
+					}
 				}
 			}
 		}
-
-		if ( ComputeIntersectionBarycentricCoordinates( ray, m_aVerts[pTri1->GetVert( 0 )], m_aVerts[pTri1->GetVert( 2 )], m_aVerts[pTri1->GetVert( 1 )], flU, flV, &flT ) )
-		{
-			// Make sure it's inside the range
-			if ( ( flU >= 0.0f ) && ( flV >= 0.0f ) && ( ( flU + flV ) <= 1.0f ) )
-			{
-				if( ( flT > 0.0f ) && ( flT < output.dist ) )
-				{
-					(*pImpactTri) = pTri1;
-					output.u = flU;
-					output.v = flV;
-					output.dist = flT;
-				}
-			}
-		}
-	}
-	else
-	{
-		int iChildNode[4];
-		iChildNode[0] = Nodes_GetChild( iNode, 0 );
-		iChildNode[1] = Nodes_GetChild( iNode, 1 );
-		iChildNode[2] = Nodes_GetChild( iNode, 2 );
-		iChildNode[3] = Nodes_GetChild( iNode, 3 );
-
-		bool bIntersectChild[4];
-		bIntersectChild[0] = IsBoxIntersectingRay( m_aNodes[iChildNode[0]].m_vecBox[0], m_aNodes[iChildNode[0]].m_vecBox[1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
-		bIntersectChild[1] = IsBoxIntersectingRay( m_aNodes[iChildNode[1]].m_vecBox[0], m_aNodes[iChildNode[1]].m_vecBox[1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
-		bIntersectChild[2] = IsBoxIntersectingRay( m_aNodes[iChildNode[2]].m_vecBox[0], m_aNodes[iChildNode[2]].m_vecBox[1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
-		bIntersectChild[3] = IsBoxIntersectingRay( m_aNodes[iChildNode[3]].m_vecBox[0], m_aNodes[iChildNode[3]].m_vecBox[1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
-
-		if ( bIntersectChild[0] ) { AABBTree_TreeTrisRayBarycentricTest_r( ray, vecInvDelta, iChildNode[0], output, pImpactTri ); }
-		if ( bIntersectChild[1] ) { AABBTree_TreeTrisRayBarycentricTest_r( ray, vecInvDelta, iChildNode[1], output, pImpactTri ); }
-		if ( bIntersectChild[2] ) { AABBTree_TreeTrisRayBarycentricTest_r( ray, vecInvDelta, iChildNode[2], output, pImpactTri ); }
-		if ( bIntersectChild[3] ) { AABBTree_TreeTrisRayBarycentricTest_r( ray, vecInvDelta, iChildNode[3], output, pImpactTri ); }
 	}
-}
-#else
-//-----------------------------------------------------------------------------
-// Purpose: 
-//-----------------------------------------------------------------------------
-bool CDispCollTree::AABBTree_Ray( const Ray_t &ray, RayDispOutput_t &output )
-{
-	// Check for opacity.
-	if ( !( m_nContents & MASK_OPAQUE ) )
-		return false;
 
-	// Build the triangle list.
-	unsigned short nTreeTriCount = 0;
-	CDispCollTri *aTreeTris[DISPCOLL_TREETRI_SIZE];
-	AABBTree_BuildTreeTrisSweep_r( ray, DISPCOLL_ROOTNODE_INDEX, &aTreeTris[0], nTreeTriCount );
-	if ( nTreeTriCount == 0 )
-		return false;
-
-	// Init output data.
-	float flMinT = 1.0f;
-	float flMinU = 0.0f;
-	float flMinV = 0.0f;
-
-	CDispCollTri *pImpactTri = NULL;
-	for( int iTri = 0; iTri < nTreeTriCount; ++iTri )
-	{
-		float flU, flV, flT;
-
-		CDispCollTri *pTri = aTreeTris[iTri];
-		if ( ComputeIntersectionBarycentricCoordinates( ray, m_aVerts[pTri->GetVert( 0 )], m_aVerts[pTri->GetVert( 2 )], m_aVerts[pTri->GetVert( 1 )], flU, flV, &flT ) )
-		{
-			// Make sure it's inside the range
-			if ( ( flU < 0.0f ) || ( flV < 0.0f ) || ( ( flU + flV ) > 1.0f ) )
-				continue;
-
-			if( ( flT > 0.0f ) && ( flT < flMinT ) )
-			{
-				pImpactTri = pTri;
-				flMinT = flT;
-				flMinU = flU;
-				flMinV = flV;
-			}
-		}
-	}
-
-	// Collision.
-	if( pImpactTri )
+	if ( pImpactTri )
 	{
+		// Collision.
 		output.ndxVerts[0] = pImpactTri->GetVert( 0 );
-		output.ndxVerts[1] = pImpactTri->GetVert( 1 );
-		output.ndxVerts[2] = pImpactTri->GetVert( 2 );
-		output.u = flMinU;
-		output.v = flMinV;
-		output.dist = flMinT;
+		output.ndxVerts[1] = pImpactTri->GetVert( 2 );
+		output.ndxVerts[2] = pImpactTri->GetVert( 1 );
 
 		Assert( (output.u <= 1.0f ) && ( output.v <= 1.0f ) );
 		Assert( (output.u >= 0.0f ) && ( output.v >= 0.0f ) );
@@ -528,9 +667,8 @@ bool CDispCollTree::AABBTree_Ray( const Ray_t &ray, RayDispOutput_t &output )
 	// No collision.
 	return false;
 }
-#endif
 
-#ifdef NEWRAYTEST
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -558,11 +696,26 @@ bool CDispCollTree::AABBTree_Ray( const Ray_t &ray, CBaseTrace *pTrace, bool bSi
 		}
 	}
 
-	if ( IsBoxIntersectingRay( m_aNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[0], 
-		                       m_aNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[1], 
+	if ( IsBoxIntersectingRay( m_vecTreeBounds[0], 
+		                       m_vecTreeBounds[1], 
 		                       ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON ) )
 	{
-		AABBTree_TreeTrisRayTest_r( ray, vecInvDelta, DISPCOLL_ROOTNODE_INDEX, pTrace, bSide, &pImpactTri );
+		unsigned short aLeafs[DISPCOLL_TREETRI_SIZE/2];
+		int nLeafCount = AABBTree_GatherLeafsRay( ray, vecInvDelta, vec3_origin, aLeafs );
+		for ( int iLeaf = 0; iLeaf < nLeafCount; ++iLeaf )
+		{
+			const CDispCollAABBNode &leaf = Nodes_GetLeaf( aLeafs[iLeaf] );
+			for ( int iTri = 0; iTri < 2; ++iTri )
+			{
+				CDispCollTri *pTri = &m_aTris[leaf.m_iTris[iTri]];
+				float flFrac = IntersectRayWithTriangle( ray, m_aVerts[pTri->GetVert( 0 )], m_aVerts[pTri->GetVert( 2 )], m_aVerts[pTri->GetVert( 1 )], bSide );
+				if( ( flFrac >= 0.0f ) && ( flFrac < pTrace->fraction ) )
+				{
+					pTrace->fraction = flFrac;
+					pImpactTri = pTri;
+				}
+			}
+		}
 	}
 
 	if ( pImpactTri )
@@ -578,203 +731,58 @@ bool CDispCollTree::AABBTree_Ray( const Ray_t &ray, CBaseTrace *pTrace, bool bSi
 	return false;
 }
 
-//-----------------------------------------------------------------------------
-// Purpose: 
-//-----------------------------------------------------------------------------
-void CDispCollTree::AABBTree_TreeTrisRayTest_r( const Ray_t &ray, const Vector &vecInvDelta, int iNode, CBaseTrace *pTrace, bool bSide, CDispCollTri **pImpactTri )
-{
-	if ( m_aNodes[iNode].IsLeaf() )
-	{
-		CDispCollTri *pTri0 = &m_aTris[m_aNodes[iNode].m_iTris[0]];
-		CDispCollTri *pTri1 = &m_aTris[m_aNodes[iNode].m_iTris[1]];
-		float flFrac = IntersectRayWithTriangle( ray, m_aVerts[pTri0->GetVert( 0 )], m_aVerts[pTri0->GetVert( 2 )], m_aVerts[pTri0->GetVert( 1 )], bSide );
-		if( ( flFrac >= 0.0f ) && ( flFrac < pTrace->fraction ) )
-		{
-			pTrace->fraction = flFrac;
-			(*pImpactTri) = pTri0;
-		}
-		
-		flFrac = IntersectRayWithTriangle( ray, m_aVerts[pTri1->GetVert( 0 )], m_aVerts[pTri1->GetVert( 2 )], m_aVerts[pTri1->GetVert( 1 )], bSide );
-		if( ( flFrac >= 0.0f ) && ( flFrac < pTrace->fraction ) )
-		{
-			pTrace->fraction = flFrac;
-			(*pImpactTri) = pTri1;
-		}
-	}
-	else
-	{
-		int iChildNode[4];
-		iChildNode[0] = Nodes_GetChild( iNode, 0 );
-		iChildNode[1] = Nodes_GetChild( iNode, 1 );
-		iChildNode[2] = Nodes_GetChild( iNode, 2 );
-		iChildNode[3] = Nodes_GetChild( iNode, 3 );
-		
-		bool bIntersectChild[4];
-		bIntersectChild[0] = IsBoxIntersectingRay( m_aNodes[iChildNode[0]].m_vecBox[0], m_aNodes[iChildNode[0]].m_vecBox[1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
-		bIntersectChild[1] = IsBoxIntersectingRay( m_aNodes[iChildNode[1]].m_vecBox[0], m_aNodes[iChildNode[1]].m_vecBox[1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
-		bIntersectChild[2] = IsBoxIntersectingRay( m_aNodes[iChildNode[2]].m_vecBox[0], m_aNodes[iChildNode[2]].m_vecBox[1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
-		bIntersectChild[3] = IsBoxIntersectingRay( m_aNodes[iChildNode[3]].m_vecBox[0], m_aNodes[iChildNode[3]].m_vecBox[1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
-
-		if ( bIntersectChild[0] ) { AABBTree_TreeTrisRayTest_r( ray, vecInvDelta, iChildNode[0], pTrace, bSide, pImpactTri ); }
-		if ( bIntersectChild[1] ) { AABBTree_TreeTrisRayTest_r( ray, vecInvDelta, iChildNode[1], pTrace, bSide, pImpactTri ); }
-		if ( bIntersectChild[2] ) { AABBTree_TreeTrisRayTest_r( ray, vecInvDelta, iChildNode[2], pTrace, bSide, pImpactTri ); }
-		if ( bIntersectChild[3] ) { AABBTree_TreeTrisRayTest_r( ray, vecInvDelta, iChildNode[3], pTrace, bSide, pImpactTri ); }
-	}
-}
-#else
-//-----------------------------------------------------------------------------
-// Purpose: 
-//-----------------------------------------------------------------------------
-bool CDispCollTree::AABBTree_Ray( const Ray_t &ray, CBaseTrace *pTrace, bool bSide )
-{
-	// Check for opacity.
-	if ( !( m_nContents & MASK_OPAQUE ) )
-		return false;	
-
-	// Build the triangle list.
-	unsigned short nTreeTriCount = 0;
-	CDispCollTri *aTreeTris[DISPCOLL_TREETRI_SIZE];
-	AABBTree_BuildTreeTrisSweep_r( ray, DISPCOLL_ROOTNODE_INDEX, &aTreeTris[0], nTreeTriCount );
-	if ( nTreeTriCount == 0 )
-		return false;
-
-	CDispCollTri *pImpactTri = NULL;
-	for( int iTri = 0; iTri < nTreeTriCount; ++iTri )
-	{
-		CDispCollTri *pTri = aTreeTris[iTri];
-		float flFrac = IntersectRayWithTriangle( ray, m_aVerts[pTri->GetVert( 0 )], m_aVerts[pTri->GetVert( 2 )], m_aVerts[pTri->GetVert( 1 )], bSide );
-		if( flFrac < 0.0f )
-			continue;			
-		
-		if( flFrac < pTrace->fraction )
-		{
-			pTrace->fraction = flFrac;
-			pImpactTri = pTri;
-		}
-	}
-
-	if ( pImpactTri )
-	{
-		pTrace->plane.normal = pImpactTri->m_vecNormal;
-		pTrace->plane.dist = pImpactTri->m_flDist;
-		pTrace->dispFlags = pImpactTri->m_uiFlags;
-		return true;
-	}
-
-	// No collision.
-	return false;
-}
-#endif
 
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
-void CDispCollTree::AABBTree_BuildTreeTrisSweep_r( const Ray_t &ray, int iNode, CDispCollTri **ppTreeTris, unsigned short &nTriCount )
+bool CDispCollTree::AABBTree_IntersectAABB( const Ray_t &ray )
 {
-	bool bIntersect = IsBoxIntersectingRay( m_aNodes[iNode].m_vecBox[0], m_aNodes[iNode].m_vecBox[1], ray, DISPCOLL_DIST_EPSILON );
-	if ( bIntersect )
-	{
-		if ( m_aNodes[iNode].IsLeaf() )
-		{
-			if ( nTriCount <= (DISPCOLL_TREETRI_SIZE-2) )
-			{
-				ppTreeTris[nTriCount] = &m_aTris[m_aNodes[iNode].m_iTris[0]];
-				ppTreeTris[nTriCount+1] = &m_aTris[m_aNodes[iNode].m_iTris[1]];
-				nTriCount += 2;
-			}
-			else
-			{
-				// If we get here, then it generated more triangles than there should even be in a displacement.
-				Assert( false );
-			}
-		}
-		else
-		{
-			AABBTree_BuildTreeTrisSweep_r( ray, Nodes_GetChild( iNode, 0 ), ppTreeTris, nTriCount );
-			AABBTree_BuildTreeTrisSweep_r( ray, Nodes_GetChild( iNode, 1 ), ppTreeTris, nTriCount );
-			AABBTree_BuildTreeTrisSweep_r( ray, Nodes_GetChild( iNode, 2 ), ppTreeTris, nTriCount );
-			AABBTree_BuildTreeTrisSweep_r( ray, Nodes_GetChild( iNode, 3 ), ppTreeTris, nTriCount );
-		}
-	}
-}
+	cplane_t plane;
 
-//-----------------------------------------------------------------------------
-// Purpose: 
-//-----------------------------------------------------------------------------
-void CDispCollTree::AABBTree_BuildTreeTrisIntersect_r( const Ray_t &ray, int iNode, CDispCollTri **ppTreeTris, unsigned short &nTriCount )
-{
-	bool bIntersect = false;
-	if ( ray.m_IsRay )
-	{
-		bIntersect = IsPointInBox( ray.m_Start, m_aNodes[iNode].m_vecBox[0], m_aNodes[iNode].m_vecBox[1] );
-	}
-	else
+	// Gather the leaves near the box (bloated a little so none of the leaves
+	// the exact test below accepts can be culled by rounding).
+	Vector vecMin, vecMax;
+	for ( int iAxis = 0; iAxis < 3; ++iAxis )
 	{
-		// Box.
-		Vector vecMin, vecMax;
-		VectorSubtract( m_aNodes[iNode].m_vecBox[0], ray.m_Extents, vecMin );
-		VectorAdd( m_aNodes[iNode].m_vecBox[1], ray.m_Extents, vecMax );
-		bIntersect = IsPointInBox( ray.m_Start, vecMin, vecMax );
+		vecMin[iAxis] = ray.m_Start[iAxis] - ray.m_Extents[iAxis] - DISPCOLL_DIST_EPSILON;
+		vecMax[iAxis] = ray.m_Start[iAxis] + ray.m_Extents[iAxis] + DISPCOLL_DIST_EPSILON;
 	}
 
-	if ( bIntersect )
+	unsigned short aLeafs[DISPCOLL_TREETRI_SIZE/2];
+	int nLeafCount = AABBTree_GatherLeafsBox( vecMin, vecMax, aLeafs );
+	for ( int iLeaf = 0; iLeaf < nLeafCount; ++iLeaf )
 	{
-		if ( m_aNodes[iNode].IsLeaf() )
-		{
-			if ( nTriCount < DISPCOLL_TREETRI_SIZE )
-			{
-				ppTreeTris[nTriCount] = &m_aTris[m_aNodes[iNode].m_iTris[0]];
-				ppTreeTris[nTriCount+1] = &m_aTris[m_aNodes[iNode].m_iTris[1]];
-				nTriCount += 2;
-			}
-		}
-		else
+		// Is the box center inside the leaf box bloated by the extents?
+		const CDispCollAABBNode &leaf = Nodes_GetLeaf( aLeafs[iLeaf] );
+		Vector vecBoxMin, vecBoxMax;
+		VectorSubtract( leaf.m_vecBox[0], ray.m_Extents, vecBoxMin );
+		VectorAdd( leaf.m_vecBox[1], ray.m_Extents, vecBoxMax );
+		if ( !IsPointInBox( ray.m_Start, vecBoxMin, vecBoxMax ) )
+			continue;
+
+		// Test the axial-aligned box against the leaf triangles.
+		for ( int iTri = 0; iTri < 2; ++iTri )
 		{
-			AABBTree_BuildTreeTrisIntersect_r( ray, Nodes_GetChild( iNode, 0 ), ppTreeTris, nTriCount );
-			AABBTree_BuildTreeTrisIntersect_r( ray, Nodes_GetChild( iNode, 1 ), ppTreeTris, nTriCount );
-			AABBTree_BuildTreeTrisIntersect_r( ray, Nodes_GetChild( iNode, 2 ), ppTreeTris, nTriCount );
-			AABBTree_BuildTreeTrisIntersect_r( ray, Nodes_GetChild( iNode, 3 ), ppTreeTris, nTriCount );
+			CDispCollTri *pTri = &m_aTris[leaf.m_iTris[iTri]];
+
+			VectorCopy( pTri->m_vecNormal, plane.normal );
+			plane.dist = pTri->m_flDist;
+			plane.signbits = pTri->m_ucSignBits;
+			plane.type = pTri->m_ucPlaneType;
+
+			if ( IsBoxIntersectingTriangle( ray.m_Start, ray.m_Extents,
+				                            m_aVerts[pTri->GetVert( 0 )],
+				                            m_aVerts[pTri->GetVert( 2 )],
+				                            m_aVerts[pTri->GetVert( 1 )],
+											plane, 0.0f ) )
+				return true;
 		}
 	}
-}
-
-//-----------------------------------------------------------------------------
-// Purpose: 
-//-----------------------------------------------------------------------------
-bool CDispCollTree::AABBTree_IntersectAABB( const Ray_t &ray )
-{
-	cplane_t plane;
-
-	// Build the triangle list.
-	unsigned short nTreeTriCount = 0;
-	CDispCollTri *aTreeTris[DISPCOLL_TREETRI_SIZE];
-	AABBTree_BuildTreeTrisIntersect_r( ray, DISPCOLL_ROOTNODE_INDEX, &aTreeTris[0], nTreeTriCount );
-	if ( nTreeTriCount == 0 )
-		return false;
-
-	// Test the axial-aligned box against the triangle list.
-	for ( int iTri = 0; iTri < nTreeTriCount; ++iTri )
-	{
-		CDispCollTri *pTri = aTreeTris[iTri];
-
-		VectorCopy( pTri->m_vecNormal, plane.normal );
-		plane.dist = pTri->m_flDist;
-		plane.signbits = pTri->m_ucSignBits;
-		plane.type = pTri->m_ucPlaneType;
-
-		if ( IsBoxIntersectingTriangle( ray.m_Start, ray.m_Extents,
-			                            m_aVerts[pTri->GetVert( 0 )],
-			                            m_aVerts[pTri->GetVert( 2 )],
-			                            m_aVerts[pTri->GetVert( 1 )],
-										plane, 0.0f ) )
-			return true;
-	}
 
 	// no collision
 	return false; 
 }
 
-#ifdef NEWRAYTEST
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -810,11 +818,18 @@ bool CDispCollTree::AABBTree_SweepAABB( const Ray_t &ray, CBaseTrace *pTrace )
 	}
 		
 	Vector vecBox[2];
-	VectorSubtract( m_aNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[0], ray.m_Extents, vecBox[0] );
-	VectorAdd( m_aNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[1], ray.m_Extents, vecBox[1] );
+	VectorSubtract( m_vecTreeBounds[0], ray.m_Extents, vecBox[0] );
+	VectorAdd( m_vecTreeBounds[1], ray.m_Extents, vecBox[1] );
 	if( IsBoxIntersectingRay( vecBox[0], vecBox[1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON ) )
 	{
-		AABBTree_TreeTrisSweepTest_r( ray, vecInvDelta, rayDir, DISPCOLL_ROOTNODE_INDEX, pTrace );
+		unsigned short aLeafs[DISPCOLL_TREETRI_SIZE/2];
+		int nLeafCount = AABBTree_GatherLeafsRay( ray, vecInvDelta, ray.m_Extents, aLeafs );
+		for ( int iLeaf = 0; iLeaf < nLeafCount; ++iLeaf )
+		{
+			const CDispCollAABBNode &leaf = Nodes_GetLeaf( aLeafs[iLeaf] );
+			SweepAABBTriIntersect( ray, rayDir, &m_aTris[leaf.m_iTris[0]], pTrace, false );
+			SweepAABBTriIntersect( ray, rayDir, &m_aTris[leaf.m_iTris[1]], pTrace, false );
+		}
 	}
 
 	// Collision.
@@ -825,51 +840,6 @@ bool CDispCollTree::AABBTree_SweepAABB( const Ray_t &ray, CBaseTrace *pTrace )
 	return false;
 }
 
-//-----------------------------------------------------------------------------
-// Purpose: 
-//-----------------------------------------------------------------------------
-void CDispCollTree::AABBTree_TreeTrisSweepTest_r( const Ray_t &ray, const Vector &vecInvDelta, const Vector &rayDir,
-												  int iNode, CBaseTrace *pTrace )
-{
-	if ( m_aNodes[iNode].IsLeaf() )
-	{
-		CDispCollTri *pTri0 = &m_aTris[m_aNodes[iNode].m_iTris[0]];
-		CDispCollTri *pTri1 = &m_aTris[m_aNodes[iNode].m_iTris[1]];
-
-		SweepAABBTriIntersect( ray, rayDir, pTri0, pTrace, false );
-		SweepAABBTriIntersect( ray, rayDir, pTri1, pTrace, false );
-	}
-	else
-	{
-		int iChildNode[4];
-		iChildNode[0] = Nodes_GetChild( iNode, 0 );
-		iChildNode[1] = Nodes_GetChild( iNode, 1 );
-		iChildNode[2] = Nodes_GetChild( iNode, 2 );
-		iChildNode[3] = Nodes_GetChild( iNode, 3 );
-
-		Vector vecBox[4][2];
-		VectorSubtract( m_aNodes[iChildNode[0]].m_vecBox[0], ray.m_Extents, vecBox[0][0] );
-		VectorAdd( m_aNodes[iChildNode[0]].m_vecBox[1], ray.m_Extents, vecBox[0][1] );
-		VectorSubtract( m_aNodes[iChildNode[1]].m_vecBox[0], ray.m_Extents, vecBox[1][0] );
-		VectorAdd( m_aNodes[iChildNode[1]].m_vecBox[1], ray.m_Extents, vecBox[1][1] );
-		VectorSubtract( m_aNodes[iChildNode[2]].m_vecBox[0], ray.m_Extents, vecBox[2][0] );
-		VectorAdd( m_aNodes[iChildNode[2]].m_vecBox[1], ray.m_Extents, vecBox[2][1] );
-		VectorSubtract( m_aNodes[iChildNode[3]].m_vecBox[0], ray.m_Extents, vecBox[3][0] );
-		VectorAdd( m_aNodes[iChildNode[3]].m_vecBox[1], ray.m_Extents, vecBox[3][1] );
-
-		bool bIntersectChild[4];
-		bIntersectChild[0] = IsBoxIntersectingRay( vecBox[0][0], vecBox[0][1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
-		bIntersectChild[1] = IsBoxIntersectingRay( vecBox[1][0], vecBox[1][1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
-		bIntersectChild[2] = IsBoxIntersectingRay( vecBox[2][0], vecBox[2][1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
-		bIntersectChild[3] = IsBoxIntersectingRay( vecBox[3][0], vecBox[3][1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
-
-		if ( bIntersectChild[0] ) { AABBTree_TreeTrisSweepTest_r( ray, vecInvDelta, rayDir, iChildNode[0], pTrace ); }
-		if ( bIntersectChild[1] ) { AABBTree_TreeTrisSweepTest_r( ray, vecInvDelta, rayDir, iChildNode[1], pTrace ); }
-		if ( bIntersectChild[2] ) { AABBTree_TreeTrisSweepTest_r( ray, vecInvDelta, rayDir, iChildNode[2], pTrace ); }
-		if ( bIntersectChild[3] ) { AABBTree_TreeTrisSweepTest_r( ray, vecInvDelta, rayDir, iChildNode[3], pTrace ); }
-	}
-}
-
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -896,9 +866,16 @@ bool CDispCollTree::AABBTree_SweepAABBBox( const Ray_t &ray, const Vector &rayDi
 		}
 	}
 
-	if ( IsBoxIntersectingBox( m_aNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[0], m_aNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[1], vecMin, vecMax ) )
+	if ( IsBoxIntersectingBox( m_vecTreeBounds[0], m_vecTreeBounds[1], vecMin, vecMax ) )
 	{
-		AABBTree_TreeTrisSweepTestBox_r( ray, rayDir, vecMin, vecMax, DISPCOLL_ROOTNODE_INDEX, pTrace );
+		unsigned short aLeafs[DISPCOLL_TREETRI_SIZE/2];
+		int nLeafCount = AABBTree_GatherLeafsBox( vecMin, vecMax, aLeafs );
+		for ( int iLeaf = 0; iLeaf < nLeafCount; ++iLeaf )
+		{
+			const CDispCollAABBNode &leaf = Nodes_GetLeaf( aLeafs[iLeaf] );
+			SweepAABBTriIntersect( ray, rayDir, &m_aTris[leaf.m_iTris[0]], pTrace, false );
+			SweepAABBTriIntersect( ray, rayDir, &m_aTris[leaf.m_iTris[1]], pTrace, false );
+		}
 	}
 
 	// Collision.
@@ -909,74 +886,6 @@ bool CDispCollTree::AABBTree_SweepAABBBox( const Ray_t &ray, const Vector &rayDi
 	return false;
 }
 
-void CDispCollTree::AABBTree_TreeTrisSweepTestBox_r( const Ray_t &ray, const Vector &rayDir, const Vector &vecMin, const Vector &vecMax,
-													 int iNode, CBaseTrace *pTrace )
-{
-	if ( m_aNodes[iNode].IsLeaf() )
-	{
-		CDispCollTri *pTri0 = &m_aTris[m_aNodes[iNode].m_iTris[0]];
-		CDispCollTri *pTri1 = &m_aTris[m_aNodes[iNode].m_iTris[1]];
-
-
-		SweepAABBTriIntersect( ray, rayDir, pTri0, pTrace, false );
-		SweepAABBTriIntersect( ray, rayDir, pTri1, pTrace, false );
-	}
-	else
-	{
-		int iChildNode[4];
-		iChildNode[0] = Nodes_GetChild( iNode, 0 );
-		iChildNode[1] = Nodes_GetChild( iNode, 1 );
-		iChildNode[2] = Nodes_GetChild( iNode, 2 );
-		iChildNode[3] = Nodes_GetChild( iNode, 3 );
-
-		bool bIntersectChild[4];
-		bIntersectChild[0] = IsBoxIntersectingBox( m_aNodes[iChildNode[0]].m_vecBox[0], m_aNodes[iChildNode[0]].m_vecBox[1], vecMin, vecMax );
-		bIntersectChild[1] = IsBoxIntersectingBox( m_aNodes[iChildNode[1]].m_vecBox[0], m_aNodes[iChildNode[1]].m_vecBox[1], vecMin, vecMax );
-		bIntersectChild[2] = IsBoxIntersectingBox( m_aNodes[iChildNode[2]].m_vecBox[0], m_aNodes[iChildNode[2]].m_vecBox[1], vecMin, vecMax );
-		bIntersectChild[3] = IsBoxIntersectingBox( m_aNodes[iChildNode[3]].m_vecBox[0], m_aNodes[iChildNode[3]].m_vecBox[1], vecMin, vecMax );
-
-		if ( bIntersectChild[0] ) { AABBTree_TreeTrisSweepTestBox_r( ray, rayDir, vecMin, vecMax, iChildNode[0], pTrace ); }
-		if ( bIntersectChild[1] ) { AABBTree_TreeTrisSweepTestBox_r( ray, rayDir, vecMin, vecMax, iChildNode[1], pTrace ); }
-		if ( bIntersectChild[2] ) { AABBTree_TreeTrisSweepTestBox_r( ray, rayDir, vecMin, vecMax, iChildNode[2], pTrace ); }
-		if ( bIntersectChild[3] ) { AABBTree_TreeTrisSweepTestBox_r( ray, rayDir, vecMin, vecMax, iChildNode[3], pTrace ); }
-	}
-}
-#else
-//-----------------------------------------------------------------------------
-// Purpose: 
-//-----------------------------------------------------------------------------
-bool CDispCollTree::AABBTree_SweepAABB( const Ray_t &ray, CBaseTrace *pTrace )
-{
-//	VPROF_BUDGET( "DispHullTraces", VPROF_BUDGETGROUP_DISP_HULLTRACES );
-
-	// Build the triangle list.
-	unsigned short nTreeTriCount = 0;
-	CDispCollTri *aTreeTris[DISPCOLL_TREETRI_SIZE];
-	AABBTree_BuildTreeTrisSweep_r( ray, DISPCOLL_ROOTNODE_INDEX, &aTreeTris[0], nTreeTriCount );
-	if ( !nTreeTriCount )
-		return false;
-
-	// Save min fraction.
-	float flMinFrac = pTrace->fraction;
-
-	// Test ray against the triangles in the list.
-	Vector rayDir = ray.m_Delta;
-	VectorNormalize( rayDir );
-
-	for ( int iTri = 0; iTri < nTreeTriCount; ++iTri )
-	{
-		CDispCollTri *pTri = aTreeTris[iTri];
-		SweepAABBTriIntersect( ray, rayDir, pTri, pTrace, false );
-	}
-
-	// Collision.
-	if ( pTrace->fraction < flMinFrac )
-		return true;
-
-	// No collision.
-	return false;
-}
-#endif
 
 //-----------------------------------------------------------------------------
 // Purpose: 
@@ -1494,6 +1403,11 @@ CDispCollTree::CDispCollTree()
 	m_vecBounds[0].Init( FLT_MAX, FLT_MAX, FLT_MAX );
 	m_vecBounds[1].Init( -FLT_MAX, -FLT_MAX, -FLT_MAX );
 
+	m_vecTreeBounds[0].Init();
+	m_vecTreeBounds[1].Init();
+	m_vecQuantOrigin.Init();
+	m_vecQuantScale.Init();
+
 	for ( int iCount = 0; iCount < MAX_CHECK_COUNT_DEPTH; ++iCount )
 	{
 		m_nCheckCount[iCount] = 0;
@@ -1501,7 +1415,8 @@ CDispCollTree::CDispCollTree()
 
 	m_aVerts.Purge();
 	m_aTris.Purge();
-	m_aNodes.Purge();
+	m_aLeafs.Purge();
+	m_aNodes4.Purge();
 	m_aEdgePlanes.Purge();
 }
 
@@ -1512,7 +1427,8 @@ CDispCollTree::~CDispCollTree()
 {
 	m_aVerts.Purge();
 	m_aTris.Purge();
-	m_aNodes.Purge();
+	m_aLeafs.Purge();
+	m_aNodes4.Purge();
 	m_aEdgePlanes.Purge();
 }
 
@@ -1565,8 +1481,13 @@ void CDispCollTree::ApplyTerrainMod( ITerrainMod *pMod )
 	// Setup/create the leaf nodes first so the recusion can use this data to stop.
 	AABBTree_CreateLeafs();
 
-	// Generate bounding boxes.
-	AABBTree_GenerateBoxes();
+	// Generate bounding boxes. The exact boxes of the internal nodes are only
+	// needed to build the quantized 4-wide nodes, so they aren't kept.
+	CUtlVector<CDispCollAABBNode> aNodes;
+	AABBTree_GenerateBoxes( aNodes );
+
+	// Generate the quantized 4-wide nodes used for traversal.
+	AABBTree_GenerateNodes4( aNodes );
 
 	// Create the bounding box of the displacement surface + the base face.
 	AABBTree_CalcBounds();
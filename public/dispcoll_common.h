@@ -19,6 +19,8 @@
 #define DISPCOLL_INVALID_TRI		-1
 #define DISPCOLL_INVALID_FRAC		-99999.9f
 #define DISPCOLL_NORMAL_UNDEF		0xffff
+#define DISPCOLL_NODESTACK_SIZE		16
+#define DISPCOLL_QUANT_STEPS		65280.0f	// Leaves some slack below 65535 so the tree max is always representable.
 
 extern double g_flDispCollSweepTimer;
 extern double g_flDispCollIntersectTimer;
@@ -103,6 +105,21 @@ public:
 	void GenerateBox( CUtlVector <CDispCollTri> &m_aTris, CUtlVector<Vector> &m_aVerts );
 };
 
+//=============================================================================
+//	4-wide AABB Node
+//
+//	The bounds of the four children of an internal node, stored as structure-
+//	of-arrays so all four can be tested against a ray at once. The bounds are
+//	quantized to 16-bits over the tree bounds and rounded outwards, so they
+//	always contain the exact child boxes.
+class CDispCollAABBNode4
+{
+public:
+
+	unsigned short	m_nMins[3][4];			// [axis][child]
+	unsigned short	m_nMaxs[3][4];			// [axis][child]
+};
+
 //=============================================================================
 //	Helper
 class CDispCollHelper
@@ -189,26 +206,21 @@ public:
 	inline int Nodes_GetParent( int iNode );
 	inline int Nodes_GetLevel( int iNode );
 	inline int Nodes_GetIndexFromComponents( int x, int y );
+	inline const CDispCollAABBNode &Nodes_GetLeaf( int iNode );
 
 protected:
 
 	bool AABBTree_Create( CCoreDispInfo *pDisp );
 	void AABBTree_CopyDispData( CCoreDispInfo *pDisp );
 	void AABBTree_CreateLeafs( void );
-	void AABBTree_GenerateBoxes( void );
+	void AABBTree_GenerateBoxes( CUtlVector<CDispCollAABBNode> &aNodes );
+	void AABBTree_GenerateNodes4( const CUtlVector<CDispCollAABBNode> &aNodes );
 	void AABBTree_CalcBounds( void );
 
-	void AABBTree_BuildTreeTrisSweep_r( const Ray_t &ray, int iNode, CDispCollTri **ppTreeTris, unsigned short &nTriCount );
-	void AABBTree_BuildTreeTrisIntersect_r( const Ray_t &ray, int iNode, CDispCollTri **ppTreeTris, unsigned short &nTriCount );
-
-	void AABBTree_TreeTrisRayTest_r( const Ray_t &ray, const Vector &vecInvDelta, int iNode, CBaseTrace *pTrace, bool bSide, CDispCollTri **pImpactTri );
-	void AABBTree_TreeTrisRayBarycentricTest_r( const Ray_t &ray, const Vector &vecInvDelta, int iNode, RayDispOutput_t &output, CDispCollTri **pImpactTri );
-	void AABBTree_TreeTrisSweepTest_r( const Ray_t &ray, const Vector &vecInvDelta, const Vector &rayDir, int iNode, CBaseTrace *pTrace );
+	int AABBTree_GatherLeafsRay( const Ray_t &ray, const Vector &vecInvDelta, const Vector &vecExtents, unsigned short *pLeafs );
+	int AABBTree_GatherLeafsBox( const Vector &vecMin, const Vector &vecMax, unsigned short *pLeafs );
 
 	bool AABBTree_SweepAABBBox( const Ray_t &ray, const Vector &rayDir, CBaseTrace *pTrace );
-	void AABBTree_TreeTrisSweepTestBox_r( const Ray_t &ray, const Vector &rayDir, const Vector &vecMin, const Vector &vecMax, int iNode, CBaseTrace *pTrace );
-
-	void AABBTree_TreeTrisIntersectBox_r( const Ray_t &ray, const Vector &vecMin, const Vector &vecMax, int iNode, bool bIntersect );
 
 protected:
 
@@ -230,6 +242,12 @@ protected:
 
 	inline bool ResolveRayPlaneIntersect( float flStart, float flEnd, const Vector &vecNormal, float flDist );
 
+	// 4-wide nodes.
+	inline int Nodes4_CalcCount( int nPower );
+	inline float Nodes4_Dequantize( int iAxis, unsigned short nValue );
+	int Nodes4_IntersectRay( int iNode, const Vector &vecStart, const Vector &vecDelta, const Vector &vecExtents, float flTolerance );
+	int Nodes4_IntersectBox( int iNode, const Vector &vecMin, const Vector &vecMax );
+
 	// Utility
 	inline void CalcClosestBoxPoint( const Vector &vecPlaneNormal, const Vector &vecBoxStart, const Vector &vecBoxExtents, Vector &vecBoxPoint );
 	inline void CalcClosestExtents( const Vector &vecPlaneNormal, const Vector &vecBoxExtents, Vector &vecBoxPoint );
@@ -255,7 +273,11 @@ protected:
 
 	CUtlVector<Vector>				m_aVerts;								// Displacement verts.
 	CUtlVector<CDispCollTri>		m_aTris;								// Displacement triangles.
-	CUtlVector<CDispCollAABBNode>	m_aNodes;								// Nodes.
+	CUtlVector<CDispCollAABBNode>	m_aLeafs;								// Leaf nodes (the last level of the tree) with exact boxes.
+	CUtlVector<CDispCollAABBNode4>	m_aNodes4;								// Quantized child bounds of the internal nodes (traversal).
+	Vector							m_vecTreeBounds[2];						// Exact bounds of the root node
+	Vector							m_vecQuantOrigin;						// Quantized bounds: value = origin + q * scale
+	Vector							m_vecQuantScale;
 	
 	// Cache
 	CUtlVector<CDispCollTriCache>	m_aTrisCache;
@@ -278,7 +300,7 @@ inline int CDispCollTree::Nodes_GetChild( int iNode, int nDirection )
 {
 	// node range [0...m_NodeCount)
 	Assert( iNode >= 0 );
-	Assert( iNode < m_aNodes.Count() );
+	Assert( iNode < Nodes_CalcCount( m_nPower ) );
 
     // ( node index * 4 ) + ( direction + 1 )
     return ( ( iNode << 2 ) + ( nDirection + 1 ) );	
@@ -304,7 +326,7 @@ inline int CDispCollTree::Nodes_GetParent( int iNode )
 {
 	// node range [0...m_NodeCount)
 	Assert( iNode >= 0 );
-	Assert( iNode < m_aNodes.Count() );
+	Assert( iNode < Nodes_CalcCount( m_nPower ) );
 
 	// ( node index - 1 ) / 4
 	return ( ( iNode - 1 ) >> 2 );
@@ -318,7 +340,7 @@ inline int CDispCollTree::Nodes_GetLevel( int iNode )
 {
 	// node range [0...m_NodeCount)
 	Assert( iNode >= 0 );
-	Assert( iNode < m_aNodes.Count() );
+	Assert( iNode < Nodes_CalcCount( m_nPower ) );
 
 	// level = 2^n + 1
 	if ( iNode == 0 )  { return 1; }
@@ -330,6 +352,26 @@ inline int CDispCollTree::Nodes_GetLevel( int iNode )
 	return -1;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: the internal nodes are stored first (breadth first), so they are
+//          also the indices of the 4-wide nodes
+//-----------------------------------------------------------------------------
+inline int CDispCollTree::Nodes4_CalcCount( int nPower )
+{
+	Assert( nPower >= 1 );
+	Assert( nPower <= 4 );
+
+	return ( ( ( 1 << ( nPower << 1 ) ) - 1 ) / 3 );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+inline float CDispCollTree::Nodes4_Dequantize( int iAxis, unsigned short nValue )
+{
+	return ( m_vecQuantOrigin[iAxis] + ( float )nValue * m_vecQuantScale[iAxis] );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
@@ -352,6 +394,16 @@ inline int CDispCollTree::Nodes_GetIndexFromComponents( int x, int y )
 	return nIndex;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: the leaves are the last level of the tree, stored after the
+//          internal nodes
+//-----------------------------------------------------------------------------
+inline const CDispCollAABBNode &CDispCollTree::Nodes_GetLeaf( int iNode )
+{
+	Assert( iNode >= m_aNodes4.Count() );
+	return m_aLeafs[iNode - m_aNodes4.Count()];
+}
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
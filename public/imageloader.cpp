@@ -14,7 +14,15 @@
 #include "tier0/dbg.h"
 #include <malloc.h>
 #include <memory.h>
+
+// The S3TC library is Win32 only, everywhere else DXT is encoded in here
+#if !defined( _WIN32 ) && !defined( IMAGE_LOADER_NO_DXTC )
+#define IMAGE_LOADER_NO_DXTC
+#endif
+
+#ifndef IMAGE_LOADER_NO_DXTC
 #include "nvtc.h"
+#endif
 #include "mathlib.h"
 #include "vector.h"
 #include "utlmemory.h"
@@ -310,6 +318,7 @@ ImageFormatInfo_t const& ImageFormatInfo( ImageFormat fmt )
 	return g_ImageFormatInfo[fmt];
 }
 
+#ifndef IMAGE_LOADER_NO_DXTC
 static DWORD GetDXTCEncodeType( ImageFormat imageFormat )
 {
 	switch( imageFormat )
@@ -326,6 +335,7 @@ static DWORD GetDXTCEncodeType( ImageFormat imageFormat )
 		return 0;
 	}
 }
+#endif
 
 int GetMemRequired( int width, int height, ImageFormat imageFormat, bool mipmap )
 {
@@ -701,49 +711,20 @@ static inline void DecodeColorBlock( CDestPixel *pOutputImage, DXTColBlock *pCol
 					                 DXTColorBGRA8888 *col_2, DXTColorBGRA8888 *col_3 )
 {
 	// width is width of image in pixels
-	DWORD bits;
+	const DXTColorBGRA8888 *pPalette[4] = { col_0, col_1, col_2, col_3 };
 	int r,n;
 
-	// bit masks = 00000011, 00001100, 00110000, 11000000
-	const DWORD masks[] = { 3, 12, 3 << 4, 3 << 6 };
-	const int   shift[] = { 0, 2, 4, 6 };
-
 	// r steps through lines in y
 	for( r=0; r < 4; r++, pOutputImage += width-4 )	// no width*4 as DWORD ptr inc will *4
 	{
-
-		// width * 4 bytes per pixel per line
-		// each j dxtc row is 4 lines of pixels
+		// 2 bits per pixel, first pixel in the low bits
+		BYTE bits = pColorBlock->row[r];
 
 		// n steps through pixels
-		for( n=0; n < 4; n++ )
+		for( n=0; n < 4; n++, bits >>= 2 )
 		{
-			bits =		pColorBlock->row[r] & masks[n];
-			bits >>=	shift[n];
-
-			switch( bits )
-			{
-			case 0 :
-				pOutputImage->FromBGRA8888( *col_0 );
-				pOutputImage++;		// increment to next output pixel
-				break;
-			case 1 :
-				pOutputImage->FromBGRA8888( *col_1 );
-				pOutputImage++;
-				break;
-			case 2 :
-				pOutputImage->FromBGRA8888( *col_2 );
-				pOutputImage++;
-				break;
-			case 3 :
-				pOutputImage->FromBGRA8888( *col_3 );
-				pOutputImage++;
-				break;
-			default:
-				Assert( 0 );
-				pOutputImage++;
-				break;
-			}
+			pOutputImage->FromBGRA8888( *pPalette[ bits & 3 ] );
+			pOutputImage++;		// increment to next output pixel
 		}
 	}
 }
@@ -752,107 +733,76 @@ template <class CDestPixel>
 static inline void DecodeAlpha3BitLinear( CDestPixel *pImPos, DXTAlphaBlock3BitLinear *pAlphaBlock,
 									      int width )
 {
-	static BYTE		gBits[4][4];
-	static WORD		gAlphas[8];
-	static DXTColorBGRA8888	gACol[4][4];
+	WORD alphas[8];
 
-	gAlphas[0] = pAlphaBlock->alpha0;
-	gAlphas[1] = pAlphaBlock->alpha1;
+	alphas[0] = pAlphaBlock->alpha0;
+	alphas[1] = pAlphaBlock->alpha1;
 
 	
 	// 8-alpha or 6-alpha block?    
 
-	if( gAlphas[0] > gAlphas[1] )
+	if( alphas[0] > alphas[1] )
 	{
 		// 8-alpha block:  derive the other 6 alphas.    
 		// 000 = alpha_0, 001 = alpha_1, others are interpolated
 
-		gAlphas[2] = ( 6 * gAlphas[0] +     gAlphas[1]) / 7;	// bit code 010
-		gAlphas[3] = ( 5 * gAlphas[0] + 2 * gAlphas[1]) / 7;	// Bit code 011    
-		gAlphas[4] = ( 4 * gAlphas[0] + 3 * gAlphas[1]) / 7;	// Bit code 100    
-		gAlphas[5] = ( 3 * gAlphas[0] + 4 * gAlphas[1]) / 7;	// Bit code 101
-		gAlphas[6] = ( 2 * gAlphas[0] + 5 * gAlphas[1]) / 7;	// Bit code 110    
-		gAlphas[7] = (     gAlphas[0] + 6 * gAlphas[1]) / 7;	// Bit code 111
+		alphas[2] = ( 6 * alphas[0] +     alphas[1]) / 7;	// bit code 010
+		alphas[3] = ( 5 * alphas[0] + 2 * alphas[1]) / 7;	// Bit code 011    
+		alphas[4] = ( 4 * alphas[0] + 3 * alphas[1]) / 7;	// Bit code 100    
+		alphas[5] = ( 3 * alphas[0] + 4 * alphas[1]) / 7;	// Bit code 101
+		alphas[6] = ( 2 * alphas[0] + 5 * alphas[1]) / 7;	// Bit code 110    
+		alphas[7] = (     alphas[0] + 6 * alphas[1]) / 7;	// Bit code 111
 	}    
 	else
 	{
 		// 6-alpha block:  derive the other alphas.    
 		// 000 = alpha_0, 001 = alpha_1, others are interpolated
 
-		gAlphas[2] = (4 * gAlphas[0] +     gAlphas[1]) / 5;	// Bit code 010
-		gAlphas[3] = (3 * gAlphas[0] + 2 * gAlphas[1]) / 5;	// Bit code 011    
-		gAlphas[4] = (2 * gAlphas[0] + 3 * gAlphas[1]) / 5;	// Bit code 100    
-		gAlphas[5] = (    gAlphas[0] + 4 * gAlphas[1]) / 5;	// Bit code 101
-		gAlphas[6] = 0;										// Bit code 110
-		gAlphas[7] = 255;									// Bit code 111
-	}
-
-
-	// Decode 3-bit fields into array of 16 BYTES with same value
-
-	// first two rows of 4 pixels each:
-	// pRows = (Alpha3BitRows*) & ( pAlphaBlock->stuff[0] );
-	const DWORD mask = 0x00000007;		// bits = 00 00 01 11
-
-	DWORD bits = *( (DWORD*) & ( pAlphaBlock->stuff[0] ));
-
-	gBits[0][0] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[0][1] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[0][2] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[0][3] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[1][0] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[1][1] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[1][2] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[1][3] = (BYTE)( bits & mask );
-
-	// now for last two rows:
-
-	bits = *( (DWORD*) & ( pAlphaBlock->stuff[3] ));		// last 3 bytes
-
-	gBits[2][0] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[2][1] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[2][2] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[2][3] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[3][0] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[3][1] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[3][2] = (BYTE)( bits & mask );
-	bits >>= 3;
-	gBits[3][3] = (BYTE)( bits & mask );
-
-	// decode the codes into alpha values
-	int row, pix;
-	for( row = 0; row < 4; row++ )
+		alphas[2] = (4 * alphas[0] +     alphas[1]) / 5;	// Bit code 010
+		alphas[3] = (3 * alphas[0] + 2 * alphas[1]) / 5;	// Bit code 011    
+		alphas[4] = (2 * alphas[0] + 3 * alphas[1]) / 5;	// Bit code 100    
+		alphas[5] = (    alphas[0] + 4 * alphas[1]) / 5;	// Bit code 101
+		alphas[6] = 0;										// Bit code 110
+		alphas[7] = 255;									// Bit code 111
+	}
+
+	DXTColorBGRA8888 col;
+	col.r = col.g = col.b = 0;
+
+	// Each group of 3 bytes holds the 3-bit codes for two rows of 4 pixels
+	int half, row, pix;
+	for( half = 0; half < 2; half++ )
 	{
-		for( pix=0; pix < 4; pix++ )
-		{
-			gACol[row][pix].a = (BYTE) gAlphas[ gBits[row][pix] ];
+		const BYTE *pCodes = &pAlphaBlock->stuff[ half * 3 ];
+		DWORD bits = pCodes[0] | ( pCodes[1] << 8 ) | ( pCodes[2] << 16 );
 
-			Assert( gACol[row][pix].r == 0 );
-			Assert( gACol[row][pix].g == 0 );
-			Assert( gACol[row][pix].b == 0 );
+		for( row = 0; row < 2; row++, pImPos += width-4 )
+		{
+			for( pix = 0; pix < 4; pix++, bits >>= 3 )
+			{
+				col.a = (BYTE)alphas[ bits & 7 ];
+				pImPos->AlphaFromBGRA8888( col );
+				pImPos++;
+			}
 		}
 	}
+}
+
+template <class CDestPixel> 
+static inline void DecodeAlphaExplicit( CDestPixel *pImPos, const BYTE *pAlphaBlock, int width )
+{
+	DXTColorBGRA8888 col;
+	col.r = col.g = col.b = 0;
 
-	// Write out alpha values to the image bits
-	for( row=0; row < 4; row++, pImPos += width-4 )
+	// 4 bits per pixel, a row per 16 bits, first pixel in the low bits
+	int row, pix;
+	for( row = 0; row < 4; row++, pImPos += width-4 )
 	{
-		for( pix = 0; pix < 4; pix++ )
+		WORD bits = pAlphaBlock[ row * 2 ] | ( pAlphaBlock[ row * 2 + 1 ] << 8 );
+		for( pix = 0; pix < 4; pix++, bits >>= 4 )
 		{
-			// zero the alpha bits of image pixel
-			pImPos->AlphaFromBGRA8888( *(( DXTColorBGRA8888 *) &(gACol[row][pix])) );
+			col.a = (BYTE)( ( bits & 0xf ) * 17 );
+			pImPos->AlphaFromBGRA8888( col );
 			pImPos++;
 		}
 	}
@@ -1007,6 +957,79 @@ static void ConvertFromDXT5( unsigned char *src, CDestPixel *dst, int width, int
 	}
 }
 
+template <class CDestPixel> 
+static void ConvertFromDXT3( unsigned char *src, CDestPixel *dst, int width, int height )
+{
+	int realWidth = 0;
+	int realHeight = 0;
+	CDestPixel *realDst = NULL;
+	// Deal with the case where we have a dimension smaller than 4.
+	if( width < 4 || height < 4 )
+	{
+		realWidth = width;
+		realHeight = height;
+		// round up to the nearest four
+		width = ( width + 3 ) & ~3;
+		height = ( height + 3 ) & ~3;
+		realDst = dst;
+		dst = ( CDestPixel * )_alloca( width * height * sizeof( CDestPixel ) );
+		Assert( dst );
+	}
+	Assert( !( width % 4 ) );
+	Assert( !( height % 4 ) );
+
+	int xblocks, yblocks;
+	xblocks = width >> 2;
+	yblocks = height >> 2;
+	
+	CDestPixel *pDstScan = dst;
+	DWORD *pSrcScan = ( DWORD * )src;
+
+	DXTColBlock				*pBlock;
+	BYTE					*pAlphaBlock;
+
+	DXTColorBGRA8888 col_0, col_1, col_2, col_3;
+	WORD wrd;
+
+	int i,j;
+	for( j=0; j < yblocks; j++ )
+	{
+		// 8 bytes per block
+		// 1 block for explicit alpha, 1 block for color
+
+		pBlock = (DXTColBlock*) ( (unsigned char *)pSrcScan + j * xblocks * 16 );
+
+		for( i=0; i < xblocks; i++, pBlock ++ )
+		{
+			pAlphaBlock = (BYTE*) pBlock;
+			pBlock++;
+
+			GetColorBlockColorsBGRA8888( pBlock, &col_0, &col_1, &col_2, &col_3, wrd );
+
+			pDstScan = dst + i*4 + j*4*width;
+
+			DecodeColorBlock<CDestPixel>( pDstScan, pBlock, width, &col_0, &col_1,
+								          &col_2, &col_3 );
+
+			// Overwrite the previous alpha bits with the alpha block
+			DecodeAlphaExplicit( pDstScan, pAlphaBlock, width );
+		}
+	}
+	// Deal with the case where we have a dimension smaller than 4.
+	if( realDst )
+	{
+		int x, y;
+		for( y = 0; y < realHeight; y++ )
+		{
+			for( x = 0; x < realWidth; x++ )
+			{
+				realDst[x+(y*realWidth)] = dst[x+(y*width)];
+			}
+		}
+	}
+}
+
+// Also used for DXT3, the color blocks are laid out the same way
 template <class CDestPixel> 
 static void ConvertFromDXT5IgnoreAlpha( unsigned char *src, CDestPixel *dst, int width, int height )
 {
@@ -1078,6 +1101,477 @@ static void ConvertFromDXT5IgnoreAlpha( unsigned char *src, CDestPixel *dst, int
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Built-in DXT encoder
+//-----------------------------------------------------------------------------
+
+static DXTEncodeQuality_t s_DXTEncodeQuality = DXT_ENCODE_NORMAL;
+
+void SetDXTEncodeQuality( DXTEncodeQuality_t quality )
+{
+	s_DXTEncodeQuality = quality;
+}
+
+DXTEncodeQuality_t GetDXTEncodeQuality()
+{
+	return s_DXTEncodeQuality;
+}
+
+// Same channel weights the S3TC library gets handed
+static const float s_DXTColorWeight[3] = { 0.3086f, 0.6094f, 0.0820f };
+
+struct DXTEncodeBlock_t
+{
+	unsigned char m_Pixels[16][4];	// RGBA, row major
+};
+
+static void LoadDXTEncodeBlock( unsigned char *src, ImageFormat srcImageFormat, int width, int height,
+							    int x0, int y0, DXTEncodeBlock_t &block )
+{
+	int pixelSize = SizeInBytes( srcImageFormat );
+	int x, y;
+	for( y = 0; y < 4; y++ )
+	{
+		// Replicate the last row/column into blocks that hang off the edge
+		int sy = ( y0 + y < height ) ? y0 + y : height - 1;
+		for( x = 0; x < 4; x++ )
+		{
+			int sx = ( x0 + x < width ) ? x0 + x : width - 1;
+			unsigned char *pSrc = src + ( sy * width + sx ) * pixelSize;
+			unsigned char *pDst = block.m_Pixels[ y * 4 + x ];
+			switch( srcImageFormat )
+			{
+			case IMAGE_FORMAT_RGBA8888:
+				pDst[0] = pSrc[0]; pDst[1] = pSrc[1]; pDst[2] = pSrc[2]; pDst[3] = pSrc[3];
+				break;
+			case IMAGE_FORMAT_RGB888:
+				pDst[0] = pSrc[0]; pDst[1] = pSrc[1]; pDst[2] = pSrc[2]; pDst[3] = 255;
+				break;
+			case IMAGE_FORMAT_BGRA8888:
+				pDst[0] = pSrc[2]; pDst[1] = pSrc[1]; pDst[2] = pSrc[0]; pDst[3] = pSrc[3];
+				break;
+			case IMAGE_FORMAT_BGRX8888:
+				pDst[0] = pSrc[2]; pDst[1] = pSrc[1]; pDst[2] = pSrc[0]; pDst[3] = 255;
+				break;
+			default:
+				Assert( 0 );
+				break;
+			}
+		}
+	}
+}
+
+static inline int DXTQuantize( float flValue, int nMax )
+{
+	int q = (int)( flValue * nMax / 255.0f + 0.5f );
+	return ( q < 0 ) ? 0 : ( ( q > nMax ) ? nMax : q );
+}
+
+static inline WORD DXTPack565( const float *pColor )
+{
+	return (WORD)( ( DXTQuantize( pColor[0], 31 ) << 11 ) | ( DXTQuantize( pColor[1], 63 ) << 5 ) | DXTQuantize( pColor[2], 31 ) );
+}
+
+// Expands a 565 color to 888 the way the hardware does
+static inline void DXTUnpack565( WORD color, int *pColor )
+{
+	int r = ( color >> 11 ) & 31;
+	int g = ( color >> 5 ) & 63;
+	int b = color & 31;
+	pColor[0] = ( r << 3 ) | ( r >> 2 );
+	pColor[1] = ( g << 2 ) | ( g >> 4 );
+	pColor[2] = ( b << 3 ) | ( b >> 2 );
+}
+
+//-----------------------------------------------------------------------------
+// Picks the closest of the four palette entries for each pixel. The
+// endpoints are put in col0 > col1 order so the block decodes as four-color.
+//-----------------------------------------------------------------------------
+static float FitDXTColorIndices( const DXTEncodeBlock_t &block, WORD &col0, WORD &col1, BYTE *pIndices )
+{
+	if( col0 < col1 )
+	{
+		WORD tmp = col0;
+		col0 = col1;
+		col1 = tmp;
+	}
+
+	int palette[4][3];
+	DXTUnpack565( col0, palette[0] );
+	DXTUnpack565( col1, palette[1] );
+
+	int c;
+	for( c = 0; c < 3; c++ )
+	{
+		palette[2][c] = ( 2 * palette[0][c] + palette[1][c] ) / 3;
+		palette[3][c] = ( palette[0][c] + 2 * palette[1][c] ) / 3;
+	}
+
+	// Equal endpoints decode as a three-color block; index 0 is still col0
+	int nColors = ( col0 == col1 ) ? 1 : 4;
+
+	float flTotalError = 0.0f;
+	int i, j;
+	for( i = 0; i < 16; i++ )
+	{
+		const unsigned char *pPixel = block.m_Pixels[i];
+		float flBestError = FLT_MAX;
+		int nBest = 0;
+		for( j = 0; j < nColors; j++ )
+		{
+			float flError = 0.0f;
+			for( c = 0; c < 3; c++ )
+			{
+				float d = (float)( pPixel[c] - palette[j][c] );
+				flError += s_DXTColorWeight[c] * d * d;
+			}
+			if( flError < flBestError )
+			{
+				flBestError = flError;
+				nBest = j;
+			}
+		}
+		pIndices[i] = (BYTE)nBest;
+		flTotalError += flBestError;
+	}
+	return flTotalError;
+}
+
+//-----------------------------------------------------------------------------
+// Initial endpoints: either the inset bounding box, or the extremes of the
+// block along its principal axis
+//-----------------------------------------------------------------------------
+static void ComputeDXTColorEndpoints( const DXTEncodeBlock_t &block, DXTEncodeQuality_t quality, 
+									  float *pColor0, float *pColor1 )
+{
+	int i, c;
+	float flMin[3] = { 255.0f, 255.0f, 255.0f };
+	float flMax[3] = { 0.0f, 0.0f, 0.0f };
+	float flMean[3] = { 0.0f, 0.0f, 0.0f };
+	for( i = 0; i < 16; i++ )
+	{
+		for( c = 0; c < 3; c++ )
+		{
+			float v = block.m_Pixels[i][c];
+			flMin[c] = ( v < flMin[c] ) ? v : flMin[c];
+			flMax[c] = ( v > flMax[c] ) ? v : flMax[c];
+			flMean[c] += v;
+		}
+	}
+
+	if( quality == DXT_ENCODE_FAST )
+	{
+		for( c = 0; c < 3; c++ )
+		{
+			float flInset = ( flMax[c] - flMin[c] ) / 16.0f;
+			pColor0[c] = flMax[c] - flInset;
+			pColor1[c] = flMin[c] + flInset;
+		}
+		return;
+	}
+
+	float flCov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for( c = 0; c < 3; c++ )
+	{
+		flMean[c] /= 16.0f;
+	}
+	for( i = 0; i < 16; i++ )
+	{
+		float r = block.m_Pixels[i][0] - flMean[0];
+		float g = block.m_Pixels[i][1] - flMean[1];
+		float b = block.m_Pixels[i][2] - flMean[2];
+		flCov[0] += r * r;
+		flCov[1] += r * g;
+		flCov[2] += r * b;
+		flCov[3] += g * g;
+		flCov[4] += g * b;
+		flCov[5] += b * b;
+	}
+
+	// Power iteration, starting from the bounding box diagonal
+	float vAxis[3] = { flMax[0] - flMin[0], flMax[1] - flMin[1], flMax[2] - flMin[2] };
+	for( i = 0; i < 8; i++ )
+	{
+		float x = vAxis[0] * flCov[0] + vAxis[1] * flCov[1] + vAxis[2] * flCov[2];
+		float y = vAxis[0] * flCov[1] + vAxis[1] * flCov[3] + vAxis[2] * flCov[4];
+		float z = vAxis[0] * flCov[2] + vAxis[1] * flCov[4] + vAxis[2] * flCov[5];
+		float flLength = x * x + y * y + z * z;
+		if( flLength < 1e-6f )
+			break;
+		flLength = 1.0f / sqrt( flLength );
+		vAxis[0] = x * flLength;
+		vAxis[1] = y * flLength;
+		vAxis[2] = z * flLength;
+	}
+
+	float flMinDot = FLT_MAX;
+	float flMaxDot = -FLT_MAX;
+	int iMin = 0, iMax = 0;
+	for( i = 0; i < 16; i++ )
+	{
+		float flDot = block.m_Pixels[i][0] * vAxis[0] + block.m_Pixels[i][1] * vAxis[1] + block.m_Pixels[i][2] * vAxis[2];
+		if( flDot < flMinDot )
+		{
+			flMinDot = flDot;
+			iMin = i;
+		}
+		if( flDot > flMaxDot )
+		{
+			flMaxDot = flDot;
+			iMax = i;
+		}
+	}
+
+	for( c = 0; c < 3; c++ )
+	{
+		pColor0[c] = block.m_Pixels[iMax][c];
+		pColor1[c] = block.m_Pixels[iMin][c];
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Solves for the endpoints that best reproduce the block given its indices
+//-----------------------------------------------------------------------------
+static bool RefineDXTColorEndpoints( const DXTEncodeBlock_t &block, const BYTE *pIndices, 
+									 float *pColor0, float *pColor1 )
+{
+	// weight of col0 for each index
+	static const float s_flWeight0[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+	float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+	float ax[3] = { 0.0f, 0.0f, 0.0f };
+	float bx[3] = { 0.0f, 0.0f, 0.0f };
+
+	int i, c;
+	for( i = 0; i < 16; i++ )
+	{
+		float a = s_flWeight0[ pIndices[i] ];
+		float b = 1.0f - a;
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for( c = 0; c < 3; c++ )
+		{
+			ax[c] += a * block.m_Pixels[i][c];
+			bx[c] += b * block.m_Pixels[i][c];
+		}
+	}
+
+	float flDet = aa * bb - ab * ab;
+	if( fabs( flDet ) < 1e-6f )
+		return false;
+
+	flDet = 1.0f / flDet;
+	for( c = 0; c < 3; c++ )
+	{
+		pColor0[c] = ( ax[c] * bb - bx[c] * ab ) * flDet;
+		pColor1[c] = ( bx[c] * aa - ax[c] * ab ) * flDet;
+	}
+	return true;
+}
+
+static void EncodeDXTColorBlock( const DXTEncodeBlock_t &block, DXTEncodeQuality_t quality, DXTColBlock *pOut )
+{
+	float flColor0[3], flColor1[3];
+	ComputeDXTColorEndpoints( block, quality, flColor0, flColor1 );
+
+	WORD col0 = DXTPack565( flColor0 );
+	WORD col1 = DXTPack565( flColor1 );
+	BYTE indices[16];
+	float flError = FitDXTColorIndices( block, col0, col1, indices );
+
+	int nRefinements = ( quality == DXT_ENCODE_FAST ) ? 0 : ( ( quality == DXT_ENCODE_NORMAL ) ? 1 : 8 );
+	int i;
+	for( i = 0; i < nRefinements && flError > 0.0f; i++ )
+	{
+		if( !RefineDXTColorEndpoints( block, indices, flColor0, flColor1 ) )
+			break;
+
+		WORD newCol0 = DXTPack565( flColor0 );
+		WORD newCol1 = DXTPack565( flColor1 );
+		BYTE newIndices[16];
+		float flNewError = FitDXTColorIndices( block, newCol0, newCol1, newIndices );
+		if( flNewError >= flError )
+			break;
+
+		col0 = newCol0;
+		col1 = newCol1;
+		memcpy( indices, newIndices, sizeof( indices ) );
+		flError = flNewError;
+	}
+
+	pOut->col0 = col0;
+	pOut->col1 = col1;
+	for( i = 0; i < 4; i++ )
+	{
+		pOut->row[i] = (BYTE)( indices[i*4] | ( indices[i*4+1] << 2 ) | ( indices[i*4+2] << 4 ) | ( indices[i*4+3] << 6 ) );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Fits one interpolated alpha block; returns the squared error
+//-----------------------------------------------------------------------------
+static int FitDXTAlphaIndices( const DXTEncodeBlock_t &block, int alpha0, int alpha1, BYTE *pIndices )
+{
+	int alphas[8];
+	alphas[0] = alpha0;
+	alphas[1] = alpha1;
+	if( alpha0 > alpha1 )
+	{
+		alphas[2] = ( 6 * alpha0 +     alpha1 ) / 7;
+		alphas[3] = ( 5 * alpha0 + 2 * alpha1 ) / 7;
+		alphas[4] = ( 4 * alpha0 + 3 * alpha1 ) / 7;
+		alphas[5] = ( 3 * alpha0 + 4 * alpha1 ) / 7;
+		alphas[6] = ( 2 * alpha0 + 5 * alpha1 ) / 7;
+		alphas[7] = (     alpha0 + 6 * alpha1 ) / 7;
+	}
+	else
+	{
+		alphas[2] = ( 4 * alpha0 +     alpha1 ) / 5;
+		alphas[3] = ( 3 * alpha0 + 2 * alpha1 ) / 5;
+		alphas[4] = ( 2 * alpha0 + 3 * alpha1 ) / 5;
+		alphas[5] = (     alpha0 + 4 * alpha1 ) / 5;
+		alphas[6] = 0;
+		alphas[7] = 255;
+	}
+
+	int nTotalError = 0;
+	int i, j;
+	for( i = 0; i < 16; i++ )
+	{
+		int a = block.m_Pixels[i][3];
+		int nBestError = 256 * 256;	// above any single-pixel error
+		int nBest = 0;
+		for( j = 0; j < 8; j++ )
+		{
+			int d = a - alphas[j];
+			if( d * d < nBestError )
+			{
+				nBestError = d * d;
+				nBest = j;
+			}
+		}
+		pIndices[i] = (BYTE)nBest;
+		nTotalError += nBestError;
+	}
+	return nTotalError;
+}
+
+static void EncodeDXT5AlphaBlock( const DXTEncodeBlock_t &block, DXTEncodeQuality_t quality, DXTAlphaBlock3BitLinear *pOut )
+{
+	int nMin = 255, nMax = 0;
+	int nInnerMin = 255, nInnerMax = 0;	// ignoring 0 and 255, which the 6-alpha mode has for free
+	int i;
+	for( i = 0; i < 16; i++ )
+	{
+		int a = block.m_Pixels[i][3];
+		nMin = ( a < nMin ) ? a : nMin;
+		nMax = ( a > nMax ) ? a : nMax;
+		if( a != 0 && a != 255 )
+		{
+			nInnerMin = ( a < nInnerMin ) ? a : nInnerMin;
+			nInnerMax = ( a > nInnerMax ) ? a : nInnerMax;
+		}
+	}
+
+	// 8-alpha mode needs alpha0 > alpha1
+	int alpha0 = nMax;
+	int alpha1 = nMin;
+	BYTE indices[16];
+	int nError = FitDXTAlphaIndices( block, alpha0, alpha1, indices );
+
+	if( quality == DXT_ENCODE_HIGH && nError > 0 && nInnerMin <= nInnerMax )
+	{
+		BYTE indices6[16];
+		int nError6 = FitDXTAlphaIndices( block, nInnerMin, nInnerMax, indices6 );
+		if( nError6 < nError )
+		{
+			alpha0 = nInnerMin;
+			alpha1 = nInnerMax;
+			memcpy( indices, indices6, sizeof( indices ) );
+		}
+	}
+
+	pOut->alpha0 = (BYTE)alpha0;
+	pOut->alpha1 = (BYTE)alpha1;
+
+	// 3 bits per pixel, two rows per 3 bytes
+	int half;
+	for( half = 0; half < 2; half++ )
+	{
+		DWORD bits = 0;
+		for( i = 0; i < 8; i++ )
+		{
+			bits |= (DWORD)indices[ half * 8 + i ] << ( i * 3 );
+		}
+		pOut->stuff[ half * 3 ] = (BYTE)( bits & 0xff );
+		pOut->stuff[ half * 3 + 1 ] = (BYTE)( ( bits >> 8 ) & 0xff );
+		pOut->stuff[ half * 3 + 2 ] = (BYTE)( ( bits >> 16 ) & 0xff );
+	}
+}
+
+static void EncodeDXT3AlphaBlock( const DXTEncodeBlock_t &block, BYTE *pOut )
+{
+	int i;
+	for( i = 0; i < 8; i++ )
+	{
+		int a0 = ( block.m_Pixels[ i * 2 ][3] * 15 + 127 ) / 255;
+		int a1 = ( block.m_Pixels[ i * 2 + 1 ][3] * 15 + 127 ) / 255;
+		pOut[i] = (BYTE)( a0 | ( a1 << 4 ) );
+	}
+}
+
+bool EncodeDXT( unsigned char *src, ImageFormat srcImageFormat, 
+			    unsigned char *dst, ImageFormat dstImageFormat, 
+				int width, int height, DXTEncodeQuality_t quality )
+{
+	if( srcImageFormat != IMAGE_FORMAT_RGBA8888 &&
+		srcImageFormat != IMAGE_FORMAT_RGB888 &&
+		srcImageFormat != IMAGE_FORMAT_BGRA8888 &&
+		srcImageFormat != IMAGE_FORMAT_BGRX8888 )
+	{
+		return false;
+	}
+	if( dstImageFormat != IMAGE_FORMAT_DXT1 &&
+		dstImageFormat != IMAGE_FORMAT_DXT3 &&
+		dstImageFormat != IMAGE_FORMAT_DXT5 )
+	{
+		return false;
+	}
+	if( width <= 0 || height <= 0 )
+	{
+		return false;
+	}
+
+	int xblocks = ( width + 3 ) >> 2;
+	int yblocks = ( height + 3 ) >> 2;
+
+	DXTEncodeBlock_t block;
+	int i, j;
+	for( j = 0; j < yblocks; j++ )
+	{
+		for( i = 0; i < xblocks; i++ )
+		{
+			LoadDXTEncodeBlock( src, srcImageFormat, width, height, i * 4, j * 4, block );
+
+			if( dstImageFormat == IMAGE_FORMAT_DXT5 )
+			{
+				EncodeDXT5AlphaBlock( block, quality, ( DXTAlphaBlock3BitLinear * )dst );
+				dst += 8;
+			}
+			else if( dstImageFormat == IMAGE_FORMAT_DXT3 )
+			{
+				EncodeDXT3AlphaBlock( block, dst );
+				dst += 8;
+			}
+
+			EncodeDXTColorBlock( block, quality, ( DXTColBlock * )dst );
+			dst += 8;
+		}
+	}
+	return true;
+}
+
 bool ConvertImageFormat( unsigned char *src, ImageFormat srcImageFormat,
  					     unsigned char *dst, ImageFormat dstImageFormat, 
 						 int width, int height, int srcStride, int dstStride )
@@ -1173,6 +1667,22 @@ bool ConvertImageFormat( unsigned char *src, ImageFormat srcImageFormat,
 		S3TCencode( &descIn, NULL, &descOut, dst, dwEncodeType, weight );
 		return true;
 	}
+#else
+	else if( ( srcImageFormat == IMAGE_FORMAT_RGBA8888 ||
+			   srcImageFormat == IMAGE_FORMAT_RGB888   ||
+			   srcImageFormat == IMAGE_FORMAT_BGRA8888 ||
+			   srcImageFormat == IMAGE_FORMAT_BGRX8888 ) &&
+			 ( dstImageFormat == IMAGE_FORMAT_DXT1 ||
+			   dstImageFormat == IMAGE_FORMAT_DXT3 ||
+			   dstImageFormat == IMAGE_FORMAT_DXT5 ) )
+	{
+		// from rgb(a) to dxtN
+		if( srcStride != 0 || dstStride != 0 )
+		{
+			return false;
+		}
+		return EncodeDXT( src, srcImageFormat, dst, dstImageFormat, width, height, s_DXTEncodeQuality );
+	}
 #endif
 	else if( ( dstImageFormat == IMAGE_FORMAT_RGBA8888 ||
 			   dstImageFormat == IMAGE_FORMAT_BGRX8888 ||
@@ -1233,6 +1743,46 @@ bool ConvertImageFormat( unsigned char *src, ImageFormat srcImageFormat,
 				return true;
 			}
 		}
+		if( srcImageFormat == IMAGE_FORMAT_DXT3 )
+		{
+			if( dstImageFormat == IMAGE_FORMAT_RGBA8888 )
+			{
+				ConvertFromDXT3( src, ( DXTColorRGBA8888 * )dst, width, height );
+				return true;
+			}
+			if( dstImageFormat == IMAGE_FORMAT_BGRA8888 ||
+			    dstImageFormat == IMAGE_FORMAT_BGRX8888 )
+			{
+				ConvertFromDXT3( src, ( DXTColorBGRA8888 * )dst, width, height );
+				return true;
+			}
+			if( dstImageFormat == IMAGE_FORMAT_RGB888 )
+			{
+				ConvertFromDXT5IgnoreAlpha( src, ( DXTColorRGB888 * )dst, width, height );
+				return true;
+			}
+			if( dstImageFormat == IMAGE_FORMAT_BGR888 )
+			{
+				ConvertFromDXT5IgnoreAlpha( src, ( DXTColorBGR888 * )dst, width, height );
+				return true;
+			}
+			if( dstImageFormat == IMAGE_FORMAT_BGR565 )
+			{
+				ConvertFromDXT5IgnoreAlpha( src, ( DXTColorBGR565 * )dst, width, height );
+				return true;
+			}
+			if( dstImageFormat == IMAGE_FORMAT_BGRA5551 ||
+				dstImageFormat == IMAGE_FORMAT_BGRX5551 )
+			{
+				ConvertFromDXT3( src, ( DXTColorBGRA5551 * )dst, width, height );
+				return true;
+			}
+			if( dstImageFormat == IMAGE_FORMAT_BGRA4444 )
+			{
+				ConvertFromDXT3( src, ( DXTColorBGRA4444 * )dst, width, height );
+				return true;
+			}
+		}
 		if( srcImageFormat == IMAGE_FORMAT_DXT5 )
 		{
 			if( dstImageFormat == IMAGE_FORMAT_RGBA8888 )
@@ -1521,30 +2071,55 @@ public:
 		int nInitialY = (hratio >> 1) - ((hratio * kernel.m_nDiameter) >> 1);
 		int nInitialX = (wratio >> 1) - ((wratio * kernel.m_nDiameter) >> 1);
 
+		// Wrap or clamp every source row + column the kernel can touch up front,
+		// instead of once per kernel tap
+		CUtlMemory<int> rowOffsets( 0, hratio * ( info.m_nDestHeight - 1 ) + kernel.m_nHeight );
+		CUtlMemory<int> columnOffsets( 0, wratio * ( info.m_nDestWidth - 1 ) + kernel.m_nWidth );
+		int n;
+		for ( n = 0; n < rowOffsets.NumAllocated(); ++n )
+		{
+			int sy = n + nInitialY;
+			if ( info.m_nFlags & RESAMPLE_CLAMPT )
+			{
+				sy = clamp( sy, 0, info.m_nSrcHeight - 1 );
+			}
+			else
+			{
+				// This works since srcHeight is a power of two.
+				// Even for negative #s!
+				sy &= (info.m_nSrcHeight - 1);
+			}
+			rowOffsets[n] = sy * info.m_nSrcWidth;
+		}
+		for ( n = 0; n < columnOffsets.NumAllocated(); ++n )
+		{
+			int sx = n + nInitialX;
+			if ( info.m_nFlags & RESAMPLE_CLAMPS )
+			{
+				sx = clamp( sx, 0, info.m_nSrcWidth - 1 );
+			}
+			else
+			{
+				// This works since srcWidth is a power of two.
+				sx &= (info.m_nSrcWidth - 1);
+			}
+			columnOffsets[n] = sx;
+		}
+
 		float flAlphaThreshhold = (info.m_flAlphaThreshhold >= 0 ) ? 255.0f * info.m_flAlphaThreshhold : 255.0f * 0.4f;
 		for ( int i = 0; i < info.m_nDestHeight; ++i )
 		{
 			int startY = hratio * i + nInitialY;
+			const int *pRowOffset = rowOffsets.Base() + hratio * i;
 			int dstPixel = (i * info.m_nDestWidth) << 2;
 			for ( int j = 0; j < info.m_nDestWidth; ++j, dstPixel += 4 )
 			{
 				int startX = wratio * j + nInitialX;
+				const int *pColumnOffset = columnOffsets.Base() + wratio * j;
 				float total[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-				for ( int k = 0, srcY = startY; k < kernel.m_nHeight; ++k, ++srcY )
+				for ( int k = 0; k < kernel.m_nHeight; ++k )
 				{
-					int sy = srcY;
-					if ( info.m_nFlags & RESAMPLE_CLAMPT )
-					{
-						sy = clamp( sy, 0, info.m_nSrcHeight - 1 );
-					}
-					else
-					{
-						// This works since srcHeight is a power of two.
-						// Even for negative #s!
-						sy &= (info.m_nSrcHeight - 1);
-					}
-
-					sy *= info.m_nSrcWidth;
+					int sy = pRowOffset[k];
 
 					int kernelIdx;
 					if ( bNiceFilter )
@@ -1556,21 +2131,9 @@ public:
 						kernelIdx = 0;
 					}
 
-					for ( int l = 0, srcX = startX; l < kernel.m_nWidth; ++l, ++srcX, ++kernelIdx )
+					for ( int l = 0; l < kernel.m_nWidth; ++l, ++kernelIdx )
 					{
-						int sx = srcX;
-						if ( info.m_nFlags & RESAMPLE_CLAMPS )
-						{
-							sx = clamp( sx, 0, info.m_nSrcWidth - 1 );
-						}
-						else
-						{
-							// This works since srcHeight is a power of two.
-							// Even for negative #s!
-							sx &= (info.m_nSrcWidth - 1);
-						}
-						
-						int srcPixel = (sy + sx) << 2;
+						int srcPixel = (sy + pColumnOffset[l]) << 2;
 
 						float flKernelFactor;
 						if ( bNiceFilter )
@@ -2236,6 +2799,42 @@ bool GenMipLevel( unsigned char *src, unsigned char *dst, ImageFormat imageForma
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Most of the converters below move whole pixels at a time. A 32-bit pixel is
+// loaded as R | G << 8 | B << 16 | A << 24 (byte order in memory), shuffled 
+// with shifts and masks, and stored with a single write.
+//-----------------------------------------------------------------------------
+static inline unsigned int LoadPixel8888( const unsigned char *p )
+{
+	return LittleDWord( *(const unsigned int *)p );
+}
+
+static inline void StorePixel8888( unsigned char *p, unsigned int pixel )
+{
+	*(unsigned int *)p = LittleDWord( pixel );
+}
+
+static inline unsigned int SwapPixelRB( unsigned int pixel )
+{
+	return ( pixel & 0xff00ff00 ) | ( ( pixel >> 16 ) & 0xff ) | ( ( pixel & 0xff ) << 16 );
+}
+
+static inline unsigned int ReversePixel( unsigned int pixel )
+{
+	return ( pixel >> 24 ) | ( ( pixel >> 8 ) & 0xff00 ) | ( ( pixel << 8 ) & 0xff0000 ) | ( pixel << 24 );
+}
+
+// Bit replication used when expanding 4, 5 and 6 bit channels to 8 bits
+static inline unsigned int Expand5( unsigned int c )
+{
+	return ( c << 3 ) | ( c >> 2 );
+}
+
+static inline unsigned int Expand6( unsigned int c )
+{
+	return ( c << 2 ) | ( c >> 4 );
+}
+
 void RGBA8888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 {
 	memcpy( dst, src, 4 * numPixels );
@@ -2246,10 +2845,7 @@ void RGBA8888ToABGR8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 4;
 	for( ; src < endSrc; src += 4, dst += 4 )
 	{
-		dst[0] = src[3];
-		dst[1] = src[2];
-		dst[2] = src[1];
-		dst[3] = src[0];
+		StorePixel8888( dst, ReversePixel( LoadPixel8888( src ) ) );
 	}
 }
 
@@ -2363,10 +2959,8 @@ void RGBA8888ToARGB8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 4;
 	for( ; src < endSrc; src += 4, dst += 4 )
 	{
-		dst[0] = src[3];
-		dst[1] = src[0];
-		dst[2] = src[1];
-		dst[3] = src[2];
+		unsigned int pixel = LoadPixel8888( src );
+		StorePixel8888( dst, ( pixel << 8 ) | ( pixel >> 24 ) );
 	}
 }
 
@@ -2375,21 +2969,18 @@ void RGBA8888ToBGRA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 4;
 	for( ; src < endSrc; src += 4, dst += 4 )
 	{
-		dst[0] = src[2];
-		dst[1] = src[1];
-		dst[2] = src[0];
-		dst[3] = src[3];
+		StorePixel8888( dst, SwapPixelRB( LoadPixel8888( src ) ) );
 	}
 }
 
 void RGBA8888ToBGRX8888( unsigned char *src, unsigned char *dst, int numPixels )
 {
+	// NOTE: Leaves whatever was in the X channel of the destination alone
 	unsigned char *endSrc = src + numPixels * 4;
 	for( ; src < endSrc; src += 4, dst += 4 )
 	{
-		dst[0] = src[2];
-		dst[1] = src[1];
-		dst[2] = src[0];
+		unsigned int pixel = SwapPixelRB( LoadPixel8888( src ) ) & 0x00ffffff;
+		StorePixel8888( dst, pixel | ( LoadPixel8888( dst ) & 0xff000000 ) );
 	}
 }
 
@@ -2399,9 +2990,10 @@ void RGBA8888ToBGR565( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 4;
 	for( ; src < endSrc; src += 4, pDstShort ++ )
 	{
-		*pDstShort = ((src[0] >> 3) << 11) |
-					 ((src[1] >> 2) << 5) |
-					  (src[2] >> 3);
+		unsigned int pixel = LoadPixel8888( src );
+		*pDstShort = ( ( pixel << 8 ) & 0xf800 ) |
+					 ( ( pixel >> 5 ) & 0x07e0 ) |
+					 ( ( pixel >> 19 ) & 0x001f );
 	}
 }
 
@@ -2411,9 +3003,10 @@ void RGBA8888ToBGRX5551( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 4;
 	for( ; src < endSrc; src += 4, pDstShort ++ )
 	{
-		*pDstShort = ((src[0] >> 3) << 10) |
-					 ((src[1] >> 3) << 5) |
-					  (src[2] >> 3);
+		unsigned int pixel = LoadPixel8888( src );
+		*pDstShort = ( ( pixel << 7 ) & 0x7c00 ) |
+					 ( ( pixel >> 6 ) & 0x03e0 ) |
+					 ( ( pixel >> 19 ) & 0x001f );
 	}
 }
 
@@ -2423,10 +3016,11 @@ void RGBA8888ToBGRA5551( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 4;
 	for( ; src < endSrc; src += 4, pDstShort ++ )
 	{
-		*pDstShort = ((src[0] >> 3) << 10) |
-					 ((src[1] >> 3) << 5) |
-					  (src[2] >> 3) |
-					  (src[3] >> 7) << 15;
+		unsigned int pixel = LoadPixel8888( src );
+		*pDstShort = ( ( pixel << 7 ) & 0x7c00 ) |
+					 ( ( pixel >> 6 ) & 0x03e0 ) |
+					 ( ( pixel >> 19 ) & 0x001f ) |
+					 ( ( pixel >> 16 ) & 0x8000 );
 	}
 }
 
@@ -2436,10 +3030,11 @@ void RGBA8888ToBGRA4444( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 4;
 	for( ; src < endSrc; src += 4, pDstShort ++ )
 	{
-		*pDstShort = ((src[0] >> 4) << 8) |
-					 ((src[1] >> 4) << 4) |
-					  (src[2] >> 4) |
-					 ((src[3] >> 4) << 12);
+		unsigned int pixel = LoadPixel8888( src );
+		*pDstShort = ( ( pixel << 4 ) & 0x0f00 ) |
+					 ( ( pixel >> 8 ) & 0x00f0 ) |
+					 ( ( pixel >> 20 ) & 0x000f ) |
+					 ( ( pixel >> 16 ) & 0xf000 );
 	}
 }
 
@@ -2468,10 +3063,7 @@ void ABGR8888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 4;
 	for( ; src < endSrc; src += 4, dst += 4 )
 	{
-		dst[0] = src[3];
-		dst[1] = src[2];
-		dst[2] = src[1];
-		dst[3] = src[0];
+		StorePixel8888( dst, ReversePixel( LoadPixel8888( src ) ) );
 	}
 }
 
@@ -2480,10 +3072,7 @@ void RGB888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 3;
 	for( ; src < endSrc; src += 3, dst += 4 )
 	{
-		dst[0] = src[0];
-		dst[1] = src[1];
-		dst[2] = src[2];
-		dst[3] = 255;
+		StorePixel8888( dst, src[0] | ( src[1] << 8 ) | ( src[2] << 16 ) | 0xff000000 );
 	}
 }
 
@@ -2492,10 +3081,7 @@ void BGR888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 3;
 	for( ; src < endSrc; src += 3, dst += 4 )
 	{
-		dst[0] = src[2];
-		dst[1] = src[1];
-		dst[2] = src[0];
-		dst[3] = 255;
+		StorePixel8888( dst, src[2] | ( src[1] << 8 ) | ( src[0] << 16 ) | 0xff000000 );
 	}
 }
 
@@ -2513,10 +3099,7 @@ void I8ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels;
 	for( ; src < endSrc; src += 1, dst += 4 )
 	{
-		dst[0] = src[0];
-		dst[1] = src[0];
-		dst[2] = src[0];
-		dst[3] = 255;
+		StorePixel8888( dst, ( src[0] * 0x00010101 ) | 0xff000000 );
 	}
 }
 
@@ -2525,10 +3108,7 @@ void IA88ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 2;
 	for( ; src < endSrc; src += 2, dst += 4 )
 	{
-		dst[0] = src[0];
-		dst[1] = src[0];
-		dst[2] = src[0];
-		dst[3] = src[1];
+		StorePixel8888( dst, ( src[0] * 0x00010101 ) | ( (unsigned int)src[1] << 24 ) );
 	}
 }
 
@@ -2542,10 +3122,7 @@ void A8ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels;
 	for( ; src < endSrc; src += 1, dst += 4 )
 	{
-		dst[0] = 255;
-		dst[1] = 255;
-		dst[2] = 255;
-		dst[3] = src[0];
+		StorePixel8888( dst, 0x00ffffff | ( (unsigned int)src[0] << 24 ) );
 	}
 }
 
@@ -2598,10 +3175,8 @@ void ARGB8888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 4;
 	for( ; src < endSrc; src += 4, dst += 4 )
 	{
-		dst[0] = src[1];
-		dst[1] = src[2];
-		dst[2] = src[3];
-		dst[3] = src[0];
+		unsigned int pixel = LoadPixel8888( src );
+		StorePixel8888( dst, ( pixel >> 8 ) | ( pixel << 24 ) );
 	}
 }
 
@@ -2610,10 +3185,7 @@ void BGRA8888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 4;
 	for( ; src < endSrc; src += 4, dst += 4 )
 	{
-		dst[0] = src[2];
-		dst[1] = src[1];
-		dst[2] = src[0];
-		dst[3] = src[3];
+		StorePixel8888( dst, SwapPixelRB( LoadPixel8888( src ) ) );
 	}
 }
 
@@ -2622,10 +3194,7 @@ void BGRX8888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char *endSrc = src + numPixels * 4;
 	for( ; src < endSrc; src += 4, dst += 4 )
 	{
-		dst[0] = src[2];
-		dst[1] = src[1];
-		dst[2] = src[0];
-		dst[3] = 255;
+		StorePixel8888( dst, SwapPixelRB( LoadPixel8888( src ) ) | 0xff000000 );
 	}
 }
 
@@ -2635,15 +3204,12 @@ void BGR565ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned short* pEndSrc = pSrcShort + numPixels;
 	for( ; pSrcShort < pEndSrc; pSrcShort++, dst += 4 )
 	{
-		int blue = (*pSrcShort & 0x1F);
-		int green = (*pSrcShort >> 5) & 0x3F;
-		int red = (*pSrcShort >> 11) & 0x1F;
+		unsigned int blue = (*pSrcShort & 0x1F);
+		unsigned int green = (*pSrcShort >> 5) & 0x3F;
+		unsigned int red = (*pSrcShort >> 11) & 0x1F;
 
 		// Expand to 8 bits
-		dst[0] = (red << 3) | (red >> 2);
-		dst[1] = (green << 2) | (green >> 4);
-		dst[2] = (blue << 3) | (blue >> 2);
-		dst[3] = 255;
+		StorePixel8888( dst, Expand5( red ) | ( Expand6( green ) << 8 ) | ( Expand5( blue ) << 16 ) | 0xff000000 );
 	}
 }
 
@@ -2653,15 +3219,12 @@ void BGRX5551ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned short* pEndSrc = pSrcShort + numPixels;
 	for( ; pSrcShort < pEndSrc; pSrcShort++, dst += 4 )
 	{
-		int blue = (*pSrcShort & 0x1F);
-		int green = (*pSrcShort >> 5) & 0x1F;
-		int red = (*pSrcShort >> 10) & 0x1F;
+		unsigned int blue = (*pSrcShort & 0x1F);
+		unsigned int green = (*pSrcShort >> 5) & 0x1F;
+		unsigned int red = (*pSrcShort >> 10) & 0x1F;
 
 		// Expand to 8 bits
-		dst[0] = (red << 3) | (red >> 2);
-		dst[1] = (green << 3) | (green >> 2);
-		dst[2] = (blue << 3) | (blue >> 2);
-		dst[3] = 255;
+		StorePixel8888( dst, Expand5( red ) | ( Expand5( green ) << 8 ) | ( Expand5( blue ) << 16 ) | 0xff000000 );
 	}
 }
 
@@ -2671,24 +3234,13 @@ void BGRA5551ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned short* pEndSrc = pSrcShort + numPixels;
 	for( ; pSrcShort < pEndSrc; pSrcShort++, dst += 4 )
 	{
-		int blue = (*pSrcShort & 0x1F);
-		int green = (*pSrcShort >> 5) & 0x1F;
-		int red = (*pSrcShort >> 10) & 0x1F;
-		int alpha = *pSrcShort & ( 1 << 15 );
+		unsigned int blue = (*pSrcShort & 0x1F);
+		unsigned int green = (*pSrcShort >> 5) & 0x1F;
+		unsigned int red = (*pSrcShort >> 10) & 0x1F;
 
-		// Expand to 8 bits
-		dst[0] = (red << 3) | (red >> 2);
-		dst[1] = (green << 3) | (green >> 2);
-		dst[2] = (blue << 3) | (blue >> 2);
-		// garymcthack
-		if( alpha )
-		{
-			dst[3] = 255;
-		}
-		else
-		{
-			dst[3] = 0;
-		}
+		// Expand to 8 bits, the alpha bit becomes 0 or 255
+		unsigned int alpha = ( *pSrcShort & ( 1 << 15 ) ) ? 0xff000000 : 0;
+		StorePixel8888( dst, Expand5( red ) | ( Expand5( green ) << 8 ) | ( Expand5( blue ) << 16 ) | alpha );
 	}
 }
 
@@ -2698,17 +3250,14 @@ void BGRA4444ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned short* pEndSrc = pSrcShort + numPixels;
 	for( ; pSrcShort < pEndSrc; pSrcShort++, dst += 4 )
 	{
-		int blue = (*pSrcShort & 0xF);
-		int green = (*pSrcShort >> 4) & 0xF;
-		int red = (*pSrcShort >> 8) & 0xF;
-		int alpha = (*pSrcShort >> 12) & 0xF;
+		unsigned int pixel = *pSrcShort;
 
 		// Expand to 8 bits
 		// FIXME: shouldn't this be (red << 4) | red?
-		dst[0] = (red << 4) | (red >> 4);
-		dst[1] = (green << 4) | (green >> 4);
-		dst[2] = (blue << 4) | (blue >> 4);
-		dst[3] = (alpha << 4) | (alpha >> 4);
+		StorePixel8888( dst, ( ( pixel >> 4 ) & 0x000000f0 ) |
+							 ( ( pixel << 8 ) & 0x0000f000 ) |
+							 ( ( pixel << 20 ) & 0x00f00000 ) |
+							 ( ( pixel << 16 ) & 0xf0000000 ) );
 	}
 }
 
@@ -2717,10 +3266,7 @@ void UV88ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
 	unsigned char* pEndSrc = src + numPixels * 2;
 	for( ; src < pEndSrc; src += 2, dst += 4 )
 	{
-		dst[0] = src[0];
-		dst[1] = src[1];
-		dst[2] = 0;
-		dst[3] = 0;
+		StorePixel8888( dst, src[0] | ( src[1] << 8 ) );
 	}
 }
 
@@ -101,6 +101,26 @@ bool ConvertImageFormat( unsigned char *src, enum ImageFormat srcImageFormat,
 		                 unsigned char *dst, enum ImageFormat dstImageFormat, 
 						 int width, int height, int srcStride = 0, int dstStride = 0 );
 
+//-----------------------------------------------------------------------------
+// Built-in DXT encoder. ConvertImageFormat uses it to produce DXT1/3/5 when
+// the S3TC library isn't compiled in (IMAGE_LOADER_NO_DXTC, and always off
+// Win32); it can also be called directly.
+//-----------------------------------------------------------------------------
+enum DXTEncodeQuality_t
+{
+	DXT_ENCODE_FAST = 0,	// bounding box endpoints
+	DXT_ENCODE_NORMAL,		// principal axis endpoints with one least squares pass
+	DXT_ENCODE_HIGH,		// iterated least squares, tries both DXT5 alpha modes
+};
+
+void SetDXTEncodeQuality( DXTEncodeQuality_t quality );
+DXTEncodeQuality_t GetDXTEncodeQuality();
+
+// src must be RGBA8888, RGB888, BGRA8888 or BGRX8888, dst DXT1, DXT3 or DXT5
+bool EncodeDXT( unsigned char *src, enum ImageFormat srcImageFormat, 
+			    unsigned char *dst, enum ImageFormat dstImageFormat, 
+				int width, int height, DXTEncodeQuality_t quality );
+
 // Flags for ResampleRGBA8888
 enum
 {
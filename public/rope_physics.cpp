@@ -115,13 +115,16 @@ void CBaseRopePhysics::ApplyConstraints( CSimplePhysics::CNode *pNodes, int nNod
 	// Iterate multiple times here. If we don't, then gravity tends to
 	// win over the constraint solver and it's impossible to get straight ropes.
 	static int nIterations = 3;
+	int nSprings = NumSprings();
 	for( int iIteration=0; iIteration < nIterations; iIteration++ )
 	{
-		for( int i=0; i < NumSprings(); i++ )
+		// Spring i always joins node i and i+1, so walk the nodes directly.
+		for( int i=0; i < nSprings; i++ )
 		{
-			CRopeSpring *s = &m_pSprings[i];
+			Vector &vNode1 = m_pNodes[i].m_vPos;
+			Vector &vNode2 = m_pNodes[i+1].m_vPos;
 
-			Vector vTo = *s->m_pNode1 - *s->m_pNode2;
+			Vector vTo = vNode1 - vNode2;
 
 			float flDistSqr = vTo.LengthSqr();
 
@@ -139,8 +142,8 @@ void CBaseRopePhysics::ApplyConstraints( CSimplePhysics::CNode *pNodes, int nNod
 				float flDist = (float)sqrt( flDistSqr );
 				vTo *= 1 - (m_flSpringDist / flDist);
 
-				*s->m_pNode1 -= vTo * 0.5f;
-				*s->m_pNode2 += vTo * 0.5f;
+				vNode1 -= vTo * 0.5f;
+				vNode2 += vTo * 0.5f;
 			}
 		}
 
@@ -0,0 +1,1210 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Checks the blocked bone setup in bone_setup.cpp against the per
+//			bone code it replaced. The SoA kernels are run on random poses
+//			against QuaternionSlerp, QuaternionBlend and QuaternionMatrix,
+//			then whole poses (CalcPose, a layered AccumulatePose and
+//			Studio_BuildMatrices) are built on generated models and compared
+//			with a copy of the old per bone pipeline kept in this file. Every
+//			position, quaternion and bone matrix has to match exactly. The
+//			exit code is the number of mismatches.
+//
+//			With -bench it times bone setup for BENCH_INSTANCE_COUNT
+//			instances of BENCH_MODEL_COUNT generated models, or of the .mdl
+//			files given on the command line, for both pipelines. Each is run
+//			with the instances in entity order, where models are interleaved,
+//			and grouped by model.
+//
+// $NoKeywords: $
+//=============================================================================//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "bone_setup.h"
+#include "studio.h"
+#include "mathlib.h"
+#include "vector.h"
+#include "compressed_vector.h"
+#include "tier0/dbg.h"
+#include "tier0/platform.h"
+#include "utlvector.h"
+
+#define IDSTUDIOHEADER			(('T'<<24)+('S'<<16)+('D'<<8)+'I')
+
+// bone_setup.cpp
+extern void ExtractAnimValue( const studiohdr_t *pStudioHdr, int frame, mstudioanimvalue_t *panimvalue, float scale, float &v1, float &v2 );
+extern void CalcBonePosition( const studiohdr_t *pStudioHdr, int frame, float s, const mstudiobone_t *pbone, const mstudioanim_t *panim, Vector &pos );
+
+
+//-----------------------------------------------------------------------------
+// Repeatable random numbers, so a failure can be reproduced
+//-----------------------------------------------------------------------------
+static unsigned int s_nRandomSeed = 1;
+
+static int RandomInt( int nMin, int nMax )
+{
+	s_nRandomSeed = s_nRandomSeed * 1103515245 + 12345;
+	return nMin + ( int )( ( s_nRandomSeed >> 8 ) % ( unsigned int )( nMax - nMin + 1 ) );
+}
+
+static float RandomFloat( float flMin, float flMax )
+{
+	return flMin + ( flMax - flMin ) * ( RandomInt( 0, 65535 ) / 65535.0f );
+}
+
+static void RandomQuaternion( Quaternion &q )
+{
+	q.Init( RandomFloat( -1.0f, 1.0f ), RandomFloat( -1.0f, 1.0f ), RandomFloat( -1.0f, 1.0f ), RandomFloat( -1.0f, 1.0f ) );
+	QuaternionNormalize( q );
+}
+
+static void RandomVector( float flRange, Vector &v )
+{
+	v.Init( RandomFloat( -flRange, flRange ), RandomFloat( -flRange, flRange ), RandomFloat( -flRange, flRange ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Generated models. Every bone gets a random parent, rest pose, usage flags
+// and sometimes BONE_FIXED_ALIGNMENT. Sequences play one animation or blend
+// two across the single pose parameter, with partial bone weights. The
+// animations mix compressed runs of every length, raw and missing channels
+// and bones with no data at all.
+//-----------------------------------------------------------------------------
+struct TestModelParams_t
+{
+	int m_nBones;
+	int m_nSequences;
+	int m_nFrames;
+};
+
+static const int s_nBoneUsage[] =
+{
+	BONE_USED_BY_HITBOX,
+	BONE_USED_BY_ATTACHMENT,
+	BONE_USED_BY_VERTEX_LOD0,
+	BONE_USED_BY_VERTEX_LOD0 | BONE_USED_BY_VERTEX_LOD1,
+	BONE_USED_BY_ANYTHING
+};
+
+class CTestModelWriter
+{
+public:
+	CTestModelWriter( int nMaxSize )
+	{
+		m_pBase = ( byte * )calloc( nMaxSize, 1 );
+		m_nSize = 0;
+		m_nMaxSize = nMaxSize;
+	}
+
+	// Returns the offset of nBytes of zeroed space
+	int Alloc( int nBytes, int nAlign = 4 )
+	{
+		m_nSize = ( m_nSize + nAlign - 1 ) & ~( nAlign - 1 );
+		int nOffset = m_nSize;
+		m_nSize += nBytes;
+		if ( m_nSize > m_nMaxSize )
+		{
+			Error( "CTestModelWriter: out of space\n" );
+		}
+		return nOffset;
+	}
+
+	template< class T > T *Get( int nOffset ) { return ( T * )( m_pBase + nOffset ); }
+
+	byte	*m_pBase;
+	int		m_nSize;
+	int		m_nMaxSize;
+};
+
+// Writes one channel as runs of { valid, total } followed by the valid values
+static int WriteAnimChannel( CTestModelWriter &writer, int nFrames )
+{
+	int nStart = -1;
+	int nFrame = 0;
+
+	// One run past the last frame, the decoder may peek at it
+	while ( nFrame <= nFrames )
+	{
+		int nTotal = RandomInt( 1, 8 );
+		int nValid = RandomInt( 1, nTotal );
+		if ( RandomInt( 0, 3 ) == 0 )
+		{
+			nValid = nTotal;
+		}
+
+		int nOffset = writer.Alloc( ( nValid + 1 ) * sizeof( mstudioanimvalue_t ), 2 );
+		if ( nStart < 0 )
+		{
+			nStart = nOffset;
+		}
+
+		mstudioanimvalue_t *pValue = writer.Get<mstudioanimvalue_t>( nOffset );
+		pValue[0].num.valid = nValid;
+		pValue[0].num.total = nTotal;
+		for ( int i = 1; i <= nValid; ++i )
+		{
+			pValue[i].value = RandomInt( -32767, 32767 );
+		}
+		nFrame += nTotal;
+	}
+	return nStart;
+}
+
+static void WriteAnimation( CTestModelWriter &writer, int nAnimDesc, int nBones, int nFrames )
+{
+	static const int s_nAnimFlags[] =
+	{
+		STUDIO_ANIM_ANIMROT | STUDIO_ANIM_ANIMPOS,
+		STUDIO_ANIM_ANIMROT | STUDIO_ANIM_ANIMPOS,
+		STUDIO_ANIM_ANIMROT | STUDIO_ANIM_ANIMPOS,
+		STUDIO_ANIM_ANIMROT,
+		STUDIO_ANIM_ANIMPOS,
+		STUDIO_ANIM_RAWROT,
+		STUDIO_ANIM_RAWROT | STUDIO_ANIM_RAWPOS,
+		0,
+	};
+
+	bool bDelta = ( RandomInt( 0, 7 ) == 0 );
+	int nPrev = -1;
+	for ( int nBone = 0; nBone < nBones; ++nBone )
+	{
+		// some bones have no data in this animation
+		if ( RandomInt( 0, 9 ) == 0 )
+			continue;
+
+		int nFlags = s_nAnimFlags[ RandomInt( 0, ARRAYSIZE( s_nAnimFlags ) - 1 ) ];
+		if ( bDelta )
+		{
+			nFlags |= STUDIO_ANIM_DELTA;
+		}
+
+		int nAnim = writer.Alloc( sizeof( mstudioanim_t ), 2 );
+		if ( nPrev < 0 )
+		{
+			writer.Get<mstudioanimdesc_t>( nAnimDesc )->animindex = nAnim - nAnimDesc;
+		}
+		else
+		{
+			writer.Get<mstudioanim_t>( nPrev )->nextoffset = nAnim - nPrev;
+		}
+		nPrev = nAnim;
+
+		writer.Get<mstudioanim_t>( nAnim )->bone = nBone;
+		writer.Get<mstudioanim_t>( nAnim )->flags = nFlags;
+
+		if ( nFlags & STUDIO_ANIM_RAWROT )
+		{
+			Quaternion q;
+			RandomQuaternion( q );
+			*writer.Get<Quaternion48>( writer.Alloc( sizeof( Quaternion48 ), 2 ) ) = q;
+		}
+		if ( nFlags & STUDIO_ANIM_RAWPOS )
+		{
+			Vector v;
+			RandomVector( 8.0f, v );
+			*writer.Get<Vector48>( writer.Alloc( sizeof( Vector48 ), 2 ) ) = v;
+		}
+
+		int nValuePtr[2];
+		int nValuePtrCount = 0;
+		if ( nFlags & STUDIO_ANIM_ANIMROT )
+		{
+			nValuePtr[ nValuePtrCount++ ] = writer.Alloc( sizeof( mstudioanim_valueptr_t ), 2 );
+		}
+		if ( nFlags & STUDIO_ANIM_ANIMPOS )
+		{
+			nValuePtr[ nValuePtrCount++ ] = writer.Alloc( sizeof( mstudioanim_valueptr_t ), 2 );
+		}
+		for ( int i = 0; i < nValuePtrCount; ++i )
+		{
+			for ( int j = 0; j < 3; ++j )
+			{
+				// a missing channel reads as zero
+				if ( RandomInt( 0, 5 ) == 0 )
+					continue;
+
+				int nChannel = WriteAnimChannel( writer, nFrames );
+				writer.Get<mstudioanim_valueptr_t>( nValuePtr[i] )->offset[j] = nChannel - nValuePtr[i];
+			}
+		}
+	}
+
+	// a bone past the end terminates the list
+	int nEnd = writer.Alloc( sizeof( mstudioanim_t ), 2 );
+	writer.Get<mstudioanim_t>( nEnd )->bone = 255;
+	if ( nPrev < 0 )
+	{
+		writer.Get<mstudioanimdesc_t>( nAnimDesc )->animindex = nEnd - nAnimDesc;
+	}
+	else
+	{
+		writer.Get<mstudioanim_t>( nPrev )->nextoffset = nEnd - nPrev;
+	}
+}
+
+static studiohdr_t *CreateTestModel( const TestModelParams_t &params )
+{
+	int nChannelSize = ( params.m_nFrames + 9 ) * 2 * sizeof( mstudioanimvalue_t ) + 2;
+	int nBoneAnimSize = sizeof( mstudioanim_t ) + 2 * sizeof( mstudioanim_valueptr_t ) + 2 * sizeof( Vector48 ) + 6 * nChannelSize + 8;
+	int nMaxSize = sizeof( studiohdr_t ) + params.m_nBones * sizeof( mstudiobone_t ) +
+		params.m_nSequences * ( sizeof( mstudioseqdesc_t ) + 2 * sizeof( mstudioanimdesc_t ) + 2 * ( params.m_nBones + 1 ) * nBoneAnimSize + params.m_nBones * sizeof( float ) + 64 ) + 1024;
+	CTestModelWriter writer( nMaxSize );
+
+	int nHdr = writer.Alloc( sizeof( studiohdr_t ) );
+	int nName = writer.Alloc( 1 );
+	int nBones = writer.Alloc( params.m_nBones * sizeof( mstudiobone_t ) );
+	int nPoseParam = writer.Alloc( sizeof( mstudioposeparamdesc_t ) );
+
+	for ( int i = 0; i < params.m_nBones; ++i )
+	{
+		mstudiobone_t *pBone = writer.Get<mstudiobone_t>( nBones ) + i;
+		pBone->sznameindex = nName - ( nBones + i * sizeof( mstudiobone_t ) );
+		pBone->parent = ( i == 0 ) ? -1 : RandomInt( -1, i - 1 );
+		for ( int j = 0; j < 6; ++j )
+		{
+			pBone->bonecontroller[j] = -1;
+		}
+		RandomVector( 16.0f, pBone->pos );
+		pBone->rot.Init( RandomFloat( -M_PI, M_PI ), RandomFloat( -M_PI, M_PI ), RandomFloat( -M_PI, M_PI ) );
+		AngleQuaternion( pBone->rot, pBone->quat );
+		pBone->posscale.Init( 1.0f / 1024.0f, 1.0f / 1024.0f, 1.0f / 1024.0f );
+		pBone->rotscale.Init( M_PI / 32767.0f, M_PI / 32767.0f, M_PI / 32767.0f );
+		SetIdentityMatrix( pBone->poseToBone );
+		RandomQuaternion( pBone->qAlignment );
+		pBone->flags = s_nBoneUsage[ RandomInt( 0, ARRAYSIZE( s_nBoneUsage ) - 1 ) ];
+		if ( RandomInt( 0, 3 ) == 0 )
+		{
+			pBone->flags |= BONE_FIXED_ALIGNMENT;
+		}
+		pBone->surfacepropidx = nName - ( nBones + i * sizeof( mstudiobone_t ) );
+	}
+
+	mstudioposeparamdesc_t *pPoseParam = writer.Get<mstudioposeparamdesc_t>( nPoseParam );
+	pPoseParam->sznameindex = nName - nPoseParam;
+	pPoseParam->start = 0.0f;
+	pPoseParam->end = 1.0f;
+	pPoseParam->loop = 0.0f;
+
+	// Sequences first, then their animations, since each can blend two
+	int nSequences = writer.Alloc( params.m_nSequences * sizeof( mstudioseqdesc_t ) );
+	int nAnimCount[ 256 ];
+	int nTotalAnims = 0;
+	for ( int i = 0; i < params.m_nSequences; ++i )
+	{
+		nAnimCount[i] = RandomInt( 1, 2 );
+		nTotalAnims += nAnimCount[i];
+	}
+	int nAnimDescs = writer.Alloc( nTotalAnims * sizeof( mstudioanimdesc_t ) );
+
+	int nAnim = 0;
+	for ( int i = 0; i < params.m_nSequences; ++i )
+	{
+		int nSeq = nSequences + i * sizeof( mstudioseqdesc_t );
+		int nAnimIndex = writer.Alloc( nAnimCount[i] * sizeof( short ), 2 );
+		int nWeights = writer.Alloc( params.m_nBones * sizeof( float ) );
+
+		mstudioseqdesc_t *pSeq = writer.Get<mstudioseqdesc_t>( nSeq );
+		pSeq->baseptr = nHdr - nSeq;
+		pSeq->szlabelindex = nName - nSeq;
+		pSeq->szactivitynameindex = nName - nSeq;
+		pSeq->flags = RandomInt( 0, 1 ) ? STUDIO_LOOPING : 0;
+		pSeq->activity = -1;
+		pSeq->numblends = nAnimCount[i];
+		pSeq->animindexindex = nAnimIndex - nSeq;
+		pSeq->groupsize[0] = nAnimCount[i];
+		pSeq->groupsize[1] = 1;
+		pSeq->paramindex[0] = ( nAnimCount[i] > 1 ) ? 0 : -1;
+		pSeq->paramindex[1] = -1;
+		pSeq->paramstart[0] = pSeq->paramstart[1] = 0.0f;
+		pSeq->paramend[0] = pSeq->paramend[1] = 1.0f;
+		pSeq->paramparent = -1;
+		pSeq->weightlistindex = nWeights - nSeq;
+
+		for ( int j = 0; j < params.m_nBones; ++j )
+		{
+			static const float s_flWeights[] = { 1.0f, 1.0f, 1.0f, 0.0f, 0.5f, 0.25f };
+			writer.Get<float>( nWeights )[j] = s_flWeights[ RandomInt( 0, ARRAYSIZE( s_flWeights ) - 1 ) ];
+		}
+
+		for ( int j = 0; j < nAnimCount[i]; ++j, ++nAnim )
+		{
+			int nAnimDesc = nAnimDescs + nAnim * sizeof( mstudioanimdesc_t );
+			writer.Get<short>( nAnimIndex )[j] = nAnim;
+
+			mstudioanimdesc_t *pAnimDesc = writer.Get<mstudioanimdesc_t>( nAnimDesc );
+			pAnimDesc->baseptr = nHdr - nAnimDesc;
+			pAnimDesc->sznameindex = nName - nAnimDesc;
+			pAnimDesc->fps = 30.0f;
+			pAnimDesc->flags = pSeq->flags;
+			pAnimDesc->numframes = params.m_nFrames;
+
+			WriteAnimation( writer, nAnimDesc, params.m_nBones, params.m_nFrames );
+		}
+	}
+
+	studiohdr_t *pHdr = writer.Get<studiohdr_t>( nHdr );
+	pHdr->id = IDSTUDIOHEADER;
+	pHdr->version = STUDIO_VERSION;
+	Q_strncpy( pHdr->name, "bonesetupcheck.mdl", sizeof( pHdr->name ) );
+	pHdr->length = writer.m_nSize;
+	pHdr->numbones = params.m_nBones;
+	pHdr->boneindex = nBones - nHdr;
+	pHdr->numlocalanim = nTotalAnims;
+	pHdr->localanimindex = nAnimDescs - nHdr;
+	pHdr->numlocalseq = params.m_nSequences;
+	pHdr->localseqindex = nSequences - nHdr;
+	pHdr->numlocalposeparameters = 1;
+	pHdr->localposeparamindex = nPoseParam - nHdr;
+	pHdr->surfacepropindex = nName - nHdr;
+	return pHdr;
+}
+
+
+//-----------------------------------------------------------------------------
+// .mdl files for -bench. Included models and animation blocks are looked up
+// the same way, relative to the current directory or -game.
+//-----------------------------------------------------------------------------
+static char s_szGameDir[MAX_PATH] = ".";
+
+static studiohdr_t *LoadModelFile( const char *pFileName )
+{
+	FILE *fp = fopen( pFileName, "rb" );
+	if ( !fp )
+		return NULL;
+
+	fseek( fp, 0, SEEK_END );
+	int nSize = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+
+	studiohdr_t *pHdr = ( studiohdr_t * )malloc( nSize );
+	if ( fread( pHdr, nSize, 1, fp ) != 1 )
+	{
+		free( pHdr );
+		pHdr = NULL;
+	}
+	fclose( fp );
+	return pHdr;
+}
+
+studiohdr_t *FindOrLoadGroupFile( char const *modelname )
+{
+	studiohdr_t *pHdr = LoadModelFile( modelname );
+	if ( !pHdr )
+	{
+		char szFileName[MAX_PATH];
+		Q_snprintf( szFileName, sizeof( szFileName ), "%s/%s", s_szGameDir, modelname );
+		pHdr = LoadModelFile( szFileName );
+	}
+	if ( !pHdr )
+	{
+		Error( "Can't load %s\n", modelname );
+	}
+	return pHdr;
+}
+
+
+//-----------------------------------------------------------------------------
+// The per bone pipeline from before the SoA blocks, for the generated models.
+// Those never include other models, so the virtual model paths are left out,
+// and their sequences only blend along the first pose parameter.
+//-----------------------------------------------------------------------------
+namespace Reference
+{
+
+static void CalcBoneQuaternion( const studiohdr_t *pStudioHdr, int frame, float s,
+						const mstudiobone_t *pbone, const mstudioanim_t *panim, Quaternion &q )
+{
+	if (panim->flags & STUDIO_ANIM_RAWROT)
+	{
+		q = *(panim->pQuat());
+		Assert( q.IsValid() );
+		return;
+	}
+	else if (!(panim->flags & STUDIO_ANIM_ANIMROT))
+	{
+		if (panim->flags & STUDIO_ANIM_DELTA)
+		{
+			q.Init( 0.0f, 0.0f, 0.0f, 1.0f );
+		}
+		else
+		{
+			q = pbone->quat;
+		}
+		return;
+	}
+
+	Quaternion			q1, q2;
+	RadianEuler			angle1, angle2;
+	mstudioanim_valueptr_t *pValuesPtr = panim->pRotV();
+
+	ExtractAnimValue( pStudioHdr, frame, pValuesPtr->pAnimvalue( 0 ), pbone->rotscale.x, angle1.x, angle2.x );
+	ExtractAnimValue( pStudioHdr, frame, pValuesPtr->pAnimvalue( 1 ), pbone->rotscale.y, angle1.y, angle2.y );
+	ExtractAnimValue( pStudioHdr, frame, pValuesPtr->pAnimvalue( 2 ), pbone->rotscale.z, angle1.z, angle2.z );
+
+	if (!(panim->flags & STUDIO_ANIM_DELTA))
+	{
+		angle1.x = angle1.x + pbone->rot.x;
+		angle1.y = angle1.y + pbone->rot.y;
+		angle1.z = angle1.z + pbone->rot.z;
+		angle2.x = angle2.x + pbone->rot.x;
+		angle2.y = angle2.y + pbone->rot.y;
+		angle2.z = angle2.z + pbone->rot.z;
+	}
+
+	Assert( angle1.IsValid() && angle2.IsValid() );
+	if (angle1.x != angle2.x || angle1.y != angle2.y || angle1.z != angle2.z)
+	{
+		AngleQuaternion( angle1, q1 );
+		AngleQuaternion( angle2, q2 );
+		QuaternionBlend( q1, q2, s, q );
+	}
+	else
+	{
+		AngleQuaternion( angle1, q );
+	}
+
+	Assert( q.IsValid() );
+
+	// align to unified bone
+	if (!(panim->flags & STUDIO_ANIM_DELTA) && (pbone->flags & BONE_FIXED_ALIGNMENT))
+	{
+		QuaternionAlign( pbone->qAlignment, q, q );
+	}
+}
+
+static void CalcAnimation( const studiohdr_t *pStudioHdr,	Vector *pos, Quaternion *q,
+	int sequence, int animation,
+	float cycle, int boneMask )
+{
+	int					i;
+
+	Assert( !pStudioHdr->GetVirtualModel() );
+
+	mstudioseqdesc_t &seqdesc	= 	pStudioHdr->pSeqdesc( sequence );
+	mstudioanimdesc_t &animdesc = pStudioHdr->pAnimdesc( animation );
+	mstudiobone_t *pbone = pStudioHdr->pBone( 0 );
+	mstudioanim_t *panim = animdesc.pAnim( );
+	mstudiobone_t *pAnimbone = pbone;
+
+	int					iFrame;
+	float				s;
+
+	float fFrame = cycle * (animdesc.numframes - 1);
+
+	iFrame = (int)fFrame;
+	s = (fFrame - iFrame);
+
+	float *pweight = seqdesc.pBoneweight( 0 );
+
+	for (i = 0; i < pStudioHdr->numbones; i++, pbone++, pweight++, pAnimbone++)
+	{
+		if (panim && panim->bone == i)
+		{
+			if (*pweight > 0 && (pbone->flags & boneMask))
+			{
+				Reference::CalcBoneQuaternion( pStudioHdr, iFrame, s, pAnimbone, panim, q[i] );
+				CalcBonePosition  ( pStudioHdr, iFrame, s, pAnimbone, panim, pos[i] );
+			}
+			panim = panim->pNext();
+		}
+		else if (*pweight > 0 && (pbone->flags & boneMask))
+		{
+			if (animdesc.flags & STUDIO_DELTA)
+			{
+				q[i].Init( 0.0f, 0.0f, 0.0f, 1.0f );
+				pos[i].Init( 0.0f, 0.0f, 0.0f );
+			}
+			else
+			{
+				q[i] = pbone->quat;
+				pos[i] = pbone->pos;
+			}
+		}
+	}
+}
+
+static void SlerpBones(
+	const studiohdr_t *pStudioHdr,
+	Quaternion q1[MAXSTUDIOBONES],
+	Vector pos1[MAXSTUDIOBONES],
+	int sequence,
+	const Quaternion q2[MAXSTUDIOBONES],
+	const Vector pos2[MAXSTUDIOBONES],
+	float s,
+	int boneMask )
+{
+	int			i;
+	Quaternion		q3;
+	float		s1, s2;
+
+	const mstudioseqdesc_t &seqdesc = pStudioHdr->pSeqdesc( sequence );
+	mstudiobone_t *pbone = pStudioHdr->pBone( 0 );
+
+	if (s <= 0.0f)
+	{
+		return;
+	}
+	else if (s > 1.0f)
+	{
+		s = 1.0f;
+	}
+
+	Assert( !(seqdesc.flags & STUDIO_DELTA) );
+
+	for (i = 0; i < pStudioHdr->numbones; i++)
+	{
+		// skip unused bones
+		if (!(pbone[i].flags & boneMask))
+		{
+			continue;
+		}
+
+		s2 = s * seqdesc.weight( i );	// blend in based on this animations weights
+		if (s2 > 0.0)
+		{
+			s1 = 1.0 - s2;
+
+			if (pbone[i].flags & BONE_FIXED_ALIGNMENT)
+			{
+				QuaternionSlerpNoAlign( q2[i], q1[i], s1, q3 );
+			}
+			else
+			{
+				QuaternionSlerp( q2[i], q1[i], s1, q3 );
+			}
+			q1[i][0] = q3[0];
+			q1[i][1] = q3[1];
+			q1[i][2] = q3[2];
+			q1[i][3] = q3[3];
+			pos1[i][0] = pos1[i][0] * s1 + pos2[i][0] * s2;
+			pos1[i][1] = pos1[i][1] * s1 + pos2[i][1] * s2;
+			pos1[i][2] = pos1[i][2] * s1 + pos2[i][2] * s2;
+		}
+	}
+}
+
+static void BlendBones(
+	const studiohdr_t *pStudioHdr,
+	Quaternion q1[MAXSTUDIOBONES],
+	Vector pos1[MAXSTUDIOBONES],
+	int sequence,
+	const Quaternion q2[MAXSTUDIOBONES],
+	const Vector pos2[MAXSTUDIOBONES],
+	float s,
+	int boneMask )
+{
+	int			i;
+	Quaternion		q3;
+
+	mstudioseqdesc_t &seqdesc = pStudioHdr->pSeqdesc( sequence );
+	mstudiobone_t *pbone = pStudioHdr->pBone( 0 );
+
+	Assert( s > 0 && s < 1.0 );
+
+	float s2 = s;
+	float s1 = 1.0 - s2;
+
+	for (i = 0; i < pStudioHdr->numbones; i++)
+	{
+		// skip unused bones
+		if (!(pbone[i].flags & boneMask))
+		{
+			continue;
+		}
+
+		if (seqdesc.weight( i ) > 0.0)
+		{
+			if (pbone[i].flags & BONE_FIXED_ALIGNMENT)
+			{
+				QuaternionBlendNoAlign( q2[i], q1[i], s1, q3 );
+			}
+			else
+			{
+				QuaternionBlend( q2[i], q1[i], s1, q3 );
+			}
+			q1[i][0] = q3[0];
+			q1[i][1] = q3[1];
+			q1[i][2] = q3[2];
+			q1[i][3] = q3[3];
+			pos1[i][0] = pos1[i][0] * s1 + pos2[i][0] * s2;
+			pos1[i][1] = pos1[i][1] * s1 + pos2[i][1] * s2;
+			pos1[i][2] = pos1[i][2] * s1 + pos2[i][2] * s2;
+		}
+	}
+}
+
+static bool CalcPoseSingle(
+	const studiohdr_t *pStudioHdr,
+	Vector pos[],
+	Quaternion q[],
+	int sequence,
+	float cycle,
+	const float poseParameter[],
+	int boneMask
+	)
+{
+	static Vector		pos2[MAXSTUDIOBONES];
+	static Quaternion	q2[MAXSTUDIOBONES];
+
+	mstudioseqdesc_t	&seqdesc = pStudioHdr->pSeqdesc( sequence );
+
+	int i0 = 0;
+	float s0 = 0;
+
+	Studio_LocalPoseParameter( pStudioHdr, poseParameter, sequence, 0, s0, i0 );
+
+	if (cycle < 0 || cycle >= 1)
+	{
+		if (seqdesc.flags & STUDIO_LOOPING)
+		{
+			cycle = cycle - (int)cycle;
+			if (cycle < 0) cycle += 1;
+		}
+		else
+		{
+			cycle = max( 0.0, min( cycle, 0.9999 ) );
+		}
+	}
+
+	if (s0 < 0.001)
+	{
+		Reference::CalcAnimation( pStudioHdr, pos,  q,  sequence, seqdesc.anim( i0  , 0 ), cycle, boneMask );
+	}
+	else if (s0 > 0.999)
+	{
+		Reference::CalcAnimation( pStudioHdr, pos,  q,  sequence, seqdesc.anim( i0+1, 0 ), cycle, boneMask );
+	}
+	else
+	{
+		Reference::CalcAnimation( pStudioHdr, pos,  q,  sequence, seqdesc.anim( i0  , 0 ), cycle, boneMask );
+		Reference::CalcAnimation( pStudioHdr, pos2, q2, sequence, seqdesc.anim( i0+1, 0 ), cycle, boneMask );
+		Reference::BlendBones( pStudioHdr, q, pos, sequence, q2, pos2, s0, boneMask );
+	}
+
+	return true;
+}
+
+static void AccumulatePose(
+	const studiohdr_t *pStudioHdr,
+	Vector pos[],
+	Quaternion q[],
+	int sequence,
+	float cycle,
+	const float poseParameter[],
+	int boneMask,
+	float flWeight
+	)
+{
+	Vector		pos2[MAXSTUDIOBONES];
+	Quaternion	q2[MAXSTUDIOBONES];
+
+	if (Reference::CalcPoseSingle( pStudioHdr, pos2, q2, sequence, cycle, poseParameter, boneMask ))
+	{
+		Reference::SlerpBones( pStudioHdr, q, pos, sequence, q2, pos2, flWeight, boneMask );
+	}
+}
+
+static void Studio_BuildMatrices(
+	const studiohdr_t *pStudioHdr,
+	const QAngle& angles,
+	const Vector& origin,
+	const Vector pos[],
+	const Quaternion q[],
+	int iBone,
+	matrix3x4_t bonetoworld[MAXSTUDIOBONES],
+	int boneMask
+	)
+{
+	int i, j;
+
+	int					chain[MAXSTUDIOBONES];
+	int					chainlength = 0;
+
+	if (iBone < -1 || iBone >= pStudioHdr->numbones)
+		iBone = 0;
+
+	mstudiobone_t *pbones		= pStudioHdr->pBone( 0 );
+
+	// build list of what bones to use
+	if (iBone == -1)
+	{
+		// all bones
+		chainlength = pStudioHdr->numbones;
+		for (i = 0; i < pStudioHdr->numbones; i++)
+		{
+			chain[chainlength - i - 1] = i;
+		}
+	}
+	else
+	{
+		// only the parent bones
+		i = iBone;
+		while (i != -1)
+		{
+			chain[chainlength++] = i;
+			i = pbones[i].parent;
+		}
+	}
+
+	matrix3x4_t bonematrix;
+	matrix3x4_t rotationmatrix; // model to world transformation
+	AngleMatrix( angles, origin, rotationmatrix);
+
+	for (j = chainlength - 1; j >= 0; j--)
+	{
+		i = chain[j];
+		if (pbones[i].flags & boneMask)
+		{
+			QuaternionMatrix( q[i], pos[i], bonematrix );
+
+			if (pbones[i].parent == -1)
+			{
+				ConcatTransforms (rotationmatrix, bonematrix, bonetoworld[i]);
+			}
+			else
+			{
+				ConcatTransforms (bonetoworld[pbones[i].parent], bonematrix, bonetoworld[i]);
+			}
+		}
+	}
+}
+
+} // namespace Reference
+
+
+//-----------------------------------------------------------------------------
+// One bone setup: a sequence, a layer on top, and the bone to world matrices
+//-----------------------------------------------------------------------------
+struct BoneSetup_t
+{
+	const studiohdr_t	*m_pStudioHdr;
+	int					m_nSequence;
+	float				m_flCycle;
+	int					m_nLayerSequence;
+	float				m_flLayerCycle;
+	float				m_flLayerWeight;
+	float				m_flPoseParameter[MAXSTUDIOPOSEPARAM];
+	int					m_nBoneMask;
+	int					m_iBone;
+	QAngle				m_angles;
+	Vector				m_origin;
+};
+
+struct BonePose_t
+{
+	Vector				m_pos[MAXSTUDIOBONES];
+	Quaternion			m_q[MAXSTUDIOBONES];
+	matrix3x4_t			m_BoneToWorld[MAXSTUDIOBONES];
+};
+
+static void SetupBones( const BoneSetup_t &setup, BonePose_t &pose )
+{
+	const studiohdr_t *pStudioHdr = setup.m_pStudioHdr;
+	InitPose( pStudioHdr, pose.m_pos, pose.m_q );
+	CalcPose( pStudioHdr, NULL, pose.m_pos, pose.m_q, setup.m_nSequence, setup.m_flCycle, setup.m_flPoseParameter, setup.m_nBoneMask, 1.0f, 0.0f );
+	if ( setup.m_nLayerSequence >= 0 )
+	{
+		AccumulatePose( pStudioHdr, NULL, pose.m_pos, pose.m_q, setup.m_nLayerSequence, setup.m_flLayerCycle, setup.m_flPoseParameter, setup.m_nBoneMask, setup.m_flLayerWeight, 0.0f );
+	}
+	Studio_BuildMatrices( pStudioHdr, setup.m_angles, setup.m_origin, pose.m_pos, pose.m_q, setup.m_iBone, pose.m_BoneToWorld, setup.m_nBoneMask );
+}
+
+static void SetupBonesReference( const BoneSetup_t &setup, BonePose_t &pose )
+{
+	const studiohdr_t *pStudioHdr = setup.m_pStudioHdr;
+	InitPose( pStudioHdr, pose.m_pos, pose.m_q );
+	Reference::CalcPoseSingle( pStudioHdr, pose.m_pos, pose.m_q, setup.m_nSequence, setup.m_flCycle, setup.m_flPoseParameter, setup.m_nBoneMask );
+	if ( setup.m_nLayerSequence >= 0 )
+	{
+		Reference::AccumulatePose( pStudioHdr, pose.m_pos, pose.m_q, setup.m_nLayerSequence, setup.m_flLayerCycle, setup.m_flPoseParameter, setup.m_nBoneMask, setup.m_flLayerWeight );
+	}
+	Reference::Studio_BuildMatrices( pStudioHdr, setup.m_angles, setup.m_origin, pose.m_pos, pose.m_q, setup.m_iBone, pose.m_BoneToWorld, setup.m_nBoneMask );
+}
+
+// Pose parameter values on and just inside the ends of the blend, where
+// CalcPoseSingle switches between one and two animations
+static float RandomPoseParameter( void )
+{
+	static const float s_flEdges[] = { 0.0f, 0.0005f, 0.002f, 0.998f, 0.9995f, 1.0f };
+	if ( RandomInt( 0, 3 ) == 0 )
+		return s_flEdges[ RandomInt( 0, ARRAYSIZE( s_flEdges ) - 1 ) ];
+	return RandomFloat( 0.0f, 1.0f );
+}
+
+static void RandomBoneSetup( const studiohdr_t *pStudioHdr, BoneSetup_t &setup )
+{
+	setup.m_pStudioHdr = pStudioHdr;
+	setup.m_nSequence = RandomInt( 0, pStudioHdr->GetNumSeq() - 1 );
+	setup.m_flCycle = RandomFloat( -0.5f, 1.5f );
+	setup.m_nLayerSequence = RandomInt( 0, 3 ) ? RandomInt( 0, pStudioHdr->GetNumSeq() - 1 ) : -1;
+	setup.m_flLayerCycle = RandomFloat( 0.0f, 1.0f );
+	setup.m_flLayerWeight = RandomInt( 0, 3 ) ? RandomFloat( 0.0f, 1.0f ) : 1.0f;
+	for ( int i = 0; i < MAXSTUDIOPOSEPARAM; ++i )
+	{
+		setup.m_flPoseParameter[i] = RandomPoseParameter();
+	}
+	setup.m_nBoneMask = s_nBoneUsage[ RandomInt( 0, ARRAYSIZE( s_nBoneUsage ) - 1 ) ];
+	setup.m_iBone = RandomInt( 0, 3 ) ? -1 : RandomInt( 0, pStudioHdr->numbones - 1 );
+	setup.m_angles.Init( RandomFloat( -180.0f, 180.0f ), RandomFloat( -180.0f, 180.0f ), RandomFloat( -180.0f, 180.0f ) );
+	RandomVector( 4096.0f, setup.m_origin );
+}
+
+
+//-----------------------------------------------------------------------------
+// The SoA kernels against the per bone math they replaced
+//-----------------------------------------------------------------------------
+#define TEST_ROUNDS			2000
+#define TEST_MODEL_COUNT	64
+#define TEST_SETUPS			200		// per model
+
+static int s_nCases;
+static int s_nFailures;
+
+static void CheckKernels( int nCount )
+{
+	static Vector pos1[MAXSTUDIOBONES], pos2[MAXSTUDIOBONES], expectedPos[MAXSTUDIOBONES];
+	static Quaternion q1[MAXSTUDIOBONES], q2[MAXSTUDIOBONES], expectedQ[MAXSTUDIOBONES];
+	int nBones[MAXSTUDIOBONES];
+	float flWeights[MAXSTUDIOBONES];
+	bool bNoAlign[MAXSTUDIOBONES];
+
+	for ( int i = 0; i < nCount; ++i )
+	{
+		RandomQuaternion( q1[i] );
+		RandomQuaternion( q2[i] );
+
+		// opposite and equal quaternions take their own paths
+		int nCase = RandomInt( 0, 7 );
+		if ( nCase == 0 )
+		{
+			q2[i].Init( -q1[i].x, -q1[i].y, -q1[i].z, -q1[i].w );
+		}
+		else if ( nCase == 1 )
+		{
+			q2[i] = q1[i];
+		}
+		RandomVector( 16.0f, pos1[i] );
+		RandomVector( 16.0f, pos2[i] );
+
+		// scattered, out of order bones
+		nBones[i] = nCount - 1 - i;
+		flWeights[i] = RandomFloat( 0.0f, 1.0f );
+		bNoAlign[i] = RandomInt( 0, 1 ) != 0;
+	}
+
+	// SlerpBones
+	memcpy( expectedPos, pos1, nCount * sizeof( Vector ) );
+	memcpy( expectedQ, q1, nCount * sizeof( Quaternion ) );
+	for ( int n = 0; n < nCount; ++n )
+	{
+		int i = nBones[n];
+		float s2 = flWeights[n];
+		float s1 = 1.0 - s2;
+		Quaternion q3;
+		if ( bNoAlign[n] )
+		{
+			QuaternionSlerpNoAlign( q2[i], expectedQ[i], s1, q3 );
+		}
+		else
+		{
+			QuaternionSlerp( q2[i], expectedQ[i], s1, q3 );
+		}
+		expectedQ[i] = q3;
+		for ( int j = 0; j < 3; ++j )
+		{
+			expectedPos[i][j] = expectedPos[i][j] * s1 + pos2[i][j] * s2;
+		}
+	}
+
+	CBonePoseSoA pose1, pose2;
+	pose1.Gather( pos1, q1, nBones, nCount );
+	pose2.Gather( pos2, q2, nBones, nCount );
+	SlerpBonePoseSoA( pose1, pose2, flWeights, bNoAlign );
+	pose1.Scatter( pos1, q1, nBones );
+	++s_nCases;
+	if ( memcmp( pos1, expectedPos, nCount * sizeof( Vector ) ) || memcmp( q1, expectedQ, nCount * sizeof( Quaternion ) ) )
+	{
+		printf( "SlerpBonePoseSoA, %d bones (seed %u): differs from QuaternionSlerp\n", nCount, s_nRandomSeed );
+		++s_nFailures;
+	}
+
+	// BlendBones
+	float s2 = RandomFloat( 0.0f, 1.0f );
+	float s1 = 1.0 - s2;
+	for ( int n = 0; n < nCount; ++n )
+	{
+		int i = nBones[n];
+		Quaternion q3;
+		if ( bNoAlign[n] )
+		{
+			QuaternionBlendNoAlign( q2[i], expectedQ[i], s1, q3 );
+		}
+		else
+		{
+			QuaternionBlend( q2[i], expectedQ[i], s1, q3 );
+		}
+		expectedQ[i] = q3;
+		for ( int j = 0; j < 3; ++j )
+		{
+			expectedPos[i][j] = expectedPos[i][j] * s1 + pos2[i][j] * s2;
+		}
+	}
+
+	pose1.Gather( pos1, q1, nBones, nCount );
+	BlendBonePoseSoA( pose1, pose2, s2, bNoAlign );
+	pose1.Scatter( pos1, q1, nBones );
+	++s_nCases;
+	if ( memcmp( pos1, expectedPos, nCount * sizeof( Vector ) ) || memcmp( q1, expectedQ, nCount * sizeof( Quaternion ) ) )
+	{
+		printf( "BlendBonePoseSoA, %d bones (seed %u): differs from QuaternionBlend\n", nCount, s_nRandomSeed );
+		++s_nFailures;
+	}
+
+	// Studio_BuildMatrices
+	matrix3x4_t local[MAXSTUDIOBONES];
+	pose1.Gather( pos1, q1, nBones, nCount );
+	BuildBoneMatricesSoA( pose1, local );
+	++s_nCases;
+	for ( int n = 0; n < nCount; ++n )
+	{
+		matrix3x4_t expected;
+		QuaternionMatrix( q1[ nBones[n] ], pos1[ nBones[n] ], expected );
+		if ( memcmp( &expected, &local[n], sizeof( expected ) ) )
+		{
+			printf( "BuildBoneMatricesSoA, %d bones (seed %u): differs from QuaternionMatrix\n", nCount, s_nRandomSeed );
+			++s_nFailures;
+			break;
+		}
+	}
+}
+
+static void CheckBoneSetup( const studiohdr_t *pStudioHdr )
+{
+	static BonePose_t pose, expected;
+	BoneSetup_t setup;
+	RandomBoneSetup( pStudioHdr, setup );
+
+	// bones outside the mask are left alone, start both from the same junk
+	memset( &pose, 0xcd, sizeof( pose ) );
+	memset( &expected, 0xcd, sizeof( expected ) );
+	SetupBones( setup, pose );
+	SetupBonesReference( setup, expected );
+
+	++s_nCases;
+	if ( memcmp( &pose, &expected, sizeof( pose ) ) )
+	{
+		printf( "bone setup, %d bones, sequence %d layer %d (seed %u): differs from the per bone pipeline\n",
+			pStudioHdr->numbones, setup.m_nSequence, setup.m_nLayerSequence, s_nRandomSeed );
+		++s_nFailures;
+	}
+}
+
+static int CheckBoneSetups( void )
+{
+	s_nRandomSeed = 1;
+	s_nCases = 0;
+	s_nFailures = 0;
+	for ( int nRound = 0; nRound < TEST_ROUNDS; ++nRound )
+	{
+		CheckKernels( RandomInt( 1, MAXSTUDIOBONES ) );
+	}
+	printf( "kernels: %d cases, %d mismatches\n", s_nCases, s_nFailures );
+	int nTotalFailures = s_nFailures;
+
+	s_nCases = 0;
+	s_nFailures = 0;
+	for ( int nModel = 0; nModel < TEST_MODEL_COUNT; ++nModel )
+	{
+		TestModelParams_t params;
+		params.m_nBones = RandomInt( 1, MAXSTUDIOBONES );
+		params.m_nSequences = RandomInt( 1, 8 );
+		params.m_nFrames = RandomInt( 1, 40 );
+
+		studiohdr_t *pStudioHdr = CreateTestModel( params );
+		for ( int i = 0; i < TEST_SETUPS; ++i )
+		{
+			CheckBoneSetup( pStudioHdr );
+		}
+		free( pStudioHdr );
+	}
+	printf( "bone setup: %d cases, %d mismatches\n", s_nCases, s_nFailures );
+	nTotalFailures += s_nFailures;
+
+	return nTotalFailures;
+}
+
+
+//-----------------------------------------------------------------------------
+// Bone setup throughput, with the instances interleaved or grouped by model
+//-----------------------------------------------------------------------------
+#define BENCH_MODEL_COUNT		24
+#define BENCH_INSTANCE_COUNT	384
+#define BENCH_MIN_TIME			0.25	// seconds per variant and round
+#define BENCH_ROUNDS			8		// variants take turns, the best round counts
+
+struct BenchInstance_t
+{
+	BoneSetup_t	m_Setup;
+	int			m_nModel;
+	int			m_nIndex;
+	float		m_flRate;
+};
+
+static int BenchInstanceSortFn( const BenchInstance_t *pLeft, const BenchInstance_t *pRight )
+{
+	if ( pLeft->m_nModel != pRight->m_nModel )
+		return pLeft->m_nModel - pRight->m_nModel;
+	return pLeft->m_nIndex - pRight->m_nIndex;
+}
+
+static float s_flBenchChecksum;
+
+static void RunBenchFrame( CUtlVector<BenchInstance_t> &instances, BonePose_t *pPoses, bool bReference )
+{
+	for ( int i = 0; i < instances.Count(); ++i )
+	{
+		BenchInstance_t &instance = instances[i];
+		instance.m_Setup.m_flCycle += instance.m_flRate;
+		instance.m_Setup.m_flCycle -= ( int )instance.m_Setup.m_flCycle;
+		instance.m_Setup.m_flLayerCycle = instance.m_Setup.m_flCycle;
+
+		BonePose_t &pose = pPoses[ instance.m_nIndex ];
+		if ( bReference )
+		{
+			SetupBonesReference( instance.m_Setup, pose );
+		}
+		else
+		{
+			SetupBones( instance.m_Setup, pose );
+		}
+		s_flBenchChecksum += pose.m_BoneToWorld[0][0][3];
+	}
+}
+
+static int BenchBoneSetup( int nModels, char **ppModels )
+{
+	CUtlVector<studiohdr_t *> models;
+	int nBoneCount = 0;
+	int nDataSize = 0;
+	if ( nModels )
+	{
+		for ( int i = 0; i < nModels; ++i )
+		{
+			models.AddToTail( FindOrLoadGroupFile( ppModels[i] ) );
+		}
+	}
+	else
+	{
+		for ( int i = 0; i < BENCH_MODEL_COUNT; ++i )
+		{
+			TestModelParams_t params;
+			params.m_nBones = RandomInt( 48, 96 );
+			params.m_nSequences = 6;
+			params.m_nFrames = RandomInt( 30, 90 );
+			models.AddToTail( CreateTestModel( params ) );
+		}
+	}
+	for ( int i = 0; i < models.Count(); ++i )
+	{
+		nBoneCount += models[i]->numbones;
+		nDataSize += models[i]->length;
+	}
+
+	// The reference pipeline only understands the generated models
+	bool bReference = ( nModels == 0 );
+
+	// Spawned in turn, so neighbours in entity order use different models
+	CUtlVector<BenchInstance_t> instances;
+	for ( int i = 0; i < BENCH_INSTANCE_COUNT; ++i )
+	{
+		BenchInstance_t &instance = instances[ instances.AddToTail() ];
+		instance.m_nModel = i % models.Count();
+		instance.m_nIndex = i;
+		instance.m_flRate = RandomFloat( 0.01f, 0.05f );
+
+		RandomBoneSetup( models[ instance.m_nModel ], instance.m_Setup );
+		instance.m_Setup.m_flCycle = RandomFloat( 0.0f, 1.0f );
+		instance.m_Setup.m_nBoneMask = BONE_USED_BY_ANYTHING;
+		instance.m_Setup.m_iBone = -1;
+		for ( int j = 0; j < MAXSTUDIOPOSEPARAM; ++j )
+		{
+			instance.m_Setup.m_flPoseParameter[j] = 0.5f;
+		}
+	}
+
+	CUtlVector<BenchInstance_t> byModel;
+	byModel.AddVectorToTail( instances );
+	byModel.Sort( BenchInstanceSortFn );
+
+	BonePose_t *pPoses = new BonePose_t[ BENCH_INSTANCE_COUNT ];
+
+	printf( "%d models, %d bones on average, %d KB of model data, %d instances\n",
+		models.Count(), nBoneCount / models.Count(), nDataSize / 1024, BENCH_INSTANCE_COUNT );
+	// [order][reference]
+	double flBest[2][2] = { { 1e30, 1e30 }, { 1e30, 1e30 } };
+	for ( int nRound = 0; nRound < BENCH_ROUNDS; ++nRound )
+	{
+		for ( int nOrder = 0; nOrder < 2; ++nOrder )
+		{
+			for ( int nReference = bReference ? 1 : 0; nReference >= 0; --nReference )
+			{
+				CUtlVector<BenchInstance_t> &order = nOrder ? byModel : instances;
+
+				int nFrames = 0;
+				double flStart = Plat_FloatTime();
+				double flTime;
+				do
+				{
+					RunBenchFrame( order, pPoses, nReference != 0 );
+					++nFrames;
+					flTime = Plat_FloatTime() - flStart;
+				} while ( flTime < BENCH_MIN_TIME );
+
+				flBest[nOrder][nReference] = min( flBest[nOrder][nReference], flTime * 1e6 / ( ( double )nFrames * order.Count() ) );
+			}
+		}
+	}
+
+	printf( "%-12s %-10s %12s\n", "order", "pipeline", "us/setup" );
+	for ( int nOrder = 0; nOrder < 2; ++nOrder )
+	{
+		for ( int nReference = bReference ? 1 : 0; nReference >= 0; --nReference )
+		{
+			printf( "%-12s %-10s %12.2f\n", nOrder ? "by model" : "entity", nReference ? "reference" : "batched", flBest[nOrder][nReference] );
+		}
+	}
+
+	// Keeps the setups from being optimized away
+	printf( "(checksum %f)\n", s_flBenchChecksum );
+	delete[] pPoses;
+	return 0;
+}
+
+
+void Usage( void )
+{
+	printf( "Usage: bonesetupcheck [-bench [-game <dir>] [model.mdl ...]]\n" );
+	exit( -1 );
+}
+
+int main( int argc, char **argv )
+{
+	MathLib_Init( 2.2f, 2.2f, 0.0f, 2.0f );
+	if( argc == 1 )
+	{
+		return CheckBoneSetups();
+	}
+	if( stricmp( argv[1], "-bench" ) != 0 )
+	{
+		Usage();
+	}
+
+	int i = 2;
+	if ( i + 1 < argc && stricmp( argv[i], "-game" ) == 0 )
+	{
+		Q_strncpy( s_szGameDir, argv[i + 1], sizeof( s_szGameDir ) );
+		i += 2;
+	}
+	return BenchBoneSetup( argc - i, argv + i );
+}
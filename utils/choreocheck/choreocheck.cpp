@@ -0,0 +1,484 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Checks that CChoreoScene::Think dispatches events in the same
+//			order with its event time index as it did when it ran EventThink
+//			on every event each frame. Each case generates a scene, then
+//			plays two copies of it with the same frame times, SECTION
+//			pauses, LOOP jumps, reverse playback and event retiming. One
+//			copy uses the index and the other has SetThinkAllEvents on.
+//			Every StartEvent, ProcessEvent, EndEvent and CheckEvent
+//			callback is logged with its time, and the two logs have to
+//			match exactly. The exit code is the number of mismatches.
+//
+//			With -bench it times Think on a long scene with many events,
+//			with and without the index.
+//
+// $NoKeywords: $
+//=============================================================================//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "choreoscene.h"
+#include "choreoevent.h"
+#include "choreoactor.h"
+#include "choreochannel.h"
+#include "ichoreoeventcallback.h"
+#include "mathlib.h"
+#include "tier0/dbg.h"
+#include "tier0/platform.h"
+#include "utlvector.h"
+
+class IFileSystem;
+
+// choreoscene.cpp saves through this, nothing here saves a scene
+IFileSystem *filesystem = NULL;
+
+#define CHECK_CASES				2000
+#define CHECK_MAX_FRAMES		4000
+
+#define BENCH_EVENT_COUNT		2000
+#define BENCH_SCENE_LENGTH		600.0f
+#define BENCH_FRAME_TIME		( 1.0f / 60.0f )
+#define BENCH_ROUNDS			8
+
+
+//-----------------------------------------------------------------------------
+// Repeatable random numbers, so a failure can be reproduced
+//-----------------------------------------------------------------------------
+static unsigned int s_nRandomSeed = 1;
+
+static int RandomInt( int nMin, int nMax )
+{
+	s_nRandomSeed = s_nRandomSeed * 1103515245 + 12345;
+	return nMin + ( int )( ( s_nRandomSeed >> 8 ) % ( unsigned int )( nMax - nMin + 1 ) );
+}
+
+static float RandomFloat( float flMin, float flMax )
+{
+	return flMin + ( flMax - flMin ) * ( RandomInt( 0, 65535 ) / 65535.0f );
+}
+
+
+//-----------------------------------------------------------------------------
+// Generated scenes. Times are snapped to a coarse grid and names are picked
+// from a short list, so plenty of events start together and EventLess has
+// to fall back on end times, channel slots and names to order them.
+//-----------------------------------------------------------------------------
+static const char *s_pEventNames[] = { "a", "b", "c", "d" };
+
+static const CChoreoEvent::EVENTTYPE s_EventTypes[] =
+{
+	CChoreoEvent::EXPRESSION,
+	CChoreoEvent::LOOKAT,
+	CChoreoEvent::MOVETO,
+	CChoreoEvent::SPEAK,
+	CChoreoEvent::SPEAK,
+	CChoreoEvent::GESTURE,
+	CChoreoEvent::SEQUENCE,
+	CChoreoEvent::FACE,
+	CChoreoEvent::FIRETRIGGER,
+	CChoreoEvent::FLEXANIMATION,
+	CChoreoEvent::SUBSCENE,
+	CChoreoEvent::INTERRUPT,
+	CChoreoEvent::PERMIT_RESPONSES,
+	CChoreoEvent::GENERIC,
+	CChoreoEvent::SECTION,
+	CChoreoEvent::LOOP,
+};
+
+struct TestSceneParams_t
+{
+	int		m_nActors;
+	int		m_nChannels;
+	int		m_nEvents;
+	float	m_flLength;
+	float	m_flGrid;
+	bool	m_bPauses;
+};
+
+static void RandomSceneParams( TestSceneParams_t &params )
+{
+	params.m_nActors = RandomInt( 1, 4 );
+	params.m_nChannels = RandomInt( 1, 3 );
+	params.m_nEvents = RandomInt( 1, 120 );
+	params.m_flLength = RandomFloat( 1.0f, 30.0f );
+	params.m_flGrid = RandomInt( 0, 1 ) ? 0.1f : 0.0f;
+	params.m_bPauses = true;
+}
+
+static float RandomSceneTime( const TestSceneParams_t &params )
+{
+	float t = RandomFloat( 0.0f, params.m_flLength );
+	if ( params.m_flGrid > 0.0f )
+	{
+		t = ( int )( t / params.m_flGrid ) * params.m_flGrid;
+	}
+	return t;
+}
+
+static CChoreoScene *CreateTestScene( const TestSceneParams_t &params, IChoreoEventCallback *pCallback )
+{
+	CChoreoScene *pScene = new CChoreoScene( pCallback );
+
+	CUtlVector<CChoreoChannel *> channels;
+	for ( int i = 0; i < params.m_nActors; ++i )
+	{
+		CChoreoActor *pActor = pScene->AllocActor();
+		pActor->SetName( s_pEventNames[ i % ARRAYSIZE( s_pEventNames ) ] );
+		for ( int j = 0; j < params.m_nChannels; ++j )
+		{
+			CChoreoChannel *pChannel = pScene->AllocChannel();
+			pChannel->SetName( s_pEventNames[ j % ARRAYSIZE( s_pEventNames ) ] );
+			pChannel->SetActor( pActor );
+			pActor->AddChannel( pChannel );
+			channels.AddToTail( pChannel );
+		}
+	}
+
+	for ( int i = 0; i < params.m_nEvents; ++i )
+	{
+		CChoreoEvent::EVENTTYPE type = s_EventTypes[ RandomInt( 0, ARRAYSIZE( s_EventTypes ) - 1 ) ];
+		if ( !params.m_bPauses && ( type == CChoreoEvent::SECTION || type == CChoreoEvent::LOOP ) )
+		{
+			type = CChoreoEvent::GENERIC;
+		}
+
+		CChoreoEvent *e = pScene->AllocEvent();
+		e->SetType( type );
+		e->SetName( s_pEventNames[ RandomInt( 0, ARRAYSIZE( s_pEventNames ) - 1 ) ] );
+
+		float flStart = RandomSceneTime( params );
+		e->SetStartTime( flStart );
+
+		// Single fire events have no end time
+		if ( type != CChoreoEvent::SECTION && type != CChoreoEvent::LOOP && type != CChoreoEvent::FIRETRIGGER && RandomInt( 0, 4 ) )
+		{
+			e->SetEndTime( flStart + ( RandomInt( 0, 5 ) ? RandomFloat( 0.0f, params.m_flLength * 0.25f ) : 0.0f ) );
+		}
+		else
+		{
+			e->SetEndTime( -1.0f );
+		}
+
+		if ( type != CChoreoEvent::SECTION && !RandomInt( 0, 9 ) )
+		{
+			e->SetResumeCondition( true );
+		}
+
+		// Events without an actor sort by name only
+		if ( channels.Count() && RandomInt( 0, 7 ) )
+		{
+			CChoreoChannel *pChannel = channels[ RandomInt( 0, channels.Count() - 1 ) ];
+			e->SetChannel( pChannel );
+			e->SetActor( pChannel->GetActor() );
+			pChannel->AddEvent( e );
+		}
+	}
+
+	return pScene;
+}
+
+
+//-----------------------------------------------------------------------------
+// Logs every callback. Events are logged by their position in the scene, so
+// logs from two copies of the same scene can be compared directly.
+//-----------------------------------------------------------------------------
+enum
+{
+	LOG_START = 0,
+	LOG_END,
+	LOG_PROCESS,
+	LOG_CHECK,
+	LOG_FRAME,
+};
+
+struct CallbackLog_t
+{
+	int		m_nType;
+	int		m_nEvent;
+	float	m_flTime;
+};
+
+class CLoggingCallback : public IChoreoEventCallback
+{
+public:
+	CLoggingCallback( void )
+	{
+		m_nFirstEventID = 0;
+		m_bLog = true;
+		m_pPauseEvent = NULL;
+		m_pLoopEvent = NULL;
+	}
+
+	virtual void StartEvent( float currenttime, CChoreoScene *scene, CChoreoEvent *event )
+	{
+		Log( LOG_START, event, currenttime );
+
+		// What CSceneEntity does with these, the driver below acts on them
+		if ( event->GetType() == CChoreoEvent::SECTION )
+		{
+			m_pPauseEvent = event;
+		}
+		else if ( event->GetType() == CChoreoEvent::LOOP )
+		{
+			m_pLoopEvent = event;
+		}
+	}
+
+	virtual void EndEvent( float currenttime, CChoreoScene *scene, CChoreoEvent *event )
+	{
+		Log( LOG_END, event, currenttime );
+	}
+
+	virtual void ProcessEvent( float currenttime, CChoreoScene *scene, CChoreoEvent *event )
+	{
+		Log( LOG_PROCESS, event, currenttime );
+	}
+
+	virtual bool CheckEvent( float currenttime, CChoreoScene *scene, CChoreoEvent *event )
+	{
+		Log( LOG_CHECK, event, currenttime );
+		return ( ( event->GetGlobalID() - m_nFirstEventID + ( int )( currenttime * 10.0f ) ) % 3 ) == 0;
+	}
+
+	void LogFrame( CChoreoScene *pScene )
+	{
+		if ( m_bLog )
+		{
+			CallbackLog_t &entry = m_Log[ m_Log.AddToTail() ];
+			entry.m_nType = LOG_FRAME;
+			entry.m_nEvent = pScene->SimulationFinished() ? 1 : 0;
+			entry.m_flTime = pScene->GetTime();
+		}
+	}
+
+	int							m_nFirstEventID;
+	bool						m_bLog;
+	CChoreoEvent				*m_pPauseEvent;
+	CChoreoEvent				*m_pLoopEvent;
+	CUtlVector<CallbackLog_t>	m_Log;
+
+private:
+	void Log( int nType, CChoreoEvent *event, float currenttime )
+	{
+		if ( m_bLog )
+		{
+			CallbackLog_t &entry = m_Log[ m_Log.AddToTail() ];
+			entry.m_nType = nType;
+			entry.m_nEvent = event->GetGlobalID() - m_nFirstEventID;
+			entry.m_flTime = currenttime;
+		}
+	}
+};
+
+
+//-----------------------------------------------------------------------------
+// Plays a scene the way the game does. All the decisions come from the random
+// stream, so both copies of a scene get the same frames as long as their
+// callbacks agree.
+//-----------------------------------------------------------------------------
+static void PlayTestScene( CChoreoScene *pScene, CLoggingCallback &callback, const TestSceneParams_t &params )
+{
+	bool bForward = RandomInt( 0, 3 ) != 0;
+	pScene->SetSoundFileStartupLatency( RandomInt( 0, 1 ) ? RandomFloat( 0.0f, 0.3f ) : 0.0f );
+	pScene->ResetSimulation( bForward );
+
+	float t = pScene->GetTime();
+
+	int nPausedFrames = 0;
+	int nLoops = 0;
+	for ( int nFrame = 0; nFrame < CHECK_MAX_FRAMES; ++nFrame )
+	{
+		if ( nPausedFrames )
+		{
+			// A SECTION pause holds the scene until its resume conditions are done
+			--nPausedFrames;
+			if ( pScene->CheckEventCompletion() || !nPausedFrames )
+			{
+				pScene->ResumeSimulation();
+				nPausedFrames = 0;
+			}
+			callback.LogFrame( pScene );
+			continue;
+		}
+
+		float dt;
+		switch ( RandomInt( 0, 15 ) )
+		{
+		case 0:
+			// hitch
+			dt = RandomFloat( 0.2f, 2.0f );
+			break;
+		case 1:
+			// Paused game
+			dt = 0.0f;
+			break;
+		default:
+			dt = RandomFloat( 0.005f, 0.1f );
+			break;
+		}
+		t += bForward ? dt : -dt;
+
+		// Retime an event mid-scene, which has to rebuild the index
+		if ( params.m_nEvents && !RandomInt( 0, 31 ) )
+		{
+			CChoreoEvent *e = pScene->GetEvent( RandomInt( 0, pScene->GetNumEvents() - 1 ) );
+			e->OffsetTime( RandomFloat( -1.0f, 1.0f ) );
+		}
+
+		pScene->Think( t );
+		callback.LogFrame( pScene );
+
+		if ( callback.m_pPauseEvent )
+		{
+			callback.m_pPauseEvent = NULL;
+			nPausedFrames = RandomInt( 1, 5 );
+		}
+
+		if ( callback.m_pLoopEvent )
+		{
+			if ( nLoops < 4 )
+			{
+				++nLoops;
+				t = callback.m_pLoopEvent->GetStartTime() - RandomFloat( 0.0f, 3.0f );
+				pScene->LoopToTime( t );
+			}
+			callback.m_pLoopEvent = NULL;
+		}
+
+		if ( pScene->SimulationFinished() )
+			break;
+	}
+}
+
+static int s_nCases;
+static int s_nFailures;
+
+static void CheckScene( void )
+{
+	TestSceneParams_t params;
+	RandomSceneParams( params );
+
+	unsigned int nSeed = s_nRandomSeed;
+
+	CLoggingCallback indexed;
+	indexed.m_nFirstEventID = CChoreoEvent::s_nGlobalID;
+	CChoreoScene *pIndexed = CreateTestScene( params, &indexed );
+	unsigned int nPlaySeed = s_nRandomSeed;
+	PlayTestScene( pIndexed, indexed, params );
+	unsigned int nEndSeed = s_nRandomSeed;
+
+	s_nRandomSeed = nSeed;
+	CLoggingCallback thinkAll;
+	thinkAll.m_nFirstEventID = CChoreoEvent::s_nGlobalID;
+	CChoreoScene *pThinkAll = CreateTestScene( params, &thinkAll );
+	pThinkAll->SetThinkAllEvents( true );
+	Assert( s_nRandomSeed == nPlaySeed );
+	PlayTestScene( pThinkAll, thinkAll, params );
+
+	++s_nCases;
+	int nCount = min( indexed.m_Log.Count(), thinkAll.m_Log.Count() );
+	int nFirst = 0;
+	while ( nFirst < nCount && !memcmp( &indexed.m_Log[nFirst], &thinkAll.m_Log[nFirst], sizeof( CallbackLog_t ) ) )
+	{
+		++nFirst;
+	}
+	if ( nFirst < nCount || indexed.m_Log.Count() != thinkAll.m_Log.Count() || s_nRandomSeed != nEndSeed )
+	{
+		++s_nFailures;
+		printf( "scene, %d events (seed %u): callback %d of %d differs", params.m_nEvents, nSeed, nFirst, thinkAll.m_Log.Count() );
+		if ( nFirst < nCount )
+		{
+			const CallbackLog_t &a = indexed.m_Log[nFirst];
+			const CallbackLog_t &b = thinkAll.m_Log[nFirst];
+			printf( ", indexed %d/%d/%f, every event %d/%d/%f", a.m_nType, a.m_nEvent, a.m_flTime, b.m_nType, b.m_nEvent, b.m_flTime );
+		}
+		printf( "\n" );
+	}
+
+	s_nRandomSeed = nEndSeed;
+	delete pIndexed;
+	delete pThinkAll;
+}
+
+static int CheckScenes( void )
+{
+	s_nCases = 0;
+	s_nFailures = 0;
+	for ( int i = 0; i < CHECK_CASES; ++i )
+	{
+		CheckScene();
+	}
+	printf( "scenes: %d cases, %d mismatches\n", s_nCases, s_nFailures );
+	return s_nFailures;
+}
+
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+static int BenchThink( void )
+{
+	TestSceneParams_t params;
+	params.m_nActors = 8;
+	params.m_nChannels = 4;
+	params.m_nEvents = BENCH_EVENT_COUNT;
+	params.m_flLength = BENCH_SCENE_LENGTH;
+	params.m_flGrid = 0.0f;
+	params.m_bPauses = false;
+
+	int nFrames = ( int )( BENCH_SCENE_LENGTH / BENCH_FRAME_TIME );
+
+	CLoggingCallback callback;
+	callback.m_bLog = false;
+	CChoreoScene *pScene = CreateTestScene( params, &callback );
+
+	printf( "%d events over %.0f seconds, %d frames\n", BENCH_EVENT_COUNT, BENCH_SCENE_LENGTH, nFrames );
+
+	double flBest[2] = { 1e30, 1e30 };
+	for ( int nRound = 0; nRound < BENCH_ROUNDS; ++nRound )
+	{
+		for ( int nThinkAll = 0; nThinkAll < 2; ++nThinkAll )
+		{
+			pScene->SetThinkAllEvents( nThinkAll != 0 );
+			pScene->ResetSimulation( true );
+
+			double flStart = Plat_FloatTime();
+			for ( int i = 1; i <= nFrames; ++i )
+			{
+				pScene->Think( i * BENCH_FRAME_TIME );
+			}
+			double flTime = Plat_FloatTime() - flStart;
+
+			flBest[nThinkAll] = min( flBest[nThinkAll], flTime * 1e6 / nFrames );
+		}
+	}
+
+	printf( "%-14s %12s\n", "think", "us/frame" );
+	printf( "%-14s %12.2f\n", "every event", flBest[1] );
+	printf( "%-14s %12.2f\n", "indexed", flBest[0] );
+
+	delete pScene;
+	return 0;
+}
+
+
+void Usage( void )
+{
+	printf( "Usage: choreocheck [-bench]\n" );
+	exit( -1 );
+}
+
+int main( int argc, char **argv )
+{
+	MathLib_Init( 2.2f, 2.2f, 0.0f, 2.0f );
+	if( argc == 1 )
+	{
+		return CheckScenes();
+	}
+	if( stricmp( argv[1], "-bench" ) != 0 )
+	{
+		Usage();
+	}
+	return BenchThink();
+}
@@ -0,0 +1,466 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Checks the batched collisionutils queries against the single
+//			primitive versions on random inputs. Every batch size from 1 to
+//			TEST_MAX_BATCH is run with the SSE kernels off and, when the CPU
+//			has them, on. Each lane of the result mask (and each t for the
+//			triangle query) has to match the scalar call exactly. The exit
+//			code is the number of mismatches.
+//
+//			With -bench it instead times one ray or box against
+//			BENCH_BOX_COUNT boxes: a loop of scalar calls, the batch with
+//			the scalar kernels, and the batch with SSE.
+//
+// $NoKeywords: $
+//=============================================================================//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "collisionutils.h"
+#include "cmodel.h"
+#include "mathlib.h"
+#include "vector.h"
+#include "tier0/dbg.h"
+#include "tier0/platform.h"
+#include "utlvector.h"
+
+
+//-----------------------------------------------------------------------------
+// Repeatable random numbers, so a failure can be reproduced
+//-----------------------------------------------------------------------------
+static unsigned int s_nRandomSeed = 1;
+
+static int RandomInt( int nMin, int nMax )
+{
+	s_nRandomSeed = s_nRandomSeed * 1103515245 + 12345;
+	return nMin + ( int )( ( s_nRandomSeed >> 8 ) % ( unsigned int )( nMax - nMin + 1 ) );
+}
+
+static float RandomFloat( float flMin, float flMax )
+{
+	return flMin + ( flMax - flMin ) * ( RandomInt( 0, 65535 ) / 65535.0f );
+}
+
+// Whole numbers most of the time, so that faces and rays line up exactly
+// and the equality cases of the compares get exercised
+static float RandomCoord( float flRange )
+{
+	if ( RandomInt( 0, 3 ) != 0 )
+		return ( float )RandomInt( ( int )-flRange, ( int )flRange );
+	return RandomFloat( -flRange, flRange );
+}
+
+static void RandomBox( float flRange, Vector &vecMin, Vector &vecMax )
+{
+	for ( int i = 0; i < 3; ++i )
+	{
+		vecMin[i] = RandomCoord( flRange );
+		vecMax[i] = vecMin[i] + ( RandomInt( 0, 7 ) == 0 ? 0.0f : ( float )RandomInt( 0, ( int )flRange / 4 ) );
+	}
+}
+
+static void RandomRay( float flRange, Vector &vecStart, Vector &vecDelta )
+{
+	for ( int i = 0; i < 3; ++i )
+	{
+		vecStart[i] = RandomCoord( flRange );
+		vecDelta[i] = RandomCoord( flRange * 2.0f );
+
+		// Parallel axes take a different path
+		if ( RandomInt( 0, 3 ) == 0 )
+		{
+			vecDelta[i] = 0.0f;
+		}
+	}
+}
+
+static float RandomTolerance( void )
+{
+	static const float s_Tolerances[] = { 0.0f, 0.0f, 0.03125f, 1.0f };
+	return s_Tolerances[ RandomInt( 0, 3 ) ];
+}
+
+
+//-----------------------------------------------------------------------------
+// Primitives in the batch layouts, along with the same data as vectors
+//-----------------------------------------------------------------------------
+#define TEST_MAX_BATCH		67
+#define TEST_ROUNDS			400
+#define TEST_RANGE			256.0f
+
+struct TestBoxes_t
+{
+	CUtlVector<float> m_Mins[3];
+	CUtlVector<float> m_Maxs[3];
+	CUtlVector<Vector> m_vecMins;
+	CUtlVector<Vector> m_vecMaxs;
+
+	void Generate( int nCount, float flRange )
+	{
+		m_vecMins.SetSize( nCount );
+		m_vecMaxs.SetSize( nCount );
+		for ( int i = 0; i < 3; ++i )
+		{
+			m_Mins[i].SetSize( nCount );
+			m_Maxs[i].SetSize( nCount );
+		}
+		for ( int n = 0; n < nCount; ++n )
+		{
+			RandomBox( flRange, m_vecMins[n], m_vecMaxs[n] );
+			for ( int i = 0; i < 3; ++i )
+			{
+				m_Mins[i][n] = m_vecMins[n][i];
+				m_Maxs[i][n] = m_vecMaxs[n][i];
+			}
+		}
+	}
+
+	void GetArray( CollisionAABBArray_t &boxes )
+	{
+		for ( int i = 0; i < 3; ++i )
+		{
+			boxes.m_pMins[i] = m_Mins[i].Base();
+			boxes.m_pMaxs[i] = m_Maxs[i].Base();
+		}
+		boxes.m_nCount = m_vecMins.Count();
+	}
+};
+
+struct TestOBBs_t
+{
+	CUtlVector<Vector> m_Origins;
+	CUtlVector<QAngle> m_Angles;
+	CUtlVector<Vector> m_Mins;
+	CUtlVector<Vector> m_Maxs;
+
+	void Generate( int nCount, const QAngle &vecShared )
+	{
+		m_Origins.SetSize( nCount );
+		m_Angles.SetSize( nCount );
+		m_Mins.SetSize( nCount );
+		m_Maxs.SetSize( nCount );
+		for ( int n = 0; n < nCount; ++n )
+		{
+			for ( int i = 0; i < 3; ++i )
+			{
+				m_Origins[n][i] = RandomCoord( TEST_RANGE );
+				m_Mins[n][i] = -( float )RandomInt( 1, 64 );
+				m_Maxs[n][i] = ( float )RandomInt( 1, 64 );
+			}
+
+			// Some share the query's orientation, which takes the AABB path
+			if ( RandomInt( 0, 2 ) == 0 )
+			{
+				m_Angles[n] = vecShared;
+			}
+			else
+			{
+				m_Angles[n].Init( RandomFloat( -180, 180 ), RandomFloat( -180, 180 ), RandomFloat( -180, 180 ) );
+			}
+		}
+	}
+
+	void GetArray( CollisionOBBArray_t &boxes )
+	{
+		boxes.m_pOrigins = m_Origins.Base();
+		boxes.m_pAngles = m_Angles.Base();
+		boxes.m_pMins = m_Mins.Base();
+		boxes.m_pMaxs = m_Maxs.Base();
+		boxes.m_nCount = m_Origins.Count();
+	}
+};
+
+struct TestTriangles_t
+{
+	CUtlVector<float> m_Verts[3][3];
+	CUtlVector<Vector> m_vecVerts[3];
+
+	void Generate( int nCount )
+	{
+		for ( int v = 0; v < 3; ++v )
+		{
+			m_vecVerts[v].SetSize( nCount );
+			for ( int i = 0; i < 3; ++i )
+			{
+				m_Verts[v][i].SetSize( nCount );
+			}
+		}
+		for ( int n = 0; n < nCount; ++n )
+		{
+			Vector vecBase;
+			for ( int i = 0; i < 3; ++i )
+			{
+				vecBase[i] = RandomCoord( TEST_RANGE );
+			}
+			for ( int v = 0; v < 3; ++v )
+			{
+				for ( int i = 0; i < 3; ++i )
+				{
+					m_vecVerts[v][n][i] = vecBase[i] + RandomCoord( TEST_RANGE / 2 );
+					m_Verts[v][i][n] = m_vecVerts[v][n][i];
+				}
+			}
+		}
+	}
+
+	void GetArray( CollisionTriangleArray_t &triangles )
+	{
+		for ( int v = 0; v < 3; ++v )
+		{
+			for ( int i = 0; i < 3; ++i )
+			{
+				triangles.m_pVerts[v][i] = m_Verts[v][i].Base();
+			}
+		}
+		triangles.m_nCount = m_vecVerts[0].Count();
+	}
+};
+
+
+//-----------------------------------------------------------------------------
+// Compares a batch result against the scalar results
+//-----------------------------------------------------------------------------
+static int s_nCases;
+static int s_nFailures;
+
+static void CheckMask( const char *pQuery, int nCount, int nHits, const uint32 *pMask, const bool *pExpected )
+{
+	int nExpectedHits = 0;
+	bool bMatch = true;
+	for ( int n = 0; n < nCount; ++n )
+	{
+		nExpectedHits += pExpected[n] ? 1 : 0;
+		bMatch &= ( IsCollisionBatchBitSet( pMask, n ) == pExpected[n] );
+	}
+
+	++s_nCases;
+	if ( !bMatch || ( nHits != nExpectedHits ) )
+	{
+		printf( "%s, %d primitives (seed %u): batch differs from scalar\n", pQuery, nCount, s_nRandomSeed );
+		++s_nFailures;
+	}
+}
+
+static void CheckBatchSize( int nCount )
+{
+	uint32 nMask[ COLLISION_BATCH_MASK_SIZE( TEST_MAX_BATCH ) ];
+	bool bExpected[ TEST_MAX_BATCH ];
+
+	// One ray against N boxes
+	TestBoxes_t boxData;
+	boxData.Generate( nCount, TEST_RANGE );
+	CollisionAABBArray_t boxes;
+	boxData.GetArray( boxes );
+
+	Vector vecStart, vecDelta;
+	RandomRay( TEST_RANGE, vecStart, vecDelta );
+	float flTolerance = RandomTolerance();
+	for ( int n = 0; n < nCount; ++n )
+	{
+		bExpected[n] = IsBoxIntersectingRay( boxData.m_vecMins[n], boxData.m_vecMaxs[n], vecStart, vecDelta, flTolerance );
+	}
+	int nHits = IsBoxIntersectingRayBatch( boxes, vecStart, vecDelta, flTolerance, nMask );
+	CheckMask( "ray/box", nCount, nHits, nMask, bExpected );
+
+	// A swept or unswept box against N boxes
+	Vector vecMins, vecMaxs;
+	RandomBox( 32.0f, vecMins, vecMaxs );
+	vecMins -= vecMaxs;
+	vecMins *= 0.5f;
+	Ray_t ray;
+	ray.Init( vecStart, RandomInt( 0, 3 ) ? vecStart + vecDelta : vecStart, vecMins, -vecMins );
+	for ( int n = 0; n < nCount; ++n )
+	{
+		bExpected[n] = IsBoxIntersectingRay( boxData.m_vecMins[n], boxData.m_vecMaxs[n], ray, flTolerance );
+	}
+	nHits = IsBoxIntersectingRayBatch( boxes, ray, flTolerance, nMask );
+	CheckMask( ray.m_IsSwept ? "swept box/box" : "box/box (unswept ray)", nCount, nHits, nMask, bExpected );
+
+	// A box against N boxes
+	RandomBox( TEST_RANGE, vecMins, vecMaxs );
+	for ( int n = 0; n < nCount; ++n )
+	{
+		bExpected[n] = IsBoxIntersectingBox( vecMins, vecMaxs, boxData.m_vecMins[n], boxData.m_vecMaxs[n] );
+	}
+	nHits = IsBoxIntersectingBoxBatch( boxes, vecMins, vecMaxs, nMask );
+	CheckMask( "box/box", nCount, nHits, nMask, bExpected );
+
+	// An OBB against N OBBs
+	Vector vecOrigin( RandomCoord( TEST_RANGE ), RandomCoord( TEST_RANGE ), RandomCoord( TEST_RANGE ) );
+	QAngle vecAngles( RandomFloat( -180, 180 ), RandomFloat( -180, 180 ), RandomFloat( -180, 180 ) );
+	Vector vecOBBMin( -( float )RandomInt( 1, 64 ), -( float )RandomInt( 1, 64 ), -( float )RandomInt( 1, 64 ) );
+	Vector vecOBBMax( ( float )RandomInt( 1, 64 ), ( float )RandomInt( 1, 64 ), ( float )RandomInt( 1, 64 ) );
+	TestOBBs_t obbData;
+	obbData.Generate( nCount, vecAngles );
+	CollisionOBBArray_t obbs;
+	obbData.GetArray( obbs );
+	for ( int n = 0; n < nCount; ++n )
+	{
+		bExpected[n] = IsOBBIntersectingOBB( vecOrigin, vecAngles, vecOBBMin, vecOBBMax,
+			obbData.m_Origins[n], obbData.m_Angles[n], obbData.m_Mins[n], obbData.m_Maxs[n], flTolerance );
+	}
+	nHits = IsOBBIntersectingOBBBatch( obbs, vecOrigin, vecAngles, vecOBBMin, vecOBBMax, flTolerance, nMask );
+	CheckMask( "obb/obb", nCount, nHits, nMask, bExpected );
+
+	// A ray against N triangles, the t values have to match too
+	TestTriangles_t triData;
+	triData.Generate( nCount );
+	CollisionTriangleArray_t triangles;
+	triData.GetArray( triangles );
+	bool bOneSided = ( RandomInt( 0, 1 ) != 0 );
+	float flT[ TEST_MAX_BATCH ];
+	float flExpectedT[ TEST_MAX_BATCH ];
+	for ( int n = 0; n < nCount; ++n )
+	{
+		flExpectedT[n] = IntersectRayWithTriangle( ray, triData.m_vecVerts[0][n], triData.m_vecVerts[1][n], triData.m_vecVerts[2][n], bOneSided );
+		bExpected[n] = ( flExpectedT[n] >= 0.0f );
+	}
+	nHits = IntersectRayWithTriangleBatch( triangles, ray, bOneSided, flT, nMask );
+	CheckMask( "ray/triangle", nCount, nHits, nMask, bExpected );
+	if ( memcmp( flT, flExpectedT, nCount * sizeof( float ) ) != 0 )
+	{
+		printf( "ray/triangle, %d primitives (seed %u): t differs from scalar\n", nCount, s_nRandomSeed );
+		++s_nFailures;
+	}
+}
+
+static int CheckBatches( void )
+{
+	const CPUInformation &pi = GetCPUInformation();
+	int nTotalFailures = 0;
+	for ( int nSSE = 0; nSSE < 2; ++nSSE )
+	{
+		if ( nSSE && !pi.m_bSSE )
+		{
+			printf( "no SSE on this CPU, SSE kernels not checked\n" );
+			break;
+		}
+
+		MathLib_Init( 2.2f, 2.2f, 0.0f, 2.0f, false, nSSE != 0, false, false );
+		s_nRandomSeed = 1;
+		s_nCases = 0;
+		s_nFailures = 0;
+		for ( int nRound = 0; nRound < TEST_ROUNDS; ++nRound )
+		{
+			for ( int nCount = 1; nCount <= TEST_MAX_BATCH; ++nCount )
+			{
+				CheckBatchSize( nCount );
+			}
+		}
+		printf( "%s: %d cases, %d mismatches\n", MathLib_SSEEnabled() ? "SSE" : "scalar", s_nCases, s_nFailures );
+		nTotalFailures += s_nFailures;
+	}
+
+	return nTotalFailures;
+}
+
+
+//-----------------------------------------------------------------------------
+// Throughput of one query against many boxes
+//-----------------------------------------------------------------------------
+#define BENCH_BOX_COUNT		1024
+#define BENCH_QUERY_COUNT	1024
+#define BENCH_MIN_TIME		0.5		// seconds spent on each variant
+
+enum
+{
+	BENCH_RAY = 0,
+	BENCH_BOX,
+	BENCH_NUM_QUERIES
+};
+
+static const char *s_pBenchQueryNames[BENCH_NUM_QUERIES] = { "ray/box", "box/box" };
+
+static int s_nBenchHits;
+
+static void RunBenchQuery( int nQuery, int nVariant, TestBoxes_t &boxData, const Vector *pStart, const Vector *pDelta )
+{
+	CollisionAABBArray_t boxes;
+	boxData.GetArray( boxes );
+
+	uint32 nMask[ COLLISION_BATCH_MASK_SIZE( BENCH_BOX_COUNT ) ];
+	for ( int q = 0; q < BENCH_QUERY_COUNT; ++q )
+	{
+		if ( nVariant == 0 )
+		{
+			for ( int n = 0; n < BENCH_BOX_COUNT; ++n )
+			{
+				bool bHit = ( nQuery == BENCH_RAY ) ?
+					IsBoxIntersectingRay( boxData.m_vecMins[n], boxData.m_vecMaxs[n], pStart[q], pDelta[q] ) :
+					IsBoxIntersectingBox( boxData.m_vecMins[n], boxData.m_vecMaxs[n], pStart[q], pDelta[q] );
+				s_nBenchHits += bHit ? 1 : 0;
+			}
+		}
+		else if ( nQuery == BENCH_RAY )
+		{
+			s_nBenchHits += IsBoxIntersectingRayBatch( boxes, pStart[q], pDelta[q], 0.0f, nMask );
+		}
+		else
+		{
+			s_nBenchHits += IsBoxIntersectingBoxBatch( boxes, pStart[q], pDelta[q], nMask );
+		}
+	}
+}
+
+static int BenchBatches( void )
+{
+	TestBoxes_t boxData;
+	boxData.Generate( BENCH_BOX_COUNT, 4096.0f );
+
+	// Ray start and delta, or box mins and maxs
+	static Vector s_vecQuery[BENCH_NUM_QUERIES][2][BENCH_QUERY_COUNT];
+	for ( int q = 0; q < BENCH_QUERY_COUNT; ++q )
+	{
+		RandomRay( 4096.0f, s_vecQuery[BENCH_RAY][0][q], s_vecQuery[BENCH_RAY][1][q] );
+		RandomBox( 4096.0f, s_vecQuery[BENCH_BOX][0][q], s_vecQuery[BENCH_BOX][1][q] );
+	}
+
+	static const char *s_pVariantNames[3] = { "scalar calls", "batch", "batch SSE" };
+	printf( "%-10s %-14s %12s\n", "query", "method", "Mtests/s" );
+	for ( int nQuery = 0; nQuery < BENCH_NUM_QUERIES; ++nQuery )
+	{
+		for ( int nVariant = 0; nVariant < 3; ++nVariant )
+		{
+			MathLib_Init( 2.2f, 2.2f, 0.0f, 2.0f, false, nVariant == 2, false, false );
+			if ( ( nVariant == 2 ) && !MathLib_SSEEnabled() )
+				continue;
+
+			int nRuns = 0;
+			double flStart = Plat_FloatTime();
+			double flTime;
+			do
+			{
+				RunBenchQuery( nQuery, nVariant, boxData, s_vecQuery[nQuery][0], s_vecQuery[nQuery][1] );
+				++nRuns;
+				flTime = Plat_FloatTime() - flStart;
+			} while ( flTime < BENCH_MIN_TIME );
+
+			double flTests = ( double )nRuns * BENCH_QUERY_COUNT * BENCH_BOX_COUNT;
+			printf( "%-10s %-14s %12.1f\n", s_pBenchQueryNames[nQuery], s_pVariantNames[nVariant], flTests / flTime * 1e-6 );
+		}
+	}
+
+	// Keeps the scalar loop from being optimized away
+	printf( "(%d hits)\n", s_nBenchHits );
+	return 0;
+}
+
+
+void Usage( void )
+{
+	printf( "Usage: collisioncheck [-bench]\n" );
+	exit( -1 );
+}
+
+int main( int argc, char **argv )
+{
+	if( argc == 1 )
+	{
+		return CheckBatches();
+	}
+	if( stricmp( argv[1], "-bench" ) != 0 )
+	{
+		Usage();
+	}
+	return BenchBatches();
+}
@@ -0,0 +1,755 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Checks the displacement collision queries in dispcoll_common.cpp,
+//			which walk the quantized 4-wide nodes and gather the leafs before
+//			testing triangles, against the recursive walk of the exact node
+//			boxes that they replaced. A copy of the old traversal is kept in
+//			this file and run on the same generated displacements of every
+//			power. Rays, barycentric rays, hull sweeps (long and short) and
+//			point/box intersections are traced through both, and the hit,
+//			fraction, plane, flags, barycentric coordinates and vertex
+//			indices all have to match exactly. The exit code is the number
+//			of mismatches.
+//
+//			With -bench it times every query type through both walks on
+//			BENCH_DISP_COUNT power 4 displacements.
+//
+// $NoKeywords: $
+//=============================================================================//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "cmodel.h"
+#include "dispcoll_common.h"
+#include "collisionutils.h"
+#include "mathlib.h"
+#include "tier0/dbg.h"
+#include "tier0/platform.h"
+#include "utlvector.h"
+
+
+//-----------------------------------------------------------------------------
+// Repeatable random numbers, so a failure can be reproduced
+//-----------------------------------------------------------------------------
+static unsigned int s_nRandomSeed = 1;
+
+static int RandomInt( int nMin, int nMax )
+{
+	s_nRandomSeed = s_nRandomSeed * 1103515245 + 12345;
+	return nMin + ( int )( ( s_nRandomSeed >> 8 ) % ( unsigned int )( nMax - nMin + 1 ) );
+}
+
+static float RandomFloat( float flMin, float flMax )
+{
+	return flMin + ( flMax - flMin ) * ( RandomInt( 0, 65535 ) / 65535.0f );
+}
+
+
+//-----------------------------------------------------------------------------
+// A displacement built straight from a generated height field, that also
+// keeps the exact boxes of every node so the old recursive walk can be run
+// next to the new one.
+//-----------------------------------------------------------------------------
+#define DISP_SPACING		32.0f
+
+class CTestDispCollTree : public CDispCollTree
+{
+public:
+	void Build( int nPower, float flRoughness );
+
+	// The traversal this tree used before the 4-wide nodes.
+	bool Reference_Ray( const Ray_t &ray, CBaseTrace *pTrace, bool bSide );
+	bool Reference_Ray( const Ray_t &ray, RayDispOutput_t &output );
+	bool Reference_SweepAABB( const Ray_t &ray, CBaseTrace *pTrace );
+	bool Reference_IntersectAABB( const Ray_t &ray );
+
+	inline float GetExtent( void )					{ return ( 1 << m_nPower ) * DISP_SPACING; }
+	inline const Vector &GetRandomVert( void )		{ return m_aVerts[RandomInt( 0, m_aVerts.Count() - 1 )]; }
+
+private:
+	void Reference_TreeTrisRayTest_r( const Ray_t &ray, const Vector &vecInvDelta, int iNode, CBaseTrace *pTrace, bool bSide, CDispCollTri **pImpactTri );
+	void Reference_TreeTrisRayBarycentricTest_r( const Ray_t &ray, const Vector &vecInvDelta, int iNode, RayDispOutput_t &output, CDispCollTri **pImpactTri );
+	void Reference_TreeTrisSweepTest_r( const Ray_t &ray, const Vector &vecInvDelta, const Vector &rayDir, int iNode, CBaseTrace *pTrace );
+	bool Reference_SweepAABBBox( const Ray_t &ray, const Vector &rayDir, CBaseTrace *pTrace );
+	void Reference_TreeTrisSweepTestBox_r( const Ray_t &ray, const Vector &rayDir, const Vector &vecMin, const Vector &vecMax, int iNode, CBaseTrace *pTrace );
+	void Reference_BuildTreeTrisIntersect_r( const Ray_t &ray, int iNode, CDispCollTri **ppTreeTris, unsigned short &nTriCount );
+
+	CUtlVector<CDispCollAABBNode>	m_aReferenceNodes;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Lays the verts out on a grid with random heights, triangulated the
+//			way CCoreDispInfo does, then builds the tree like AABBTree_Create.
+//-----------------------------------------------------------------------------
+void CTestDispCollTree::Build( int nPower, float flRoughness )
+{
+	m_nPower = nPower;
+	m_nContents = CONTENTS_SOLID;
+
+	int nWidth = GetWidth();
+	m_aVerts.SetSize( GetSize() );
+	m_aTris.SetSize( GetTriSize() );
+	m_aLeafs.SetSize( Nodes_CalcCount( m_nPower ) - Nodes4_CalcCount( m_nPower ) );
+	m_aNodes4.SetSize( Nodes4_CalcCount( m_nPower ) );
+
+	for ( int y = 0; y < nWidth; ++y )
+	{
+		for ( int x = 0; x < nWidth; ++x )
+		{
+			float flHeight = RandomFloat( 0.0f, flRoughness );
+
+			// The odd cliff.
+			if ( RandomInt( 0, 15 ) == 0 )
+			{
+				flHeight += RandomFloat( -256.0f, 256.0f );
+			}
+
+			m_aVerts[y*nWidth+x].Init( x * DISP_SPACING + RandomFloat( -4.0f, 4.0f ), y * DISP_SPACING, flHeight );
+		}
+	}
+
+	int iTri = 0;
+	for ( int y = 0; y < nWidth - 1; ++y )
+	{
+		for ( int x = 0; x < nWidth - 1; ++x )
+		{
+			int iVert = y * nWidth + x;
+			int iVerts[2][3] = { { iVert, iVert + nWidth, iVert + 1 }, { iVert + 1, iVert + nWidth, iVert + nWidth + 1 } };
+			for ( int i = 0; i < 2; ++i, ++iTri )
+			{
+				for ( int j = 0; j < 3; ++j )
+				{
+					m_aTris[iTri].SetVert( j, iVerts[i][j] );
+				}
+				m_aTris[iTri].CalcPlane( m_aVerts );
+				m_aTris[iTri].FindMinMax( m_aVerts );
+			}
+		}
+	}
+	Cache_TestIt();
+
+	m_vecSurfPoints[0] = m_aVerts[0];
+	m_vecSurfPoints[1] = m_aVerts[nWidth - 1];
+	m_vecSurfPoints[2] = m_aVerts[GetSize() - 1];
+	m_vecSurfPoints[3] = m_aVerts[GetSize() - nWidth];
+
+	AABBTree_CreateLeafs();
+	AABBTree_GenerateBoxes( m_aReferenceNodes );
+	AABBTree_GenerateNodes4( m_aReferenceNodes );
+	AABBTree_CalcBounds();
+}
+
+static void CalcInvDelta( const Ray_t &ray, Vector &vecInvDelta )
+{
+	for ( int iAxis = 0; iAxis < 3; ++iAxis )
+	{
+		if ( ray.m_Delta[iAxis] != 0.0f )
+		{
+			vecInvDelta[iAxis] = 1.0f / ray.m_Delta[iAxis];
+		}
+		else
+		{
+			vecInvDelta[iAxis] = FLT_MAX;
+		}
+	}
+}
+
+bool CTestDispCollTree::Reference_Ray( const Ray_t &ray, CBaseTrace *pTrace, bool bSide )
+{
+	if ( !( m_nContents & MASK_OPAQUE ) )
+		return false;
+
+	CDispCollTri *pImpactTri = NULL;
+
+	Vector vecInvDelta;
+	CalcInvDelta( ray, vecInvDelta );
+
+	if ( IsBoxIntersectingRay( m_aReferenceNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[0],
+		                       m_aReferenceNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[1],
+		                       ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON ) )
+	{
+		Reference_TreeTrisRayTest_r( ray, vecInvDelta, DISPCOLL_ROOTNODE_INDEX, pTrace, bSide, &pImpactTri );
+	}
+
+	if ( pImpactTri )
+	{
+		VectorCopy( pImpactTri->m_vecNormal, pTrace->plane.normal );
+		pTrace->plane.dist = pImpactTri->m_flDist;
+		pTrace->dispFlags = pImpactTri->m_uiFlags;
+		return true;
+	}
+
+	return false;
+}
+
+void CTestDispCollTree::Reference_TreeTrisRayTest_r( const Ray_t &ray, const Vector &vecInvDelta, int iNode, CBaseTrace *pTrace, bool bSide, CDispCollTri **pImpactTri )
+{
+	CDispCollAABBNode &node = m_aReferenceNodes[iNode];
+	if ( node.IsLeaf() )
+	{
+		for ( int i = 0; i < 2; ++i )
+		{
+			CDispCollTri *pTri = &m_aTris[node.m_iTris[i]];
+			float flFrac = IntersectRayWithTriangle( ray, m_aVerts[pTri->GetVert( 0 )], m_aVerts[pTri->GetVert( 2 )], m_aVerts[pTri->GetVert( 1 )], bSide );
+			if( ( flFrac >= 0.0f ) && ( flFrac < pTrace->fraction ) )
+			{
+				pTrace->fraction = flFrac;
+				(*pImpactTri) = pTri;
+			}
+		}
+		return;
+	}
+
+	int iChildNode[4];
+	bool bIntersectChild[4];
+	for ( int i = 0; i < 4; ++i )
+	{
+		iChildNode[i] = Nodes_GetChild( iNode, i );
+		bIntersectChild[i] = IsBoxIntersectingRay( m_aReferenceNodes[iChildNode[i]].m_vecBox[0], m_aReferenceNodes[iChildNode[i]].m_vecBox[1],
+			                                       ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
+	}
+
+	for ( int i = 0; i < 4; ++i )
+	{
+		if ( bIntersectChild[i] )
+		{
+			Reference_TreeTrisRayTest_r( ray, vecInvDelta, iChildNode[i], pTrace, bSide, pImpactTri );
+		}
+	}
+}
+
+bool CTestDispCollTree::Reference_Ray( const Ray_t &ray, RayDispOutput_t &output )
+{
+	if ( !( m_nContents & MASK_OPAQUE ) )
+		return false;
+
+	CDispCollTri *pImpactTri = NULL;
+
+	Vector vecInvDelta;
+	CalcInvDelta( ray, vecInvDelta );
+
+	if ( IsBoxIntersectingRay( m_aReferenceNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[0],
+		                       m_aReferenceNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[1],
+		                       ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON ) )
+	{
+		Reference_TreeTrisRayBarycentricTest_r( ray, vecInvDelta, DISPCOLL_ROOTNODE_INDEX, output, &pImpactTri );
+	}
+
+	if ( pImpactTri )
+	{
+		output.ndxVerts[0] = pImpactTri->GetVert( 0 );
+		output.ndxVerts[1] = pImpactTri->GetVert( 2 );
+		output.ndxVerts[2] = pImpactTri->GetVert( 1 );
+		return true;
+	}
+
+	return false;
+}
+
+void CTestDispCollTree::Reference_TreeTrisRayBarycentricTest_r( const Ray_t &ray, const Vector &vecInvDelta, int iNode, RayDispOutput_t &output, CDispCollTri **pImpactTri )
+{
+	CDispCollAABBNode &node = m_aReferenceNodes[iNode];
+	if ( node.IsLeaf() )
+	{
+		for ( int i = 0; i < 2; ++i )
+		{
+			float flU, flV, flT;
+			CDispCollTri *pTri = &m_aTris[node.m_iTris[i]];
+			if ( ComputeIntersectionBarycentricCoordinates( ray, m_aVerts[pTri->GetVert( 0 )], m_aVerts[pTri->GetVert( 2 )], m_aVerts[pTri->GetVert( 1 )], flU, flV, &flT ) )
+			{
+				if ( ( flU >= 0.0f ) && ( flV >= 0.0f ) && ( ( flU + flV ) <= 1.0f ) )
+				{
+					if( ( flT > 0.0f ) && ( flT < output.dist ) )
+					{
+						(*pImpactTri) = pTri;
+						output.u = flU;
+						output.v = flV;
+						output.dist = flT;
+					}
+				}
+			}
+		}
+		return;
+	}
+
+	int iChildNode[4];
+	bool bIntersectChild[4];
+	for ( int i = 0; i < 4; ++i )
+	{
+		iChildNode[i] = Nodes_GetChild( iNode, i );
+		bIntersectChild[i] = IsBoxIntersectingRay( m_aReferenceNodes[iChildNode[i]].m_vecBox[0], m_aReferenceNodes[iChildNode[i]].m_vecBox[1],
+			                                       ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
+	}
+
+	for ( int i = 0; i < 4; ++i )
+	{
+		if ( bIntersectChild[i] )
+		{
+			Reference_TreeTrisRayBarycentricTest_r( ray, vecInvDelta, iChildNode[i], output, pImpactTri );
+		}
+	}
+}
+
+bool CTestDispCollTree::Reference_SweepAABB( const Ray_t &ray, CBaseTrace *pTrace )
+{
+	Vector rayDir;
+	VectorCopy( ray.m_Delta, rayDir );
+	float flRayLength = VectorNormalize( rayDir );
+	float flExtentLength = ray.m_Extents.Length();
+	if ( flRayLength < ( flExtentLength * 0.5f ) )
+	{
+		return Reference_SweepAABBBox( ray, rayDir, pTrace );
+	}
+
+	float flFrac = pTrace->fraction;
+
+	Vector vecInvDelta;
+	CalcInvDelta( ray, vecInvDelta );
+
+	Vector vecBox[2];
+	VectorSubtract( m_aReferenceNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[0], ray.m_Extents, vecBox[0] );
+	VectorAdd( m_aReferenceNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[1], ray.m_Extents, vecBox[1] );
+	if( IsBoxIntersectingRay( vecBox[0], vecBox[1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON ) )
+	{
+		Reference_TreeTrisSweepTest_r( ray, vecInvDelta, rayDir, DISPCOLL_ROOTNODE_INDEX, pTrace );
+	}
+
+	return ( pTrace->fraction < flFrac );
+}
+
+void CTestDispCollTree::Reference_TreeTrisSweepTest_r( const Ray_t &ray, const Vector &vecInvDelta, const Vector &rayDir, int iNode, CBaseTrace *pTrace )
+{
+	CDispCollAABBNode &node = m_aReferenceNodes[iNode];
+	if ( node.IsLeaf() )
+	{
+		SweepAABBTriIntersect( ray, rayDir, &m_aTris[node.m_iTris[0]], pTrace, false );
+		SweepAABBTriIntersect( ray, rayDir, &m_aTris[node.m_iTris[1]], pTrace, false );
+		return;
+	}
+
+	int iChildNode[4];
+	bool bIntersectChild[4];
+	for ( int i = 0; i < 4; ++i )
+	{
+		iChildNode[i] = Nodes_GetChild( iNode, i );
+
+		Vector vecBox[2];
+		VectorSubtract( m_aReferenceNodes[iChildNode[i]].m_vecBox[0], ray.m_Extents, vecBox[0] );
+		VectorAdd( m_aReferenceNodes[iChildNode[i]].m_vecBox[1], ray.m_Extents, vecBox[1] );
+		bIntersectChild[i] = IsBoxIntersectingRay( vecBox[0], vecBox[1], ray.m_Start, ray.m_Delta, vecInvDelta, DISPCOLL_DIST_EPSILON );
+	}
+
+	for ( int i = 0; i < 4; ++i )
+	{
+		if ( bIntersectChild[i] )
+		{
+			Reference_TreeTrisSweepTest_r( ray, vecInvDelta, rayDir, iChildNode[i], pTrace );
+		}
+	}
+}
+
+bool CTestDispCollTree::Reference_SweepAABBBox( const Ray_t &ray, const Vector &rayDir, CBaseTrace *pTrace )
+{
+	float flFrac = pTrace->fraction;
+
+	Vector vecMin, vecMax;
+	for ( int iAxis = 0; iAxis < 3; ++iAxis )
+	{
+		vecMin[iAxis] = ray.m_Start[iAxis] - ray.m_Extents[iAxis];
+		vecMax[iAxis] = ray.m_Start[iAxis] + ray.m_Extents[iAxis];
+		if ( ray.m_Delta[iAxis] < 0.0f )
+		{
+			vecMin[iAxis] += ray.m_Delta[iAxis];
+		}
+		else
+		{
+			vecMax[iAxis] += ray.m_Delta[iAxis];
+		}
+	}
+
+	if ( IsBoxIntersectingBox( m_aReferenceNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[0], m_aReferenceNodes[DISPCOLL_ROOTNODE_INDEX].m_vecBox[1], vecMin, vecMax ) )
+	{
+		Reference_TreeTrisSweepTestBox_r( ray, rayDir, vecMin, vecMax, DISPCOLL_ROOTNODE_INDEX, pTrace );
+	}
+
+	return ( pTrace->fraction < flFrac );
+}
+
+void CTestDispCollTree::Reference_TreeTrisSweepTestBox_r( const Ray_t &ray, const Vector &rayDir, const Vector &vecMin, const Vector &vecMax, int iNode, CBaseTrace *pTrace )
+{
+	CDispCollAABBNode &node = m_aReferenceNodes[iNode];
+	if ( node.IsLeaf() )
+	{
+		SweepAABBTriIntersect( ray, rayDir, &m_aTris[node.m_iTris[0]], pTrace, false );
+		SweepAABBTriIntersect( ray, rayDir, &m_aTris[node.m_iTris[1]], pTrace, false );
+		return;
+	}
+
+	int iChildNode[4];
+	bool bIntersectChild[4];
+	for ( int i = 0; i < 4; ++i )
+	{
+		iChildNode[i] = Nodes_GetChild( iNode, i );
+		bIntersectChild[i] = IsBoxIntersectingBox( m_aReferenceNodes[iChildNode[i]].m_vecBox[0], m_aReferenceNodes[iChildNode[i]].m_vecBox[1], vecMin, vecMax );
+	}
+
+	for ( int i = 0; i < 4; ++i )
+	{
+		if ( bIntersectChild[i] )
+		{
+			Reference_TreeTrisSweepTestBox_r( ray, rayDir, vecMin, vecMax, iChildNode[i], pTrace );
+		}
+	}
+}
+
+bool CTestDispCollTree::Reference_IntersectAABB( const Ray_t &ray )
+{
+	unsigned short nTreeTriCount = 0;
+	CDispCollTri *aTreeTris[DISPCOLL_TREETRI_SIZE];
+	Reference_BuildTreeTrisIntersect_r( ray, DISPCOLL_ROOTNODE_INDEX, &aTreeTris[0], nTreeTriCount );
+
+	for ( int iTri = 0; iTri < nTreeTriCount; ++iTri )
+	{
+		CDispCollTri *pTri = aTreeTris[iTri];
+
+		cplane_t plane;
+		VectorCopy( pTri->m_vecNormal, plane.normal );
+		plane.dist = pTri->m_flDist;
+		plane.signbits = pTri->m_ucSignBits;
+		plane.type = pTri->m_ucPlaneType;
+
+		if ( IsBoxIntersectingTriangle( ray.m_Start, ray.m_Extents,
+			                            m_aVerts[pTri->GetVert( 0 )],
+			                            m_aVerts[pTri->GetVert( 2 )],
+			                            m_aVerts[pTri->GetVert( 1 )],
+										plane, 0.0f ) )
+			return true;
+	}
+
+	return false;
+}
+
+void CTestDispCollTree::Reference_BuildTreeTrisIntersect_r( const Ray_t &ray, int iNode, CDispCollTri **ppTreeTris, unsigned short &nTriCount )
+{
+	CDispCollAABBNode &node = m_aReferenceNodes[iNode];
+
+	Vector vecMin, vecMax;
+	VectorSubtract( node.m_vecBox[0], ray.m_Extents, vecMin );
+	VectorAdd( node.m_vecBox[1], ray.m_Extents, vecMax );
+	if ( !IsPointInBox( ray.m_Start, vecMin, vecMax ) )
+		return;
+
+	if ( node.IsLeaf() )
+	{
+		if ( nTriCount < DISPCOLL_TREETRI_SIZE )
+		{
+			ppTreeTris[nTriCount] = &m_aTris[node.m_iTris[0]];
+			ppTreeTris[nTriCount+1] = &m_aTris[node.m_iTris[1]];
+			nTriCount += 2;
+		}
+		return;
+	}
+
+	for ( int i = 0; i < 4; ++i )
+	{
+		Reference_BuildTreeTrisIntersect_r( ray, Nodes_GetChild( iNode, i ), ppTreeTris, nTriCount );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Queries. Starts and ends are spread a little past the displacement, some
+// rays are level, straight down or start on a vert, and hulls range from player sized to
+// short moves where the sweep takes its box path.
+//-----------------------------------------------------------------------------
+enum QueryType_t
+{
+	QUERY_RAY = 0,
+	QUERY_RAY_BARYCENTRIC,
+	QUERY_SWEEP,
+	QUERY_INTERSECT,
+
+	QUERY_TYPE_COUNT
+};
+
+static const char *s_pQueryNames[QUERY_TYPE_COUNT] = { "ray", "barycentric", "sweep", "intersect" };
+
+struct Query_t
+{
+	Ray_t	m_Ray;
+	bool	m_bSide;
+};
+
+static void RandomQuery( CTestDispCollTree &tree, QueryType_t nType, Query_t &query )
+{
+	float flExtent = tree.GetExtent();
+	Vector vecStart( RandomFloat( -32.0f, flExtent + 32.0f ), RandomFloat( -32.0f, flExtent + 32.0f ), RandomFloat( -300.0f, 500.0f ) );
+	Vector vecEnd( RandomFloat( -32.0f, flExtent + 32.0f ), RandomFloat( -32.0f, flExtent + 32.0f ), RandomFloat( -300.0f, 500.0f ) );
+	switch ( RandomInt( 0, 4 ) )
+	{
+	case 0:
+		vecEnd.z = vecStart.z;
+		break;
+	case 1:
+		vecEnd = vecStart;
+		vecEnd.z -= RandomFloat( 0.0f, 800.0f );
+		break;
+	case 2:
+		// Short moves, like a player walking.
+		vecEnd = vecStart;
+		vecEnd.x += RandomFloat( -16.0f, 16.0f );
+		vecEnd.y += RandomFloat( -16.0f, 16.0f );
+		vecEnd.z += RandomFloat( -16.0f, 16.0f );
+		break;
+	case 3:
+		// Starts right on a vert, so the node boxes are touched exactly.
+		vecStart = tree.GetRandomVert();
+		vecEnd = vecStart;
+		vecEnd.z -= RandomFloat( 0.0f, 64.0f );
+		break;
+	}
+
+	query.m_bSide = ( RandomInt( 0, 1 ) != 0 );
+	if ( nType == QUERY_RAY || nType == QUERY_RAY_BARYCENTRIC )
+	{
+		query.m_Ray.Init( vecStart, vecEnd );
+	}
+	else if ( nType == QUERY_SWEEP )
+	{
+		float flHalfWidth = RandomFloat( 1.0f, 32.0f );
+		query.m_Ray.Init( vecStart, vecEnd, Vector( -flHalfWidth, -flHalfWidth, 0.0f ), Vector( flHalfWidth, flHalfWidth, RandomFloat( 1.0f, 72.0f ) ) );
+	}
+	else if ( RandomInt( 0, 3 ) == 0 )
+	{
+		query.m_Ray.Init( vecStart, vecStart );
+	}
+	else
+	{
+		Vector vecMins( -RandomFloat( 0.0f, 48.0f ), -RandomFloat( 0.0f, 48.0f ), -RandomFloat( 0.0f, 48.0f ) );
+		Vector vecMaxs( RandomFloat( 0.0f, 48.0f ), RandomFloat( 0.0f, 48.0f ), RandomFloat( 0.0f, 48.0f ) );
+		query.m_Ray.Init( vecStart, vecStart, vecMins, vecMaxs );
+	}
+}
+
+struct QueryResult_t
+{
+	bool	m_bHit;
+	float	m_flFraction;
+	Vector	m_vecNormal;
+	float	m_flDist;
+	int		m_nFlags;
+	float	m_flU;
+	float	m_flV;
+	int		m_nVerts[3];
+};
+
+static void RunQuery( CTestDispCollTree &tree, QueryType_t nType, const Query_t &query, bool bReference, QueryResult_t &result )
+{
+	memset( &result, 0, sizeof( result ) );
+
+	CBaseTrace trace;
+	memset( &trace, 0, sizeof( trace ) );
+	trace.fraction = 1.0f;
+
+	switch ( nType )
+	{
+	case QUERY_RAY:
+		result.m_bHit = bReference ? tree.Reference_Ray( query.m_Ray, &trace, query.m_bSide ) : tree.AABBTree_Ray( query.m_Ray, &trace, query.m_bSide );
+		break;
+
+	case QUERY_RAY_BARYCENTRIC:
+		{
+			RayDispOutput_t output;
+			memset( &output, 0, sizeof( output ) );
+			output.dist = 1.0f;
+			result.m_bHit = bReference ? tree.Reference_Ray( query.m_Ray, output ) : tree.AABBTree_Ray( query.m_Ray, output );
+			result.m_flFraction = output.dist;
+			result.m_flU = output.u;
+			result.m_flV = output.v;
+			for ( int i = 0; i < 3; ++i )
+			{
+				result.m_nVerts[i] = output.ndxVerts[i];
+			}
+			return;
+		}
+
+	case QUERY_SWEEP:
+		result.m_bHit = bReference ? tree.Reference_SweepAABB( query.m_Ray, &trace ) : tree.AABBTree_SweepAABB( query.m_Ray, &trace );
+		break;
+
+	case QUERY_INTERSECT:
+		result.m_bHit = bReference ? tree.Reference_IntersectAABB( query.m_Ray ) : tree.AABBTree_IntersectAABB( query.m_Ray );
+		return;
+	}
+
+	result.m_flFraction = trace.fraction;
+	result.m_vecNormal = trace.plane.normal;
+	result.m_flDist = trace.plane.dist;
+	result.m_nFlags = trace.dispFlags;
+}
+
+
+//-----------------------------------------------------------------------------
+// New walk vs. old walk
+//-----------------------------------------------------------------------------
+#define CHECK_DISPS_PER_POWER	8
+#define CHECK_QUERY_COUNT		4000	// per displacement and query type
+
+static int s_nCases;
+static int s_nFailures;
+
+static int CheckDispCollision( void )
+{
+	s_nRandomSeed = 1;
+	s_nCases = 0;
+	s_nFailures = 0;
+
+	int nHits = 0;
+	for ( int nPower = 1; nPower <= 4; ++nPower )
+	{
+		for ( int iDisp = 0; iDisp < CHECK_DISPS_PER_POWER; ++iDisp )
+		{
+			CTestDispCollTree tree;
+			tree.Build( nPower, ( iDisp & 1 ) ? 32.0f : 256.0f );
+
+			for ( int nType = 0; nType < QUERY_TYPE_COUNT; ++nType )
+			{
+				for ( int i = 0; i < CHECK_QUERY_COUNT; ++i )
+				{
+					unsigned int nSeed = s_nRandomSeed;
+
+					Query_t query;
+					RandomQuery( tree, ( QueryType_t )nType, query );
+
+					QueryResult_t result, reference;
+					RunQuery( tree, ( QueryType_t )nType, query, false, result );
+					RunQuery( tree, ( QueryType_t )nType, query, true, reference );
+
+					++s_nCases;
+					if ( result.m_bHit )
+					{
+						++nHits;
+					}
+					if ( memcmp( &result, &reference, sizeof( result ) ) != 0 )
+					{
+						printf( "%s, power %d (seed %u): hit %d fraction %f, expected hit %d fraction %f\n",
+							s_pQueryNames[nType], nPower, nSeed, result.m_bHit, result.m_flFraction, reference.m_bHit, reference.m_flFraction );
+						++s_nFailures;
+					}
+				}
+			}
+		}
+	}
+
+	printf( "%d cases, %d hits, %d mismatches\n", s_nCases, nHits, s_nFailures );
+	return s_nFailures;
+}
+
+
+//-----------------------------------------------------------------------------
+// Query throughput on power 4 displacements
+//-----------------------------------------------------------------------------
+#define BENCH_DISP_COUNT		16
+#define BENCH_QUERY_COUNT		1024	// per displacement and query type
+#define BENCH_MIN_TIME			0.25	// seconds per variant and round
+#define BENCH_ROUNDS			8		// variants take turns, the best round counts
+
+static int s_nBenchHits;
+
+static void RunBenchQueries( CTestDispCollTree *pTrees, CUtlVector<Query_t> *pQueries, QueryType_t nType, bool bReference )
+{
+	for ( int iDisp = 0; iDisp < BENCH_DISP_COUNT; ++iDisp )
+	{
+		CUtlVector<Query_t> &queries = pQueries[iDisp * QUERY_TYPE_COUNT + nType];
+		for ( int i = 0; i < queries.Count(); ++i )
+		{
+			QueryResult_t result;
+			RunQuery( pTrees[iDisp], nType, queries[i], bReference, result );
+			s_nBenchHits += result.m_bHit;
+		}
+	}
+}
+
+static int BenchDispCollision( void )
+{
+	s_nRandomSeed = 1;
+
+	CTestDispCollTree *pTrees = new CTestDispCollTree[ BENCH_DISP_COUNT ];
+	CUtlVector<Query_t> *pQueries = new CUtlVector<Query_t>[ BENCH_DISP_COUNT * QUERY_TYPE_COUNT ];
+	for ( int iDisp = 0; iDisp < BENCH_DISP_COUNT; ++iDisp )
+	{
+		pTrees[iDisp].Build( 4, ( iDisp & 1 ) ? 32.0f : 256.0f );
+		for ( int nType = 0; nType < QUERY_TYPE_COUNT; ++nType )
+		{
+			CUtlVector<Query_t> &queries = pQueries[iDisp * QUERY_TYPE_COUNT + nType];
+			queries.SetSize( BENCH_QUERY_COUNT );
+			for ( int i = 0; i < BENCH_QUERY_COUNT; ++i )
+			{
+				RandomQuery( pTrees[iDisp], ( QueryType_t )nType, queries[i] );
+			}
+		}
+	}
+
+	printf( "%d power 4 displacements, %d queries of each type per displacement\n", BENCH_DISP_COUNT, BENCH_QUERY_COUNT );
+
+	// [type][reference]
+	double flBest[QUERY_TYPE_COUNT][2];
+	for ( int nType = 0; nType < QUERY_TYPE_COUNT; ++nType )
+	{
+		flBest[nType][0] = flBest[nType][1] = 1e30;
+	}
+
+	for ( int nRound = 0; nRound < BENCH_ROUNDS; ++nRound )
+	{
+		for ( int nType = 0; nType < QUERY_TYPE_COUNT; ++nType )
+		{
+			for ( int nReference = 1; nReference >= 0; --nReference )
+			{
+				int nPasses = 0;
+				double flStart = Plat_FloatTime();
+				double flTime;
+				do
+				{
+					RunBenchQueries( pTrees, pQueries, ( QueryType_t )nType, nReference != 0 );
+					++nPasses;
+					flTime = Plat_FloatTime() - flStart;
+				} while ( flTime < BENCH_MIN_TIME );
+
+				flBest[nType][nReference] = min( flBest[nType][nReference], flTime * 1e9 / ( ( double )nPasses * BENCH_DISP_COUNT * BENCH_QUERY_COUNT ) );
+			}
+		}
+	}
+
+	printf( "%-12s %14s %14s %8s\n", "query", "old ns/query", "new ns/query", "speedup" );
+	for ( int nType = 0; nType < QUERY_TYPE_COUNT; ++nType )
+	{
+		printf( "%-12s %14.1f %14.1f %7.2fx\n", s_pQueryNames[nType], flBest[nType][1], flBest[nType][0], flBest[nType][1] / flBest[nType][0] );
+	}
+
+	// Keeps the queries from being optimized away
+	printf( "(%d hits)\n", s_nBenchHits );
+	delete[] pQueries;
+	delete[] pTrees;
+	return 0;
+}
+
+
+void Usage( void )
+{
+	printf( "Usage: dispcollcheck [-bench]\n" );
+	exit( -1 );
+}
+
+int main( int argc, char **argv )
+{
+	MathLib_Init( 2.2f, 2.2f, 0.0f, 2.0f );
+	if( argc == 1 )
+	{
+		return CheckDispCollision();
+	}
+	if( stricmp( argv[1], "-bench" ) != 0 )
+	{
+		Usage();
+	}
+	return BenchDispCollision();
+}
@@ -0,0 +1,995 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Checks ImageLoader::ConvertImageFormat against the byte at a time
+//			converters it used before they were changed to move whole pixels.
+//			Every pair of uncompressed formats is run over random images of
+//			several widths, packed and with padded strides, and the output has
+//			to match byte for byte. The exit code is the number of mismatches.
+//
+//			With -dxt it instead measures the DXT encoders: RMSE after a
+//			round trip and throughput of ConvertImageFormat (the S3TC library
+//			on Win32) and of EncodeDXT at each quality, over the given .tga
+//			files or a few generated images.
+//
+// $NoKeywords: $
+//=============================================================================//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "imageloader.h"
+#include "tgaloader.h"
+#include "tier0/dbg.h"
+#include "tier0/platform.h"
+#include "mathlib.h"
+#include "utlmemory.h"
+
+
+//-----------------------------------------------------------------------------
+// The converters as they were, kept verbatim so the output can be compared
+//-----------------------------------------------------------------------------
+namespace Reference
+{
+
+typedef void (*UserFormatToRGBA8888Func_t )( unsigned char *src, unsigned char *dst, int numPixels );
+typedef void (*RGBA8888ToUserFormatFunc_t )( unsigned char *src, unsigned char *dst, int numPixels );
+
+void RGBA8888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	memcpy( dst, src, 4 * numPixels );
+}
+
+void RGBA8888ToABGR8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 4 )
+	{
+		dst[0] = src[3];
+		dst[1] = src[2];
+		dst[2] = src[1];
+		dst[3] = src[0];
+	}
+}
+
+void RGBA8888ToRGB888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 3 )
+	{
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+	}
+}
+
+void RGBA8888ToBGR888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 3 )
+	{
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = src[0];
+	}
+}
+
+void RGBA8888ToRGB565( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	Assert( 0 );
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 2 )
+	{
+	}
+}
+
+void RGBA8888ToI8( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 1 )
+	{
+		dst[0] = ( unsigned char )( 0.299f * src[0] + 0.587f * src[1] + 0.114f * src[2] );
+	}
+}
+
+void RGBA8888ToIA88( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	// fixme: need to find the proper rgb weighting
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 2 )
+	{
+		dst[0] = ( unsigned char )( 0.299f * src[0] + 0.587f * src[1] + 0.114f * src[2] );
+		dst[1] = src[3];
+	}
+}
+
+void RGBA8888ToP8( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	Assert( 0 );
+}
+
+void RGBA8888ToA8( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 1 )
+	{
+		dst[0] = src[3];
+	}
+}
+
+void RGBA8888ToRGB888_BLUESCREEN( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 3 )
+	{
+		if( src[3] == 0 )
+		{
+			dst[0] = 0;
+			dst[1] = 0;
+			dst[2] = 255;
+		}
+		else
+		{
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+		}
+	}
+}
+
+void RGBA8888ToBGR888_BLUESCREEN( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 3 )
+	{
+		if( src[3] == 0 )
+		{
+			dst[2] = 0;
+			dst[1] = 0;
+			dst[0] = 255;
+		}
+		else
+		{
+			dst[2] = src[0];
+			dst[1] = src[1];
+			dst[0] = src[2];
+		}
+	}
+}
+
+void RGBA8888ToARGB8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 4 )
+	{
+		dst[0] = src[3];
+		dst[1] = src[0];
+		dst[2] = src[1];
+		dst[3] = src[2];
+	}
+}
+
+void RGBA8888ToBGRA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 4 )
+	{
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = src[0];
+		dst[3] = src[3];
+	}
+}
+
+void RGBA8888ToBGRX8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 4 )
+	{
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = src[0];
+	}
+}
+
+void RGBA8888ToBGR565( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned short* pDstShort = (unsigned short*)dst;
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, pDstShort ++ )
+	{
+		*pDstShort = ((src[0] >> 3) << 11) |
+					 ((src[1] >> 2) << 5) |
+					  (src[2] >> 3);
+	}
+}
+
+void RGBA8888ToBGRX5551( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned short* pDstShort = (unsigned short*)dst;
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, pDstShort ++ )
+	{
+		*pDstShort = ((src[0] >> 3) << 10) |
+					 ((src[1] >> 3) << 5) |
+					  (src[2] >> 3);
+	}
+}
+
+void RGBA8888ToBGRA5551( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned short* pDstShort = (unsigned short*)dst;
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, pDstShort ++ )
+	{
+		*pDstShort = ((src[0] >> 3) << 10) |
+					 ((src[1] >> 3) << 5) |
+					  (src[2] >> 3) |
+					  (src[3] >> 7) << 15;
+	}
+}
+
+void RGBA8888ToBGRA4444( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned short* pDstShort = (unsigned short*)dst;
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, pDstShort ++ )
+	{
+		*pDstShort = ((src[0] >> 4) << 8) |
+					 ((src[1] >> 4) << 4) |
+					  (src[2] >> 4) |
+					 ((src[3] >> 4) << 12);
+	}
+}
+
+void RGBA8888ToUV88( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 2 )
+	{
+		dst[0] = src[0];
+		dst[1] = src[1];
+	}
+}
+
+void RGBA8888ToUVWQ8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	RGBA8888ToRGBA8888( src, dst, numPixels );
+}
+
+void RGBA8888ToUVLX8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	RGBA8888ToRGBA8888( src, dst, numPixels );
+}
+
+void ABGR8888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 4 )
+	{
+		dst[0] = src[3];
+		dst[1] = src[2];
+		dst[2] = src[1];
+		dst[3] = src[0];
+	}
+}
+
+void RGB888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 3;
+	for( ; src < endSrc; src += 3, dst += 4 )
+	{
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+		dst[3] = 255;
+	}
+}
+
+void BGR888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 3;
+	for( ; src < endSrc; src += 3, dst += 4 )
+	{
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = src[0];
+		dst[3] = 255;
+	}
+}
+
+void RGB565ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	Assert( 0 );
+	unsigned char *endSrc = src + numPixels * 2;
+	for( ; src < endSrc; src += 2, dst += 4 )
+	{
+	}
+}
+
+void I8ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels;
+	for( ; src < endSrc; src += 1, dst += 4 )
+	{
+		dst[0] = src[0];
+		dst[1] = src[0];
+		dst[2] = src[0];
+		dst[3] = 255;
+	}
+}
+
+void IA88ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 2;
+	for( ; src < endSrc; src += 2, dst += 4 )
+	{
+		dst[0] = src[0];
+		dst[1] = src[0];
+		dst[2] = src[0];
+		dst[3] = src[1];
+	}
+}
+
+void P8ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	Assert( 0 );
+}
+
+void A8ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels;
+	for( ; src < endSrc; src += 1, dst += 4 )
+	{
+		dst[0] = 255;
+		dst[1] = 255;
+		dst[2] = 255;
+		dst[3] = src[0];
+	}
+}
+
+void RGB888_BLUESCREENToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 3;
+	for( ; src < endSrc; src += 3, dst += 4 )
+	{
+		if( src[0] == 0 && src[1] == 0 && src[2] == 255 )
+		{
+			dst[0] = 0;
+			dst[1] = 0;
+			dst[2] = 0;
+			dst[3] = 0;
+		}
+		else
+		{
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+			dst[3] = 255;
+		}
+	}
+}
+
+void BGR888_BLUESCREENToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 3;
+	for( ; src < endSrc; src += 3, dst += 4 )
+	{
+		if( src[2] == 0 && src[1] == 0 && src[0] == 255 )
+		{
+			dst[0] = 0;
+			dst[1] = 0;
+			dst[2] = 0;
+			dst[3] = 0;
+		}
+		else
+		{
+			dst[2] = src[0];
+			dst[1] = src[1];
+			dst[0] = src[2];
+			dst[3] = 255;
+		}
+	}
+}
+
+void ARGB8888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 4 )
+	{
+		dst[0] = src[1];
+		dst[1] = src[2];
+		dst[2] = src[3];
+		dst[3] = src[0];
+	}
+}
+
+void BGRA8888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 4 )
+	{
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = src[0];
+		dst[3] = src[3];
+	}
+}
+
+void BGRX8888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char *endSrc = src + numPixels * 4;
+	for( ; src < endSrc; src += 4, dst += 4 )
+	{
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = src[0];
+		dst[3] = 255;
+	}
+}
+
+void BGR565ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned short* pSrcShort = (unsigned short*)src;
+	unsigned short* pEndSrc = pSrcShort + numPixels;
+	for( ; pSrcShort < pEndSrc; pSrcShort++, dst += 4 )
+	{
+		int blue = (*pSrcShort & 0x1F);
+		int green = (*pSrcShort >> 5) & 0x3F;
+		int red = (*pSrcShort >> 11) & 0x1F;
+
+		// Expand to 8 bits
+		dst[0] = (red << 3) | (red >> 2);
+		dst[1] = (green << 2) | (green >> 4);
+		dst[2] = (blue << 3) | (blue >> 2);
+		dst[3] = 255;
+	}
+}
+
+void BGRX5551ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned short* pSrcShort = (unsigned short*)src;
+	unsigned short* pEndSrc = pSrcShort + numPixels;
+	for( ; pSrcShort < pEndSrc; pSrcShort++, dst += 4 )
+	{
+		int blue = (*pSrcShort & 0x1F);
+		int green = (*pSrcShort >> 5) & 0x1F;
+		int red = (*pSrcShort >> 10) & 0x1F;
+
+		// Expand to 8 bits
+		dst[0] = (red << 3) | (red >> 2);
+		dst[1] = (green << 3) | (green >> 2);
+		dst[2] = (blue << 3) | (blue >> 2);
+		dst[3] = 255;
+	}
+}
+
+void BGRA5551ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned short* pSrcShort = (unsigned short*)src;
+	unsigned short* pEndSrc = pSrcShort + numPixels;
+	for( ; pSrcShort < pEndSrc; pSrcShort++, dst += 4 )
+	{
+		int blue = (*pSrcShort & 0x1F);
+		int green = (*pSrcShort >> 5) & 0x1F;
+		int red = (*pSrcShort >> 10) & 0x1F;
+		int alpha = *pSrcShort & ( 1 << 15 );
+
+		// Expand to 8 bits
+		dst[0] = (red << 3) | (red >> 2);
+		dst[1] = (green << 3) | (green >> 2);
+		dst[2] = (blue << 3) | (blue >> 2);
+		// garymcthack
+		if( alpha )
+		{
+			dst[3] = 255;
+		}
+		else
+		{
+			dst[3] = 0;
+		}
+	}
+}
+
+void BGRA4444ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned short* pSrcShort = (unsigned short*)src;
+	unsigned short* pEndSrc = pSrcShort + numPixels;
+	for( ; pSrcShort < pEndSrc; pSrcShort++, dst += 4 )
+	{
+		int blue = (*pSrcShort & 0xF);
+		int green = (*pSrcShort >> 4) & 0xF;
+		int red = (*pSrcShort >> 8) & 0xF;
+		int alpha = (*pSrcShort >> 12) & 0xF;
+
+		// Expand to 8 bits
+		// FIXME: shouldn't this be (red << 4) | red?
+		dst[0] = (red << 4) | (red >> 4);
+		dst[1] = (green << 4) | (green >> 4);
+		dst[2] = (blue << 4) | (blue >> 4);
+		dst[3] = (alpha << 4) | (alpha >> 4);
+	}
+}
+
+void UV88ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	unsigned char* pEndSrc = src + numPixels * 2;
+	for( ; src < pEndSrc; src += 2, dst += 4 )
+	{
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = 0;
+		dst[3] = 0;
+	}
+}
+
+void UVWQ8888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	RGBA8888ToRGBA8888( src, dst, numPixels );
+}
+
+void UVLX8888ToRGBA8888( unsigned char *src, unsigned char *dst, int numPixels )
+{
+	RGBA8888ToRGBA8888( src, dst, numPixels );
+}
+
+static UserFormatToRGBA8888Func_t GetUserFormatToRGBA8888Func_t( ImageFormat srcImageFormat )
+{
+	switch( srcImageFormat )
+	{
+	case IMAGE_FORMAT_RGBA8888:
+		return RGBA8888ToRGBA8888;
+	case IMAGE_FORMAT_ABGR8888:
+		return ABGR8888ToRGBA8888;
+	case IMAGE_FORMAT_RGB888:
+		return RGB888ToRGBA8888;
+	case IMAGE_FORMAT_BGR888:
+		return BGR888ToRGBA8888;
+	case IMAGE_FORMAT_RGB565:
+		return NULL;
+//			return RGB565ToRGBA8888;
+	case IMAGE_FORMAT_I8:
+		return I8ToRGBA8888;
+	case IMAGE_FORMAT_IA88:
+		return IA88ToRGBA8888;
+	case IMAGE_FORMAT_P8:
+		return NULL;
+//			return P8ToRGBA8888;
+	case IMAGE_FORMAT_A8:
+		return A8ToRGBA8888;
+	case IMAGE_FORMAT_RGB888_BLUESCREEN:
+		return RGB888_BLUESCREENToRGBA8888;
+	case IMAGE_FORMAT_BGR888_BLUESCREEN:
+		return BGR888_BLUESCREENToRGBA8888;
+	case IMAGE_FORMAT_ARGB8888:
+		return ARGB8888ToRGBA8888;
+	case IMAGE_FORMAT_BGRA8888:
+		return BGRA8888ToRGBA8888;
+	case IMAGE_FORMAT_BGRX8888:
+		return BGRX8888ToRGBA8888;
+	case IMAGE_FORMAT_BGR565:
+		return BGR565ToRGBA8888;
+	case IMAGE_FORMAT_BGRX5551:
+		return BGRX5551ToRGBA8888;
+	case IMAGE_FORMAT_BGRA5551:
+		return BGRA5551ToRGBA8888;
+	case IMAGE_FORMAT_BGRA4444:
+		return BGRA4444ToRGBA8888;
+	case IMAGE_FORMAT_UV88:
+		return UV88ToRGBA8888;
+	case IMAGE_FORMAT_UVWQ8888:
+		return UVWQ8888ToRGBA8888;
+	case IMAGE_FORMAT_UVLX8888:
+		return UVLX8888ToRGBA8888;
+	case IMAGE_FORMAT_RGBA16161616F:
+		return NULL;
+		//		return RGBA16161616FToRGBA8888;
+	default:
+		return NULL;
+	}
+}
+
+static RGBA8888ToUserFormatFunc_t GetRGBA8888ToUserFormatFunc_t( ImageFormat dstImageFormat )
+{
+	switch( dstImageFormat )
+	{
+	case IMAGE_FORMAT_RGBA8888:
+		return RGBA8888ToRGBA8888;
+	case IMAGE_FORMAT_ABGR8888:
+		return RGBA8888ToABGR8888;
+	case IMAGE_FORMAT_RGB888:
+		return RGBA8888ToRGB888;
+	case IMAGE_FORMAT_BGR888:
+		return RGBA8888ToBGR888;
+	case IMAGE_FORMAT_RGB565:
+		return NULL;
+//			return RGBA8888ToRGB565;
+	case IMAGE_FORMAT_I8:
+		return RGBA8888ToI8;
+	case IMAGE_FORMAT_IA88:
+		return RGBA8888ToIA88;
+	case IMAGE_FORMAT_P8:
+		return NULL;
+//			return RGBA8888ToP8;
+	case IMAGE_FORMAT_A8:
+		return RGBA8888ToA8;
+	case IMAGE_FORMAT_RGB888_BLUESCREEN:
+		return RGBA8888ToRGB888_BLUESCREEN;
+	case IMAGE_FORMAT_BGR888_BLUESCREEN:
+		return RGBA8888ToBGR888_BLUESCREEN;
+	case IMAGE_FORMAT_ARGB8888:
+		return RGBA8888ToARGB8888;
+	case IMAGE_FORMAT_BGRA8888:
+		return RGBA8888ToBGRA8888;
+	case IMAGE_FORMAT_BGRX8888:
+		return RGBA8888ToBGRX8888;
+	case IMAGE_FORMAT_BGR565:
+		return RGBA8888ToBGR565;
+	case IMAGE_FORMAT_BGRX5551:
+		return RGBA8888ToBGRX5551;
+	case IMAGE_FORMAT_BGRA5551:
+		return RGBA8888ToBGRA5551;
+	case IMAGE_FORMAT_BGRA4444:
+		return RGBA8888ToBGRA4444;
+	case IMAGE_FORMAT_UV88:
+		return RGBA8888ToUV88;
+	case IMAGE_FORMAT_UVWQ8888:
+		return RGBA8888ToUVWQ8888;
+	case IMAGE_FORMAT_UVLX8888:
+		return RGBA8888ToUVLX8888;
+	case IMAGE_FORMAT_RGBA16161616F:
+		return NULL;
+//		return RGBA8888ToRGBA16161616F;
+	default:
+		return NULL;
+	}
+}
+
+// The uncompressed path of ImageLoader::ConvertImageFormat
+static bool ConvertImageFormat( unsigned char *src, ImageFormat srcImageFormat,
+								unsigned char *dst, ImageFormat dstImageFormat, 
+								int width, int height, int srcStride, int dstStride )
+{
+	int line;
+	int srcPixelSize = ImageLoader::SizeInBytes(srcImageFormat);
+	int dstPixelSize = ImageLoader::SizeInBytes(dstImageFormat);
+	
+	if( srcStride == 0 )
+	{
+		srcStride = srcPixelSize * width;
+	}
+	if( dstStride == 0 )
+	{
+		dstStride = dstPixelSize * width;
+	}
+	
+	if( srcImageFormat == dstImageFormat )
+	{
+		for( line = 0; line < height; line++ )
+		{
+			memcpy( dst + line * dstStride, src + line * srcStride, width * srcPixelSize ); 
+		}
+		return true;
+	}
+	
+	unsigned char lineBufRGBA8888[IMAGE_MAX_DIM*4];
+	
+	UserFormatToRGBA8888Func_t userFormatToRGBA8888Func = GetUserFormatToRGBA8888Func_t( srcImageFormat );
+	RGBA8888ToUserFormatFunc_t RGBA8888ToUserFormatFunc = GetRGBA8888ToUserFormatFunc_t( dstImageFormat );
+	if( !userFormatToRGBA8888Func || !RGBA8888ToUserFormatFunc )
+	{
+		return false;
+	}
+	
+	for( line = 0; line < height; line++ )
+	{
+		userFormatToRGBA8888Func( src + line * srcStride, lineBufRGBA8888, width );
+		RGBA8888ToUserFormatFunc( lineBufRGBA8888, dst + line * dstStride, width );
+	}
+	return true;
+}
+
+} // namespace Reference
+
+
+//-----------------------------------------------------------------------------
+// Repeatable random bytes, so a failure can be reproduced
+//-----------------------------------------------------------------------------
+static unsigned int s_nRandomSeed = 1;
+
+static unsigned char RandomByte( void )
+{
+	s_nRandomSeed = s_nRandomSeed * 1103515245 + 12345;
+	return ( unsigned char )( s_nRandomSeed >> 16 );
+}
+
+static void FillRandom( unsigned char *pBuf, int nBytes )
+{
+	for( int i = 0; i < nBytes; i++ )
+	{
+		pBuf[i] = RandomByte();
+	}
+}
+
+
+#define TEST_HEIGHT			4
+#define TEST_STRIDE_PAD		12
+#define TEST_MAX_PIXEL_SIZE	8
+#define TEST_BUFFER_SIZE	( ( IMAGE_MAX_DIM * TEST_MAX_PIXEL_SIZE + TEST_STRIDE_PAD ) * TEST_HEIGHT )
+
+static unsigned char s_Src[TEST_BUFFER_SIZE];
+static unsigned char s_Dst[TEST_BUFFER_SIZE];
+static unsigned char s_RefDst[TEST_BUFFER_SIZE];
+
+//-----------------------------------------------------------------------------
+// Every uncompressed format pair against the reference converters
+//-----------------------------------------------------------------------------
+static int CheckConverters( void )
+{
+	static const int s_Widths[] = { 1, 2, 3, 7, 64, 255, IMAGE_MAX_DIM };
+	const int nWidths = sizeof( s_Widths ) / sizeof( s_Widths[0] );
+
+	int nCases = 0;
+	int nFailures = 0;
+
+	for( int srcFormat = 0; srcFormat < NUM_IMAGE_FORMATS; srcFormat++ )
+	{
+		ImageFormat srcImageFormat = ( ImageFormat )srcFormat;
+		if( ImageLoader::IsCompressed( srcImageFormat ) )
+			continue;
+
+		for( int dstFormat = 0; dstFormat < NUM_IMAGE_FORMATS; dstFormat++ )
+		{
+			ImageFormat dstImageFormat = ( ImageFormat )dstFormat;
+			if( ImageLoader::IsCompressed( dstImageFormat ) )
+				continue;
+
+			for( int w = 0; w < nWidths; w++ )
+			{
+				for( int padded = 0; padded < 2; padded++ )
+				{
+					int width = s_Widths[w];
+					int srcStride = padded ? ImageLoader::SizeInBytes( srcImageFormat ) * width + TEST_STRIDE_PAD : 0;
+					int dstStride = padded ? ImageLoader::SizeInBytes( dstImageFormat ) * width + TEST_STRIDE_PAD : 0;
+
+					// Both outputs start from the same garbage, some converters leave bytes alone
+					FillRandom( s_Src, TEST_BUFFER_SIZE );
+					FillRandom( s_Dst, TEST_BUFFER_SIZE );
+					memcpy( s_RefDst, s_Dst, TEST_BUFFER_SIZE );
+
+					bool bResult = ImageLoader::ConvertImageFormat( s_Src, srcImageFormat, s_Dst, dstImageFormat, 
+						width, TEST_HEIGHT, srcStride, dstStride );
+					bool bRefResult = Reference::ConvertImageFormat( s_Src, srcImageFormat, s_RefDst, dstImageFormat, 
+						width, TEST_HEIGHT, srcStride, dstStride );
+
+					++nCases;
+					if( bResult != bRefResult || memcmp( s_Dst, s_RefDst, TEST_BUFFER_SIZE ) != 0 )
+					{
+						printf( "%s -> %s, width %d%s: output differs\n", ImageLoader::GetName( srcImageFormat ), 
+							ImageLoader::GetName( dstImageFormat ), width, padded ? " (padded)" : "" );
+						++nFailures;
+					}
+				}
+			}
+		}
+	}
+
+	printf( "%d cases, %d mismatches\n", nCases, nFailures );
+	return nFailures;
+}
+
+
+//-----------------------------------------------------------------------------
+// DXT encoder quality and speed
+//-----------------------------------------------------------------------------
+#if defined( _WIN32 ) && !defined( IMAGE_LOADER_NO_DXTC )
+#define DXT_LIBRARY_ENCODER_NAME	"S3TC"
+#else
+#define DXT_LIBRARY_ENCODER_NAME	"ConvertImageFormat"
+#endif
+
+#define DXT_NUM_ENCODERS		4		// ConvertImageFormat, then EncodeDXT fast/normal/high
+#define DXT_NUM_FORMATS			3
+#define DXT_MIN_BENCH_TIME		0.25	// seconds spent encoding each image per encoder
+#define DXT_GENERATED_SIZE		256
+
+static const char *s_pDXTEncoderNames[DXT_NUM_ENCODERS] = 
+{
+	DXT_LIBRARY_ENCODER_NAME,
+	"EncodeDXT fast",
+	"EncodeDXT normal",
+	"EncodeDXT high",
+};
+
+static const ImageFormat s_DXTFormats[DXT_NUM_FORMATS] = 
+{
+	IMAGE_FORMAT_DXT1, IMAGE_FORMAT_DXT3, IMAGE_FORMAT_DXT5
+};
+
+struct DXTBenchResult_t
+{
+	double m_flColorError;		// summed squared error over r, g and b
+	double m_flAlphaError;
+	double m_flPixels;
+	double m_flTime;
+};
+
+static DXTBenchResult_t s_DXTResults[DXT_NUM_FORMATS][DXT_NUM_ENCODERS];
+
+static bool EncodeWith( int nEncoder, unsigned char *pSrc, unsigned char *pDst, ImageFormat dstFormat, int width, int height )
+{
+	if( nEncoder == 0 )
+	{
+		return ImageLoader::ConvertImageFormat( pSrc, IMAGE_FORMAT_RGBA8888, pDst, dstFormat, width, height );
+	}
+	return ImageLoader::EncodeDXT( pSrc, IMAGE_FORMAT_RGBA8888, pDst, dstFormat, width, height, 
+		( ImageLoader::DXTEncodeQuality_t )( ImageLoader::DXT_ENCODE_FAST + nEncoder - 1 ) );
+}
+
+static bool BenchDXTImage( const char *pName, unsigned char *pSrc, int width, int height )
+{
+	CUtlMemory<unsigned char> encoded( 0, ImageLoader::GetMemRequired( width, height, IMAGE_FORMAT_DXT5, false ) );
+	CUtlMemory<unsigned char> decoded( 0, ImageLoader::GetMemRequired( width, height, IMAGE_FORMAT_RGBA8888, false ) );
+	int nPixels = width * height;
+
+	for( int f = 0; f < DXT_NUM_FORMATS; f++ )
+	{
+		ImageFormat fmt = s_DXTFormats[f];
+		for( int e = 0; e < DXT_NUM_ENCODERS; e++ )
+		{
+			int nIterations = 0;
+			double flStart = Plat_FloatTime();
+			double flTime;
+			do
+			{
+				if( !EncodeWith( e, pSrc, encoded.Base(), fmt, width, height ) )
+				{
+					printf( "%s: %s failed to encode %s\n", pName, s_pDXTEncoderNames[e], ImageLoader::GetName( fmt ) );
+					return false;
+				}
+				++nIterations;
+				flTime = Plat_FloatTime() - flStart;
+			} while( flTime < DXT_MIN_BENCH_TIME );
+
+			if( !ImageLoader::ConvertImageFormat( encoded.Base(), fmt, decoded.Base(), IMAGE_FORMAT_RGBA8888, width, height ) )
+			{
+				printf( "%s: couldn't decode %s\n", pName, ImageLoader::GetName( fmt ) );
+				return false;
+			}
+
+			DXTBenchResult_t &result = s_DXTResults[f][e];
+			unsigned char *pOrig = pSrc;
+			unsigned char *pOut = decoded.Base();
+			for( int i = 0; i < nPixels; i++, pOrig += 4, pOut += 4 )
+			{
+				for( int c = 0; c < 3; c++ )
+				{
+					int d = ( int )pOrig[c] - ( int )pOut[c];
+					result.m_flColorError += d * d;
+				}
+				// DXT1 has no alpha to speak of here
+				if( fmt != IMAGE_FORMAT_DXT1 )
+				{
+					int d = ( int )pOrig[3] - ( int )pOut[3];
+					result.m_flAlphaError += d * d;
+				}
+			}
+			result.m_flPixels += nPixels;
+			result.m_flTime += flTime / nIterations;
+		}
+	}
+	return true;
+}
+
+// Smooth gradients, gradients with noise and hard edged blocks, each with its own alpha
+static void GenerateDXTImage( int nType, unsigned char *pDst, int width, int height )
+{
+	for( int y = 0; y < height; y++ )
+	{
+		for( int x = 0; x < width; x++, pDst += 4 )
+		{
+			int r = x * 255 / width;
+			int g = y * 255 / height;
+			int b = ( x + y ) * 255 / ( width + height );
+			int a = 255 - ( r + g ) / 2;
+			if( nType == 1 )
+			{
+				r += ( RandomByte() & 31 ) - 16;
+				g += ( RandomByte() & 31 ) - 16;
+				b += ( RandomByte() & 31 ) - 16;
+				a += ( RandomByte() & 15 ) - 8;
+			}
+			else if( nType == 2 )
+			{
+				unsigned int nCell = ( ( x >> 3 ) * 2654435761u ) ^ ( ( y >> 3 ) * 40503u );
+				r = ( nCell >> 8 ) & 0xff;
+				g = ( nCell >> 16 ) & 0xff;
+				b = ( nCell >> 24 ) & 0xff;
+				a = ( ( x ^ y ) & 4 ) ? 255 : 0;
+			}
+			pDst[0] = ( unsigned char )clamp( r, 0, 255 );
+			pDst[1] = ( unsigned char )clamp( g, 0, 255 );
+			pDst[2] = ( unsigned char )clamp( b, 0, 255 );
+			pDst[3] = ( unsigned char )clamp( a, 0, 255 );
+		}
+	}
+}
+
+static int BenchDXTEncoders( int nFiles, char **ppFileNames )
+{
+	memset( s_DXTResults, 0, sizeof( s_DXTResults ) );
+
+	int nFailures = 0;
+	CUtlMemory<unsigned char> image;
+	if( nFiles == 0 )
+	{
+		static const char *s_pGeneratedNames[] = { "gradient", "noise", "blocks" };
+		image.EnsureCapacity( DXT_GENERATED_SIZE * DXT_GENERATED_SIZE * 4 );
+		for( int i = 0; i < 3; i++ )
+		{
+			GenerateDXTImage( i, image.Base(), DXT_GENERATED_SIZE, DXT_GENERATED_SIZE );
+			if( !BenchDXTImage( s_pGeneratedNames[i], image.Base(), DXT_GENERATED_SIZE, DXT_GENERATED_SIZE ) )
+			{
+				++nFailures;
+			}
+		}
+	}
+
+	for( int i = 0; i < nFiles; i++ )
+	{
+		int width, height;
+		if( !TGALoader::LoadRGBA8888( ppFileNames[i], image, width, height ) )
+		{
+			printf( "error loading %s\n", ppFileNames[i] );
+			++nFailures;
+			continue;
+		}
+		if( !BenchDXTImage( ppFileNames[i], image.Base(), width, height ) )
+		{
+			++nFailures;
+		}
+	}
+
+	printf( "%-8s %-20s %12s %12s %12s\n", "format", "encoder", "rgb rmse", "alpha rmse", "Mpixels/s" );
+	for( int f = 0; f < DXT_NUM_FORMATS; f++ )
+	{
+		for( int e = 0; e < DXT_NUM_ENCODERS; e++ )
+		{
+			const DXTBenchResult_t &result = s_DXTResults[f][e];
+			if( result.m_flPixels == 0 )
+				continue;
+
+			char alpha[32];
+			if( s_DXTFormats[f] == IMAGE_FORMAT_DXT1 )
+			{
+				strcpy( alpha, "-" );
+			}
+			else
+			{
+				sprintf( alpha, "%.3f", sqrt( result.m_flAlphaError / result.m_flPixels ) );
+			}
+			printf( "%-8s %-20s %12.3f %12s %12.2f\n", ImageLoader::GetName( s_DXTFormats[f] ), 
+				s_pDXTEncoderNames[e], sqrt( result.m_flColorError / ( 3.0 * result.m_flPixels ) ), alpha, 
+				result.m_flTime > 0.0 ? result.m_flPixels / ( result.m_flTime * 1000000.0 ) : 0.0 );
+		}
+	}
+	return nFailures;
+}
+
+void Usage( void )
+{
+	printf( "Usage: imageconvertcheck [-dxt [file.tga ...]]\n" );
+	exit( -1 );
+}
+
+int main( int argc, char **argv )
+{
+	if( argc == 1 )
+	{
+		return CheckConverters();
+	}
+	if( stricmp( argv[1], "-dxt" ) != 0 )
+	{
+		Usage();
+	}
+	return BenchDXTEncoders( argc - 2, argv + 2 );
+}
@@ -0,0 +1,586 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Checks the rope simulation against the per node code it
+//			replaced. Each case builds a random rope and simulates two
+//			copies of it for a run of random frames with the same wind,
+//			gusts, impulses and endpoint motion. One copy uses
+//			CBaseRopePhysics and a delegate that works out the frame's
+//			forces once, as C_RopeKeyframe::CPhysicsDelegate now does. The
+//			other relaxes the springs through their CRopeSpring pointers
+//			and works out every force per node, as before. Every node
+//			position has to match exactly after every frame. The exit code
+//			is the number of mismatches.
+//
+//			The two delegates are copies of the client's old and new
+//			CPhysicsDelegate force code, with the world collision replaced
+//			by a ground plane. rope_shake is left off, since its random
+//			kicks would not line up between the copies.
+//
+//			With -bench it times BENCH_ROPE_COUNT ropes of
+//			ROPE_MAX_SEGMENTS nodes for both versions.
+//
+// $NoKeywords: $
+//=============================================================================//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "rope_physics.h"
+#include "rope_shared.h"
+#include "mathlib.h"
+#include "vector.h"
+#include "tier0/dbg.h"
+#include "tier0/platform.h"
+
+#define CHECK_CASES				2000
+#define CHECK_MAX_FRAMES		300
+
+#define BENCH_ROPE_COUNT		1000
+#define BENCH_FRAME_COUNT		200
+#define BENCH_FRAME_TIME		( 1.0f / 60.0f )
+#define BENCH_ROUNDS			8
+
+// c_rope.cpp
+#define WIND_FORCE_FACTOR		10
+#define ROPE_IMPULSE_SCALE		20
+#define ROPE_IMPULSE_DECAY		0.95
+
+
+//-----------------------------------------------------------------------------
+// Repeatable random numbers, so a failure can be reproduced
+//-----------------------------------------------------------------------------
+static unsigned int s_nRandomSeed = 1;
+
+static int RandomInt( int nMin, int nMax )
+{
+	s_nRandomSeed = s_nRandomSeed * 1103515245 + 12345;
+	return nMin + ( int )( ( s_nRandomSeed >> 8 ) % ( unsigned int )( nMax - nMin + 1 ) );
+}
+
+static float RandomFloat( float flMin, float flMax )
+{
+	return flMin + ( flMax - flMin ) * ( RandomInt( 0, 65535 ) / 65535.0f );
+}
+
+static void RandomVector( float flRange, Vector &v )
+{
+	v.Init( RandomFloat( -flRange, flRange ), RandomFloat( -flRange, flRange ), RandomFloat( -flRange, flRange ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// The parts of C_RopeKeyframe the delegates read and write. The frame's
+// wind stands in for GetWindspeedAtTime, and the ground plane for the
+// world collision.
+//-----------------------------------------------------------------------------
+struct TestRope_t
+{
+	int		m_RopeFlags;
+	bool	m_bApplyWind;
+	Vector	m_vWindVel;
+	float	m_flCurrentGustTimer;
+	float	m_flCurrentGustLifetime;
+	Vector	m_vWindDir;
+	Vector	m_flImpulse;
+	bool	m_LinksTouchingSomething[ROPE_MAX_SEGMENTS];
+	float	m_flGround;
+	Vector	m_vStartPoint;
+	Vector	m_vEndPoint;
+};
+
+static void ApplyTestConstraints( TestRope_t *pRope, CSimplePhysics::CNode *pNodes, int nNodes )
+{
+	for ( int i = 0; i < nNodes; i++ )
+	{
+		if ( pNodes[i].m_vPos.z < pRope->m_flGround )
+		{
+			pNodes[i].m_vPos.z = pRope->m_flGround;
+			pRope->m_LinksTouchingSomething[i] = true;
+		}
+	}
+
+	pNodes[0].m_vPos = pRope->m_vStartPoint;
+	pNodes[nNodes-1].m_vPos = pRope->m_vEndPoint;
+}
+
+
+//-----------------------------------------------------------------------------
+// CPhysicsDelegate as it was, working out every force for every node
+//-----------------------------------------------------------------------------
+class CReferenceDelegate : public CSimplePhysics::IHelper
+{
+public:
+	virtual void GetNodeForces( CSimplePhysics::CNode *pNodes, int iNode, Vector *pAccel )
+	{
+		// Gravity.
+		if ( !( m_pRope->m_RopeFlags & ROPE_NO_GRAVITY ) )
+		{
+			pAccel->Init( ROPE_GRAVITY );
+		}
+		else
+		{
+			// This was left uninitialized
+			pAccel->Init();
+		}
+
+		if( !m_pRope->m_LinksTouchingSomething[iNode] && m_pRope->m_bApplyWind)
+		{
+			Vector vecWindVel = m_pRope->m_vWindVel;
+			if ( vecWindVel.LengthSqr() > 0 )
+			{
+				VectorMA( *pAccel, WIND_FORCE_FACTOR, vecWindVel, *pAccel );
+			}
+			else
+			{
+				if (m_pRope->m_flCurrentGustTimer < m_pRope->m_flCurrentGustLifetime )
+				{
+					float div = m_pRope->m_flCurrentGustTimer / m_pRope->m_flCurrentGustLifetime;
+					float scale = 1 - cos( div * M_PI );
+
+					*pAccel += m_pRope->m_vWindDir * scale;
+				}
+			}
+		}
+
+		// Apply any instananeous forces and reset
+		*pAccel += ROPE_IMPULSE_SCALE * m_pRope->m_flImpulse;
+		m_pRope->m_flImpulse *= ROPE_IMPULSE_DECAY;
+	}
+
+	virtual void ApplyConstraints( CSimplePhysics::CNode *pNodes, int nNodes )
+	{
+		ApplyTestConstraints( m_pRope, pNodes, nNodes );
+	}
+
+	TestRope_t	*m_pRope;
+};
+
+
+//-----------------------------------------------------------------------------
+// CPhysicsDelegate as it is now, with the frame's forces worked out once
+//-----------------------------------------------------------------------------
+class CTestDelegate : public CSimplePhysics::IHelper
+{
+public:
+	void SetupForces()
+	{
+		// Gravity.
+		if ( !( m_pRope->m_RopeFlags & ROPE_NO_GRAVITY ) )
+		{
+			m_vGravity.Init( ROPE_GRAVITY );
+		}
+		else
+		{
+			m_vGravity.Init();
+		}
+
+		m_vWindAccel.Init();
+		m_bWind = false;
+
+		if( m_pRope->m_bApplyWind )
+		{
+			Vector vecWindVel = m_pRope->m_vWindVel;
+			if ( vecWindVel.LengthSqr() > 0 )
+			{
+				m_vWindAccel = vecWindVel * WIND_FORCE_FACTOR;
+				m_bWind = true;
+			}
+			else
+			{
+				if (m_pRope->m_flCurrentGustTimer < m_pRope->m_flCurrentGustLifetime )
+				{
+					float div = m_pRope->m_flCurrentGustTimer / m_pRope->m_flCurrentGustLifetime;
+					float scale = 1 - cos( div * M_PI );
+
+					m_vWindAccel = m_pRope->m_vWindDir * scale;
+					m_bWind = true;
+				}
+			}
+		}
+	}
+
+	virtual void GetNodeForces( CSimplePhysics::CNode *pNodes, int iNode, Vector *pAccel )
+	{
+		*pAccel = m_vGravity;
+
+		if( m_bWind && !m_pRope->m_LinksTouchingSomething[iNode] )
+		{
+			*pAccel += m_vWindAccel;
+		}
+
+		// Apply any instananeous forces and reset
+		*pAccel += ROPE_IMPULSE_SCALE * m_pRope->m_flImpulse;
+		m_pRope->m_flImpulse *= ROPE_IMPULSE_DECAY;
+	}
+
+	virtual void ApplyConstraints( CSimplePhysics::CNode *pNodes, int nNodes )
+	{
+		ApplyTestConstraints( m_pRope, pNodes, nNodes );
+	}
+
+	TestRope_t	*m_pRope;
+	Vector		m_vGravity;
+	Vector		m_vWindAccel;
+	bool		m_bWind;
+};
+
+
+//-----------------------------------------------------------------------------
+// CBaseRopePhysics with the spring relaxation as it was, through the
+// CRopeSpring pointers
+//-----------------------------------------------------------------------------
+class CReferenceRopePhysics : public CRopePhysics<ROPE_MAX_SEGMENTS>
+{
+public:
+	virtual void ApplyConstraints( CSimplePhysics::CNode *pNodes, int nNodes )
+	{
+		// Handle springs..
+		//
+		// Iterate multiple times here. If we don't, then gravity tends to
+		// win over the constraint solver and it's impossible to get straight ropes.
+		static int nIterations = 3;
+		for( int iIteration=0; iIteration < nIterations; iIteration++ )
+		{
+			for( int i=0; i < m_nNodes - 1; i++ )
+			{
+				CRopeSpring *s = &m_pSprings[i];
+
+				Vector vTo = *s->m_pNode1 - *s->m_pNode2;
+
+				float flDistSqr = vTo.LengthSqr();
+
+				// If we don't have an overall spring distance, see if we have a per-node one
+				float flSpringDist = m_flSpringDistSqr;
+				if ( !flSpringDist )
+				{
+					// TODO: This still isn't enough. Ropes with different spring lengths
+					// per-node will oscillate forever.
+					flSpringDist = m_flNodeSpringDistsSqr[i];
+				}
+
+				if( flDistSqr > flSpringDist )
+				{
+					float flDist = (float)sqrt( flDistSqr );
+					vTo *= 1 - (m_flSpringDist / flDist);
+
+					*s->m_pNode1 -= vTo * 0.5f;
+					*s->m_pNode2 += vTo * 0.5f;
+				}
+			}
+
+			if( m_pDelegate )
+				m_pDelegate->ApplyConstraints( pNodes, nNodes );
+		}
+	}
+};
+
+
+//-----------------------------------------------------------------------------
+// A rope and the frames to run it for
+//-----------------------------------------------------------------------------
+struct TestFrame_t
+{
+	float	m_flTime;
+	bool	m_bWind;
+	Vector	m_vWindVel;
+	float	m_flGustTimer;
+	Vector	m_vImpulse;
+	Vector	m_vStartPoint;
+	Vector	m_vEndPoint;
+};
+
+struct TestRopeParams_t
+{
+	int		m_nNodes;
+	float	m_flSpringDist;
+	bool	m_bNodeSpringDists;
+	TestRope_t	m_Rope;
+};
+
+static void CreateTestRope( TestRopeParams_t &params, TestFrame_t *pFrames, int nFrames )
+{
+	params.m_nNodes = RandomInt( 2, ROPE_MAX_SEGMENTS );
+	params.m_flSpringDist = RandomFloat( 4.0f, 64.0f );
+
+	// A spring distance of zero makes the relaxation use the per node lengths
+	params.m_bNodeSpringDists = RandomInt( 0, 7 ) == 0;
+
+	TestRope_t &rope = params.m_Rope;
+	memset( &rope, 0, sizeof( rope ) );
+	rope.m_RopeFlags = RandomInt( 0, 3 ) ? 0 : ROPE_NO_GRAVITY;
+	rope.m_bApplyWind = RandomInt( 0, 3 ) != 0;
+	rope.m_flCurrentGustLifetime = RandomFloat( 0.5f, 4.0f );
+	RandomVector( 300.0f, rope.m_vWindDir );
+	rope.m_flGround = RandomFloat( -400.0f, -50.0f );
+
+	Vector vStart, vEnd;
+	RandomVector( 32.0f, vStart );
+	RandomVector( 32.0f, vEnd );
+	vEnd.x += params.m_flSpringDist * ( params.m_nNodes - 1 ) * RandomFloat( 0.3f, 1.2f );
+
+	for ( int i = 0; i < nFrames; i++ )
+	{
+		TestFrame_t &frame = pFrames[i];
+
+		// Mostly steady frame rates, with the odd hitch that runs several steps
+		frame.m_flTime = RandomInt( 0, 15 ) ? RandomFloat( 0.005f, 0.034f ) : RandomFloat( 0.05f, 0.25f );
+
+		// The wind comes and goes; a still frame falls back on the gust
+		frame.m_bWind = RandomInt( 0, 2 ) == 0;
+		if ( frame.m_bWind )
+		{
+			RandomVector( 40.0f, frame.m_vWindVel );
+		}
+		else
+		{
+			frame.m_vWindVel.Init();
+		}
+		frame.m_flGustTimer = RandomFloat( 0.0f, rope.m_flCurrentGustLifetime * 1.5f );
+
+		if ( RandomInt( 0, 19 ) == 0 )
+		{
+			RandomVector( 200.0f, frame.m_vImpulse );
+		}
+		else
+		{
+			frame.m_vImpulse.Init();
+		}
+
+		// The endpoints drift, and sometimes jump
+		if ( RandomInt( 0, 29 ) == 0 )
+		{
+			RandomVector( 64.0f, vStart );
+		}
+		else
+		{
+			Vector vDelta;
+			RandomVector( 2.0f, vDelta );
+			vStart += vDelta;
+		}
+		Vector vDelta;
+		RandomVector( 2.0f, vDelta );
+		vEnd += vDelta;
+
+		frame.m_vStartPoint = vStart;
+		frame.m_vEndPoint = vEnd;
+	}
+}
+
+static void SetupTestRope( const TestRopeParams_t &params, CRopePhysics<ROPE_MAX_SEGMENTS> *pPhysics, CSimplePhysics::IHelper *pDelegate )
+{
+	pPhysics->SetNumNodes( params.m_nNodes );
+	pPhysics->SetupSimulation( params.m_bNodeSpringDists ? 0 : params.m_flSpringDist, pDelegate );
+	if ( params.m_bNodeSpringDists )
+	{
+		for ( int i = 0; i < params.m_nNodes - 1; i++ )
+		{
+			pPhysics->ResetNodeSpringLength( i, params.m_flSpringDist * ( 0.5f + 0.25f * ( i & 3 ) ) );
+		}
+	}
+
+	for ( int i = 0; i < params.m_nNodes; i++ )
+	{
+		Vector vPos;
+		VectorLerp( params.m_Rope.m_vStartPoint, params.m_Rope.m_vEndPoint, ( float )i / ( params.m_nNodes - 1 ), vPos );
+		pPhysics->GetNode( i )->Init( vPos );
+	}
+}
+
+// What C_RopeKeyframe::RunRopeSimulation sets up before each frame
+static void BeginTestFrame( TestRope_t *pRope, const TestFrame_t &frame )
+{
+	pRope->m_vWindVel = frame.m_vWindVel;
+	pRope->m_flCurrentGustTimer = frame.m_flGustTimer;
+	pRope->m_flImpulse += frame.m_vImpulse;
+	pRope->m_vStartPoint = frame.m_vStartPoint;
+	pRope->m_vEndPoint = frame.m_vEndPoint;
+
+	for ( int i = 0; i < ROPE_MAX_SEGMENTS; i++ )
+	{
+		pRope->m_LinksTouchingSomething[i] = false;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Check
+//-----------------------------------------------------------------------------
+static int s_nCases;
+static int s_nFailures;
+
+static void CheckRope( void )
+{
+	unsigned int nSeed = s_nRandomSeed;
+
+	static TestFrame_t s_Frames[CHECK_MAX_FRAMES];
+	TestRopeParams_t params;
+	int nFrames = RandomInt( 1, CHECK_MAX_FRAMES );
+	CreateTestRope( params, s_Frames, nFrames );
+	params.m_Rope.m_vStartPoint = s_Frames[0].m_vStartPoint;
+	params.m_Rope.m_vEndPoint = s_Frames[0].m_vEndPoint;
+
+	++s_nCases;
+
+	TestRope_t refRope = params.m_Rope;
+	CReferenceDelegate refDelegate;
+	refDelegate.m_pRope = &refRope;
+	CReferenceRopePhysics *pRefPhysics = new CReferenceRopePhysics;
+	SetupTestRope( params, pRefPhysics, &refDelegate );
+
+	TestRope_t testRope = params.m_Rope;
+	CTestDelegate testDelegate;
+	testDelegate.m_pRope = &testRope;
+	CRopePhysics<ROPE_MAX_SEGMENTS> *pTestPhysics = new CRopePhysics<ROPE_MAX_SEGMENTS>;
+	SetupTestRope( params, pTestPhysics, &testDelegate );
+
+	for ( int i = 0; i < nFrames; i++ )
+	{
+		BeginTestFrame( &refRope, s_Frames[i] );
+		pRefPhysics->Simulate( s_Frames[i].m_flTime );
+
+		BeginTestFrame( &testRope, s_Frames[i] );
+		testDelegate.SetupForces();
+		pTestPhysics->Simulate( s_Frames[i].m_flTime );
+
+		if ( memcmp( pRefPhysics->m_Nodes, pTestPhysics->m_Nodes, sizeof( CSimplePhysics::CNode ) * params.m_nNodes ) ||
+			memcmp( refRope.m_LinksTouchingSomething, testRope.m_LinksTouchingSomething, sizeof( refRope.m_LinksTouchingSomething ) ) )
+		{
+			++s_nFailures;
+
+			int iNode = 0;
+			while ( iNode < params.m_nNodes - 1 && !memcmp( pRefPhysics->GetNode( iNode ), pTestPhysics->GetNode( iNode ), sizeof( CSimplePhysics::CNode ) ) )
+			{
+				++iNode;
+			}
+
+			const Vector &a = pTestPhysics->GetNode( iNode )->m_vPos;
+			const Vector &b = pRefPhysics->GetNode( iNode )->m_vPos;
+			printf( "rope, %d nodes (seed %u): frame %d of %d, node %d at %f %f %f, reference %f %f %f\n",
+				params.m_nNodes, nSeed, i, nFrames, iNode, a.x, a.y, a.z, b.x, b.y, b.z );
+			break;
+		}
+	}
+
+	delete pRefPhysics;
+	delete pTestPhysics;
+}
+
+static int CheckRopes( void )
+{
+	s_nCases = 0;
+	s_nFailures = 0;
+	for ( int i = 0; i < CHECK_CASES; ++i )
+	{
+		CheckRope();
+	}
+	printf( "ropes: %d cases, %d mismatches\n", s_nCases, s_nFailures );
+	return s_nFailures;
+}
+
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+static int BenchRopes( void )
+{
+	static TestFrame_t s_Frames[BENCH_FRAME_COUNT];
+	TestRopeParams_t *pParams = new TestRopeParams_t[BENCH_ROPE_COUNT];
+	TestRope_t *pRopes = new TestRope_t[BENCH_ROPE_COUNT];
+	CReferenceDelegate *pRefDelegates = new CReferenceDelegate[BENCH_ROPE_COUNT];
+	CTestDelegate *pTestDelegates = new CTestDelegate[BENCH_ROPE_COUNT];
+	CReferenceRopePhysics *pRefPhysics = new CReferenceRopePhysics[BENCH_ROPE_COUNT];
+	CRopePhysics<ROPE_MAX_SEGMENTS> *pTestPhysics = new CRopePhysics<ROPE_MAX_SEGMENTS>[BENCH_ROPE_COUNT];
+
+	// Every rope is the full length, in the wind, and nothing touches the ground
+	CreateTestRope( pParams[0], s_Frames, BENCH_FRAME_COUNT );
+	for ( int i = 0; i < BENCH_ROPE_COUNT; ++i )
+	{
+		pParams[i] = pParams[0];
+		pParams[i].m_nNodes = ROPE_MAX_SEGMENTS;
+		pParams[i].m_Rope.m_RopeFlags = 0;
+		pParams[i].m_Rope.m_bApplyWind = true;
+		pParams[i].m_Rope.m_flGround = -1e6f;
+		pParams[i].m_Rope.m_vStartPoint = s_Frames[0].m_vStartPoint;
+		pParams[i].m_Rope.m_vEndPoint = s_Frames[0].m_vEndPoint;
+	}
+
+	printf( "%d ropes of %d nodes, %d frames of %.1f ms\n", BENCH_ROPE_COUNT, ROPE_MAX_SEGMENTS, BENCH_FRAME_COUNT, BENCH_FRAME_TIME * 1000.0f );
+
+	double flBest[2] = { 1e30, 1e30 };
+	for ( int nRound = 0; nRound < BENCH_ROUNDS; ++nRound )
+	{
+		for ( int nReference = 0; nReference < 2; ++nReference )
+		{
+			for ( int i = 0; i < BENCH_ROPE_COUNT; ++i )
+			{
+				pRopes[i] = pParams[i].m_Rope;
+				pRefDelegates[i].m_pRope = &pRopes[i];
+				pTestDelegates[i].m_pRope = &pRopes[i];
+				if ( nReference )
+				{
+					pRefPhysics[i].Restart();
+					SetupTestRope( pParams[i], &pRefPhysics[i], &pRefDelegates[i] );
+				}
+				else
+				{
+					pTestPhysics[i].Restart();
+					SetupTestRope( pParams[i], &pTestPhysics[i], &pTestDelegates[i] );
+				}
+			}
+
+			double flStart = Plat_FloatTime();
+			for ( int nFrame = 0; nFrame < BENCH_FRAME_COUNT; ++nFrame )
+			{
+				for ( int i = 0; i < BENCH_ROPE_COUNT; ++i )
+				{
+					BeginTestFrame( &pRopes[i], s_Frames[nFrame] );
+					if ( nReference )
+					{
+						pRefPhysics[i].Simulate( BENCH_FRAME_TIME );
+					}
+					else
+					{
+						pTestDelegates[i].SetupForces();
+						pTestPhysics[i].Simulate( BENCH_FRAME_TIME );
+					}
+				}
+			}
+			double flTime = Plat_FloatTime() - flStart;
+
+			flBest[nReference] = min( flBest[nReference], flTime * 1e6 / BENCH_FRAME_COUNT );
+		}
+	}
+
+	printf( "%-14s %12s\n", "ropes", "us/frame" );
+	printf( "%-14s %12.2f\n", "per node", flBest[1] );
+	printf( "%-14s %12.2f\n", "per frame", flBest[0] );
+
+	delete [] pParams;
+	delete [] pRopes;
+	delete [] pRefDelegates;
+	delete [] pTestDelegates;
+	delete [] pRefPhysics;
+	delete [] pTestPhysics;
+	return 0;
+}
+
+
+void Usage( void )
+{
+	printf( "Usage: ropecheck [-bench]\n" );
+	exit( -1 );
+}
+
+int main( int argc, char **argv )
+{
+	MathLib_Init( 2.2f, 2.2f, 0.0f, 2.0f );
+	if( argc == 1 )
+	{
+		return CheckRopes();
+	}
+	if( stricmp( argv[1], "-bench" ) != 0 )
+	{
+		Usage();
+	}
+	return BenchRopes();
+}
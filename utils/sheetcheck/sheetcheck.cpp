@@ -0,0 +1,372 @@
+//========= Copyright  1996-2005, Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Checks CSheetSimulator::DetermineBestCollisionPlane against
+//			the version it replaced, which built a Ray_t and called
+//			IntersectRayWithPlane for every plane test. Each case fills a
+//			random sheet from 1x1 to 64x64 with particles, collision
+//			planes and a varying share of valid planes, including planes
+//			edge on to a particle's ray, particles at the origin, planes
+//			through the particle and planes the ray only reaches past its
+//			end. Both versions are run with and without the far test, and
+//			every particle's collision plane and distance have to match
+//			exactly. The exit code is the number of mismatches.
+//
+//			With -bench it times a pass of both versions on sheets from
+//			8x8 to 64x64, with no planes valid (out in the open), a
+//			quarter of them and all of them.
+//
+// $NoKeywords: $
+//=============================================================================//
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include "sheetsimulator.h"
+#include "collisionutils.h"
+#include "cmodel.h"
+#include "mathlib.h"
+#include "vector.h"
+#include "tier0/dbg.h"
+#include "tier0/platform.h"
+
+#define CHECK_CASES				4000
+#define CHECK_MAX_SIZE			64
+
+#define BENCH_PASSES			2000
+#define BENCH_ROUNDS			8
+
+
+//-----------------------------------------------------------------------------
+// Repeatable random numbers, so a failure can be reproduced
+//-----------------------------------------------------------------------------
+static unsigned int s_nRandomSeed = 1;
+
+static int RandomInt( int nMin, int nMax )
+{
+	s_nRandomSeed = s_nRandomSeed * 1103515245 + 12345;
+	return nMin + ( int )( ( s_nRandomSeed >> 8 ) % ( unsigned int )( nMax - nMin + 1 ) );
+}
+
+static float RandomFloat( float flMin, float flMax )
+{
+	return flMin + ( flMax - flMin ) * ( RandomInt( 0, 65535 ) / 65535.0f );
+}
+
+static void RandomVector( float flRange, Vector &v )
+{
+	v.Init( RandomFloat( -flRange, flRange ), RandomFloat( -flRange, flRange ), RandomFloat( -flRange, flRange ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// A sheet whose collision state can be set up directly, with the old plane
+// selection alongside the new one
+//-----------------------------------------------------------------------------
+class CTestSheetSimulator : public CSheetSimulator
+{
+public:
+	CTestSheetSimulator() : CSheetSimulator( NULL, NULL )
+	{
+	}
+
+	void Randomize( float flValidFraction );
+
+	void DetermineBestCollisionPlane( bool bFarTest )
+	{
+		CSheetSimulator::DetermineBestCollisionPlane( bFarTest );
+	}
+
+	void ReferenceDetermineBestCollisionPlane( bool bFarTest );
+
+	int FindMismatch( const CTestSheetSimulator &other ) const
+	{
+		for ( int i = 0; i < NumParticles(); ++i )
+		{
+			if ( m_Particle[i].m_CollisionPlane != other.m_Particle[i].m_CollisionPlane ||
+				memcmp( &m_Particle[i].m_CollisionDist, &other.m_Particle[i].m_CollisionDist, sizeof( float ) ) )
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	void CopyFrom( const CTestSheetSimulator &other )
+	{
+		m_Origin = other.m_Origin;
+		for ( int i = 0; i < NumParticles(); ++i )
+		{
+			m_Particle[i] = other.m_Particle[i];
+			m_pCollisionPlanes[i] = other.m_pCollisionPlanes[i];
+			m_pValidCollisionPlane[i] = other.m_pValidCollisionPlane[i];
+		}
+	}
+
+	void GetCollision( int i, int &nPlane, float &flDist ) const
+	{
+		nPlane = m_Particle[i].m_CollisionPlane;
+		flDist = m_Particle[i].m_CollisionDist;
+	}
+
+private:
+	void ReferenceTestVertAgainstPlane( int vert, int plane, bool bFarTest );
+};
+
+void CTestSheetSimulator::Randomize( float flValidFraction )
+{
+	RandomVector( 1000.0f, m_Origin );
+
+	// The sheet spreads out in front of the origin, like the shield
+	Vector vecForward;
+	RandomVector( 1.0f, vecForward );
+	if ( VectorNormalize( vecForward ) == 0.0f )
+	{
+		vecForward.Init( 1, 0, 0 );
+	}
+
+	for ( int i = 0; i < NumParticles(); ++i )
+	{
+		Vector vecOffset;
+		RandomVector( 60.0f, vecOffset );
+		VectorMA( m_Origin, RandomFloat( 0.0f, 200.0f ), vecForward, m_Particle[i].m_Position );
+		m_Particle[i].m_Position += vecOffset;
+
+		switch( RandomInt( 0, 31 ) )
+		{
+		case 0:
+			// Right at the origin
+			m_Particle[i].m_Position = m_Origin;
+			break;
+
+		case 1:
+			// Snapped to the grid, so some planes are edge on to its ray
+			m_Particle[i].m_Position.Init( m_Origin.x + RandomInt( -2, 2 ) * 32.0f, m_Origin.y, m_Origin.z + RandomInt( -2, 2 ) * 32.0f );
+			break;
+		}
+
+		cplane_t &plane = m_pCollisionPlanes[i];
+		switch( RandomInt( 0, 7 ) )
+		{
+		case 0:
+			// Axial
+			plane.normal.Init();
+			plane.normal[RandomInt( 0, 2 )] = RandomInt( 0, 1 ) ? 1.0f : -1.0f;
+			break;
+
+		default:
+			RandomVector( 1.0f, plane.normal );
+			if ( VectorNormalize( plane.normal ) == 0.0f )
+			{
+				plane.normal.Init( 0, 0, 1 );
+			}
+			break;
+		}
+
+		// Usually somewhere between the origin and a bit past the particle,
+		// sometimes right through it so the far test sees t of about 1
+		Vector vecOnPlane;
+		if ( RandomInt( 0, 7 ) == 0 )
+		{
+			vecOnPlane = m_Particle[i].m_Position;
+		}
+		else
+		{
+			VectorLerp( m_Origin, m_Particle[i].m_Position, RandomFloat( -0.5f, 1.5f ), vecOnPlane );
+		}
+		plane.dist = DotProduct( vecOnPlane, plane.normal );
+		plane.type = 3;
+		plane.signbits = 0;
+
+		m_pValidCollisionPlane[i] = RandomFloat( 0.0f, 1.0f ) < flValidFraction;
+
+		// Stale results the pass has to overwrite
+		m_Particle[i].m_CollisionPlane = RandomInt( -1, NumParticles() - 1 );
+		m_Particle[i].m_CollisionDist = RandomFloat( -1.0f, 2.0f );
+	}
+}
+
+// TestVertAgainstPlane as it was
+void CTestSheetSimulator::ReferenceTestVertAgainstPlane( int vert, int plane, bool bFarTest )
+{
+	if (!m_pValidCollisionPlane[plane])
+		return;
+
+	// Compute distance to the plane under consideration
+	cplane_t* pPlane = &m_pCollisionPlanes[plane];
+
+	Ray_t ray;
+	ray.Init( m_Origin, m_Particle[vert].m_Position );
+	float t = IntersectRayWithPlane( ray, *pPlane );
+
+	if (!bFarTest || (t <= 1.0f))
+	{
+		if ((t < m_Particle[vert].m_CollisionDist) && (t >= 0.0f))
+		{
+			m_Particle[vert].m_CollisionDist = t;
+			m_Particle[vert].m_CollisionPlane = plane;
+		}
+	}
+}
+
+// DetermineBestCollisionPlane as it was
+void CTestSheetSimulator::ReferenceDetermineBestCollisionPlane( bool bFarTest )
+{
+	// Check neighbors for violation of collision plane constraints
+	for	( int i = 0; i < NumVertical(); ++i)
+	{
+		for ( int j = 0; j < NumHorizontal(); ++j)
+		{
+			// Here's the particle we're making springs for
+			int idx = i * NumHorizontal() + j;
+
+			// Now that we've seen all collisions, find the best collision plane
+			// to use (look at myself and all neighbors). The best plane
+			// is the one that comes closest to the origin.
+			m_Particle[idx].m_CollisionDist = FLT_MAX;
+			m_Particle[idx].m_CollisionPlane = -1;
+			ReferenceTestVertAgainstPlane( idx, idx, bFarTest );
+			if (j > 0)
+			{
+				ReferenceTestVertAgainstPlane( idx, idx-1, bFarTest );
+			}
+			if (j < NumHorizontal() - 1)
+			{
+				ReferenceTestVertAgainstPlane( idx, idx+1, bFarTest );
+			}
+			if (i > 0)
+				ReferenceTestVertAgainstPlane( idx, idx-NumHorizontal(), bFarTest );
+			if (i < NumVertical() - 1)
+				ReferenceTestVertAgainstPlane( idx, idx+NumHorizontal(), bFarTest );
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Check
+//-----------------------------------------------------------------------------
+static int s_nCases;
+static int s_nFailures;
+
+static const float s_flValidFractions[] = { 0.0f, 0.1f, 0.5f, 0.9f, 1.0f };
+
+static void CheckSheet( void )
+{
+	unsigned int nSeed = s_nRandomSeed;
+
+	int w = RandomInt( 1, CHECK_MAX_SIZE );
+	int h = RandomInt( 1, CHECK_MAX_SIZE );
+	float flValidFraction = s_flValidFractions[RandomInt( 0, ARRAYSIZE( s_flValidFractions ) - 1 )];
+
+	CTestSheetSimulator sheet, reference;
+	sheet.Init( w, h, w * h );
+	reference.Init( w, h, w * h );
+
+	sheet.Randomize( flValidFraction );
+	reference.CopyFrom( sheet );
+
+	for ( int nFarTest = 0; nFarTest < 2; ++nFarTest )
+	{
+		++s_nCases;
+
+		sheet.DetermineBestCollisionPlane( nFarTest != 0 );
+		reference.ReferenceDetermineBestCollisionPlane( nFarTest != 0 );
+
+		int nMismatch = sheet.FindMismatch( reference );
+		if ( nMismatch >= 0 )
+		{
+			++s_nFailures;
+
+			int nPlane, nRefPlane;
+			float flDist, flRefDist;
+			sheet.GetCollision( nMismatch, nPlane, flDist );
+			reference.GetCollision( nMismatch, nRefPlane, flRefDist );
+			printf( "sheet %dx%d, %.0f%% valid%s (seed %u): particle %d has plane %d at %f, reference %d at %f\n",
+				w, h, flValidFraction * 100.0f, nFarTest ? ", far test" : "", nSeed, nMismatch, nPlane, flDist, nRefPlane, flRefDist );
+		}
+	}
+}
+
+static int CheckSheets( void )
+{
+	s_nCases = 0;
+	s_nFailures = 0;
+	for ( int i = 0; i < CHECK_CASES; ++i )
+	{
+		CheckSheet();
+	}
+	printf( "sheets: %d cases, %d mismatches\n", s_nCases, s_nFailures );
+	return s_nFailures;
+}
+
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+static const int s_nBenchSizes[] = { 8, 16, 32, 64 };
+static const float s_flBenchValidFractions[] = { 0.0f, 0.25f, 1.0f };
+
+static int BenchSheets( void )
+{
+	printf( "%-8s %-8s %14s %14s\n", "sheet", "valid", "old us/pass", "new us/pass" );
+	for ( int nSize = 0; nSize < ARRAYSIZE( s_nBenchSizes ); ++nSize )
+	{
+		int w = s_nBenchSizes[nSize];
+		for ( int nValid = 0; nValid < ARRAYSIZE( s_flBenchValidFractions ); ++nValid )
+		{
+			CTestSheetSimulator sheet;
+			sheet.Init( w, w, w * w );
+			sheet.Randomize( s_flBenchValidFractions[nValid] );
+
+			double flBest[2] = { 1e30, 1e30 };
+			for ( int nRound = 0; nRound < BENCH_ROUNDS; ++nRound )
+			{
+				for ( int nReference = 0; nReference < 2; ++nReference )
+				{
+					double flStart = Plat_FloatTime();
+					for ( int i = 0; i < BENCH_PASSES; ++i )
+					{
+						if ( nReference )
+						{
+							sheet.ReferenceDetermineBestCollisionPlane( true );
+						}
+						else
+						{
+							sheet.DetermineBestCollisionPlane( true );
+						}
+					}
+					double flTime = Plat_FloatTime() - flStart;
+
+					flBest[nReference] = min( flBest[nReference], flTime * 1e6 / BENCH_PASSES );
+				}
+			}
+
+			char szSize[16];
+			sprintf( szSize, "%dx%d", w, w );
+			printf( "%-8s %7.0f%% %14.2f %14.2f\n", szSize, s_flBenchValidFractions[nValid] * 100.0f, flBest[1], flBest[0] );
+		}
+	}
+
+	return 0;
+}
+
+
+void Usage( void )
+{
+	printf( "Usage: sheetcheck [-bench]\n" );
+	exit( -1 );
+}
+
+int main( int argc, char **argv )
+{
+	MathLib_Init( 2.2f, 2.2f, 0.0f, 2.0f );
+	if( argc == 1 )
+	{
+		return CheckSheets();
+	}
+	if( stricmp( argv[1], "-bench" ) != 0 )
+	{
+		Usage();
+	}
+	return BenchSheets();
+}
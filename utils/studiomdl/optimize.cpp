@@ -262,6 +262,11 @@ public:
 private:
 	void CleanupEverything();
 
+	// -vtxcheck
+	void CheckVTXFile( studiohdr_t *phdr, s_bodypart_t *pSrcBodyParts, int vertCacheSize, 
+		bool usesFixedFunction, bool bForceSoftwareSkin, int maxBonesPerVert, int maxBonesPerTri, 
+		int maxBonesPerStrip, const char *fileName, const char *glViewFileName );
+
 	// Setup to get the ball rolling
 	void SetupMeshProcessing( studiohdr_t *phdr, int vertCacheSize,  
 			bool usesFixedFunction, int maxBonesPerVert, int maxBonesPerTri, 
@@ -1158,20 +1163,53 @@ int COptimizedModel::CountMaxVertBones( int count, Vertex_t *pVertex ) const
 // Adds a vertex to the list of vertices to be added to the strip group
 //-----------------------------------------------------------------------------
 
-static int FindOrCreateVertex( VertexList_t& list, Vertex_t const& vert )
+// vertexMap maps the original mesh vertex ID to its index in list, or -1 if
+// it hasn't been added yet, so we don't have to search the list every time.
+// -vtxcheck builds each file a second time with the linear search this used
+// to do and makes sure the output comes out the same.
+static bool s_bLinearVertexSearch = false;
+
+static int FindOrCreateVertex( VertexList_t& list, CUtlVector<int>& vertexMap, Vertex_t const& vert )
 {
-	int i;
-	for( i = 0; i < list.Size(); i++ )
+	if (s_bLinearVertexSearch)
 	{
-		if (list[i].origMeshVertID == vert.origMeshVertID)
+		int i;
+		for( i = 0; i < list.Size(); i++ )
 		{
-			// If this is the case, then everything else should be too!
-			assert( !memcmp( &list[i], &vert, sizeof( vert )) );
-			return i;
+			if (list[i].origMeshVertID == vert.origMeshVertID)
+			{
+				assert( !memcmp( &list[i], &vert, sizeof( vert )) );
+				return i;
+			}
 		}
+
+		return list.AddToTail( vert );
 	}
 
-	list.AddToTail( vert );
+	int origID = vert.origMeshVertID;
+	assert( origID >= 0 );
+
+	if (origID >= vertexMap.Size())
+	{
+		int oldSize = vertexMap.Size();
+		vertexMap.SetSize( origID + 1 );
+		for( int j = oldSize; j < vertexMap.Size(); j++ )
+		{
+			vertexMap[j] = -1;
+		}
+	}
+
+	int i = vertexMap[origID];
+	if (i >= 0)
+	{
+		// If this is the case, then everything else should be too!
+		assert( list[i].origMeshVertID == vert.origMeshVertID );
+		assert( !memcmp( &list[i], &vert, sizeof( vert )) );
+		return i;
+	}
+
+	i = list.AddToTail( vert );
+	vertexMap[origID] = i;
 	return i;
 }
 
@@ -1287,6 +1325,14 @@ void COptimizedModel::ProcessStripGroup( StripGroup_t *pStripGroup, bool isHWSki
 	TriangleList_t	stripGroupSourceTriangles;
 	VertexList_t	stripGroupVertices;
 
+	// Where each mesh vertex ended up in stripGroupVertices
+	CUtlVector<int>	stripGroupVertexMap;
+	stripGroupVertexMap.SetSize( pStudioMesh->numvertices );
+	for( int v = 0; v < stripGroupVertexMap.Size(); ++v )
+	{
+		stripGroupVertexMap[v] = -1;
+	}
+
 	// FIXME: Flexed/HWSkinned state of faces don't change with each pass.
 	// We could precompute those flags just once (instead of doing it 4 times)
 
@@ -1339,9 +1385,9 @@ void COptimizedModel::ProcessStripGroup( StripGroup_t *pStripGroup, bool isHWSki
 
 		Triangle_t& newTri = stripGroupSourceTriangles[triIndex];
 		newTri.touched = false;
-		newTri.vertID[0] = FindOrCreateVertex( stripGroupVertices, stripGroupVert[0] );
-		newTri.vertID[1] = FindOrCreateVertex( stripGroupVertices, stripGroupVert[1] );
-		newTri.vertID[2] = FindOrCreateVertex( stripGroupVertices, stripGroupVert[2] );
+		newTri.vertID[0] = FindOrCreateVertex( stripGroupVertices, stripGroupVertexMap, stripGroupVert[0] );
+		newTri.vertID[1] = FindOrCreateVertex( stripGroupVertices, stripGroupVertexMap, stripGroupVert[1] );
+		newTri.vertID[2] = FindOrCreateVertex( stripGroupVertices, stripGroupVertexMap, stripGroupVert[2] );
 		BuildTriangleBoneData( stripGroupVertices, newTri );
 
 		// By default, this processes a triangle
@@ -2855,9 +2901,53 @@ bool COptimizedModel::OptimizeFromStudioHdr( studiohdr_t *pHdr, s_bodypart_t *pS
 	
 	CleanupEverything();
 
+	if( g_bCheckVTX && !s_bLinearVertexSearch )
+	{
+		CheckVTXFile( pHdr, pSrcBodyParts, vertCacheSize, usesFixedFunction, bForceSoftwareSkin,
+			maxBonesPerVert, maxBonesPerTri, maxBonesPerStrip, pFileName, glViewFileName );
+	}
+
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Builds the file again with the linear strip group vertex search and errors
+// out unless both come out byte for byte the same
+//-----------------------------------------------------------------------------
+void COptimizedModel::CheckVTXFile( studiohdr_t *pHdr, s_bodypart_t *pSrcBodyParts, 
+		int vertCacheSize, 
+		bool usesFixedFunction, bool bForceSoftwareSkin, int maxBonesPerVert, int maxBonesPerTri, 
+		int maxBonesPerStrip, const char *pFileName, const char *glViewFileName )
+{
+	char checkFileName[260];
+	strcpy( checkFileName, pFileName );
+	strcat( checkFileName, ".check" );
+
+	s_bLinearVertexSearch = true;
+	OptimizeFromStudioHdr( pHdr, pSrcBodyParts, vertCacheSize, usesFixedFunction, bForceSoftwareSkin,
+		maxBonesPerVert, maxBonesPerTri, maxBonesPerStrip, checkFileName, glViewFileName );
+	s_bLinearVertexSearch = false;
+
+	void *pFile = NULL;
+	void *pCheckFile = NULL;
+	int nSize = LoadFile( (char *)pFileName, &pFile );
+	int nCheckSize = LoadFile( checkFileName, &pCheckFile );
+	bool bSame = ( nSize == nCheckSize ) && !memcmp( pFile, pCheckFile, nSize );
+	free( pFile );
+	free( pCheckFile );
+	remove( checkFileName );
+
+	if( !bSame )
+	{
+		MdlError( "%s differs from the output of the linear vertex search (%d vs. %d bytes)\n", pFileName, nSize, nCheckSize );
+	}
+
+	if( !g_quiet )
+	{
+		printf( "%s matches the linear vertex search\n", pFileName );
+	}
+}
+
 
 static int numGLViewTrangles = 0;
 static int numGLViewSWDegenerates = 0;
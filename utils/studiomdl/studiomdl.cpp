@@ -53,6 +53,7 @@ bool g_bCreateMakefile = false;
 bool g_bHasModelName = false;
 bool g_bZBrush = false;
 bool g_bVerifyOnly = false;
+bool g_bCheckVTX = false;
 bool g_bUseBoneInBBox = true;
 bool g_bLockBoneLengths = false;
 bool g_bOverridePreDefinedBones = true;
@@ -6209,7 +6210,7 @@ bool HandlePrintSurfaceProps( int &returnValue )
 
 void UsageAndExit()
 {
-	MdlError( "usage: studiomdl [-game gamedir] [-t texture] -r(tag reversed) -n(tag bad normals) -f(flip all triangles) [-a normal_blend_angle] -h(dump hboxes) -i(ignore warnings) -d(dump glview files) [-quiet] [-fullcollide(don't truncate really big collisionmodels)] [-checklengths] [-printbones] [-perf] [-printgraph] [-definebones] file.qc");
+	MdlError( "usage: studiomdl [-game gamedir] [-t texture] -r(tag reversed) -n(tag bad normals) -f(flip all triangles) [-a normal_blend_angle] -h(dump hboxes) -i(ignore warnings) -d(dump glview files) [-quiet] [-fullcollide(don't truncate really big collisionmodels)] [-checklengths] [-printbones] [-perf] [-printgraph] [-definebones] [-vtxcheck] file.qc");
 }
 
 /*
@@ -6341,6 +6342,12 @@ int main (int argc, char **argv)
 				continue;
 			}
 
+			if (!stricmp(argv[i], "-vtxcheck"))
+			{
+				g_bCheckVTX = true;
+				continue;
+			}
+
 			if (argv[i][1] && argv[i][2] == '\0')
 			{
 				switch( argv[i][1] )
@@ -1284,6 +1284,7 @@ extern bool g_bMultistageGraph;
 extern bool g_bCreateMakefile;
 extern bool g_bZBrush;
 extern bool g_bVerifyOnly;
+extern bool g_bCheckVTX;
 extern bool g_bUseBoneInBBox;
 extern bool g_bLockBoneLengths;
 extern bool g_bOverridePreDefinedBones;
@@ -730,6 +730,70 @@ ChunkFileResult_t LoadDispDistancesCallback(CChunkFile *pFile, mapdispinfo_t *pM
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Finds the next space separated value in a displacement row. Splits
+//			the row the same way strtok( row, " " ) would, but works in place so
+//			the rows don't have to be copied first.
+// Input  : pszScan - where to start looking, moved past the value found
+// Output : the start of the value, or NULL if the row has no more
+//-----------------------------------------------------------------------------
+static const char *NextDispRowValue( const char *&pszScan )
+{
+	while (*pszScan == ' ')
+	{
+		pszScan++;
+	}
+
+	if (*pszScan == '\0')
+	{
+		return(NULL);
+	}
+
+	const char *pszValue = pszScan;
+	while ((*pszScan != '\0') && (*pszScan != ' '))
+	{
+		pszScan++;
+	}
+
+	return(pszValue);
+}
+
+
+static int s_nDispRowsChecked;
+
+//-----------------------------------------------------------------------------
+// Purpose: For -checkdisprows. Splits the row with strtok, the way the key
+//			callbacks did before they scanned rows in place, and errors out
+//			unless NextDispRowValue finds the same values at the same offsets.
+//			Every value is converted from the same characters either way, so
+//			the displacement data loaded comes out identical.
+//-----------------------------------------------------------------------------
+static void CheckDispRow(const char *szKey, const char *szValue)
+{
+	char szBuf[MAX_KEYVALUE_LEN];
+	strcpy(szBuf, szValue);
+
+	const char *pszScan = szValue;
+	const char *pszNext = NextDispRowValue(pszScan);
+	char *pszOld = strtok(szBuf, " ");
+	int nValue = 0;
+
+	while ((pszNext != NULL) || (pszOld != NULL))
+	{
+		if ((pszNext == NULL) || (pszOld == NULL) || (pszNext - szValue != pszOld - szBuf))
+		{
+			Error("Displacement %s is split differently from strtok at value %d: \"%s\"\n", szKey, nValue, szValue);
+		}
+
+		pszNext = NextDispRowValue(pszScan);
+		pszOld = strtok(NULL, " ");
+		nValue++;
+	}
+
+	s_nDispRowsChecked++;
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 // Input  : szKey - 
@@ -741,19 +805,22 @@ ChunkFileResult_t LoadDispDistancesKeyCallback(const char *szKey, const char *sz
 {
 	if (!strnicmp(szKey, "row", 3))
 	{
-		char szBuf[MAX_KEYVALUE_LEN];
-		strcpy(szBuf, szValue);
+		if (g_bCheckDispRows)
+		{
+			CheckDispRow(szKey, szValue);
+		}
 
 		int nCols = (1 << pMapDispInfo->power) + 1;
 		int nRow = atoi(&szKey[3]);
 
-		char *pszNext = strtok(szBuf, " ");
+		const char *pszScan = szValue;
+		const char *pszNext = NextDispRowValue(pszScan);
 		int nIndex = nRow * nCols;
 
 		while (pszNext != NULL)
 		{
 			pMapDispInfo->dispDists[nIndex] = (float)atof(pszNext);
-			pszNext = strtok(NULL, " ");
+			pszNext = NextDispRowValue(pszScan);
 			nIndex++;
 		}
 	}
@@ -875,15 +942,18 @@ ChunkFileResult_t LoadDispNormalsKeyCallback(const char *szKey, const char *szVa
 {
 	if (!strnicmp(szKey, "row", 3))
 	{
-		char szBuf[MAX_KEYVALUE_LEN];
-		strcpy(szBuf, szValue);
+		if (g_bCheckDispRows)
+		{
+			CheckDispRow(szKey, szValue);
+		}
 
 		int nCols = (1 << pMapDispInfo->power) + 1;
 		int nRow = atoi(&szKey[3]);
 
-		char *pszNext0 = strtok(szBuf, " ");
-		char *pszNext1 = strtok(NULL, " ");
-		char *pszNext2 = strtok(NULL, " ");
+		const char *pszScan = szValue;
+		const char *pszNext0 = NextDispRowValue(pszScan);
+		const char *pszNext1 = NextDispRowValue(pszScan);
+		const char *pszNext2 = NextDispRowValue(pszScan);
 
 		int nIndex = nRow * nCols;
 
@@ -893,9 +963,9 @@ ChunkFileResult_t LoadDispNormalsKeyCallback(const char *szKey, const char *szVa
 			pMapDispInfo->vectorDisps[nIndex][1] = (float)atof(pszNext1);
 			pMapDispInfo->vectorDisps[nIndex][2] = (float)atof(pszNext2);
 
-			pszNext0 = strtok(NULL, " ");
-			pszNext1 = strtok(NULL, " ");
-			pszNext2 = strtok(NULL, " ");
+			pszNext0 = NextDispRowValue(pszScan);
+			pszNext1 = NextDispRowValue(pszScan);
+			pszNext2 = NextDispRowValue(pszScan);
 
 			nIndex++;
 		}
@@ -929,15 +999,18 @@ ChunkFileResult_t LoadDispOffsetsKeyCallback(const char *szKey, const char *szVa
 {
 	if (!strnicmp(szKey, "row", 3))
 	{
-		char szBuf[MAX_KEYVALUE_LEN];
-		strcpy(szBuf, szValue);
+		if (g_bCheckDispRows)
+		{
+			CheckDispRow(szKey, szValue);
+		}
 
 		int nCols = (1 << pMapDispInfo->power) + 1;
 		int nRow = atoi(&szKey[3]);
 
-		char *pszNext0 = strtok(szBuf, " ");
-		char *pszNext1 = strtok(NULL, " ");
-		char *pszNext2 = strtok(NULL, " ");
+		const char *pszScan = szValue;
+		const char *pszNext0 = NextDispRowValue(pszScan);
+		const char *pszNext1 = NextDispRowValue(pszScan);
+		const char *pszNext2 = NextDispRowValue(pszScan);
 
 		int nIndex = nRow * nCols;
 
@@ -947,9 +1020,9 @@ ChunkFileResult_t LoadDispOffsetsKeyCallback(const char *szKey, const char *szVa
 			pMapDispInfo->vectorOffsets[nIndex][1] = (float)atof(pszNext1);
 			pMapDispInfo->vectorOffsets[nIndex][2] = (float)atof(pszNext2);
 
-			pszNext0 = strtok(NULL, " ");
-			pszNext1 = strtok(NULL, " ");
-			pszNext2 = strtok(NULL, " ");
+			pszNext0 = NextDispRowValue(pszScan);
+			pszNext1 = NextDispRowValue(pszScan);
+			pszNext2 = NextDispRowValue(pszScan);
 
 			nIndex++;
 		}
@@ -983,20 +1056,23 @@ ChunkFileResult_t LoadDispAlphasKeyCallback(const char *szKey, const char *szVal
 {
 	if (!strnicmp(szKey, "row", 3))
 	{
-		char szBuf[MAX_KEYVALUE_LEN];
-		strcpy(szBuf, szValue);
+		if (g_bCheckDispRows)
+		{
+			CheckDispRow(szKey, szValue);
+		}
 
 		int nCols = (1 << pMapDispInfo->power) + 1;
 		int nRow = atoi(&szKey[3]);
 
-		char *pszNext0 = strtok(szBuf, " ");
+		const char *pszScan = szValue;
+		const char *pszNext0 = NextDispRowValue(pszScan);
 
 		int nIndex = nRow * nCols;
 
 		while (pszNext0 != NULL)
 		{
 			pMapDispInfo->alphaValues[nIndex] = (float)atof(pszNext0);
-			pszNext0 = strtok(NULL, " ");
+			pszNext0 = NextDispRowValue(pszScan);
 			nIndex++;
 		}
 	}
@@ -1017,13 +1093,16 @@ ChunkFileResult_t LoadDispTriangleTagsKeyCallback(const char *szKey, const char
 {
 	if ( !strnicmp( szKey, "row", 3 ) )
 	{
-		char szBuf[MAX_KEYVALUE_LEN];
-		strcpy( szBuf, szValue );
+		if ( g_bCheckDispRows )
+		{
+			CheckDispRow( szKey, szValue );
+		}
 
 		int nCols = ( 1 << pMapDispInfo->power );
 		int nRow = atoi( &szKey[3] );
 
-		char *pszNext = strtok( szBuf, " " );
+		const char *pszScan = szValue;
+		const char *pszNext = NextDispRowValue( pszScan );
 
 		int nIndex = nRow * nCols;
 		int iTri = nIndex * 2;
@@ -1059,7 +1138,7 @@ ChunkFileResult_t LoadDispTriangleTagsKeyCallback(const char *szKey, const char
 			}
 
 			pMapDispInfo->triTags[iTri] = nTriTags;
-			pszNext = strtok( NULL, " " );
+			pszNext = NextDispRowValue( pszScan );
 			iTri++;
 		}
 	}
@@ -1470,6 +1549,7 @@ void LoadMapFile(const char *pszFileName)
 
 		// reset the displacement info count
 		nummapdispinfo = 0;
+		s_nDispRowsChecked = 0;
 
 		//
 		// Set up handlers for the subchunks that we are interested in.
@@ -1518,6 +1598,10 @@ void LoadMapFile(const char *pszFileName)
 		qprintf ("%5i entities\n", num_entities);
 		qprintf ("%5i planes\n", nummapplanes);
 		qprintf ("%5i areaportals\n", c_areaportals);
+		if (g_bCheckDispRows)
+		{
+			Msg("%5i displacement rows checked\n", s_nDispRowsChecked);
+		}
 		qprintf ("size: %5.0f,%5.0f,%5.0f to %5.0f,%5.0f,%5.0f\n", map_mins[0],map_mins[1],map_mins[2],
 			map_maxs[0],map_maxs[1],map_maxs[2]);
 
@@ -49,6 +49,7 @@ bool		g_bLightIfMissing = false;
 bool		g_snapAxialPlanes = false;
 bool		g_writelinuxphysics = false;
 bool		g_bKeepStaleZip = false;
+bool		g_bCheckDispRows = false;
 
 float		g_defaultLuxelSize = DEFAULT_LUXEL_SIZE;
 float		g_luxelScale = 1.0f;
@@ -1002,6 +1003,11 @@ int main (int argc, char **argv)
 			Msg("Dumping static props to staticpropXXX.txt\n" );
 			g_DumpStaticProps = true;
 		}
+		else if ( !stricmp( argv[i], "-checkdisprows" ) )
+		{
+			Msg("Checking displacement rows against strtok\n" );
+			g_bCheckDispRows = true;
+		}
 		else if (!stricmp (argv[i],"-tmpout"))
 		{
 			strcpy (outbase, "/tmp");
@@ -1123,6 +1129,8 @@ int main (int argc, char **argv)
 				"  -blocks # # # # : Enter the mins and maxs for the grid size vbsp uses.\n"
 				"  -dumpstaticprops: Dump static props to staticprop*.txt\n"
 				"  -dumpcollide    : Write files with collision info.\n"
+				"  -checkdisprows  : Make sure the displacement rows in the .vmf are split\n"
+				"                    the same way strtok used to split them.\n"
 				"  -luxelscale #   : Scale all lightmaps by this amount (default: 1.0).\n"
 				"  -lightifmissing : Force lightmaps to be generated for all surfaces even if\n"
 				"                    they don't need lightmaps.\n"
@@ -260,6 +260,7 @@ extern	qboolean	noopt;
 extern  qboolean	dumpcollide;
 extern	qboolean	nodetailcuts;
 extern  qboolean	g_DumpStaticProps;
+extern	bool		g_bCheckDispRows;
 extern	vec_t		microvolume;
 extern	bool		g_snapAxialPlanes;
 extern	bool		g_writelinuxphysics;
@@ -170,9 +170,23 @@ void UnSerializeFace( MessageBuffer * pmb, int facenum )
 }
 
 
+// Which faces the master has already received and run BuildPatchLights on.
+static CUtlVector<bool> g_FaceResultsReceived;
+
 void MPI_ReceiveFaceResults( int iWorkUnit, MessageBuffer *pBuf, int iWorker )
 {
+	// If a work unit got handed out twice, keep the first result. BuildPatchLights
+	// has already been applied to it and can't be applied again.
+	if ( g_FaceResultsReceived[iWorkUnit] )
+		return;
+
 	UnSerializeFace( pBuf, iWorkUnit );
+
+	// BuildPatchLights is normally called from BuildFacelights(), but in MPI mode
+	// the master does it. It only touches this face's samples and patches, so do
+	// it now while the workers are still busy instead of all at the end.
+	BuildPatchLights( iWorkUnit );
+	g_FaceResultsReceived[iWorkUnit] = true;
 }
 
 
@@ -201,6 +215,13 @@ void RunMPIBuildFacelights()
     Msg( "%-20s ", "BuildFaceLights:" );
 	StartPacifier("");
 
+	if ( g_bMPIMaster )
+	{
+		g_FaceResultsReceived.SetSize( numfaces );
+		for ( int i=0; i < numfaces; ++i )
+			g_FaceResultsReceived[i] = false;
+	}
+
 	VMPI_SetCurrentStage( "RunMPIBuildFaceLights" );
 	double elapsed = DistributeWork( 
 		numfaces, 
@@ -213,17 +234,16 @@ void RunMPIBuildFacelights()
 
 	if ( g_bMPIMaster )
 	{
-		//
-		// BuildPatchLights is normally called from BuildFacelights(),
-		// but in MPI mode we have the master do the calculation
-		// We might be able to speed this up by doing while the master
-		// is idling in the above loop. Wouldn't want to slow down the
-		// handing out of work - maybe another thread?
-		//
+		// MPI_ReceiveFaceResults ran BuildPatchLights on each face as it came
+		// in, so this only picks up anything that didn't come back.
 		for ( int i=0; i < numfaces; ++i )
 		{
-			BuildPatchLights(i);
+			if ( !g_FaceResultsReceived[i] )
+			{
+				BuildPatchLights(i);
+			}
 		}
+		g_FaceResultsReceived.Purge();
 	}
 	else
 	{
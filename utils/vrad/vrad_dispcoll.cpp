@@ -193,7 +193,7 @@ void CVRADDispColl::BuildVNodes( void )
 	for ( int iNode = iStart; iNode < iEnd; ++iNode )
 	{
 		// Get the current node
-		CDispCollAABBNode *pNode = &m_aNodes[iNode];
+		const CDispCollAABBNode *pNode = &Nodes_GetLeaf( iNode );
 		VNode_t *pVNode = &m_aVNodes[iNode];
 
 		if ( !pNode )
@@ -69,6 +69,7 @@ private:
 	// For raycasting against props
 	void InsertPropIntoTree( int propIndex );
 	void RemovePropFromTree( int propIndex );
+	void BuildLeafPropBounds();
 
 	// Creates a collision model
 	void CreateCollisionModel( char const* pModelName );
@@ -101,11 +102,23 @@ private:
 		Ray_t const* m_pRay;
 	};
 
+	// Tests a ray against the props in a leaf, returns false on a hit
+	bool TestPropsInLeaf( int leaf, EnumContext_t *pCtx );
+
 	// The list of all static props
 	CUtlVector <StaticPropDict_t>	m_StaticPropDict;
 	CUtlVector <CStaticProp>		m_StaticProps;
 
 	IBSPTreeData*	m_pBSPTreeData;
+
+	// The props in each leaf, in the order the tree enumerates them, with
+	// their bounds as structure-of-arrays so a ray can be tested against all
+	// of them with one batched query. Leaf i owns entries 
+	// [m_LeafPropStart[i], m_LeafPropStart[i+1]).
+	CUtlVector<int>		m_LeafPropStart;
+	CUtlVector<int>		m_LeafProps;
+	CUtlVector<float>	m_LeafPropMins[3];
+	CUtlVector<float>	m_LeafPropMaxs[3];
 };
 
 
@@ -545,6 +558,8 @@ void CVradStaticPropMgr::Init()
 
 	// Read in static props that have been compiled into the bsp file
 	UnserializeStaticProps();
+
+	BuildLeafPropBounds();
 }
 
 void CVradStaticPropMgr::Shutdown()
@@ -557,12 +572,20 @@ void CVradStaticPropMgr::Shutdown()
 
 	m_pBSPTreeData->Shutdown();
 
+	m_LeafPropStart.Purge();
+	m_LeafProps.Purge();
+	for ( int iAxis = 0; iAxis < 3; ++iAxis )
+	{
+		m_LeafPropMins[iAxis].Purge();
+		m_LeafPropMaxs[iAxis].Purge();
+	}
+
 	m_StaticProps.Purge();
 	m_StaticPropDict.Purge();
 }
 
 //-----------------------------------------------------------------------------
-// Do the collision test
+// Copies the bounds of the props in each leaf into structure-of-arrays form
 //-----------------------------------------------------------------------------
 
 // IBSPTreeDataEnumerator
@@ -570,35 +593,88 @@ bool FASTCALL CVradStaticPropMgr::EnumerateElement( int userId, int context )
 {
 	CStaticProp& prop = m_StaticProps[userId];
 
-	EnumContext_t* pCtx = (EnumContext_t*)context;
+	m_LeafProps.AddToTail( userId );
+	for ( int iAxis = 0; iAxis < 3; ++iAxis )
+	{
+		m_LeafPropMins[iAxis].AddToTail( prop.m_mins[iAxis] );
+		m_LeafPropMaxs[iAxis].AddToTail( prop.m_maxs[iAxis] );
+	}
+	return true;
+}
 
-	// Don't test twice
-	if (pCtx->m_pPropTested->m_pTested[ userId ] == pCtx->m_pPropTested->m_Enum )
-		return true;
+void CVradStaticPropMgr::BuildLeafPropBounds()
+{
+	int nLeafCount = ToolBSPTree()->LeafCount();
+	m_LeafPropStart.SetSize( nLeafCount + 1 );
+	for ( int leaf = 0; leaf < nLeafCount; ++leaf )
+	{
+		m_LeafPropStart[leaf] = m_LeafProps.Count();
+		m_pBSPTreeData->EnumerateElementsInLeaf( leaf, this, 0 );
+	}
+	m_LeafPropStart[nLeafCount] = m_LeafProps.Count();
+}
 
-	pCtx->m_pPropTested->m_pTested[ userId ] = pCtx->m_pPropTested->m_Enum;
 
-	StaticPropDict_t& dict = m_StaticPropDict[prop.m_ModelIdx];
-	
-	if ( !IsBoxIntersectingRay( prop.m_mins, prop.m_maxs, pCtx->m_pRay->m_Start, pCtx->m_pRay->m_Delta ) )
-		return true;
+//-----------------------------------------------------------------------------
+// Do the collision test
+//-----------------------------------------------------------------------------
+bool CVradStaticPropMgr::TestPropsInLeaf( int leaf, EnumContext_t *pCtx )
+{
+	int nFirst = m_LeafPropStart[leaf];
+	int nCount = m_LeafPropStart[leaf+1] - nFirst;
+	PropTested_t *pPropTested = pCtx->m_pPropTested;
 
-	// If there is an invalid model file, it has a null entry here.
-	if( !dict.m_pModel )
-		return false;
+	CollisionAABBArray_t boxes;
+	for ( int nBase = 0; nBase < nCount; nBase += 32 )
+	{
+		// Test the bounds of up to 32 props at once
+		for ( int iAxis = 0; iAxis < 3; ++iAxis )
+		{
+			boxes.m_pMins[iAxis] = m_LeafPropMins[iAxis].Base() + nFirst + nBase;
+			boxes.m_pMaxs[iAxis] = m_LeafPropMaxs[iAxis].Base() + nFirst + nBase;
+		}
+		boxes.m_nCount = min( 32, nCount - nBase );
+
+		uint32 nHitMask;
+		IsBoxIntersectingRayBatch( boxes, pCtx->m_pRay->m_Start, pCtx->m_pRay->m_Delta, 0.0f, &nHitMask );
+
+		for ( int i = 0; i < boxes.m_nCount; ++i )
+		{
+			int nProp = m_LeafProps[nFirst + nBase + i];
 
-	CGameTrace trace;
-	pCtx->m_pPropTested->pThreadedCollision->TraceBox( *pCtx->m_pRay, dict.m_pModel, prop.m_Origin, prop.m_Angles, &trace );
+			// Don't test twice
+			if ( pPropTested->m_pTested[ nProp ] == pPropTested->m_Enum )
+				continue;
 
-	// False means stop iterating. Return false if we hit!
-	return (trace.fraction == 1.0);
+			pPropTested->m_pTested[ nProp ] = pPropTested->m_Enum;
+
+			if ( !IsCollisionBatchBitSet( &nHitMask, i ) )
+				continue;
+
+			CStaticProp& prop = m_StaticProps[nProp];
+			StaticPropDict_t& dict = m_StaticPropDict[prop.m_ModelIdx];
+
+			// If there is an invalid model file, it has a null entry here.
+			if( !dict.m_pModel )
+				return false;
+
+			CGameTrace trace;
+			pPropTested->pThreadedCollision->TraceBox( *pCtx->m_pRay, dict.m_pModel, prop.m_Origin, prop.m_Angles, &trace );
+
+			// Return false if we hit!
+			if ( trace.fraction != 1.0 )
+				return false;
+		}
+	}
+
+	return true;
 }
 
 
 // ISpatialLeafEnumerator
 bool CVradStaticPropMgr::EnumerateLeaf( int leaf, int context )
 {
-	return m_pBSPTreeData->EnumerateElementsInLeaf( leaf, this, context );
+	return TestPropsInLeaf( leaf, (EnumContext_t*)context );
 }
 
 bool CVradStaticPropMgr::ClipRayToStaticProps( PropTested_t& propTested, Ray_t const& ray )
@@ -619,7 +695,7 @@ bool CVradStaticPropMgr::ClipRayToStaticPropsInLeaf( PropTested_t& propTested, R
 	ctx.m_pRay = &ray;
 	ctx.m_pPropTested = &propTested;
 
-	return !m_pBSPTreeData->EnumerateElementsInLeaf( leaf, this, (int)&ctx );
+	return !TestPropsInLeaf( leaf, &ctx );
 }
 
 void CVradStaticPropMgr::StartRayTest( PropTested_t& propTested )